@@ -0,0 +1,83 @@
+#include "calibration_registry.h"
+#include <stdexcept>
+
+namespace speedflow {
+
+void CalibrationRegistry::add(CameraCalibration calibration) {
+    if (calibration.source_points.size() != 4 || calibration.target_points.size() != 4) {
+        throw std::invalid_argument("Calibration for source " +
+                                    std::to_string(calibration.source_id) +
+                                    " requires exactly 4 source and 4 target points");
+    }
+    if (calibrations_.count(calibration.source_id)) {
+        throw std::invalid_argument("Duplicate calibration for source " +
+                                    std::to_string(calibration.source_id) +
+                                    " (" + calibration.path + ")");
+    }
+    
+    int source_id = calibration.source_id;
+    calibrations_[source_id] = std::make_shared<const CameraCalibration>(std::move(calibration));
+}
+
+bool CalibrationRegistry::remove(int source_id) {
+    if (!calibrations_.erase(source_id)) {
+        return false;
+    }
+    
+    for (auto it = transformers_.begin(); it != transformers_.end();) {
+        if (static_cast<int>(static_cast<uint32_t>(it->first >> 32)) == source_id) {
+            it = transformers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
+
+void CalibrationRegistry::prepare(int muxer_width, int muxer_height) {
+    for (const auto& entry : calibrations_) {
+        const CameraCalibration& calib = *entry.second;
+        uint64_t key = makeKey(calib.source_id, muxer_width, muxer_height);
+        if (transformers_.count(key)) {
+            continue;
+        }
+        
+        float scale_x = static_cast<float>(muxer_width) / calib.config_width;
+        float scale_y = static_cast<float>(muxer_height) / calib.config_height;
+        
+        std::vector<cv::Point2f> scaled = calib.source_points;
+        for (auto& pt : scaled) {
+            pt.x *= scale_x;
+            pt.y *= scale_y;
+        }
+        
+        transformers_[key] = std::make_shared<const ViewTransformer>(scaled, calib.target_points);
+    }
+}
+
+const ViewTransformer* CalibrationRegistry::transformer(int source_id,
+                                                       int muxer_width,
+                                                       int muxer_height) const {
+    auto it = transformers_.find(makeKey(source_id, muxer_width, muxer_height));
+    if (it != transformers_.end()) {
+        return it->second.get();
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const CameraCalibration> CalibrationRegistry::calibration(int source_id) const {
+    auto it = calibrations_.find(source_id);
+    if (it != calibrations_.end()) {
+        return it->second;
+    }
+    return nullptr;
+}
+
+uint64_t CalibrationRegistry::makeKey(int source_id, int width, int height) {
+    // 16 bits per dimension is plenty for any muxer resolution
+    return (static_cast<uint64_t>(static_cast<uint32_t>(source_id)) << 32) |
+           (static_cast<uint64_t>(width & 0xFFFF) << 16) |
+           static_cast<uint64_t>(height & 0xFFFF);
+}
+
+} // namespace speedflow
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "homography.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace speedflow {
+
+/**
+ * Homography calibration of a single camera, in the resolution it was
+ * measured at (points are NOT scaled to the muxer resolution)
+ */
+struct CameraCalibration {
+    int source_id = 0;
+    std::string path;                        // File the calibration came from
+    std::vector<cv::Point2f> source_points;  // Image points at config resolution
+    std::vector<cv::Point2f> target_points;  // World points in meters
+    int config_width = 1280;                 // Resolution the points were picked at
+    int config_height = 720;
+};
+
+/**
+ * CalibrationRegistry - Per-camera calibrations shared by all streams
+ *
+ * Filled once at startup, then prepared for every muxer resolution in use.
+ * Sources attached at runtime get a modified copy instead. After prepare()
+ * the registry is treated as immutable: hand it out as
+ * std::shared_ptr<const CalibrationRegistry> and look transformers up from
+ * any thread without locking. Lookups are a single hash probe.
+ */
+class CalibrationRegistry {
+public:
+    /**
+     * Add a camera calibration (build phase only)
+     * @param calibration Calibration for calibration.source_id
+     * @throws std::invalid_argument on duplicate source id or bad point count
+     */
+    void add(CameraCalibration calibration);
+    
+    /**
+     * Drop a camera and its prepared transformers (build phase only)
+     * Runtime changes go to a copy that replaces the shared registry.
+     * @param source_id Stream source id
+     * @return true if the camera was known
+     */
+    bool remove(int source_id);
+    
+    /**
+     * Precompute a ViewTransformer for every camera at the given resolution
+     * @param muxer_width Frame width the points will be looked up at
+     * @param muxer_height Frame height the points will be looked up at
+     */
+    void prepare(int muxer_width, int muxer_height);
+    
+    /**
+     * Get the precomputed transformer for a camera
+     * @param source_id Stream source id (NvDsFrameMeta::source_id)
+     * @param muxer_width Frame width passed to prepare()
+     * @param muxer_height Frame height passed to prepare()
+     * @return Transformer owned by the registry (valid for its lifetime),
+     *         or nullptr if the camera/resolution is unknown
+     */
+    const ViewTransformer* transformer(int source_id,
+                                       int muxer_width,
+                                       int muxer_height) const;
+    
+    /**
+     * Get the raw calibration of a camera
+     * @param source_id Stream source id
+     * @return Calibration, or nullptr if the camera is unknown
+     */
+    std::shared_ptr<const CameraCalibration> calibration(int source_id) const;
+    
+    size_t size() const { return calibrations_.size(); }
+
+private:
+    std::unordered_map<int, std::shared_ptr<const CameraCalibration>> calibrations_;
+    
+    // (source_id, width, height) -> transformer with scaled source points
+    std::unordered_map<uint64_t, std::shared_ptr<const ViewTransformer>> transformers_;
+    
+    static uint64_t makeKey(int source_id, int width, int height);
+};
+
+} // namespace speedflow
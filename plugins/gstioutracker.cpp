@@ -0,0 +1,283 @@
+// gstioutracker.cpp - CPU tracker element, low-power alternative to nvtracker
+// Assigns object_id to the NvDsObjectMeta of every frame with IouTracker
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include "gstnvdsmeta.h"
+#include "gst-nvevent.h"
+#include "nvdsmeta.h"
+
+#include "iou_tracker.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+GST_DEBUG_CATEGORY_STATIC(gst_ioutracker_debug);
+#define GST_CAT_DEFAULT gst_ioutracker_debug
+
+#define GST_TYPE_IOUTRACKER (gst_ioutracker_get_type())
+#define GST_IOUTRACKER(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_IOUTRACKER, GstIouTracker))
+
+typedef struct _GstIouTracker GstIouTracker;
+typedef struct _GstIouTrackerClass GstIouTrackerClass;
+
+struct _GstIouTracker {
+    GstBaseTransform parent;
+    
+    // Tracker is rebuilt on start() so property changes take effect
+    std::unique_ptr<speedflow::IouTracker> tracker;
+    std::vector<speedflow::TrackerBox> boxes;
+    std::vector<NvDsObjectMeta*> objects;
+    std::vector<uint64_t> ids;
+    
+    // Configuration
+    gboolean hungarian;
+    gfloat min_iou;
+    gfloat max_center_dist;
+    gint max_age;
+};
+
+struct _GstIouTrackerClass {
+    GstBaseTransformClass parent_class;
+};
+
+GType gst_ioutracker_get_type(void);
+
+// Properties
+enum {
+    PROP_0,
+    PROP_MATCHING,
+    PROP_MIN_IOU,
+    PROP_MAX_CENTER_DIST,
+    PROP_MAX_AGE
+};
+
+// Function declarations
+static void gst_ioutracker_set_property(GObject* object, guint prop_id,
+                                        const GValue* value, GParamSpec* pspec);
+static void gst_ioutracker_get_property(GObject* object, guint prop_id,
+                                        GValue* value, GParamSpec* pspec);
+static gboolean gst_ioutracker_start(GstBaseTransform* trans);
+static GstFlowReturn gst_ioutracker_transform_ip(GstBaseTransform* trans,
+                                                 GstBuffer* buf);
+static gboolean gst_ioutracker_sink_event(GstBaseTransform* trans, GstEvent* event);
+static void gst_ioutracker_finalize(GObject* object);
+
+// GStreamer boilerplate
+#define gst_ioutracker_parent_class parent_class
+G_DEFINE_TYPE(GstIouTracker, gst_ioutracker, GST_TYPE_BASE_TRANSFORM);
+
+// Pad templates
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE(
+    "sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY
+);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE(
+    "src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY
+);
+
+static void gst_ioutracker_class_init(GstIouTrackerClass* klass) {
+    GObjectClass* gobject_class = G_OBJECT_CLASS(klass);
+    GstElementClass* element_class = GST_ELEMENT_CLASS(klass);
+    GstBaseTransformClass* transform_class = GST_BASE_TRANSFORM_CLASS(klass);
+    
+    gobject_class->set_property = gst_ioutracker_set_property;
+    gobject_class->get_property = gst_ioutracker_get_property;
+    gobject_class->finalize = gst_ioutracker_finalize;
+    
+    transform_class->start = GST_DEBUG_FUNCPTR(gst_ioutracker_start);
+    transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_ioutracker_transform_ip);
+    transform_class->sink_event = GST_DEBUG_FUNCPTR(gst_ioutracker_sink_event);
+    
+    // Add pad templates
+    gst_element_class_add_static_pad_template(element_class, &sink_template);
+    gst_element_class_add_static_pad_template(element_class, &src_template);
+    
+    // Properties
+    g_object_class_install_property(gobject_class, PROP_MATCHING,
+        g_param_spec_string("matching", "Matching",
+            "Assignment of detections to tracks: greedy or hungarian", "greedy",
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_MIN_IOU,
+        g_param_spec_float("min-iou", "Min IoU",
+            "Weakest overlap with the predicted box accepted as the same vehicle",
+            0.0f, 1.0f, 0.3f,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_MAX_CENTER_DIST,
+        g_param_spec_float("max-center-dist", "Max Center Distance",
+            "Fallback match by center distance, in box sizes (0 = off)",
+            0.0f, 10.0f, 0.5f,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_MAX_AGE,
+        g_param_spec_int("max-age", "Max Age",
+            "Frames a track is kept without a detection", 0, 100000, 30,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    gst_element_class_set_static_metadata(element_class,
+        "IoU Tracker",
+        "Filter/Metadata",
+        "Assigns track ids to detections by IoU with constant-velocity predictions (CPU)",
+        "SpeedFlow Team");
+    
+    GST_DEBUG_CATEGORY_INIT(gst_ioutracker_debug, "ioutracker", 0,
+        "CPU IoU tracker plugin");
+}
+
+static void gst_ioutracker_init(GstIouTracker* ioutracker) {
+    new (&ioutracker->tracker) std::unique_ptr<speedflow::IouTracker>();
+    new (&ioutracker->boxes) std::vector<speedflow::TrackerBox>();
+    new (&ioutracker->objects) std::vector<NvDsObjectMeta*>();
+    new (&ioutracker->ids) std::vector<uint64_t>();
+    ioutracker->hungarian = FALSE;
+    ioutracker->min_iou = 0.3f;
+    ioutracker->max_center_dist = 0.5f;
+    ioutracker->max_age = 30;
+    
+    // Metadata only, video data is untouched
+    gst_base_transform_set_passthrough(GST_BASE_TRANSFORM(ioutracker), TRUE);
+    gst_base_transform_set_in_place(GST_BASE_TRANSFORM(ioutracker), TRUE);
+}
+
+static void gst_ioutracker_set_property(GObject* object, guint prop_id,
+                                        const GValue* value, GParamSpec* pspec) {
+    GstIouTracker* ioutracker = GST_IOUTRACKER(object);
+    
+    switch (prop_id) {
+        case PROP_MATCHING: {
+            const gchar* matching = g_value_get_string(value);
+            ioutracker->hungarian = matching && strcmp(matching, "hungarian") == 0;
+            break;
+        }
+        case PROP_MIN_IOU:
+            ioutracker->min_iou = g_value_get_float(value);
+            break;
+        case PROP_MAX_CENTER_DIST:
+            ioutracker->max_center_dist = g_value_get_float(value);
+            break;
+        case PROP_MAX_AGE:
+            ioutracker->max_age = g_value_get_int(value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            break;
+    }
+}
+
+static void gst_ioutracker_get_property(GObject* object, guint prop_id,
+                                        GValue* value, GParamSpec* pspec) {
+    GstIouTracker* ioutracker = GST_IOUTRACKER(object);
+    
+    switch (prop_id) {
+        case PROP_MATCHING:
+            g_value_set_string(value, ioutracker->hungarian ? "hungarian" : "greedy");
+            break;
+        case PROP_MIN_IOU:
+            g_value_set_float(value, ioutracker->min_iou);
+            break;
+        case PROP_MAX_CENTER_DIST:
+            g_value_set_float(value, ioutracker->max_center_dist);
+            break;
+        case PROP_MAX_AGE:
+            g_value_set_int(value, ioutracker->max_age);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            break;
+    }
+}
+
+static gboolean gst_ioutracker_start(GstBaseTransform* trans) {
+    GstIouTracker* ioutracker = GST_IOUTRACKER(trans);
+    
+    speedflow::IouTrackerConfig config;
+    config.matching = ioutracker->hungarian ? speedflow::TrackerMatching::Hungarian
+                                            : speedflow::TrackerMatching::Greedy;
+    config.min_iou = ioutracker->min_iou;
+    config.max_center_dist = ioutracker->max_center_dist;
+    config.max_age_frames = ioutracker->max_age;
+    
+    ioutracker->tracker = std::make_unique<speedflow::IouTracker>(config);
+    
+    GST_INFO_OBJECT(ioutracker, "%s matching, min IoU %.2f, max age %d frames",
+                    ioutracker->hungarian ? "Hungarian" : "Greedy",
+                    config.min_iou, config.max_age_frames);
+    return TRUE;
+}
+
+static GstFlowReturn gst_ioutracker_transform_ip(GstBaseTransform* trans,
+                                                 GstBuffer* buf) {
+    GstIouTracker* ioutracker = GST_IOUTRACKER(trans);
+    
+    NvDsBatchMeta* batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    if (!batch_meta) {
+        return GST_FLOW_OK;
+    }
+    
+    // Every frame of the batch is one update of its source's tracks
+    for (NvDsMetaList* l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+         l_frame = l_frame->next) {
+        NvDsFrameMeta* frame_meta = (NvDsFrameMeta*)(l_frame->data);
+        
+        ioutracker->boxes.clear();
+        ioutracker->objects.clear();
+        for (NvDsMetaList* l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+             l_obj = l_obj->next) {
+            NvDsObjectMeta* obj_meta = (NvDsObjectMeta*)(l_obj->data);
+            const NvOSD_RectParams& rect = obj_meta->rect_params;
+            ioutracker->boxes.push_back({rect.left, rect.top, rect.width, rect.height,
+                                         obj_meta->class_id});
+            ioutracker->objects.push_back(obj_meta);
+        }
+        
+        ioutracker->tracker->update(static_cast<int>(frame_meta->source_id),
+                                    ioutracker->boxes, ioutracker->ids);
+        
+        for (size_t i = 0; i < ioutracker->objects.size(); i++) {
+            NvDsObjectMeta* obj_meta = ioutracker->objects[i];
+            obj_meta->object_id = ioutracker->ids[i];
+            obj_meta->tracker_confidence = obj_meta->confidence;
+        }
+    }
+    
+    return GST_FLOW_OK;
+}
+
+static gboolean gst_ioutracker_sink_event(GstBaseTransform* trans, GstEvent* event) {
+    GstIouTracker* ioutracker = GST_IOUTRACKER(trans);
+    
+    // A stream that ended or was detached: its tracks never match again, and
+    // a new stream under the same id must not inherit them (as nvtracker)
+    if ((GstNvEventType)GST_EVENT_TYPE(event) == GST_NVEVENT_STREAM_EOS && ioutracker->tracker) {
+        guint source_id = 0;
+        gst_nvevent_parse_stream_eos(event, &source_id);
+        ioutracker->tracker->removeSource(static_cast<int>(source_id));
+    }
+    
+    return GST_BASE_TRANSFORM_CLASS(parent_class)->sink_event(trans, event);
+}
+
+static void gst_ioutracker_finalize(GObject* object) {
+    GstIouTracker* ioutracker = GST_IOUTRACKER(object);
+    ioutracker->tracker.~unique_ptr();
+    ioutracker->boxes.~vector();
+    ioutracker->objects.~vector();
+    ioutracker->ids.~vector();
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+// Plugin registration
+extern "C" {
+    gboolean gst_ioutracker_plugin_init(GstPlugin* plugin) {
+        return gst_element_register(plugin, "ioutracker", GST_RANK_NONE,
+                                    GST_TYPE_IOUTRACKER);
+    }
+}
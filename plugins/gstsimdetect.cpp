@@ -0,0 +1,333 @@
+// gstsimdetect.cpp - Stand-in for nvinfer + nvtracker in the cpu-sim profile
+// Attaches deterministic synthetic detections as DeepStream batch metadata
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include "gstnvdsmeta.h"
+#include "gst-nvevent.h"
+#include "nvdsmeta.h"
+
+#include "synthetic_traffic.h"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+GST_DEBUG_CATEGORY_STATIC(gst_simdetect_debug);
+#define GST_CAT_DEFAULT gst_simdetect_debug
+
+#define GST_TYPE_SIMDETECT (gst_simdetect_get_type())
+#define GST_SIMDETECT(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_SIMDETECT, GstSimDetect))
+
+typedef struct _GstSimDetect GstSimDetect;
+typedef struct _GstSimDetectClass GstSimDetectClass;
+
+struct _GstSimDetect {
+    GstBaseTransform parent;
+    
+    // Generator is rebuilt on start() so property changes take effect
+    std::unique_ptr<speedflow::SyntheticTraffic> traffic;
+    std::vector<speedflow::SyntheticDetection> detections;
+    gint64 frame_count;
+    
+    // Configuration
+    gint frame_width;
+    gint frame_height;
+    gint density;
+    guint seed;
+    guint source_id;
+    gfloat media_fps;
+};
+
+struct _GstSimDetectClass {
+    GstBaseTransformClass parent_class;
+};
+
+GType gst_simdetect_get_type(void);
+
+// Properties
+enum {
+    PROP_0,
+    PROP_FRAME_WIDTH,
+    PROP_FRAME_HEIGHT,
+    PROP_DENSITY,
+    PROP_SEED,
+    PROP_SOURCE_ID,
+    PROP_MEDIA_FPS
+};
+
+// Track ids of a source are offset by source_id << kSourceIdShift, so the
+// streams behind one funnel never share an id (as nvtracker ids); source 0
+// keeps the generator's ids, a source runs out after ~1M vehicles
+static constexpr int kSourceIdShift = 20;
+
+// Function declarations
+static void gst_simdetect_set_property(GObject* object, guint prop_id,
+                                       const GValue* value, GParamSpec* pspec);
+static void gst_simdetect_get_property(GObject* object, guint prop_id,
+                                       GValue* value, GParamSpec* pspec);
+static gboolean gst_simdetect_start(GstBaseTransform* trans);
+static GstFlowReturn gst_simdetect_transform_ip(GstBaseTransform* trans,
+                                                GstBuffer* buf);
+static gboolean gst_simdetect_sink_event(GstBaseTransform* trans, GstEvent* event);
+static void gst_simdetect_finalize(GObject* object);
+
+// GStreamer boilerplate
+#define gst_simdetect_parent_class parent_class
+G_DEFINE_TYPE(GstSimDetect, gst_simdetect, GST_TYPE_BASE_TRANSFORM);
+
+// Pad templates
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE(
+    "sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY
+);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE(
+    "src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY
+);
+
+static void gst_simdetect_class_init(GstSimDetectClass* klass) {
+    GObjectClass* gobject_class = G_OBJECT_CLASS(klass);
+    GstElementClass* element_class = GST_ELEMENT_CLASS(klass);
+    GstBaseTransformClass* transform_class = GST_BASE_TRANSFORM_CLASS(klass);
+    
+    gobject_class->set_property = gst_simdetect_set_property;
+    gobject_class->get_property = gst_simdetect_get_property;
+    gobject_class->finalize = gst_simdetect_finalize;
+    
+    transform_class->start = GST_DEBUG_FUNCPTR(gst_simdetect_start);
+    transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_simdetect_transform_ip);
+    transform_class->sink_event = GST_DEBUG_FUNCPTR(gst_simdetect_sink_event);
+    
+    // Add pad templates
+    gst_element_class_add_static_pad_template(element_class, &sink_template);
+    gst_element_class_add_static_pad_template(element_class, &src_template);
+    
+    // Properties
+    g_object_class_install_property(gobject_class, PROP_FRAME_WIDTH,
+        g_param_spec_int("frame-width", "Frame Width",
+            "Width of the frames detections are generated for", 1, G_MAXINT, 1280,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_FRAME_HEIGHT,
+        g_param_spec_int("frame-height", "Frame Height",
+            "Height of the frames detections are generated for", 1, G_MAXINT, 720,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_DENSITY,
+        g_param_spec_int("density", "Density",
+            "Number of vehicle slots (upper bound of vehicles per frame)", 0, 100000, 8,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_SEED,
+        g_param_spec_uint("seed", "Seed",
+            "Seed for the deterministic trajectories", 0, G_MAXUINT, 1,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_SOURCE_ID,
+        g_param_spec_uint("source-id", "Source ID",
+            "SOURCE_ID of the frames, one simdetect per source ahead of a funnel", 0, 2047, 0,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_MEDIA_FPS,
+        g_param_spec_float("media-fps", "Media FPS",
+            "Number frames by buffer PTS at this rate, so a chunk of a recording "
+            "sees the traffic of a full run (0 = count buffers)",
+            0.0f, 1000.0f, 0.0f,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    gst_element_class_set_static_metadata(element_class,
+        "Synthetic Detector",
+        "Filter/Metadata",
+        "Attaches synthetic tracked vehicle detections (CPU load testing)",
+        "SpeedFlow Team");
+    
+    GST_DEBUG_CATEGORY_INIT(gst_simdetect_debug, "simdetect", 0,
+        "Synthetic detection plugin");
+}
+
+static void gst_simdetect_init(GstSimDetect* simdetect) {
+    new (&simdetect->traffic) std::unique_ptr<speedflow::SyntheticTraffic>();
+    new (&simdetect->detections) std::vector<speedflow::SyntheticDetection>();
+    simdetect->frame_count = 0;
+    simdetect->frame_width = 1280;
+    simdetect->frame_height = 720;
+    simdetect->density = 8;
+    simdetect->seed = 1;
+    simdetect->source_id = 0;
+    simdetect->media_fps = 0.0f;
+    
+    // In place but not passthrough: the batch meta is a GstMeta added to the
+    // buffer, which needs a writable buffer. Base transform makes it writable
+    // first, copying only the GstBuffer (memory is shared), and the video data
+    // is never touched.
+    gst_base_transform_set_in_place(GST_BASE_TRANSFORM(simdetect), TRUE);
+}
+
+static void gst_simdetect_set_property(GObject* object, guint prop_id,
+                                       const GValue* value, GParamSpec* pspec) {
+    GstSimDetect* simdetect = GST_SIMDETECT(object);
+    
+    switch (prop_id) {
+        case PROP_FRAME_WIDTH:
+            simdetect->frame_width = g_value_get_int(value);
+            break;
+        case PROP_FRAME_HEIGHT:
+            simdetect->frame_height = g_value_get_int(value);
+            break;
+        case PROP_DENSITY:
+            simdetect->density = g_value_get_int(value);
+            break;
+        case PROP_SEED:
+            simdetect->seed = g_value_get_uint(value);
+            break;
+        case PROP_SOURCE_ID:
+            simdetect->source_id = g_value_get_uint(value);
+            break;
+        case PROP_MEDIA_FPS:
+            simdetect->media_fps = g_value_get_float(value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            break;
+    }
+}
+
+static void gst_simdetect_get_property(GObject* object, guint prop_id,
+                                       GValue* value, GParamSpec* pspec) {
+    GstSimDetect* simdetect = GST_SIMDETECT(object);
+    
+    switch (prop_id) {
+        case PROP_FRAME_WIDTH:
+            g_value_set_int(value, simdetect->frame_width);
+            break;
+        case PROP_FRAME_HEIGHT:
+            g_value_set_int(value, simdetect->frame_height);
+            break;
+        case PROP_DENSITY:
+            g_value_set_int(value, simdetect->density);
+            break;
+        case PROP_SEED:
+            g_value_set_uint(value, simdetect->seed);
+            break;
+        case PROP_SOURCE_ID:
+            g_value_set_uint(value, simdetect->source_id);
+            break;
+        case PROP_MEDIA_FPS:
+            g_value_set_float(value, simdetect->media_fps);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            break;
+    }
+}
+
+static gboolean gst_simdetect_start(GstBaseTransform* trans) {
+    GstSimDetect* simdetect = GST_SIMDETECT(trans);
+    
+    speedflow::SyntheticTrafficConfig config;
+    config.frame_width = simdetect->frame_width;
+    config.frame_height = simdetect->frame_height;
+    config.density = simdetect->density;
+    config.seed = simdetect->seed;
+    
+    simdetect->traffic = std::make_unique<speedflow::SyntheticTraffic>(config);
+    simdetect->detections.reserve(simdetect->density);
+    simdetect->frame_count = 0;
+    
+    GST_INFO_OBJECT(simdetect, "Generating %d vehicle slots at %dx%d (seed %u)",
+                    config.density, config.frame_width, config.frame_height, config.seed);
+    return TRUE;
+}
+
+static GstFlowReturn gst_simdetect_transform_ip(GstBaseTransform* trans,
+                                                GstBuffer* buf) {
+    GstSimDetect* simdetect = GST_SIMDETECT(trans);
+    
+    // After a seek the stream does not start at frame 0
+    if (simdetect->media_fps > 0.0f && GST_BUFFER_PTS_IS_VALID(buf)) {
+        simdetect->frame_count = static_cast<gint64>(std::llround(
+            GST_BUFFER_PTS(buf) * static_cast<double>(simdetect->media_fps) / GST_SECOND));
+    }
+    
+    // Build the same batch layout nvstreammux produces for batch-size 1
+    NvDsBatchMeta* batch_meta = nvds_create_batch_meta(1);
+    if (!batch_meta) {
+        GST_ELEMENT_ERROR(simdetect, RESOURCE, FAILED,
+                          ("Failed to create batch meta"), (NULL));
+        return GST_FLOW_ERROR;
+    }
+    
+    NvDsMeta* meta = gst_buffer_add_nvds_meta(buf, batch_meta, NULL,
+                                              nvds_batch_meta_copy_func,
+                                              nvds_batch_meta_release_func);
+    meta->meta_type = NVDS_BATCH_GST_META;
+    batch_meta->base_meta.batch_meta = batch_meta;
+    batch_meta->base_meta.copy_func = nvds_batch_meta_copy_func;
+    batch_meta->base_meta.release_func = nvds_batch_meta_release_func;
+    
+    NvDsFrameMeta* frame_meta = nvds_acquire_frame_meta_from_pool(batch_meta);
+    frame_meta->pad_index = simdetect->source_id;
+    frame_meta->source_id = simdetect->source_id;
+    frame_meta->batch_id = 0;
+    frame_meta->frame_num = static_cast<gint>(simdetect->frame_count);
+    frame_meta->buf_pts = GST_BUFFER_PTS(buf);
+    // Wall clock at attach time, lets the sink measure post-detection latency
+    frame_meta->ntp_timestamp = static_cast<guint64>(g_get_real_time()) * 1000;
+    frame_meta->source_frame_width = simdetect->frame_width;
+    frame_meta->source_frame_height = simdetect->frame_height;
+    nvds_add_frame_meta_to_batch(batch_meta, frame_meta);
+    
+    simdetect->traffic->generate(simdetect->frame_count, simdetect->detections);
+    
+    const guint64 id_offset = static_cast<guint64>(simdetect->source_id) << kSourceIdShift;
+    for (const auto& det : simdetect->detections) {
+        NvDsObjectMeta* obj_meta = nvds_acquire_obj_meta_from_pool(batch_meta);
+        obj_meta->unique_component_id = 1;
+        obj_meta->class_id = det.class_id;
+        obj_meta->object_id = det.track_id + id_offset;
+        obj_meta->confidence = det.confidence;
+        obj_meta->tracker_confidence = det.confidence;
+        obj_meta->rect_params.left = det.left;
+        obj_meta->rect_params.top = det.top;
+        obj_meta->rect_params.width = det.width;
+        obj_meta->rect_params.height = det.height;
+        obj_meta->text_params.display_text = NULL;
+        nvds_add_obj_meta_to_frame(frame_meta, obj_meta, NULL);
+    }
+    
+    simdetect->frame_count++;
+    return GST_FLOW_OK;
+}
+
+static gboolean gst_simdetect_sink_event(GstBaseTransform* trans, GstEvent* event) {
+    GstSimDetect* simdetect = GST_SIMDETECT(trans);
+    
+    // Announce the end of this source the way nvstreammux does, ahead of the
+    // EOS that the funnel holds back until every source has ended
+    if (GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
+        gst_pad_push_event(GST_BASE_TRANSFORM_SRC_PAD(trans),
+                           gst_nvevent_new_stream_eos(simdetect->source_id));
+    }
+    
+    return GST_BASE_TRANSFORM_CLASS(parent_class)->sink_event(trans, event);
+}
+
+static void gst_simdetect_finalize(GObject* object) {
+    GstSimDetect* simdetect = GST_SIMDETECT(object);
+    simdetect->traffic.~unique_ptr();
+    simdetect->detections.~vector();
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+// Plugin registration
+extern "C" {
+    gboolean gst_simdetect_plugin_init(GstPlugin* plugin) {
+        return gst_element_register(plugin, "simdetect", GST_RANK_NONE,
+                                    GST_TYPE_SIMDETECT);
+    }
+}
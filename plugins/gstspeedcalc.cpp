@@ -5,12 +5,18 @@
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
 #include "gstnvdsmeta.h"
+#include "gst-nvevent.h"
 #include "nvdsmeta.h"
 #include "nvds_analytics_meta.h"
 
 #include "homography.h"
 #include "speed_calculator.h"
+#include "result_sink.h"
+#include "trace_recorder.h"
+#include <algorithm>
+#include <cmath>
 #include <memory>
+#include <vector>
 #include <iostream>
 
 GST_DEBUG_CATEGORY_STATIC(gst_speedcalc_debug);
@@ -29,9 +35,20 @@ struct _GstSpeedCalc {
     // Speed calculator instance
     std::shared_ptr<speedflow::SpeedCalculator> calculator;
     
+    // Consumers of per-frame results (publisher, ...), called in order
+    std::vector<std::shared_ptr<speedflow::ResultSink>> result_sinks;
+    speedflow::FrameResult frame_result;  // Reused for every frame
+    std::vector<speedflow::AlertResult> alerts;  // Alerts of the current frame
+    std::vector<speedflow::Trajectory> trajectories;  // Closed on the current frame
+    std::shared_ptr<speedflow::TraceRecorder> tracer;  // Null unless tracing
+    
     // Configuration
     gint muxer_width;
     gint muxer_height;
+    gfloat media_fps;       // > 0: frame numbers and timestamps from buffer PTS
+    gint64 media_epoch;     // ns added to the PTS for timestamps
+    gfloat budget_ms;       // Per-buffer time budget, 0 = never degrade
+    speedflow::DegradationBudget budget;  // Stage of each buffer under budget_ms
 };
 
 struct _GstSpeedCalcClass {
@@ -44,8 +61,13 @@ GType gst_speedcalc_get_type(void);
 enum {
     PROP_0,
     PROP_CALCULATOR,
+    PROP_RESULT_SINKS,
+    PROP_TRACER,
     PROP_MUXER_WIDTH,
-    PROP_MUXER_HEIGHT
+    PROP_MUXER_HEIGHT,
+    PROP_MEDIA_FPS,
+    PROP_MEDIA_EPOCH,
+    PROP_BUDGET_MS
 };
 
 // Function declarations
@@ -55,6 +77,7 @@ static void gst_speedcalc_get_property(GObject* object, guint prop_id,
                                        GValue* value, GParamSpec* pspec);
 static GstFlowReturn gst_speedcalc_transform_ip(GstBaseTransform* trans,
                                                 GstBuffer* buf);
+static gboolean gst_speedcalc_sink_event(GstBaseTransform* trans, GstEvent* event);
 static void gst_speedcalc_finalize(GObject* object);
 
 // GStreamer boilerplate
@@ -86,6 +109,7 @@ static void gst_speedcalc_class_init(GstSpeedCalcClass* klass) {
     gobject_class->finalize = gst_speedcalc_finalize;
     
     transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_speedcalc_transform_ip);
+    transform_class->sink_event = GST_DEBUG_FUNCPTR(gst_speedcalc_sink_event);
     
     // Add pad templates
     gst_element_class_add_static_pad_template(element_class, &sink_template);
@@ -97,6 +121,16 @@ static void gst_speedcalc_class_init(GstSpeedCalcClass* klass) {
             "Pointer to SpeedCalculator instance",
             (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     
+    g_object_class_install_property(gobject_class, PROP_RESULT_SINKS,
+        g_param_spec_pointer("result-sinks", "Result Sinks",
+            "Pointer to std::vector of ResultSink instances",
+            (GParamFlags)(G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_TRACER,
+        g_param_spec_pointer("tracer", "Tracer",
+            "Pointer to std::shared_ptr of a started TraceRecorder",
+            (GParamFlags)(G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS)));
+    
     g_object_class_install_property(gobject_class, PROP_MUXER_WIDTH,
         g_param_spec_int("muxer-width", "Muxer Width",
             "Width of muxer output", 0, G_MAXINT, 1280,
@@ -107,6 +141,27 @@ static void gst_speedcalc_class_init(GstSpeedCalcClass* klass) {
             "Height of muxer output", 0, G_MAXINT, 720,
             (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     
+    g_object_class_install_property(gobject_class, PROP_MEDIA_FPS,
+        g_param_spec_float("media-fps", "Media FPS",
+            "Frame numbers and timestamps from buffer PTS at this rate, the same "
+            "in every run over a recording (0 = muxer frame numbers and NTP time)",
+            0.0f, 1000.0f, 0.0f,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_MEDIA_EPOCH,
+        g_param_spec_int64("media-epoch", "Media Epoch",
+            "Timestamp of PTS 0 in ns since the Unix epoch (with media-fps)",
+            0, G_MAXINT64, 0,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
+    g_object_class_install_property(gobject_class, PROP_BUDGET_MS,
+        g_param_spec_float("budget-ms", "Budget",
+            "Processing time per buffer; past half of it the median filter is "
+            "skipped, past three quarters only objects inside the calibration zone "
+            "are updated, past all of it low-priority tracks wait a frame (0 = off)",
+            0.0f, 10000.0f, 0.0f,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    
     gst_element_class_set_static_metadata(element_class,
         "Speed Calculator",
         "Filter/Metadata",
@@ -118,9 +173,18 @@ static void gst_speedcalc_class_init(GstSpeedCalcClass* klass) {
 }
 
 static void gst_speedcalc_init(GstSpeedCalc* speedcalc) {
+    new (&speedcalc->result_sinks) std::vector<std::shared_ptr<speedflow::ResultSink>>();
+    new (&speedcalc->frame_result) speedflow::FrameResult();
+    new (&speedcalc->alerts) std::vector<speedflow::AlertResult>();
+    new (&speedcalc->trajectories) std::vector<speedflow::Trajectory>();
+    new (&speedcalc->tracer) std::shared_ptr<speedflow::TraceRecorder>();
+    new (&speedcalc->budget) speedflow::DegradationBudget();
     speedcalc->calculator = nullptr;
     speedcalc->muxer_width = 1280;
     speedcalc->muxer_height = 720;
+    speedcalc->media_fps = 0.0f;
+    speedcalc->media_epoch = 0;
+    speedcalc->budget_ms = 0.0f;
     
     // Set passthrough mode (we only modify metadata, not buffer data)
     gst_base_transform_set_passthrough(GST_BASE_TRANSFORM(speedcalc), TRUE);
@@ -136,12 +200,30 @@ static void gst_speedcalc_set_property(GObject* object, guint prop_id,
             speedcalc->calculator = *static_cast<std::shared_ptr<speedflow::SpeedCalculator>*>(
                 g_value_get_pointer(value));
             break;
+        case PROP_RESULT_SINKS:
+            speedcalc->result_sinks =
+                *static_cast<std::vector<std::shared_ptr<speedflow::ResultSink>>*>(
+                    g_value_get_pointer(value));
+            break;
+        case PROP_TRACER:
+            speedcalc->tracer = *static_cast<std::shared_ptr<speedflow::TraceRecorder>*>(
+                g_value_get_pointer(value));
+            break;
         case PROP_MUXER_WIDTH:
             speedcalc->muxer_width = g_value_get_int(value);
             break;
         case PROP_MUXER_HEIGHT:
             speedcalc->muxer_height = g_value_get_int(value);
             break;
+        case PROP_MEDIA_FPS:
+            speedcalc->media_fps = g_value_get_float(value);
+            break;
+        case PROP_MEDIA_EPOCH:
+            speedcalc->media_epoch = g_value_get_int64(value);
+            break;
+        case PROP_BUDGET_MS:
+            speedcalc->budget_ms = g_value_get_float(value);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
@@ -159,6 +241,15 @@ static void gst_speedcalc_get_property(GObject* object, guint prop_id,
         case PROP_MUXER_HEIGHT:
             g_value_set_int(value, speedcalc->muxer_height);
             break;
+        case PROP_MEDIA_FPS:
+            g_value_set_float(value, speedcalc->media_fps);
+            break;
+        case PROP_MEDIA_EPOCH:
+            g_value_set_int64(value, speedcalc->media_epoch);
+            break;
+        case PROP_BUDGET_MS:
+            g_value_set_float(value, speedcalc->budget_ms);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
             break;
@@ -174,17 +265,48 @@ static GstFlowReturn gst_speedcalc_transform_ip(GstBaseTransform* trans,
         return GST_FLOW_OK;
     }
     
+    // Calibrations of sources attached or detached since the last batch
+    speedcalc->calculator->syncCalibrations();
+    
     // Access DeepStream batch metadata
     NvDsBatchMeta* batch_meta = gst_buffer_get_nvds_batch_meta(buf);
     if (!batch_meta) {
         return GST_FLOW_OK;
     }
     
+    const bool publish = !speedcalc->result_sinks.empty();
+    speedflow::FrameResult& frame_result = speedcalc->frame_result;
+    
+    // Stage of the buffer under budget_ms (see DegradationBudget)
+    const gint64 budget_us = static_cast<gint64>(speedcalc->budget_ms * 1000.0f);
+    const gint64 start_us = budget_us > 0 ? g_get_monotonic_time() : 0;
+    speedflow::Degradation stage = speedcalc->budget.beginBuffer(budget_us);
+    speedcalc->calculator->setDegradation(stage);
+    
     // Iterate through frames in batch
     for (NvDsMetaList* l_frame = batch_meta->frame_meta_list; l_frame != NULL;
          l_frame = l_frame->next) {
         NvDsFrameMeta* frame_meta = (NvDsFrameMeta*)(l_frame->data);
         
+        // Recording time line: a frame gets the same number and timestamp
+        // in every chunk that covers it (seeks reset the muxer's count)
+        if (speedcalc->media_fps > 0.0f && GST_CLOCK_TIME_IS_VALID(frame_meta->buf_pts)) {
+            frame_meta->frame_num = static_cast<gint>(std::llround(
+                frame_meta->buf_pts * static_cast<double>(speedcalc->media_fps) / GST_SECOND));
+            frame_meta->ntp_timestamp = static_cast<guint64>(speedcalc->media_epoch) + frame_meta->buf_pts;
+        }
+        
+        speedflow::TraceScope frame_trace(speedcalc->tracer.get(), "speedcalc:frame",
+                                          frame_meta->frame_num, frame_meta->source_id);
+        
+        if (publish) {
+            frame_result.source_id = frame_meta->source_id;
+            frame_result.frame_number = frame_meta->frame_num;
+            frame_result.ntp_timestamp = static_cast<int64_t>(frame_meta->ntp_timestamp);
+            frame_result.objects.clear();
+        }
+        speedcalc->alerts.clear();
+        
         // Iterate through objects in frame
         for (NvDsMetaList* l_obj = frame_meta->obj_meta_list; l_obj != NULL;
              l_obj = l_obj->next) {
@@ -195,21 +317,46 @@ static GstFlowReturn gst_speedcalc_transform_ip(GstBaseTransform* trans,
                 continue;
             }
             
+            if (speedcalc->budget.canRise()) {
+                speedflow::Degradation now = speedcalc->budget.update(g_get_monotonic_time() - start_us);
+                if (now != stage) {
+                    stage = now;
+                    speedcalc->calculator->setDegradation(stage);
+                }
+            }
+            
             // Calculate center-bottom point
             float cx = obj_meta->rect_params.left + obj_meta->rect_params.width / 2.0f;
             float bottom_y = obj_meta->rect_params.top + obj_meta->rect_params.height;
             float bbox_area = obj_meta->rect_params.width * obj_meta->rect_params.height;
             float det_conf = obj_meta->confidence;
             
-            // Process with speed calculator
-            auto measurement = speedcalc->calculator->processObject(
-                obj_meta->object_id,
-                cx,
-                bottom_y,
-                bbox_area,
-                det_conf,
-                frame_meta->frame_num
-            );
+            // Outside the measurement zone or not a measured class: no track
+            // state is created, the object is only published. Objects shed
+            // under the budget are published with their last speed
+            speedflow::SpeedMeasurement measurement = {};
+            if (!speedcalc->calculator->acceptsObject(obj_meta->class_id, cx, bottom_y,
+                                                      frame_meta->source_id) ||
+                (stage >= speedflow::Degradation::ZoneOnly &&
+                 speedcalc->calculator->shedObject(obj_meta->object_id, cx, bottom_y,
+                                                   frame_meta->source_id, frame_meta->frame_num))) {
+                if (!publish) {
+                    continue;
+                }
+                measurement.track_id = static_cast<int>(obj_meta->object_id);
+                measurement.frame_number = frame_meta->frame_num;
+            } else {
+                // Process with speed calculator
+                measurement = speedcalc->calculator->processObject(
+                    obj_meta->object_id,
+                    cx,
+                    bottom_y,
+                    bbox_area,
+                    det_conf,
+                    frame_meta->frame_num,
+                    frame_meta->source_id
+                );
+            }
             
             // If valid measurement, update display text
             if (measurement.is_valid) {
@@ -220,22 +367,109 @@ static GstFlowReturn gst_speedcalc_transform_ip(GstBaseTransform* trans,
                     g_free(obj_meta->text_params.display_text);
                 }
                 obj_meta->text_params.display_text = g_strdup(speed_text.c_str());
+            }
+            
+            // Once per vehicle, not once per overspeeding frame
+            if (measurement.alert) {
+                GST_INFO_OBJECT(speedcalc, "Overspeed alert: source %u track %d peak %.1f km/h",
+                               frame_meta->source_id, measurement.track_id,
+                               measurement.peak_speed_kmh);
+            }
+            
+            if (publish) {
+                speedflow::ObjectResult obj;
+                obj.track_id = obj_meta->object_id;
+                obj.class_id = obj_meta->class_id;
+                obj.confidence = det_conf;
+                obj.bbox_x = obj_meta->rect_params.left / speedcalc->muxer_width;
+                obj.bbox_y = obj_meta->rect_params.top / speedcalc->muxer_height;
+                obj.bbox_w = obj_meta->rect_params.width / speedcalc->muxer_width;
+                obj.bbox_h = obj_meta->rect_params.height / speedcalc->muxer_height;
+                obj.speed_kmh = measurement.is_valid
+                    ? measurement.speed_kmh
+                    : speedcalc->calculator->getLastSpeed(obj_meta->object_id);
+                obj.is_valid = measurement.is_valid;
+                obj.is_overspeeding = measurement.is_overspeeding;
+                frame_result.objects.push_back(obj);
                 
-                // Log overspeeding
-                if (measurement.is_overspeeding) {
-                    GST_INFO_OBJECT(speedcalc, "Overspeed detected: Track %d @ %.1f km/h",
-                                   measurement.track_id, measurement.speed_kmh);
+                if (measurement.alert) {
+                    speedflow::AlertResult alert;
+                    alert.source_id = frame_result.source_id;
+                    alert.frame_number = frame_result.frame_number;
+                    alert.ntp_timestamp = frame_result.ntp_timestamp;
+                    alert.object = obj;
+                    alert.peak_speed_kmh = measurement.peak_speed_kmh;
+                    speedcalc->alerts.push_back(alert);
                 }
             }
         }
+        
+        // Close tracks that left this source's view
+        const gint64 tail_start_us = budget_us > 0 ? g_get_monotonic_time() : 0;
+        speedcalc->calculator->endFrame(frame_meta->source_id, frame_meta->frame_num);
+        speedcalc->calculator->takeTrajectories(speedcalc->trajectories);
+        
+        if (publish) {
+            speedflow::TraceScope sinks_trace(speedcalc->tracer.get(), "speedcalc:sinks",
+                                              frame_meta->frame_num, frame_meta->source_id);
+            for (auto& trajectory : speedcalc->trajectories) {
+                trajectory.ntp_timestamp = frame_result.ntp_timestamp;
+            }
+            for (const auto& sink : speedcalc->result_sinks) {
+                sink->onFrame(frame_result);
+                for (const auto& alert : speedcalc->alerts) {
+                    sink->onAlert(alert);
+                }
+                for (const auto& trajectory : speedcalc->trajectories) {
+                    sink->onTrajectory(trajectory);
+                }
+            }
+        }
+        if (budget_us > 0) {
+            speedcalc->budget.addTail(g_get_monotonic_time() - tail_start_us);
+        }
     }
     
+    speedcalc->calculator->countDegradedBuffer(speedcalc->budget.endBuffer());
     return GST_FLOW_OK;
 }
 
+static gboolean gst_speedcalc_sink_event(GstBaseTransform* trans, GstEvent* event) {
+    GstSpeedCalc* speedcalc = GST_SPEEDCALC(trans);
+    
+    // The muxer's per-source EOS (file ended or source detached); the event
+    // is serialized, so every frame of that source was processed before it
+    if ((GstNvEventType)GST_EVENT_TYPE(event) == GST_NVEVENT_STREAM_EOS && speedcalc->calculator) {
+        guint source_id = 0;
+        gst_nvevent_parse_stream_eos(event, &source_id);
+        
+        speedcalc->calculator->removeSource(static_cast<int>(source_id));
+        speedcalc->calculator->takeTrajectories(speedcalc->trajectories);
+        GST_INFO_OBJECT(speedcalc, "Source %u ended, %zu tracks closed", source_id,
+                        speedcalc->trajectories.size());
+        
+        for (auto& trajectory : speedcalc->trajectories) {
+            trajectory.ntp_timestamp = speedcalc->frame_result.ntp_timestamp;
+        }
+        for (const auto& sink : speedcalc->result_sinks) {
+            for (const auto& trajectory : speedcalc->trajectories) {
+                sink->onTrajectory(trajectory);
+            }
+            sink->onSourceRemoved(static_cast<int>(source_id));
+        }
+    }
+    
+    return GST_BASE_TRANSFORM_CLASS(parent_class)->sink_event(trans, event);
+}
+
 static void gst_speedcalc_finalize(GObject* object) {
     GstSpeedCalc* speedcalc = GST_SPEEDCALC(object);
     speedcalc->calculator.reset();
+    speedcalc->result_sinks.~vector();
+    speedcalc->frame_result.~FrameResult();
+    speedcalc->alerts.~vector();
+    speedcalc->trajectories.~vector();
+    speedcalc->tracer.~shared_ptr();
     G_OBJECT_CLASS(parent_class)->finalize(object);
 }
 
@@ -1,5 +1,7 @@
 #include "homography.h"
 #include <stdexcept>
+#include <cfloat>
+#include <cmath>
 
 namespace speedflow {
 
@@ -11,6 +13,14 @@ ViewTransformer::ViewTransformer(const std::vector<cv::Point2f>& source,
     
     // Compute perspective transformation matrix
     homography_matrix_ = cv::getPerspectiveTransform(source, target);
+    
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            h_[r * 3 + c] = homography_matrix_.at<double>(r, c);
+        }
+    }
+    
+    zone_ = MeasurementZone(source);
 }
 
 std::vector<cv::Point2f> ViewTransformer::transformPoints(
@@ -27,9 +37,17 @@ std::vector<cv::Point2f> ViewTransformer::transformPoints(
 }
 
 cv::Point2f ViewTransformer::transformPoint(const cv::Point2f& point) const {
-    std::vector<cv::Point2f> input = {point};
-    auto output = transformPoints(input);
-    return output[0];
+    double x = point.x;
+    double y = point.y;
+    double w = h_[6] * x + h_[7] * y + h_[8];
+    
+    // Same convention as cv::perspectiveTransform for points at infinity
+    if (std::fabs(w) <= FLT_EPSILON) {
+        return cv::Point2f(0.0f, 0.0f);
+    }
+    
+    return cv::Point2f(static_cast<float>((h_[0] * x + h_[1] * y + h_[2]) / w),
+                       static_cast<float>((h_[3] * x + h_[4] * y + h_[5]) / w));
 }
 
 } // namespace speedflow
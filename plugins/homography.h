@@ -1,5 +1,6 @@
 #pragma once
 
+#include "measurement_zone.h"
 #include <opencv2/opencv.hpp>
 #include <vector>
 
@@ -32,9 +33,20 @@ public:
      * @return Transformed point in world coordinates
      */
     cv::Point2f transformPoint(const cv::Point2f& point) const;
+    
+    /** @return Source quadrilateral as a point-in-zone test (image coordinates) */
+    const MeasurementZone& zone() const { return zone_; }
 
 private:
     cv::Mat homography_matrix_;
+    
+    // Row-major copy of the 3x3 matrix so single-point transforms on the
+    // per-frame path do not allocate or go through cv::perspectiveTransform.
+    // Never modified after construction, so instances can be shared freely
+    // between streams and threads.
+    double h_[9];
+    
+    MeasurementZone zone_;
 };
 
 } // namespace speedflow
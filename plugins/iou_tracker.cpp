@@ -0,0 +1,326 @@
+#include "iou_tracker.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace speedflow {
+
+IouTracker::IouTracker(const IouTrackerConfig& config)
+    : config_(config) {
+    config_.velocity_smoothing = std::min(1.0f, std::max(0.0f, config_.velocity_smoothing));
+}
+
+void IouTracker::update(int source_id, const std::vector<TrackerBox>& boxes,
+                        std::vector<uint64_t>& ids) {
+    std::vector<Track>& tracks = streams_[source_id];
+    
+    det_track_.assign(boxes.size(), -1);
+    track_det_.assign(tracks.size(), -1);
+    
+    if (!tracks.empty() && !boxes.empty()) {
+        computeIou(tracks, boxes);
+        if (config_.matching == TrackerMatching::Hungarian) {
+            matchHungarian(pairs_, boxes.size(), tracks.size());
+        } else {
+            matchGreedy(pairs_);
+        }
+        if (config_.max_center_dist > 0.0f) {
+            matchCenters(tracks, boxes);
+        }
+    }
+    
+    // Matched tracks take the detection, the others coast
+    const float alpha = config_.velocity_smoothing;
+    for (size_t t = 0; t < tracks.size(); t++) {
+        Track& track = tracks[t];
+        int d = track_det_[t];
+        if (d < 0) {
+            track.missed++;
+            continue;
+        }
+        
+        const TrackerBox& box = boxes[d];
+        float cx = box.left + box.width * 0.5f;
+        float cy = box.top + box.height * 0.5f;
+        float steps = static_cast<float>(track.missed + 1);
+        float vx = (cx - track.cx) / steps;
+        float vy = (cy - track.cy) / steps;
+        if (track.hits == 1) {
+            track.vx = vx;  // First displacement, nothing to smooth with
+            track.vy = vy;
+        } else {
+            track.vx = alpha * vx + (1.0f - alpha) * track.vx;
+            track.vy = alpha * vy + (1.0f - alpha) * track.vy;
+        }
+        track.cx = cx;
+        track.cy = cy;
+        track.width = box.width;
+        track.height = box.height;
+        track.missed = 0;
+        track.hits++;
+    }
+    
+    ids.resize(boxes.size());
+    for (size_t d = 0; d < boxes.size(); d++) {
+        if (det_track_[d] >= 0) {
+            ids[d] = tracks[det_track_[d]].id;
+            continue;
+        }
+        
+        const TrackerBox& box = boxes[d];
+        Track track;
+        track.id = next_id_++;
+        track.class_id = box.class_id;
+        track.cx = box.left + box.width * 0.5f;
+        track.cy = box.top + box.height * 0.5f;
+        track.width = box.width;
+        track.height = box.height;
+        track.vx = 0.0f;
+        track.vy = 0.0f;
+        track.missed = 0;
+        track.hits = 1;
+        tracks.push_back(track);
+        ids[d] = track.id;
+    }
+    
+    tracks.erase(std::remove_if(tracks.begin(), tracks.end(),
+                                [this](const Track& track) { return track.missed > config_.max_age_frames; }),
+                 tracks.end());
+}
+
+void IouTracker::removeSource(int source_id) {
+    streams_.erase(source_id);
+}
+
+size_t IouTracker::trackCount() const {
+    size_t count = 0;
+    for (const auto& entry : streams_) {
+        count += entry.second.size();
+    }
+    return count;
+}
+
+void IouTracker::computeIou(const std::vector<Track>& tracks, const std::vector<TrackerBox>& boxes) {
+    const size_t num_tracks = tracks.size();
+    x1_.resize(num_tracks);
+    y1_.resize(num_tracks);
+    x2_.resize(num_tracks);
+    y2_.resize(num_tracks);
+    area_.resize(num_tracks);
+    class_.resize(num_tracks);
+    iou_row_.resize(num_tracks);
+    
+    // Predicted boxes: constant velocity over the frames since the last detection
+    for (size_t t = 0; t < num_tracks; t++) {
+        const Track& track = tracks[t];
+        float steps = static_cast<float>(track.missed + 1);
+        float cx = track.cx + track.vx * steps;
+        float cy = track.cy + track.vy * steps;
+        x1_[t] = cx - track.width * 0.5f;
+        y1_[t] = cy - track.height * 0.5f;
+        x2_[t] = cx + track.width * 0.5f;
+        y2_[t] = cy + track.height * 0.5f;
+        area_[t] = track.width * track.height;
+        class_[t] = config_.match_class ? track.class_id : 0;
+    }
+    
+    pairs_.clear();
+    const float* x1 = x1_.data();
+    const float* y1 = y1_.data();
+    const float* x2 = x2_.data();
+    const float* y2 = y2_.data();
+    const float* area = area_.data();
+    const int* cls = class_.data();
+    float* row = iou_row_.data();
+    
+    for (size_t d = 0; d < boxes.size(); d++) {
+        const TrackerBox& box = boxes[d];
+        const float bx1 = box.left;
+        const float by1 = box.top;
+        const float bx2 = box.left + box.width;
+        const float by2 = box.top + box.height;
+        const float barea = box.width * box.height;
+        const int bcls = config_.match_class ? box.class_id : 0;
+        
+        // Plain selects instead of std::min/max (references), so the loop
+        // has no control flow and vectorizes over tracks
+        for (size_t t = 0; t < num_tracks; t++) {
+            float left = bx1 > x1[t] ? bx1 : x1[t];
+            float right = bx2 < x2[t] ? bx2 : x2[t];
+            float top = by1 > y1[t] ? by1 : y1[t];
+            float bottom = by2 < y2[t] ? by2 : y2[t];
+            float iw = right - left;
+            float ih = bottom - top;
+            iw = iw > 0.0f ? iw : 0.0f;
+            ih = ih > 0.0f ? ih : 0.0f;
+            float inter = iw * ih;
+            float uni = barea + area[t] - inter;
+            float iou = inter / (uni > 1e-6f ? uni : 1e-6f);
+            row[t] = cls[t] == bcls ? iou : 0.0f;
+        }
+        
+        for (size_t t = 0; t < num_tracks; t++) {
+            if (row[t] >= config_.min_iou) {
+                pairs_.push_back({row[t], static_cast<int>(d), static_cast<int>(t)});
+            }
+        }
+    }
+}
+
+void IouTracker::matchGreedy(std::vector<Pair>& pairs) {
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) {
+        return a.iou > b.iou;
+    });
+    for (const Pair& pair : pairs) {
+        if (det_track_[pair.det] < 0 && track_det_[pair.track] < 0) {
+            det_track_[pair.det] = pair.track;
+            track_det_[pair.track] = pair.det;
+        }
+    }
+}
+
+void IouTracker::matchHungarian(const std::vector<Pair>& pairs, size_t num_dets, size_t num_tracks) {
+    // Candidate pairs split the frame into independent groups (vehicles
+    // that overlap each other); each group is solved on its own, so the
+    // cubic cost applies to the group size, not the detection count
+    std::vector<int> parent(num_dets + num_tracks);
+    for (size_t i = 0; i < parent.size(); i++) {
+        parent[i] = static_cast<int>(i);
+    }
+    auto find = [&parent](int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+    for (const Pair& pair : pairs) {
+        int a = find(pair.det);
+        int b = find(static_cast<int>(num_dets) + pair.track);
+        if (a != b) {
+            parent[a] = b;
+        }
+    }
+    
+    std::unordered_map<int, std::vector<const Pair*>> groups;
+    for (const Pair& pair : pairs) {
+        groups[find(pair.det)].push_back(&pair);
+    }
+    
+    std::vector<int> dets, trks;
+    std::vector<double> cost;
+    for (const auto& entry : groups) {
+        const std::vector<const Pair*>& group = entry.second;
+        if (group.size() == 1) {
+            det_track_[group[0]->det] = group[0]->track;
+            track_det_[group[0]->track] = group[0]->det;
+            continue;
+        }
+        
+        // Local indices of the group's detections (rows) and tracks (columns)
+        dets.clear();
+        trks.clear();
+        for (const Pair* pair : group) {
+            dets.push_back(pair->det);
+            trks.push_back(pair->track);
+        }
+        std::sort(dets.begin(), dets.end());
+        dets.erase(std::unique(dets.begin(), dets.end()), dets.end());
+        std::sort(trks.begin(), trks.end());
+        trks.erase(std::unique(trks.begin(), trks.end()), trks.end());
+        
+        // Square matrix, cost 1 - IoU; pairs below min_iou and padding cost
+        // 1 (the same as leaving both unmatched)
+        const size_t n = std::max(dets.size(), trks.size());
+        cost.assign(n * n, 1.0);
+        for (const Pair* pair : group) {
+            size_t r = std::lower_bound(dets.begin(), dets.end(), pair->det) - dets.begin();
+            size_t c = std::lower_bound(trks.begin(), trks.end(), pair->track) - trks.begin();
+            cost[r * n + c] = 1.0 - pair->iou;
+        }
+        
+        // Shortest augmenting path (Kuhn-Munkres with potentials), O(n^3);
+        // arrays are 1-based, column 0 is the virtual start
+        const double inf = std::numeric_limits<double>::infinity();
+        std::vector<double> u(n + 1, 0.0), v(n + 1, 0.0), minv(n + 1);
+        std::vector<size_t> p(n + 1, 0), way(n + 1, 0);
+        std::vector<char> used(n + 1);
+        for (size_t i = 1; i <= n; i++) {
+            p[0] = i;
+            size_t j0 = 0;
+            std::fill(minv.begin(), minv.end(), inf);
+            std::fill(used.begin(), used.end(), 0);
+            do {
+                used[j0] = 1;
+                size_t i0 = p[j0], j1 = 0;
+                double delta = inf;
+                for (size_t j = 1; j <= n; j++) {
+                    if (used[j]) {
+                        continue;
+                    }
+                    double cur = cost[(i0 - 1) * n + (j - 1)] - u[i0] - v[j];
+                    if (cur < minv[j]) {
+                        minv[j] = cur;
+                        way[j] = j0;
+                    }
+                    if (minv[j] < delta) {
+                        delta = minv[j];
+                        j1 = j;
+                    }
+                }
+                for (size_t j = 0; j <= n; j++) {
+                    if (used[j]) {
+                        u[p[j]] += delta;
+                        v[j] -= delta;
+                    } else {
+                        minv[j] -= delta;
+                    }
+                }
+                j0 = j1;
+            } while (p[j0] != 0);
+            do {
+                size_t j1 = way[j0];
+                p[j0] = p[j1];
+                j0 = j1;
+            } while (j0 != 0);
+        }
+        
+        for (size_t j = 1; j <= n; j++) {
+            size_t r = p[j] - 1;
+            size_t c = j - 1;
+            if (r < dets.size() && c < trks.size() && cost[r * n + c] < 1.0) {
+                det_track_[dets[r]] = trks[c];
+                track_det_[trks[c]] = dets[r];
+            }
+        }
+    }
+}
+
+void IouTracker::matchCenters(const std::vector<Track>& tracks, const std::vector<TrackerBox>& boxes) {
+    // Leftovers of the IoU pass, by predicted center distance relative to
+    // the track's box size
+    pairs_.clear();
+    for (size_t d = 0; d < boxes.size(); d++) {
+        if (det_track_[d] >= 0) {
+            continue;
+        }
+        const TrackerBox& box = boxes[d];
+        float cx = box.left + box.width * 0.5f;
+        float cy = box.top + box.height * 0.5f;
+        for (size_t t = 0; t < tracks.size(); t++) {
+            if (track_det_[t] >= 0 || (config_.match_class && tracks[t].class_id != box.class_id)) {
+                continue;
+            }
+            float dx = cx - (x1_[t] + x2_[t]) * 0.5f;
+            float dy = cy - (y1_[t] + y2_[t]) * 0.5f;
+            float size = 0.5f * (tracks[t].width + tracks[t].height);
+            float dist = std::sqrt(dx * dx + dy * dy) / std::max(size, 1.0f);
+            if (dist <= config_.max_center_dist) {
+                pairs_.push_back({-dist, static_cast<int>(d), static_cast<int>(t)});
+            }
+        }
+    }
+    matchGreedy(pairs_);
+}
+
+} // namespace speedflow
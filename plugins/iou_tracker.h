@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace speedflow {
+
+/**
+ * How detections are assigned to tracks once their IoU is known
+ */
+enum class TrackerMatching {
+    Greedy,     // Highest IoU first
+    Hungarian   // Maximum total IoU, per group of overlapping candidates
+};
+
+/**
+ * Configuration for IouTracker
+ */
+struct IouTrackerConfig {
+    TrackerMatching matching = TrackerMatching::Greedy;
+    float min_iou = 0.3f;               // Weakest overlap accepted as the same vehicle
+    float max_center_dist = 0.5f;       // Fallback: center distance in box sizes (0 = off)
+    int max_age_frames = 30;            // Frames a track is predicted without a detection
+    float velocity_smoothing = 0.5f;    // Weight of the newest displacement (0..1]
+    bool match_class = true;            // Never associate across classes
+};
+
+/**
+ * A detection for IouTracker (pixel coordinates)
+ */
+struct TrackerBox {
+    float left;
+    float top;
+    float width;
+    float height;
+    int class_id;
+};
+
+/**
+ * IouTracker - CPU multi-object tracker for simple scenes
+ *
+ * Each track predicts its box with a constant velocity (smoothed center
+ * displacement per frame) and detections are associated by IoU with the
+ * predicted boxes. The IoU matrix is computed from track corners stored as
+ * separate float arrays with a branch-free inner loop, so it vectorizes.
+ * Pairs below min_iou are never matched; detections and tracks left over are
+ * then paired greedily by center distance (max_center_dist), which catches
+ * fast vehicles whose velocity is not known yet. Unmatched detections start
+ * new tracks, unmatched tracks coast until max_age_frames.
+ *
+ * Streams are tracked independently; ids are unique across all streams.
+ * Not thread-safe: called from one streaming thread.
+ */
+class IouTracker {
+public:
+    explicit IouTracker(const IouTrackerConfig& config = IouTrackerConfig());
+    
+    /**
+     * Associate one frame of detections
+     * @param source_id Stream the frame belongs to
+     * @param boxes Detections of the frame
+     * @param ids Output: track id per detection (resized to boxes.size())
+     */
+    void update(int source_id, const std::vector<TrackerBox>& boxes, std::vector<uint64_t>& ids);
+    
+    /** Drop the tracks of a stream (e.g. the source was removed) */
+    void removeSource(int source_id);
+    
+    /** Live tracks over all streams, including coasting ones */
+    size_t trackCount() const;
+
+private:
+    struct Track {
+        uint64_t id;
+        int class_id;
+        float cx, cy;           // Box center at the last detection
+        float width, height;
+        float vx, vy;           // Center displacement per frame
+        int missed;             // Frames since the last detection
+        int hits;
+    };
+    
+    // Candidate pair of the IoU matrix
+    struct Pair {
+        float iou;
+        int det;
+        int track;
+    };
+    
+    void computeIou(const std::vector<Track>& tracks, const std::vector<TrackerBox>& boxes);
+    void matchGreedy(std::vector<Pair>& pairs);
+    void matchHungarian(const std::vector<Pair>& pairs, size_t num_dets, size_t num_tracks);
+    void matchCenters(const std::vector<Track>& tracks, const std::vector<TrackerBox>& boxes);
+    
+    IouTrackerConfig config_;
+    std::unordered_map<int, std::vector<Track>> streams_;
+    uint64_t next_id_ = 1;
+    
+    // Scratch reused across frames: predicted track corners (one array per
+    // coordinate), candidate pairs and the assignment of each detection/track
+    std::vector<float> x1_, y1_, x2_, y2_, area_;
+    std::vector<int> class_;
+    std::vector<float> iou_row_;
+    std::vector<Pair> pairs_;
+    std::vector<int> det_track_;
+    std::vector<int> track_det_;
+};
+
+} // namespace speedflow
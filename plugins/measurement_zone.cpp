@@ -0,0 +1,59 @@
+#include "measurement_zone.h"
+#include <algorithm>
+#include <cmath>
+
+namespace speedflow {
+
+MeasurementZone::MeasurementZone(const std::vector<cv::Point2f>& polygon) {
+    if (polygon.size() != edges_.size()) {
+        return;
+    }
+    
+    // Winding from the signed area, so "inside" is positive for either order
+    double area2 = 0.0;
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const cv::Point2f& p = polygon[i];
+        const cv::Point2f& q = polygon[(i + 1) % polygon.size()];
+        area2 += static_cast<double>(p.x) * q.y - static_cast<double>(q.x) * p.y;
+    }
+    if (std::abs(area2) < 1.0) {
+        return;
+    }
+    const double winding = area2 > 0.0 ? 1.0 : -1.0;
+    
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const cv::Point2f& p = polygon[i];
+        const cv::Point2f& q = polygon[(i + 1) % polygon.size()];
+        double dx = q.x - p.x;
+        double dy = q.y - p.y;
+        double len = std::sqrt(dx * dx + dy * dy);
+        if (len <= 0.0) {
+            return;
+        }
+        
+        // Inward normal of edge p -> q, scaled to unit length
+        double a = -dy * winding / len;
+        double b = dx * winding / len;
+        double c = -(a * p.x + b * p.y);
+        
+        // Convex: the remaining corners must not lie outside this edge
+        for (const cv::Point2f& r : polygon) {
+            if (a * r.x + b * r.y + c < -1e-3) {
+                return;
+            }
+        }
+        edges_[i] = {static_cast<float>(a), static_cast<float>(b), static_cast<float>(c)};
+    }
+    
+    auto [min_x, max_x] = std::minmax_element(polygon.begin(), polygon.end(),
+        [](const cv::Point2f& l, const cv::Point2f& r) { return l.x < r.x; });
+    auto [min_y, max_y] = std::minmax_element(polygon.begin(), polygon.end(),
+        [](const cv::Point2f& l, const cv::Point2f& r) { return l.y < r.y; });
+    min_x_ = min_x->x;
+    max_x_ = max_x->x;
+    min_y_ = min_y->y;
+    max_y_ = max_y->y;
+    valid_ = true;
+}
+
+} // namespace speedflow
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <vector>
+
+namespace speedflow {
+
+/**
+ * MeasurementZone - Point-in-quadrilateral test for the calibrated image area
+ *
+ * The four edges are precomputed as normalized edge functions
+ * a*x + b*y + c (positive inside, value = distance in pixels), so a test is a
+ * bounding-box check and at most four multiply-adds, with no allocation.
+ * Only convex quadrilaterals are valid zones; a concave or degenerate one
+ * cannot come from a usable homography and accepts every point instead.
+ */
+class MeasurementZone {
+public:
+    /** Zone that accepts every point */
+    MeasurementZone() = default;
+    
+    /**
+     * @param polygon Quadrilateral in image coordinates, either winding
+     */
+    explicit MeasurementZone(const std::vector<cv::Point2f>& polygon);
+    
+    /**
+     * @param x Image X coordinate
+     * @param y Image Y coordinate
+     * @param margin_px Grow the zone by this many pixels on every side
+     * @return true if the point lies inside (or on the border of) the zone
+     */
+    bool contains(float x, float y, float margin_px = 0.0f) const {
+        if (!valid_) {
+            return true;
+        }
+        if (x < min_x_ - margin_px || x > max_x_ + margin_px ||
+            y < min_y_ - margin_px || y > max_y_ + margin_px) {
+            return false;
+        }
+        for (const Edge& edge : edges_) {
+            if (edge.a * x + edge.b * y + edge.c < -margin_px) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    bool valid() const { return valid_; }
+
+private:
+    struct Edge {
+        float a, b, c;
+    };
+    
+    std::array<Edge, 4> edges_{};
+    float min_x_ = 0.0f;
+    float min_y_ = 0.0f;
+    float max_x_ = 0.0f;
+    float max_y_ = 0.0f;
+    bool valid_ = false;
+};
+
+} // namespace speedflow
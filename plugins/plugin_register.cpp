@@ -10,6 +10,8 @@
 
 extern "C" {
     extern gboolean gst_speedcalc_plugin_init(GstPlugin* plugin);
+    extern gboolean gst_simdetect_plugin_init(GstPlugin* plugin);
+    extern gboolean gst_ioutracker_plugin_init(GstPlugin* plugin);
     
     static gboolean plugin_init(GstPlugin* plugin) {
         // Register speedcalc element
@@ -17,6 +19,16 @@ extern "C" {
             return FALSE;
         }
         
+        // Register simdetect element (cpu-sim profile stand-in detector)
+        if (!gst_simdetect_plugin_init(plugin)) {
+            return FALSE;
+        }
+        
+        // Register ioutracker element (CPU alternative to nvtracker)
+        if (!gst_ioutracker_plugin_init(plugin)) {
+            return FALSE;
+        }
+        
         return TRUE;
     }
     
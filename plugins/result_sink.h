@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "trajectory.h"
+
+namespace speedflow {
+
+/**
+ * Per-object result of one frame, as seen by speedcalc
+ */
+struct ObjectResult {
+    uint64_t track_id;
+    int class_id;
+    float confidence;
+    
+    // Normalized bbox (0.0 - 1.0 of the muxer resolution)
+    float bbox_x;
+    float bbox_y;
+    float bbox_w;
+    float bbox_h;
+    
+    float speed_kmh;          // Last valid speed, 0 if not measured yet
+    bool is_valid;            // speed_kmh was measured on this frame
+    bool is_overspeeding;
+};
+
+/**
+ * All results of one frame of one source
+ */
+struct FrameResult {
+    int source_id = 0;
+    int frame_number = 0;
+    int64_t ntp_timestamp = 0;  // ns since epoch (NvDsFrameMeta::ntp_timestamp)
+    std::vector<ObjectResult> objects;
+};
+
+/**
+ * Confirmed overspeed of one vehicle, emitted once per track
+ */
+struct AlertResult {
+    int source_id = 0;
+    int frame_number = 0;
+    int64_t ntp_timestamp = 0;
+    ObjectResult object;        // The vehicle on the frame the alert fired
+    float peak_speed_kmh = 0.0f;
+};
+
+/**
+ * ResultSink - Consumer of speedcalc results
+ *
+ * Called synchronously on the GStreamer streaming thread once per frame,
+ * once per alert, once per finished trajectory and once per detached source.
+ * Implementations must not block: copy what is needed and hand heavy work
+ * (serialization, I/O) to their own thread.
+ */
+class ResultSink {
+public:
+    virtual ~ResultSink() = default;
+    
+    /**
+     * Consume the results of one frame
+     * @param frame Results, only valid for the duration of the call
+     */
+    virtual void onFrame(const FrameResult& frame) = 0;
+    
+    /**
+     * Consume an overspeed alert (after the frame's onFrame call)
+     * @param alert Alert, only valid for the duration of the call
+     */
+    virtual void onAlert(const AlertResult& alert) {}
+    
+    /**
+     * Consume the simplified path of a closed track (after the frame's alerts)
+     * @param trajectory Trajectory, only valid for the duration of the call
+     */
+    virtual void onTrajectory(const Trajectory& trajectory) {}
+    
+    /**
+     * A source was detached at runtime; no more frames follow for its id
+     * until a new stream is attached under it
+     * @param source_id Stream source id
+     */
+    virtual void onSourceRemoved(int source_id) {}
+};
+
+} // namespace speedflow
@@ -1,14 +1,191 @@
 #include "speed_calculator.h"
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
-#include <sstream>
-#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <memory_resource>
 
 namespace speedflow {
 
 SpeedCalculator::SpeedCalculator(std::shared_ptr<ViewTransformer> transformer,
                                  const SpeedConfig& config)
-    : transformer_(transformer), config_(config) {
+    : transformer_(transformer), config_(config),
+      alert_bucket_(std::make_shared<AlertTokenBucket>(config.alert_rate_per_s, config.alert_burst)) {
+    // Section length defaults to the distance of line A's midpoint from line B
+    section_distance_m_ = config_.section_distance_m;
+    if (section_distance_m_ <= 0.0f) {
+        const cv::Point2f* b = config_.section_line_b;
+        cv::Point2f mid_a((config_.section_line_a[0].x + config_.section_line_a[1].x) / 2.0f,
+                          (config_.section_line_a[0].y + config_.section_line_a[1].y) / 2.0f);
+        float bx = b[1].x - b[0].x;
+        float by = b[1].y - b[0].y;
+        float len = std::sqrt(bx * bx + by * by);
+        if (len > 0.0f) {
+            section_distance_m_ = std::abs(bx * (mid_a.y - b[0].y) - by * (mid_a.x - b[0].x)) / len;
+        }
+    }
+    
+    // Allowlist as a lookup table (class ids are small: 80 for COCO)
+    for (int class_id : config_.class_allowlist) {
+        if (class_id < 0) {
+            continue;
+        }
+        if (static_cast<size_t>(class_id) >= class_allowed_.size()) {
+            class_allowed_.resize(class_id + 1, false);
+        }
+        class_allowed_[class_id] = true;
+    }
+}
+
+// Checkpoint header (see saveState)
+static constexpr char kCheckpointMagic[4] = {'S', 'F', 'C', 'P'};
+static constexpr uint32_t kCheckpointVersion = 2;     // 2: re-association state
+
+// Distance a restored track may be off from where max_abs_kmh could have
+// taken it during the restart (detection jitter, homography error)
+static constexpr float kResumeSlackM = 2.0f;
+
+static double steadySeconds() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t wallMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Crossing of the movement p0 -> p1 with segment l0 - l1
+// @return Fraction of the movement (0, 1] at the crossing, or -1 if none
+static float segmentCrossing(const cv::Point2f& p0, const cv::Point2f& p1,
+                             const cv::Point2f& l0, const cv::Point2f& l1) {
+    float dx = p1.x - p0.x, dy = p1.y - p0.y;
+    float lx = l1.x - l0.x, ly = l1.y - l0.y;
+    float denom = dx * ly - dy * lx;
+    if (std::abs(denom) < 1e-9f) {
+        return -1.0f;  // Parallel or not moving
+    }
+    
+    float qx = l0.x - p0.x, qy = l0.y - p0.y;
+    float u = (qx * ly - qy * lx) / denom;  // Along the movement
+    float v = (qx * dy - qy * dx) / denom;  // Along the line
+    
+    // (0, 1] so a position exactly on the line counts once
+    if (u <= 0.0f || u > 1.0f || v < 0.0f || v > 1.0f) {
+        return -1.0f;
+    }
+    return u;
+}
+
+void SpeedCalculator::setCalibrationRegistry(std::shared_ptr<const CalibrationRegistry> registry,
+                                             int muxer_width,
+                                             int muxer_height) {
+    registry_ = std::move(registry);
+    registry_width_ = muxer_width;
+    registry_height_ = muxer_height;
+}
+
+void SpeedCalculator::replaceCalibrationRegistry(std::shared_ptr<const CalibrationRegistry> registry,
+                                                 int muxer_width,
+                                                 int muxer_height) {
+    std::lock_guard<std::mutex> lock(pending_registry_mutex_);
+    pending_registry_ = std::move(registry);
+    pending_width_ = muxer_width;
+    pending_height_ = muxer_height;
+    registry_pending_.store(true, std::memory_order_release);
+}
+
+void SpeedCalculator::syncCalibrations() {
+    if (!registry_pending_.load(std::memory_order_acquire)) {
+        return;
+    }
+    
+    // The previous registry is released here, after its last lookup
+    std::lock_guard<std::mutex> lock(pending_registry_mutex_);
+    registry_ = std::move(pending_registry_);
+    registry_width_ = pending_width_;
+    registry_height_ = pending_height_;
+    registry_pending_.store(false, std::memory_order_relaxed);
+}
+
+bool SpeedCalculator::acceptsObject(int class_id, float cx, float bottom_y, int source_id) {
+    if (!config_.class_allowlist.empty() &&
+        (class_id < 0 || static_cast<size_t>(class_id) >= class_allowed_.size() ||
+         !class_allowed_[class_id])) {
+        objects_rejected_++;
+        return false;
+    }
+    
+    // Uncalibrated cameras are rejected by processObject itself
+    if (config_.zone_filter) {
+        const ViewTransformer* transformer = transformerFor(source_id);
+        if (transformer && !transformer->zone().contains(cx, bottom_y, config_.zone_margin_px)) {
+            objects_rejected_++;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SpeedCalculator::shedObject(int track_id, float cx, float bottom_y, int source_id, int frame_number) {
+    if (degradation_ < Degradation::ZoneOnly) {
+        return false;
+    }
+    
+    auto it = tracks_.find(track_id);
+    const ViewTransformer* transformer = transformerFor(source_id);
+    if (transformer && !transformer->zone().contains(cx, bottom_y, 0.0f)) {
+        if (it != tracks_.end()) {
+            it->second.missed_frames++;
+        }
+        objects_outside_zone_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    // A track only waits if its alert does not and it has waited little.
+    // Each track also has its own turn every max_deferred_frames + 1 frames,
+    // so the tracks deferred in a burst come due spread over that many
+    // frames instead of all on the same one
+    if (degradation_ < Degradation::DeferTracks || it == tracks_.end()) {
+        return false;
+    }
+    TrackState& track = it->second;
+    const int period = config_.max_deferred_frames + 1;
+    if (track.alert_state == AlertState::Candidate || track.alert_state == AlertState::Confirmed ||
+        track.missed_frames >= config_.max_deferred_frames ||
+        (static_cast<unsigned>(frame_number) + static_cast<unsigned>(track_id)) % period == 0) {
+        return false;
+    }
+    track.missed_frames++;
+    tracks_deferred_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void SpeedCalculator::countDegradedBuffer(Degradation highest) {
+    if (highest != Degradation::None) {
+        degraded_buffers_[static_cast<int>(highest) - 1].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+DegradationStats SpeedCalculator::degradationStats() const {
+    DegradationStats stats;
+    for (int i = 0; i < 3; i++) {
+        stats.buffers[i] = degraded_buffers_[i].load(std::memory_order_relaxed);
+    }
+    stats.medians_skipped = medians_skipped_.load(std::memory_order_relaxed);
+    stats.objects_outside_zone = objects_outside_zone_.load(std::memory_order_relaxed);
+    stats.tracks_deferred = tracks_deferred_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+TrackStats SpeedCalculator::trackStats() const {
+    TrackStats stats;
+    stats.closed = tracks_closed_.load(std::memory_order_relaxed);
+    stats.measured = tracks_measured_.load(std::memory_order_relaxed);
+    stats.reassociated = tracks_reassociated_.load(std::memory_order_relaxed);
+    return stats;
 }
 
 SpeedMeasurement SpeedCalculator::processObject(int track_id,
@@ -16,27 +193,96 @@ SpeedMeasurement SpeedCalculator::processObject(int track_id,
                                                float bottom_y,
                                                float bbox_area,
                                                float det_conf,
-                                               int frame_number) {
+                                               int frame_number,
+                                               int source_id) {
+    TraceScope trace(tracer_.get(), "processObject", frame_number, source_id);
+    
     SpeedMeasurement result;
     result.track_id = track_id;
     result.frame_number = frame_number;
     result.is_valid = false;
     result.is_overspeeding = false;
     result.speed_kmh = 0.0f;
+    result.alert = false;
+    result.peak_speed_kmh = 0.0f;
     
-    // Track birth frame
-    if (track_birth_frame_.find(track_id) == track_birth_frame_.end()) {
-        track_birth_frame_[track_id] = frame_number;
+    // Uncalibrated camera: nothing meaningful can be measured
+    const ViewTransformer* transformer = transformerFor(source_id);
+    if (!transformer) {
+        return result;
     }
     
     // Transform point to world coordinates
     cv::Point2f image_point(cx, bottom_y);
-    cv::Point2f world_point = transformer_->transformPoint(image_point);
+    cv::Point2f world_point = transformer->transformPoint(image_point);
     float y_world = world_point.y;
     
+    // Tracks of the previous process wait for their source's first frame
+    if (!restored_.empty()) {
+        adoptRestored(source_id, frame_number);
+    }
+    
+    const bool section = config_.estimator == SpeedEstimator::SectionLine;
+    auto it = tracks_.find(track_id);
+    if (it == tracks_.end()) {
+        it = addTrack(track_id, newTrack(source_id, frame_number, world_point));
+        if (config_.reassociation) {
+            new_tracks_.push_back(track_id);
+        }
+    }
+    TrackState& track = it->second;
+    
+    // The tracker reused the id of a restored track for another vehicle
+    if (track.resume_gap_frames > 0 && !resumeTrack(track, world_point)) {
+        replaceTrack(*it, newTrack(source_id, frame_number, world_point));
+    }
+    
+    if (config_.trajectory_enabled) {
+        track.trajectory.add(world_point.x, world_point.y, frame_number);
+        if (track.trajectory.full()) {
+            emitTrajectory(track_id, track, false);
+        }
+    }
+    
+    // Motion for re-association, averaged over the last two samples
+    if (frame_number > track.last_seen_frame) {
+        cv::Point2f step = (world_point - track.last_world) *
+                           (1.0f / (frame_number - track.last_seen_frame));
+        track.velocity = track.last_seen_frame > track.birth_frame
+                             ? (track.velocity + step) * 0.5f : step;
+    }
+    track.bbox_area = bbox_area;
+    
+    if (section) {
+        // Crossings are interpolated between samples, shed frames included
+        measureSection(track, world_point, frame_number, det_conf, result);
+        track.last_world = world_point;
+        track.last_seen_frame = frame_number;
+        track.missed_frames = 0;
+        return result;
+    }
+    
+    // Frames the track was shed on, or missed before it was re-associated,
+    // get interpolated positions, so the window still holds one position per
+    // frame; after a longer gap it starts over
+    auto& history = track.positions;
+    const int gap = frame_number - track.last_seen_frame;
+    if (track.missed_frames > 0 && gap > 1 && !history.empty()) {
+        if (static_cast<size_t>(gap) > static_cast<size_t>(config_.video_fps)) {
+            history = SlidingWindow(static_cast<size_t>(std::max(1.0f, config_.video_fps)));
+        } else {
+            float last_y = history.back();
+            for (int i = 1; i < gap; i++) {
+                history.push(last_y + (y_world - last_y) * i / gap);
+            }
+        }
+    }
+    track.missed_frames = 0;
+    track.last_seen_frame = frame_number;
+    track.last_world = world_point;
+    
     // Add to history
-    auto& history = history_positions_[track_id];
-    history.push_back(y_world);
+    history.push(y_world);
     
     // Need full window for speed calculation
     if (history.size() < static_cast<size_t>(config_.video_fps)) {
@@ -50,50 +296,751 @@ SpeedMeasurement SpeedCalculator::processObject(int track_id,
     }
     
     // Get bbox area history
-    float area_start = last_bbox_area_.count(track_id) ? last_bbox_area_[track_id] : bbox_area;
-    last_bbox_area_[track_id] = bbox_area;
+    float area_start = track.last_bbox_area > 0.0f ? track.last_bbox_area : bbox_area;
+    track.last_bbox_area = bbox_area;
     
     // Validate measurement
-    if (!isValidMeasurement(track_id, frame_number, history, raw_speed,
+    if (!isValidMeasurement(track, frame_number, history, raw_speed,
                            area_start, bbox_area, det_conf)) {
         return result;
     }
     
-    // Apply median filter
-    float filtered_speed = applyMedianFilter(track_id, raw_speed);
+    // Apply median filter (the window is kept filled while degraded)
+    float filtered_speed;
+    if (degradation_ >= Degradation::SkipMedian) {
+        track.speeds.push(raw_speed);
+        filtered_speed = raw_speed;
+        medians_skipped_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        filtered_speed = applyMedianFilter(track, raw_speed);
+    }
     
     // Update result
     result.speed_kmh = filtered_speed;
     result.is_valid = true;
     result.is_overspeeding = (filtered_speed > config_.speed_limit_kmh);
     
-    // Update display text
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(1) << filtered_speed << " km/h";
-    last_speed_text_[track_id] = oss.str();
-    last_update_frame_[track_id] = frame_number;
+    // Update display text (assign() reuses the string's storage)
+    char text[32];
+    int len = std::snprintf(text, sizeof(text), "%.1f km/h", filtered_speed);
+    track.last_speed_text.assign(text, static_cast<size_t>(std::max(len, 0)));
+    track.last_speed_kmh = filtered_speed;
+    track.last_update_frame = frame_number;
+    
+    updateAlert(track, result);
     
     return result;
 }
 
+SpeedCalculator::TrackState SpeedCalculator::newTrack(int source_id,
+                                                      int frame_number,
+                                                      const cv::Point2f& world) const {
+    // Windows are sized once here and reused for the track's lifetime
+    // (the section estimator needs none)
+    TrackState state;
+    if (config_.estimator != SpeedEstimator::SectionLine) {
+        state.positions = SlidingWindow(static_cast<size_t>(std::max(1.0f, config_.video_fps)));
+        state.speeds = SlidingWindow(static_cast<size_t>(std::max(1, config_.median_window)));
+    }
+    if (config_.trajectory_enabled) {
+        state.trajectory = TrajectorySimplifier(
+            config_.trajectory_max_error_m,
+            static_cast<size_t>(std::max(2, config_.trajectory_max_vertices)));
+    }
+    state.source_id = source_id;
+    state.birth_frame = frame_number;
+    state.last_seen_frame = frame_number;
+    state.last_world = world;
+    return state;
+}
+
+SpeedCalculator::TrackMap::iterator SpeedCalculator::addTrack(int track_id, TrackState&& track) {
+    auto it = tracks_.emplace(track_id, std::move(track)).first;
+    auto& index = source_tracks_[it->second.source_id];
+    it->second.source_slot = static_cast<uint32_t>(index.size());
+    index.push_back(&*it);
+    return it;
+}
+
+void SpeedCalculator::replaceTrack(TrackMap::value_type& entry, TrackState&& track) {
+    unindexTrack(entry);
+    entry.second = std::move(track);
+    auto& index = source_tracks_[entry.second.source_id];
+    entry.second.source_slot = static_cast<uint32_t>(index.size());
+    index.push_back(&entry);
+}
+
+void SpeedCalculator::eraseTrack(TrackMap::iterator it) {
+    unindexTrack(*it);
+    tracks_.erase(it);
+}
+
+void SpeedCalculator::unindexTrack(TrackMap::value_type& entry) {
+    auto& index = source_tracks_[entry.second.source_id];
+    TrackMap::value_type* last = index.back();
+    index[entry.second.source_slot] = last;
+    last->second.source_slot = entry.second.source_slot;
+    index.pop_back();
+}
+
+void SpeedCalculator::measureSection(TrackState& track,
+                                     const cv::Point2f& world,
+                                     int frame_number,
+                                     float det_conf,
+                                     SpeedMeasurement& result) {
+    // Already measured (one reading per track), or no new sample
+    if ((track.crossed_a_s >= 0.0f && track.crossed_b_s >= 0.0f) ||
+        frame_number <= track.last_seen_frame) {
+        return;
+    }
+    
+    // Sub-frame crossing time by linear interpolation between the samples
+    auto crossing_time = [&](const cv::Point2f* line) {
+        float u = segmentCrossing(track.last_world, world, line[0], line[1]);
+        if (u < 0.0f) {
+            return -1.0f;
+        }
+        // Relative to the track's birth, so rebasing frame numbers on restore
+        // leaves recorded crossings valid
+        float frame = track.last_seen_frame + u * (frame_number - track.last_seen_frame);
+        return (frame - track.birth_frame) / config_.video_fps;
+    };
+    
+    // Either direction of travel: A then B, or B then A
+    if (track.crossed_a_s < 0.0f) {
+        track.crossed_a_s = crossing_time(config_.section_line_a);
+    }
+    if (track.crossed_b_s < 0.0f) {
+        track.crossed_b_s = crossing_time(config_.section_line_b);
+    }
+    if (track.crossed_a_s < 0.0f || track.crossed_b_s < 0.0f) {
+        return;
+    }
+    
+    float dt = std::abs(track.crossed_b_s - track.crossed_a_s);
+    if (dt <= 0.0f) {
+        return;
+    }
+    float speed_kmh = section_distance_m_ / dt * 3.6f;
+    if (speed_kmh > config_.max_abs_kmh || det_conf < config_.min_det_conf) {
+        return;
+    }
+    
+    result.speed_kmh = speed_kmh;
+    result.is_valid = true;
+    result.is_overspeeding = speed_kmh > config_.speed_limit_kmh;
+    
+    char text[32];
+    int len = std::snprintf(text, sizeof(text), "%.1f km/h", speed_kmh);
+    track.last_speed_text.assign(text, static_cast<size_t>(std::max(len, 0)));
+    track.last_speed_kmh = speed_kmh;
+    track.last_update_frame = frame_number;
+    
+    updateAlert(track, result);
+}
+
+void SpeedCalculator::updateAlert(TrackState& track, SpeedMeasurement& result) {
+    switch (track.alert_state) {
+        case AlertState::Idle:
+        case AlertState::Candidate:
+            if (!result.is_overspeeding) {
+                track.alert_state = AlertState::Idle;
+                track.overspeed_readings = 0;
+                track.peak_speed_kmh = 0.0f;
+                return;
+            }
+            track.alert_state = AlertState::Candidate;
+            track.peak_speed_kmh = std::max(track.peak_speed_kmh, result.speed_kmh);
+            // A section measurement is a single, already averaged reading
+            if (++track.overspeed_readings < config_.alert_confirm_frames &&
+                config_.estimator != SpeedEstimator::SectionLine) {
+                return;
+            }
+            track.alert_state = AlertState::Confirmed;
+            break;
+            
+        case AlertState::Confirmed:
+            // Waiting for a token; keep the peak current until then
+            if (result.is_overspeeding) {
+                track.peak_speed_kmh = std::max(track.peak_speed_kmh, result.speed_kmh);
+            }
+            break;
+            
+        case AlertState::Emitted:
+            return;
+    }
+    
+    if (!alert_bucket_->take(steadySeconds())) {
+        return;
+    }
+    track.alert_state = AlertState::Emitted;
+    result.alert = true;
+    result.peak_speed_kmh = track.peak_speed_kmh;
+    alerts_emitted_++;
+}
+
+AlertTokenBucket::AlertTokenBucket(float rate_per_s, int burst)
+    : rate_per_s_(rate_per_s), burst_(burst), tokens_(burst) {}
+
+bool AlertTokenBucket::take(double now_s) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // Callers on other threads may have read the clock a little later
+    if (now_s > updated_s_) {
+        if (updated_s_ > 0.0) {
+            tokens_ = std::min<double>(burst_, tokens_ + (now_s - updated_s_) * rate_per_s_);
+        }
+        updated_s_ = now_s;
+    }
+    
+    if (tokens_ < 1.0) {
+        return false;
+    }
+    tokens_ -= 1.0;
+    return true;
+}
+
+double AlertTokenBucket::tokens() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tokens_;
+}
+
+void AlertTokenBucket::setTokens(double tokens) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tokens_ = std::min<double>(tokens, burst_);
+}
+
+Degradation DegradationBudget::stageFor(int64_t elapsed_us, int64_t budget_us) {
+    if (elapsed_us >= budget_us) {
+        return Degradation::DeferTracks;
+    }
+    if (elapsed_us * 4 >= budget_us * 3) {
+        return Degradation::ZoneOnly;
+    }
+    if (elapsed_us * 2 >= budget_us) {
+        return Degradation::SkipMedian;
+    }
+    return Degradation::None;
+}
+
+Degradation DegradationBudget::beginBuffer(int64_t budget_us) {
+    budget_us_ = budget_us;
+    stage_ = Degradation::None;
+    tail_us_ = 0;
+    if (budget_us_ > 0 && last_stage_ != Degradation::None) {
+        stage_ = static_cast<Degradation>(static_cast<int>(last_stage_) - 1);
+    }
+    return stage_;
+}
+
+Degradation DegradationBudget::update(int64_t elapsed_us) {
+    if (canRise()) {
+        stage_ = std::max(stage_, stageFor(elapsed_us + last_tail_us_, budget_us_));
+    }
+    return stage_;
+}
+
+Degradation DegradationBudget::endBuffer() {
+    // Without a budget nothing carries over to a budget set later
+    last_stage_ = budget_us_ > 0 ? stage_ : Degradation::None;
+    last_tail_us_ = budget_us_ > 0 ? tail_us_ : 0;
+    return stage_;
+}
+
+void SpeedCalculator::endFrame(int source_id, int frame_number) {
+    TraceScope trace(tracer_.get(), "endFrame", frame_number, source_id);
+    
+    source_frames_[source_id] = frame_number;
+    
+    // Restored tracks of sources that never came back
+    if (!restored_.empty() && steadySeconds() > restored_expiry_s_) {
+        restored_.clear();
+    }
+    
+    // Before closing, so a lost track can still be continued
+    if (!new_tracks_.empty()) {
+        reassociate(source_id, frame_number);
+    }
+    
+    auto index = source_tracks_.find(source_id);
+    if (index == source_tracks_.end()) {
+        return;
+    }
+    // Backwards, as erasing moves the last entry into the erased slot
+    for (size_t i = index->second.size(); i-- > 0;) {
+        // Frame numbers going backwards means the source restarted
+        TrackMap::value_type& entry = *index->second[i];
+        bool lost = frame_number - entry.second.last_seen_frame > config_.track_lost_frames ||
+                    frame_number < entry.second.last_seen_frame;
+        if (!lost) {
+            continue;
+        }
+        
+        closeTrack(entry.first, entry.second);
+        eraseTrack(tracks_.find(entry.first));
+    }
+}
+
+// Grid cell key of a world position
+static uint64_t lostCell(int cell_x, int cell_y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cell_x)) << 32) |
+           static_cast<uint32_t>(cell_y);
+}
+
+void SpeedCalculator::reassociate(int source_id, int frame_number) {
+    const int max_gap = std::min(config_.reassoc_max_gap_frames,
+                                 static_cast<int>(config_.video_fps));
+    
+    // New tracks of this source that have a second position (a velocity)
+    // by now; the others wait as long as a lost track would
+    std::vector<int> ready;
+    size_t kept = 0;
+    for (int track_id : new_tracks_) {
+        auto it = tracks_.find(track_id);
+        if (it == tracks_.end()) {
+            continue;
+        }
+        const TrackState& track = it->second;
+        if (track.source_id != source_id) {
+            new_tracks_[kept++] = track_id;
+        } else if (track.last_seen_frame > track.birth_frame) {
+            ready.push_back(track_id);
+        } else if (frame_number - track.birth_frame < max_gap) {
+            new_tracks_[kept++] = track_id;
+        }
+    }
+    new_tracks_.resize(kept);
+    if (ready.empty()) {
+        return;
+    }
+    
+    // Lost tracks of the source, at their constant-velocity prediction for
+    // this frame; a new track waited at most max_gap frames for its second
+    // position, so they may be unseen for twice that. A track shed on every
+    // frame since is not lost, and a track seen once has no velocity.
+    const float cell = std::max(0.1f, config_.reassoc_max_distance_m);
+    lost_tracks_.clear();
+    lost_grid_.clear();
+    for (TrackMap::value_type* entry : source_tracks_[source_id]) {
+        TrackState& track = entry->second;
+        int gap = frame_number - track.last_seen_frame;
+        if (gap < 1 || gap > 2 * max_gap ||
+            gap <= track.missed_frames || track.last_seen_frame == track.birth_frame) {
+            continue;
+        }
+        cv::Point2f predicted = track.last_world + track.velocity * static_cast<float>(gap);
+        lost_grid_[lostCell(static_cast<int>(std::floor(predicted.x / cell)),
+                            static_cast<int>(std::floor(predicted.y / cell)))]
+            .push_back(static_cast<uint32_t>(lost_tracks_.size()));
+        lost_tracks_.push_back({entry->first, &track, predicted, false});
+    }
+    if (lost_tracks_.empty()) {
+        return;
+    }
+    
+    const float max_d2 = config_.reassoc_max_distance_m * config_.reassoc_max_distance_m;
+    const float max_dv = config_.reassoc_max_speed_diff_kmh / 3.6f / config_.video_fps;
+    for (int track_id : ready) {
+        TrackMap::value_type& entry = *tracks_.find(track_id);
+        TrackState& track = entry.second;
+        
+        // Anything within the distance is in the 3x3 cells around the position
+        int cell_x = static_cast<int>(std::floor(track.last_world.x / cell));
+        int cell_y = static_cast<int>(std::floor(track.last_world.y / cell));
+        LostTrack* best = nullptr;
+        float best_d2 = max_d2;
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                auto bucket = lost_grid_.find(lostCell(cell_x + dx, cell_y + dy));
+                if (bucket == lost_grid_.end()) {
+                    continue;
+                }
+                for (uint32_t index : bucket->second) {
+                    LostTrack& lost = lost_tracks_[index];
+                    const TrackState& old = *lost.state;
+                    
+                    // Gone before the new id appeared, not too long before
+                    int gap = track.birth_frame - old.last_seen_frame;
+                    if (lost.taken || gap < 1 || gap > max_gap) {
+                        continue;
+                    }
+                    cv::Point2f d = track.last_world - lost.predicted;
+                    float d2 = d.x * d.x + d.y * d.y;
+                    cv::Point2f dv = track.velocity - old.velocity;
+                    float area_ratio = std::max(track.bbox_area, old.bbox_area) /
+                                       std::max(1.0f, std::min(track.bbox_area, old.bbox_area));
+                    if (d2 > best_d2 || dv.x * dv.x + dv.y * dv.y > max_dv * max_dv ||
+                        area_ratio > config_.bbox_area_jump) {
+                        continue;
+                    }
+                    best = &lost;
+                    best_d2 = d2;
+                }
+            }
+        }
+        if (!best) {
+            continue;
+        }
+        
+        // The lost track continues under the new id; its positions since it
+        // was last seen are interpolated at the next update (the new id's two
+        // are dropped) and the section estimator interpolates crossings anyway
+        best->taken = true;
+        auto old = tracks_.find(best->track_id);
+        unindexTrack(*old);
+        replaceTrack(entry, std::move(old->second));
+        track.missed_frames = std::max(1, frame_number - track.last_seen_frame);
+        tracks_.erase(old);
+        tracks_reassociated_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SpeedCalculator::removeSource(int source_id) {
+    auto index = source_tracks_.find(source_id);
+    if (index != source_tracks_.end()) {
+        for (TrackMap::value_type* entry : index->second) {
+            int track_id = entry->first;
+            closeTrack(track_id, entry->second);
+            tracks_.erase(track_id);
+        }
+        source_tracks_.erase(index);
+    }
+    
+    source_frames_.erase(source_id);
+    restored_.erase(source_id);
+}
+
+void SpeedCalculator::closeTrack(int track_id, TrackState& track) {
+    tracks_closed_.fetch_add(1, std::memory_order_relaxed);
+    if (track.last_update_frame >= 0) {
+        tracks_measured_.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Confirmed but never emitted: the burst budget swallowed it
+    if (track.alert_state == AlertState::Confirmed) {
+        alerts_suppressed_++;
+    }
+    if (config_.trajectory_enabled) {
+        emitTrajectory(track_id, track, true);
+    }
+}
+
+void SpeedCalculator::emitTrajectory(int track_id, TrackState& track, bool finish) {
+    uint32_t points = track.trajectory.pointCount();
+    
+    Trajectory trajectory;
+    trajectory.source_id = track.source_id;
+    trajectory.track_id = track_id;
+    trajectory.video_fps = config_.video_fps;
+    trajectory.max_error_m = track.trajectory.maxError();
+    trajectory.complete = finish;
+    track.trajectory.take(trajectory.vertices, finish);
+    
+    // A single position is not a path
+    if (trajectory.vertices.size() < 2) {
+        return;
+    }
+    trajectory.num_points = points;
+    trajectories_.push_back(std::move(trajectory));
+}
+
+void SpeedCalculator::takeTrajectories(std::vector<Trajectory>& out) {
+    out.clear();
+    out.swap(trajectories_);
+}
+
+// Fixed-size fields in host byte order; checkpoints are read back by the
+// same build on the same machine
+template <typename T>
+static void putValue(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool getValue(const std::string& data, size_t& pos, T& value) {
+    if (data.size() - pos < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, data.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+static void putWindow(std::string& out, const SlidingWindow& window) {
+    putValue<uint16_t>(out, static_cast<uint16_t>(window.size()));
+    for (size_t i = 0; i < window.size(); i++) {
+        putValue<float>(out, window[i]);
+    }
+}
+
+static bool getWindow(const std::string& data, size_t& pos, SlidingWindow& window) {
+    uint16_t count;
+    if (!getValue(data, pos, count)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        float value;
+        if (!getValue(data, pos, value)) {
+            return false;
+        }
+        window.push(value);  // Keeps the newest values if the window shrank
+    }
+    return true;
+}
+
+void SpeedCalculator::captureState(CheckpointState& out) const {
+    out.wall_us = wallMicros();
+    out.video_fps = config_.video_fps;
+    out.alert_tokens = alert_bucket_->tokens();
+    if (out.tracks.size() < tracks_.size()) {
+        out.tracks.resize(tracks_.size());
+    }
+    out.count = 0;
+    
+    for (const auto& [source_id, index] : source_tracks_) {
+        auto source = source_frames_.find(source_id);
+        for (const TrackMap::value_type* entry : index) {
+            const TrackState& track = entry->second;
+            int now = source != source_frames_.end() ? source->second : track.last_seen_frame;
+            
+            CheckpointState::Track& saved = out.tracks[out.count++];
+            saved.track_id = entry->first;
+            saved.source_id = track.source_id;
+            saved.birth_age = now - track.birth_frame;
+            saved.seen_age = now - track.last_seen_frame;
+            saved.update_age = track.last_update_frame < 0 ? -1 : now - track.last_update_frame;
+            saved.last_bbox_area = track.last_bbox_area;
+            saved.last_speed_kmh = track.last_speed_kmh;
+            saved.world_x = track.last_world.x;
+            saved.world_y = track.last_world.y;
+            saved.crossed_a_s = track.crossed_a_s;
+            saved.crossed_b_s = track.crossed_b_s;
+            saved.alert_state = static_cast<uint8_t>(track.alert_state);
+            saved.overspeed_readings = track.overspeed_readings;
+            saved.peak_speed_kmh = track.peak_speed_kmh;
+            saved.velocity_x = track.velocity.x;
+            saved.velocity_y = track.velocity.y;
+            saved.bbox_area = track.bbox_area;
+            saved.missed_frames = track.missed_frames;
+            saved.positions = track.positions;
+            saved.speeds = track.speeds;
+        }
+    }
+}
+
+void SpeedCalculator::serializeState(const CheckpointState& state, std::string& out) {
+    // Layout: magic, version, wall time (us), video_fps, alert tokens, track
+    // count, then per track its fields with frames relative to the latest
+    // frame of its source, its re-association state (velocity, bbox area,
+    // missed frames), followed by the position and speed windows
+    out.clear();
+    out.reserve(32 + state.count * 64);
+    out.append(kCheckpointMagic, sizeof(kCheckpointMagic));
+    putValue<uint32_t>(out, kCheckpointVersion);
+    putValue<int64_t>(out, state.wall_us);
+    putValue<float>(out, state.video_fps);
+    putValue<double>(out, state.alert_tokens);
+    putValue<uint32_t>(out, static_cast<uint32_t>(state.count));
+    
+    for (size_t i = 0; i < state.count; i++) {
+        const CheckpointState::Track& track = state.tracks[i];
+        putValue<int32_t>(out, track.track_id);
+        putValue<int32_t>(out, track.source_id);
+        putValue<int32_t>(out, track.birth_age);
+        putValue<int32_t>(out, track.seen_age);
+        putValue<int32_t>(out, track.update_age);
+        putValue<float>(out, track.last_bbox_area);
+        putValue<float>(out, track.last_speed_kmh);
+        putValue<float>(out, track.world_x);
+        putValue<float>(out, track.world_y);
+        putValue<float>(out, track.crossed_a_s);
+        putValue<float>(out, track.crossed_b_s);
+        putValue<uint8_t>(out, track.alert_state);
+        putValue<int32_t>(out, track.overspeed_readings);
+        putValue<float>(out, track.peak_speed_kmh);
+        putValue<float>(out, track.velocity_x);
+        putValue<float>(out, track.velocity_y);
+        putValue<float>(out, track.bbox_area);
+        putValue<int32_t>(out, track.missed_frames);
+        putWindow(out, track.positions);
+        putWindow(out, track.speeds);
+    }
+}
+
+void SpeedCalculator::saveState(std::string& out) const {
+    CheckpointState state;
+    captureState(state);
+    serializeState(state, out);
+}
+
+int SpeedCalculator::restoreState(const std::string& data) {
+    size_t pos = sizeof(kCheckpointMagic);
+    if (data.size() < pos || std::memcmp(data.data(), kCheckpointMagic, pos) != 0) {
+        return -1;
+    }
+    
+    uint32_t version, count;
+    int64_t wall_us;
+    float video_fps;
+    double alert_tokens;
+    // Version 1 lacks the re-association state: its tracks resume, but are
+    // not re-associated until a few updates have rebuilt their velocity
+    if (!getValue(data, pos, version) || version < 1 || version > kCheckpointVersion ||
+        !getValue(data, pos, wall_us) || !getValue(data, pos, video_fps) ||
+        !getValue(data, pos, alert_tokens) || !getValue(data, pos, count)) {
+        return -1;
+    }
+    
+    // Position windows hold one sample per frame; another rate makes them useless
+    const bool keep_windows = video_fps == config_.video_fps;
+    
+    std::unordered_map<int, std::vector<std::pair<int, TrackState>>> restored;
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t track_id, source_id, birth_age, seen_age, update_age, overspeed_readings;
+        float bbox_area, speed_kmh, world_x, world_y, crossed_a_s, crossed_b_s, peak_speed_kmh;
+        uint8_t alert_state;
+        if (!getValue(data, pos, track_id) || !getValue(data, pos, source_id) ||
+            !getValue(data, pos, birth_age) || !getValue(data, pos, seen_age) ||
+            !getValue(data, pos, update_age) || !getValue(data, pos, bbox_area) ||
+            !getValue(data, pos, speed_kmh) || !getValue(data, pos, world_x) ||
+            !getValue(data, pos, world_y) || !getValue(data, pos, crossed_a_s) ||
+            !getValue(data, pos, crossed_b_s) || !getValue(data, pos, alert_state) ||
+            !getValue(data, pos, overspeed_readings) || !getValue(data, pos, peak_speed_kmh) ||
+            alert_state > static_cast<uint8_t>(AlertState::Emitted)) {
+            return -1;
+        }
+        
+        // Frames relative to the checkpoint (0); rebased in adoptRestored
+        TrackState track = newTrack(source_id, -birth_age, cv::Point2f(world_x, world_y));
+        track.last_seen_frame = -seen_age;
+        track.last_update_frame = update_age < 0 ? -1 : -update_age;
+        track.last_bbox_area = bbox_area;
+        track.last_speed_kmh = speed_kmh;
+        track.crossed_a_s = crossed_a_s;
+        track.crossed_b_s = crossed_b_s;
+        track.alert_state = static_cast<AlertState>(alert_state);
+        track.overspeed_readings = overspeed_readings;
+        track.peak_speed_kmh = peak_speed_kmh;
+        
+        if (version >= 2) {
+            float velocity_x, velocity_y;
+            int32_t missed_frames;
+            if (!getValue(data, pos, velocity_x) || !getValue(data, pos, velocity_y) ||
+                !getValue(data, pos, track.bbox_area) || !getValue(data, pos, missed_frames)) {
+                return -1;
+            }
+            
+            // Meters per frame at the checkpoint's rate
+            float rate = config_.video_fps > 0.0f ? video_fps / config_.video_fps : 1.0f;
+            track.velocity = cv::Point2f(velocity_x, velocity_y) * rate;
+            track.missed_frames = missed_frames;
+        }
+        
+        SlidingWindow positions = track.positions;
+        SlidingWindow speeds = track.speeds;
+        if (!getWindow(data, pos, positions) || !getWindow(data, pos, speeds)) {
+            return -1;
+        }
+        if (keep_windows) {
+            track.positions = positions;
+            track.speeds = speeds;
+        }
+        
+        if (update_age >= 0) {
+            char text[32];
+            int len = std::snprintf(text, sizeof(text), "%.1f km/h", speed_kmh);
+            track.last_speed_text.assign(text, static_cast<size_t>(std::max(len, 0)));
+        }
+        restored[source_id].emplace_back(track_id, std::move(track));
+    }
+    if (pos != data.size()) {
+        return -1;
+    }
+    
+    restored_ = std::move(restored);
+    restored_wall_us_ = wall_us;
+    double age_s = (wallMicros() - wall_us) / 1e6;
+    restored_expiry_s_ = steadySeconds() - age_s + config_.track_lost_frames / config_.video_fps;
+    alert_bucket_->setTokens(alert_tokens);
+    return static_cast<int>(count);
+}
+
+void SpeedCalculator::adoptRestored(int source_id, int frame_number) {
+    auto entry = restored_.find(source_id);
+    if (entry == restored_.end()) {
+        return;
+    }
+    
+    // Frames that passed since the checkpoint, by the wall clock
+    double elapsed_s = std::max<int64_t>(0, wallMicros() - restored_wall_us_) / 1e6;
+    int shift = frame_number - static_cast<int>(std::lround(elapsed_s * config_.video_fps));
+    
+    for (auto& [track_id, track] : entry->second) {
+        track.birth_frame += shift;
+        track.last_seen_frame += shift;
+        if (!track.last_speed_text.empty()) {  // Measured at least once
+            track.last_update_frame += shift;
+        }
+        // At least one frame, also for a restart faster than a frame interval
+        track.resume_gap_frames = std::max(1, frame_number - track.last_seen_frame);
+        
+        // Lost during the restart, or the tracker already reused the id
+        if (track.resume_gap_frames > config_.track_lost_frames || tracks_.count(track_id)) {
+            continue;
+        }
+        addTrack(track_id, std::move(track));
+    }
+    restored_.erase(entry);
+}
+
+bool SpeedCalculator::resumeTrack(TrackState& track, const cv::Point2f& world) {
+    int gap = track.resume_gap_frames;
+    track.resume_gap_frames = 0;
+    
+    float dx = world.x - track.last_world.x;
+    float dy = world.y - track.last_world.y;
+    float reach_m = config_.max_abs_kmh / 3.6f * gap / config_.video_fps + kResumeSlackM;
+    if (dx * dx + dy * dy > reach_m * reach_m) {
+        return false;
+    }
+    
+    // The window assumes one position per frame: fill the frames missed during
+    // the restart by linear interpolation, so its time span stays correct
+    // (the section estimator interpolates across last_seen_frame by itself)
+    if (!track.positions.empty() && gap > 1) {
+        float from = track.positions.back();
+        int first = std::max(1, gap - static_cast<int>(config_.video_fps));
+        for (int k = first; k < gap; k++) {
+            track.positions.push(from + (world.y - from) * k / gap);
+        }
+    }
+    return true;
+}
+
 std::string SpeedCalculator::getSpeedText(int track_id) const {
-    auto it = last_speed_text_.find(track_id);
-    if (it != last_speed_text_.end()) {
-        return it->second;
+    auto it = tracks_.find(track_id);
+    if (it != tracks_.end()) {
+        return it->second.last_speed_text;
     }
     return "";
 }
 
+float SpeedCalculator::getLastSpeed(int track_id) const {
+    auto it = tracks_.find(track_id);
+    if (it != tracks_.end()) {
+        return it->second.last_speed_kmh;
+    }
+    return 0.0f;
+}
+
 void SpeedCalculator::clearTrack(int track_id) {
-    history_positions_.erase(track_id);
-    speed_history_.erase(track_id);
-    track_birth_frame_.erase(track_id);
-    last_bbox_area_.erase(track_id);
-    last_speed_text_.erase(track_id);
-    last_update_frame_.erase(track_id);
+    auto it = tracks_.find(track_id);
+    if (it != tracks_.end()) {
+        eraseTrack(it);
+    }
 }
 
-float SpeedCalculator::computeSpeedKmh(const std::deque<float>& history) const {
+float SpeedCalculator::computeSpeedKmh(const SlidingWindow& history) const {
     if (history.size() < static_cast<size_t>(config_.video_fps)) {
         return -1.0f;
     }
@@ -109,16 +1056,15 @@ float SpeedCalculator::computeSpeedKmh(const std::deque<float>& history) const {
     return (distance_m / time_s) * 3.6f;
 }
 
-bool SpeedCalculator::isValidMeasurement(int track_id,
+bool SpeedCalculator::isValidMeasurement(const TrackState& track,
                                          int frame_no,
-                                         const std::deque<float>& history,
+                                         const SlidingWindow& history,
                                          float speed_kmh,
                                          float area_start,
                                          float area_end,
                                          float det_conf) const {
     // 1. Track age validation
-    int birth_frame = track_birth_frame_.at(track_id);
-    int age_frames = frame_no - birth_frame;
+    int age_frames = frame_no - track.birth_frame;
     if (age_frames < config_.min_track_age_frames) {
         return false;
     }
@@ -149,24 +1095,25 @@ bool SpeedCalculator::isValidMeasurement(int track_id,
     return true;
 }
 
-float SpeedCalculator::applyMedianFilter(int track_id, float raw_speed) {
-    auto& history = speed_history_[track_id];
-    history.push_back(raw_speed);
-    
-    // Keep only last N values
-    while (history.size() > static_cast<size_t>(config_.median_window)) {
-        history.pop_front();
-    }
-    
-    return computeMedian(history);
+float SpeedCalculator::applyMedianFilter(TrackState& track, float raw_speed) {
+    // Window keeps only the last median_window values
+    track.speeds.push(raw_speed);
+    return computeMedian(track.speeds);
 }
 
-float SpeedCalculator::computeMedian(std::deque<float> values) const {
+float SpeedCalculator::computeMedian(const SlidingWindow& values) const {
     if (values.empty()) {
         return 0.0f;
     }
     
-    std::vector<float> sorted(values.begin(), values.end());
+    // Scratch copy lives on the stack; only windows beyond 64 values reach the heap
+    std::array<std::byte, 64 * sizeof(float)> scratch;
+    std::pmr::monotonic_buffer_resource arena(scratch.data(), scratch.size());
+    std::pmr::vector<float> sorted(&arena);
+    sorted.reserve(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        sorted.push_back(values[i]);
+    }
     std::sort(sorted.begin(), sorted.end());
     
     size_t n = sorted.size();
@@ -177,4 +1124,15 @@ float SpeedCalculator::computeMedian(std::deque<float> values) const {
     }
 }
 
+const ViewTransformer* SpeedCalculator::transformerFor(int source_id) const {
+    if (registry_) {
+        const ViewTransformer* transformer =
+            registry_->transformer(source_id, registry_width_, registry_height_);
+        if (transformer) {
+            return transformer;
+        }
+    }
+    return transformer_.get();
+}
+
 } // namespace speedflow
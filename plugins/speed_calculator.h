@@ -1,13 +1,57 @@
 #pragma once
 
 #include "homography.h"
-#include <deque>
+#include "calibration_registry.h"
+#include "trajectory.h"
+#include "trace_recorder.h"
+#include <algorithm>
+#include <atomic>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace speedflow {
 
+/**
+ * How speed is derived from a track
+ */
+enum class SpeedEstimator {
+    Window,         // Displacement over the last video_fps positions (default)
+    SectionLine     // Time between crossing two world-space lines
+};
+
+/**
+ * Work shed when speedcalc runs over its per-buffer time budget; each
+ * stage includes the ones before it
+ */
+enum class Degradation {
+    None,
+    SkipMedian,     // Raw speed instead of the median of the last median_window
+    ZoneOnly,       // Only objects inside the calibration quadrilateral itself
+    DeferTracks     // Low-priority tracks wait for the next frame
+};
+
+/**
+ * Work shed under degradation, running totals
+ */
+struct DegradationStats {
+    uint64_t buffers[3] = {};       // Buffers whose highest stage was SkipMedian, ZoneOnly, DeferTracks
+    uint64_t medians_skipped = 0;
+    uint64_t objects_outside_zone = 0;
+    uint64_t tracks_deferred = 0;
+};
+
+/**
+ * Track lifetimes, running totals
+ */
+struct TrackStats {
+    uint64_t closed = 0;            // Tracks ended (lost or source removed)
+    uint64_t measured = 0;          // ... with at least one valid speed
+    uint64_t reassociated = 0;      // New tracker ids that continued a lost track
+};
+
 /**
  * Configuration for speed calculation
  * Ported from: IoT_Graduate/speedflow/settings.py
@@ -23,6 +67,37 @@ struct SpeedConfig {
     float bbox_area_jump = 2.5f;        // Max bbox area ratio change
     float min_det_conf = 0.45f;         // Minimum detection confidence
     int median_window = 5;              // Median filter window size
+    
+    // Alerting
+    int alert_confirm_frames = 3;       // Consecutive overspeed readings to confirm
+    float alert_rate_per_s = 2.0f;      // Sustained alert rate (all tracks)
+    int alert_burst = 10;               // Alerts allowed back to back
+    int track_lost_frames = 50;         // Frames unseen before a track is closed
+    
+    // Section-line estimator (world coordinates, meters)
+    SpeedEstimator estimator = SpeedEstimator::Window;
+    cv::Point2f section_line_a[2] = {{0.0f, 20.0f}, {24.0f, 20.0f}};
+    cv::Point2f section_line_b[2] = {{0.0f, 100.0f}, {24.0f, 100.0f}};
+    float section_distance_m = 0.0f;    // 0 = distance from line A's midpoint to line B
+    
+    // Trajectory export (simplified world-space path per track)
+    bool trajectory_enabled = false;
+    float trajectory_max_error_m = 0.25f;
+    int trajectory_max_vertices = 256;  // Longer paths are emitted in parts
+    
+    // Prefilter (see acceptsObject)
+    bool zone_filter = true;            // Only objects inside the calibration quadrilateral
+    float zone_margin_px = 0.0f;        // Grow the quadrilateral by this much
+    std::vector<int> class_allowlist;   // Detector class ids to measure, empty = all
+    
+    // Degradation (see shedObject)
+    int max_deferred_frames = 2;        // Frames in a row a track may be deferred
+    
+    // Re-association of new tracker ids with lost tracks (see endFrame)
+    bool reassociation = true;
+    int reassoc_max_gap_frames = 12;        // Frames unseen, at most video_fps
+    float reassoc_max_distance_m = 3.0f;    // From the predicted position (also the grid cell)
+    float reassoc_max_speed_diff_kmh = 30.0f;  // Velocity of a new track is from two positions
 };
 
 /**
@@ -34,6 +109,160 @@ struct SpeedMeasurement {
     int frame_number;
     bool is_valid;
     bool is_overspeeding;
+    bool alert;             // Overspeed alert emitted for this track on this call
+    float peak_speed_kmh;   // Peak filtered speed so far while overspeeding (if alert)
+};
+
+/**
+ * Fixed-capacity window over the most recent values
+ * Storage is allocated once; pushing into a full window overwrites the oldest
+ * value (like Python's deque(maxlen=N)).
+ */
+class SlidingWindow {
+public:
+    explicit SlidingWindow(size_t capacity = 0) : values_(capacity) {}
+    
+    void push(float value) {
+        if (values_.empty()) {
+            return;
+        }
+        values_[(head_ + size_) % values_.size()] = value;
+        if (size_ < values_.size()) {
+            size_++;
+        } else {
+            head_ = (head_ + 1) % values_.size();
+        }
+    }
+    
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    
+    /** @param i Index from the oldest (0) to the newest (size() - 1) value */
+    float operator[](size_t i) const { return values_[(head_ + i) % values_.size()]; }
+    float front() const { return (*this)[0]; }
+    float back() const { return (*this)[size_ - 1]; }
+
+private:
+    std::vector<float> values_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
+
+/**
+ * Track state copied out of a SpeedCalculator for a checkpoint
+ * Capturing is a plain copy on the thread that runs processObject; the
+ * copy can then be serialized on any other thread. Entries are reused by
+ * the next capture, which only allocates when the track count grows.
+ */
+struct CheckpointState {
+    struct Track {
+        int32_t track_id;
+        int32_t source_id;
+        int32_t birth_age;          // Frames before the source's latest frame
+        int32_t seen_age;
+        int32_t update_age;         // -1 = never measured
+        float last_bbox_area;
+        float last_speed_kmh;
+        float world_x;
+        float world_y;
+        float crossed_a_s;
+        float crossed_b_s;
+        uint8_t alert_state;
+        int32_t overspeed_readings;
+        float peak_speed_kmh;
+        float velocity_x;           // Re-association state (version 2)
+        float velocity_y;
+        float bbox_area;
+        int32_t missed_frames;
+        SlidingWindow positions;
+        SlidingWindow speeds;
+    };
+    
+    int64_t wall_us = 0;
+    float video_fps = 0.0f;
+    double alert_tokens = 0.0;
+    std::vector<Track> tracks;      // The first count are in use
+    size_t count = 0;
+};
+
+/**
+ * Token bucket limiting overspeed alerts (alert_rate_per_s, alert_burst)
+ * Every SpeedCalculator has one; calculators that must stay within one
+ * budget together share it (see setAlertTokenBucket). Only taken when an
+ * alert is about to fire, so the lock is rarely touched.
+ */
+class AlertTokenBucket {
+public:
+    AlertTokenBucket(float rate_per_s, int burst);
+    
+    /**
+     * Take one token
+     * @param now_s Steady clock in seconds
+     * @return false if the burst budget is exhausted
+     */
+    bool take(double now_s);
+    
+    double tokens() const;
+    void setTokens(double tokens);
+
+private:
+    const float rate_per_s_;
+    const int burst_;
+    mutable std::mutex mutex_;
+    double tokens_;
+    double updated_s_ = 0.0;
+};
+
+/**
+ * Degradation stages of speedcalc's buffers under a per-buffer time budget
+ * A buffer starts one stage below where the previous one ended, so a lasting
+ * burst is shed from its first object and a calm scene recovers within a
+ * few buffers. The stage then rises with the time spent on the buffer's
+ * objects plus the previous buffer's longest frame tail (endFrame and
+ * sinks), which cannot be shed. Times are microseconds on any clock; one
+ * instance per element, used by its streaming thread.
+ */
+class DegradationBudget {
+public:
+    /**
+     * Stage for the share of the budget used
+     * @param elapsed_us Time spent
+     * @param budget_us Time budget, > 0
+     */
+    static Degradation stageFor(int64_t elapsed_us, int64_t budget_us);
+    
+    /**
+     * Start a buffer
+     * @param budget_us Time budget of the buffer, 0 = never degrade
+     * @return Stage of the buffer's first object
+     */
+    Degradation beginBuffer(int64_t budget_us);
+    
+    /** Whether update() can still raise the stage (worth reading the clock) */
+    bool canRise() const { return budget_us_ > 0 && stage_ != Degradation::DeferTracks; }
+    
+    /**
+     * Raise the stage for the time spent on the buffer so far
+     * @param elapsed_us Time since the buffer started, tails excluded
+     * @return Current stage (never lower than before within a buffer)
+     */
+    Degradation update(int64_t elapsed_us);
+    
+    /** Record the tail (endFrame and sinks) of one of the buffer's frames */
+    void addTail(int64_t tail_us) { tail_us_ = std::max(tail_us_, tail_us); }
+    
+    /**
+     * End the buffer; its stage and longest tail carry over to the next
+     * @return Highest stage reached on the buffer
+     */
+    Degradation endBuffer();
+
+private:
+    int64_t budget_us_ = 0;
+    Degradation stage_ = Degradation::None;
+    int64_t tail_us_ = 0;
+    Degradation last_stage_ = Degradation::None;
+    int64_t last_tail_us_ = 0;
 };
 
 /**
@@ -45,6 +274,61 @@ public:
     explicit SpeedCalculator(std::shared_ptr<ViewTransformer> transformer,
                             const SpeedConfig& config = SpeedConfig());
     
+    /**
+     * Use per-camera calibrations instead of the single transformer
+     * Sources missing from the registry fall back to the default transformer.
+     * @param registry Prepared, immutable calibration registry
+     * @param muxer_width Frame width the registry was prepared for
+     * @param muxer_height Frame height the registry was prepared for
+     */
+    void setCalibrationRegistry(std::shared_ptr<const CalibrationRegistry> registry,
+                                int muxer_width,
+                                int muxer_height);
+    
+    /**
+     * Hand over a new registry from another thread (sources attached or
+     * detached at runtime); it takes effect at the next syncCalibrations()
+     * @param registry Prepared, immutable calibration registry
+     * @param muxer_width Frame width the registry was prepared for
+     * @param muxer_height Frame height the registry was prepared for
+     */
+    void replaceCalibrationRegistry(std::shared_ptr<const CalibrationRegistry> registry,
+                                    int muxer_width,
+                                    int muxer_height);
+    
+    /**
+     * Adopt a registry passed to replaceCalibrationRegistry, if any
+     * Call on the processing thread before each batch; a single atomic load
+     * when nothing changed.
+     */
+    void syncCalibrations();
+    
+    /**
+     * Record per-object and per-frame timing spans
+     * @param tracer Started recorder, or nullptr to stop tracing
+     */
+    void setTracer(std::shared_ptr<TraceRecorder> tracer) { tracer_ = std::move(tracer); }
+    
+    /**
+     * Draw alerts from a bucket shared with other calculators instead of
+     * this one's own, so they are limited together
+     * @param bucket Shared bucket; call before the first frame
+     */
+    void setAlertTokenBucket(std::shared_ptr<AlertTokenBucket> bucket) { alert_bucket_ = std::move(bucket); }
+    
+    /**
+     * Prefilter run before processObject: rejects objects of classes outside
+     * class_allowlist and objects whose bottom-center point lies outside the
+     * source's calibration quadrilateral, before any track state or
+     * transform work is done for them
+     * @param class_id Detector class id
+     * @param cx Center X coordinate in image
+     * @param bottom_y Bottom Y coordinate in image
+     * @param source_id Stream the object belongs to (selects the calibration)
+     * @return true if the object should be passed to processObject
+     */
+    bool acceptsObject(int class_id, float cx, float bottom_y, int source_id);
+    
     /**
      * Process a tracked object and calculate speed
      * @param track_id Object tracking ID
@@ -53,6 +337,7 @@ public:
      * @param bbox_area Bounding box area
      * @param det_conf Detection confidence
      * @param frame_number Current frame number
+     * @param source_id Stream the object belongs to (selects the calibration)
      * @return Speed measurement (may be invalid if validation fails)
      */
     SpeedMeasurement processObject(int track_id,
@@ -60,7 +345,47 @@ public:
                                    float bottom_y,
                                    float bbox_area,
                                    float det_conf,
-                                   int frame_number);
+                                   int frame_number,
+                                   int source_id = 0);
+    
+    /**
+     * Set the degradation stage for the following calls
+     * Called by speedcalc as its per-buffer budget runs out.
+     */
+    void setDegradation(Degradation stage) { degradation_ = stage; }
+    Degradation degradation() const { return degradation_; }
+    
+    /**
+     * Degradation check for an object accepted by acceptsObject
+     * From ZoneOnly on, objects outside the calibration quadrilateral
+     * (margin ignored, even without zone_filter) are shed. With DeferTracks,
+     * so are tracks of low priority: measured or warming up, no alert
+     * pending, and deferred fewer than max_deferred_frames frames in a row.
+     * Every track is also updated on one frame in max_deferred_frames + 1,
+     * chosen by (frame_number + track_id), so a sustained burst updates
+     * about that fraction of the deferrable tracks per frame. New tracks
+     * and tracks with a pending alert are never deferred. A shed track's
+     * missed positions are interpolated at its next update.
+     * @param track_id Object tracking ID
+     * @param cx Center X coordinate in image
+     * @param bottom_y Bottom Y coordinate in image
+     * @param source_id Stream the object belongs to
+     * @param frame_number Frame of the object
+     * @return true if processObject must not be called for the object now
+     */
+    bool shedObject(int track_id, float cx, float bottom_y, int source_id, int frame_number);
+    
+    /**
+     * Count a buffer that was processed degraded
+     * @param highest Highest stage reached on the buffer (None is not counted)
+     */
+    void countDegradedBuffer(Degradation highest);
+    
+    /** Snapshot of the degradation counters, from any thread */
+    DegradationStats degradationStats() const;
+    
+    /** Snapshot of the track counters, from any thread */
+    TrackStats trackStats() const;
     
     /**
      * Get last computed speed text for display
@@ -69,38 +394,307 @@ public:
      */
     std::string getSpeedText(int track_id) const;
     
+    /**
+     * Get last valid filtered speed
+     * @param track_id Tracking ID
+     * @return Speed in km/h, or 0 if the track has not been measured yet
+     */
+    float getLastSpeed(int track_id) const;
+    
     /**
      * Clear history for a specific track (when track is lost)
      * @param track_id Tracking ID
      */
     void clearTrack(int track_id);
+    
+    /**
+     * Close tracks of a source that have not been seen for track_lost_frames
+     * Call once per frame after its objects were processed.
+     *
+     * With reassociation, a track that is new since its previous frame (two
+     * positions, so a velocity) is first matched against the source's tracks
+     * unseen for 1..reassoc_max_gap_frames: the tracker may have given the
+     * same vehicle a new id. A lost track qualifies if its constant-velocity
+     * prediction is within reassoc_max_distance_m, its velocity within
+     * reassoc_max_speed_diff_kmh and its bbox area within bbox_area_jump of
+     * the new track's. The closest one is moved to the new id, with its
+     * windows, alert state and trajectory, and the missed positions are
+     * interpolated at the next update, so the speed continues without
+     * warming up again. On a frame where a new track is ready, the source's
+     * lost tracks are bucketed in a world-space grid (O(source tracks)),
+     * after which the lookup per new track is O(1).
+     * @param source_id Stream source id
+     * @param frame_number Current frame number of that source
+     */
+    void endFrame(int source_id, int frame_number);
+    
+    /**
+     * Close every track of a source that was detached (its stream-eos)
+     * Tracks end as if lost, and the source's frame number and restored
+     * tracks are forgotten, so a new stream reusing the id starts clean.
+     * @param source_id Stream source id
+     */
+    void removeSource(int source_id);
+    
+    /**
+     * Move out the trajectories finished since the last call
+     * Tracks closed by endFrame, and tracks that reached the vertex budget
+     * (complete = false), produce one each when trajectory_enabled is set.
+     * @param out Receives the trajectories (previous contents replaced)
+     */
+    void takeTrajectories(std::vector<Trajectory>& out);
+    
+    /**
+     * Copy the live track state for a checkpoint
+     * Frame numbers are made relative to each source's latest frame and
+     * stamped with the wall-clock time, so another process can restore them.
+     * Call on the thread that runs processObject.
+     * @param out Receives the state (entries reused)
+     */
+    void captureState(CheckpointState& out) const;
+    
+    /**
+     * Serialize a captured state into a compact checkpoint, on any thread
+     * @param state Output of captureState
+     * @param out Receives the checkpoint (previous contents replaced)
+     */
+    static void serializeState(const CheckpointState& state, std::string& out);
+    
+    /**
+     * captureState and serializeState in one call
+     * @param out Receives the checkpoint (previous contents replaced)
+     */
+    void saveState(std::string& out) const;
+    
+    /**
+     * Load a checkpoint written by saveState, typically by the previous process
+     * Tracks are held back until their source delivers its first frame, then
+     * rebased onto the new frame numbers using the wall-clock time since the
+     * checkpoint. Tracks unseen for longer than track_lost_frames by then are
+     * dropped. If a restored track id reappears farther away than max_abs_kmh
+     * allows, it is another vehicle and starts as a new track.
+     * @param data Checkpoint bytes
+     * @return Number of tracks restored, or -1 if data is not a valid checkpoint
+     */
+    int restoreState(const std::string& data);
+    
+    uint64_t alertsEmitted() const { return alerts_emitted_; }
+    uint64_t objectsRejected() const { return objects_rejected_; }
+    uint64_t alertsSuppressed() const { return alerts_suppressed_; }
 
 private:
     std::shared_ptr<ViewTransformer> transformer_;
     SpeedConfig config_;
     
-    // Track history: track_id -> deque of y_world positions
-    std::unordered_map<int, std::deque<float>> history_positions_;
+    // Optional per-camera calibrations (see setCalibrationRegistry)
+    std::shared_ptr<const CalibrationRegistry> registry_;
+    int registry_width_ = 0;
+    int registry_height_ = 0;
+    
+    // Registry waiting for syncCalibrations (see replaceCalibrationRegistry)
+    std::mutex pending_registry_mutex_;
+    std::shared_ptr<const CalibrationRegistry> pending_registry_;
+    int pending_width_ = 0;
+    int pending_height_ = 0;
+    std::atomic<bool> registry_pending_{false};
+    
+    std::shared_ptr<TraceRecorder> tracer_;     // Optional (see setTracer)
+    
+    // Degradation stage and what it shed (counters are read by other threads)
+    Degradation degradation_ = Degradation::None;
+    std::atomic<uint64_t> degraded_buffers_[3] = {};
+    std::atomic<uint64_t> medians_skipped_{0};
+    std::atomic<uint64_t> objects_outside_zone_{0};
+    std::atomic<uint64_t> tracks_deferred_{0};
+    
+    // Track lifetimes (read by other threads)
+    std::atomic<uint64_t> tracks_closed_{0};
+    std::atomic<uint64_t> tracks_measured_{0};
+    std::atomic<uint64_t> tracks_reassociated_{0};
+    
+    std::vector<bool> class_allowed_;   // Indexed by class id, empty = all allowed
+    uint64_t objects_rejected_ = 0;
+    
+    /**
+     * Per-track alert lifecycle:
+     *   Idle -> Candidate (valid overspeed reading)
+     *   Candidate -> Confirmed (alert_confirm_frames consecutive readings,
+     *                a valid reading under the limit goes back to Idle)
+     *   Confirmed -> Emitted (once, when the rate limiter has a token)
+     * The track (and its state) is closed when it is lost.
+     */
+    enum class AlertState { Idle, Candidate, Confirmed, Emitted };
+    
+    /**
+     * Everything known about one track, kept in a single map entry so a
+     * new track costs one allocation and an update one lookup
+     */
+    struct TrackState {
+        SlidingWindow positions;        // y_world over the last video_fps frames
+        SlidingWindow speeds;           // Raw speeds for median filtering
+        int source_id = 0;
+        uint32_t source_slot = 0;       // Index in source_tracks_[source_id]
+        int birth_frame = 0;
+        int last_seen_frame = 0;
+        int last_update_frame = -1;
+        float last_bbox_area = 0.0f;    // 0 until the first full window
+        float last_speed_kmh = 0.0f;
+        std::string last_speed_text;
+        
+        // Section-line estimator (windows above stay empty in that mode)
+        cv::Point2f last_world;
+        float crossed_a_s = -1.0f;      // Seconds from birth_frame to each crossing, -1 = not yet
+        float crossed_b_s = -1.0f;
+        
+        int resume_gap_frames = 0;      // Frames missed across a restart (restored tracks)
+        int missed_frames = 0;          // Frames shed, or bridged by re-association, since the last update
+        
+        // Re-association (see endFrame)
+        cv::Point2f velocity;           // World meters per frame, smoothed
+        float bbox_area = 0.0f;         // Latest
+        
+        AlertState alert_state = AlertState::Idle;
+        int overspeed_readings = 0;     // Consecutive, while Candidate
+        float peak_speed_kmh = 0.0f;
+        
+        TrajectorySimplifier trajectory;    // Only fed with trajectory_enabled
+    };
+    
+    using TrackMap = std::unordered_map<int, TrackState>;
+    TrackMap tracks_;
+    
+    // The same tracks per source (map nodes are stable), so endFrame only
+    // visits the tracks of the source that finished its frame
+    std::unordered_map<int, std::vector<TrackMap::value_type*>> source_tracks_;
+    std::unordered_map<int, int> source_frames_;    // Latest frame per source (checkpoints)
     
-    // Speed history for median filtering
-    std::unordered_map<int, std::deque<float>> speed_history_;
+    // Restored tracks per source, frames relative to the checkpoint (see restoreState)
+    std::unordered_map<int, std::vector<std::pair<int, TrackState>>> restored_;
+    int64_t restored_wall_us_ = 0;      // Checkpoint time (system clock)
+    double restored_expiry_s_ = 0.0;    // Steady clock time after which all have expired
+    std::vector<Trajectory> trajectories_;  // Finished, see takeTrajectories
     
-    // Track metadata
-    std::unordered_map<int, int> track_birth_frame_;
-    std::unordered_map<int, float> last_bbox_area_;
-    std::unordered_map<int, std::string> last_speed_text_;
-    std::unordered_map<int, int> last_update_frame_;
+    // Re-association: ids created since their source's last endFrame, and
+    // per endFrame the source's lost tracks bucketed by predicted position
+    struct LostTrack {
+        int track_id;
+        TrackState* state;              // Node in tracks_
+        cv::Point2f predicted;          // Where it would be on the current frame
+        bool taken;
+    };
+    std::vector<int> new_tracks_;
+    std::vector<LostTrack> lost_tracks_;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> lost_grid_;    // Cell -> lost_tracks_ index
+    float section_distance_m_;          // Resolved section length
+    
+    // Token bucket for alert bursts, own or shared (see setAlertTokenBucket)
+    std::shared_ptr<AlertTokenBucket> alert_bucket_;
+    uint64_t alerts_emitted_ = 0;
+    uint64_t alerts_suppressed_ = 0;
+    
+    /**
+     * Fresh state for a track's first position
+     * @param source_id Stream source id
+     * @param frame_number Current frame number
+     * @param world World position
+     */
+    TrackState newTrack(int source_id, int frame_number, const cv::Point2f& world) const;
+    
+    /**
+     * Add a track to tracks_ and to its source's index
+     * @param track_id Tracking ID (not in tracks_ yet)
+     * @param track Track state
+     * @return The new entry
+     */
+    TrackMap::iterator addTrack(int track_id, TrackState&& track);
+    
+    /**
+     * Replace the state of an existing track, keeping the source index right
+     * @param entry Entry in tracks_
+     * @param track New state (may belong to another source)
+     */
+    void replaceTrack(TrackMap::value_type& entry, TrackState&& track);
+    
+    /**
+     * Remove a track from tracks_ and from its source's index
+     * @param it Entry in tracks_
+     */
+    void eraseTrack(TrackMap::iterator it);
+    
+    /**
+     * Take an entry out of its source's index (swap with the last one)
+     * @param entry Entry in tracks_
+     */
+    void unindexTrack(TrackMap::value_type& entry);
+    
+    /**
+     * Continue lost tracks under the ids the tracker gave them anew
+     * @param source_id Stream source id
+     * @param frame_number Current frame number of that source
+     */
+    void reassociate(int source_id, int frame_number);
+    
+    /**
+     * Move the restored tracks of a source into tracks_ on its first frame
+     * @param source_id Stream source id
+     * @param frame_number Current frame number of that source
+     */
+    void adoptRestored(int source_id, int frame_number);
+    
+    /**
+     * Reconcile a restored track with its first position after the restart
+     * @param track Track state (resume_gap_frames > 0)
+     * @param world Current world position
+     * @return false if the position is implausible for the same vehicle
+     */
+    bool resumeTrack(TrackState& track, const cv::Point2f& world);
+    
+    /**
+     * Section-line measurement for one new position
+     * @param track Track state (last_world / last_seen_frame are the previous sample)
+     * @param world Current world position
+     * @param frame_number Current frame number
+     * @param det_conf Detection confidence
+     * @param result Set valid on the frame the second line is crossed
+     */
+    void measureSection(TrackState& track,
+                        const cv::Point2f& world,
+                        int frame_number,
+                        float det_conf,
+                        SpeedMeasurement& result);
+    
+    /**
+     * Move a track's simplified path into trajectories_
+     * @param track_id Tracking ID
+     * @param track Track state
+     * @param finish true when the track is closed, false when its vertex budget is full
+     */
+    void emitTrajectory(int track_id, TrackState& track, bool finish);
+    
+    /**
+     * Account for a track that ends (alert never emitted, final trajectory)
+     * @param track_id Tracking ID
+     * @param track Track state, erased by the caller afterwards
+     */
+    void closeTrack(int track_id, TrackState& track);
+    
+    /**
+     * Advance the alert state machine with a valid measurement
+     * @param track Track state
+     * @param result Measurement; alert/peak_speed_kmh are set when it fires
+     */
+    void updateAlert(TrackState& track, SpeedMeasurement& result);
     
     /**
      * Compute speed from position history
-     * @param history Deque of y_world positions
+     * @param history Window of y_world positions
      * @return Speed in km/h (or -1 if insufficient data)
      */
-    float computeSpeedKmh(const std::deque<float>& history) const;
+    float computeSpeedKmh(const SlidingWindow& history) const;
     
     /**
      * Validate speed measurement
-     * @param track_id Tracking ID
+     * @param track Track state
      * @param frame_no Current frame number
      * @param history Position history
      * @param speed_kmh Computed speed
@@ -109,9 +703,9 @@ private:
      * @param det_conf Detection confidence
      * @return true if measurement is valid
      */
-    bool isValidMeasurement(int track_id,
+    bool isValidMeasurement(const TrackState& track,
                            int frame_no,
-                           const std::deque<float>& history,
+                           const SlidingWindow& history,
                            float speed_kmh,
                            float area_start,
                            float area_end,
@@ -119,18 +713,25 @@ private:
     
     /**
      * Apply median filter to speed
-     * @param track_id Tracking ID
+     * @param track Track state
      * @param raw_speed Raw speed value
      * @return Filtered speed
      */
-    float applyMedianFilter(int track_id, float raw_speed);
+    float applyMedianFilter(TrackState& track, float raw_speed);
     
     /**
-     * Compute median of a deque
+     * Compute median of a window
      * @param values Input values
      * @return Median value
      */
-    float computeMedian(std::deque<float> values) const;
+    float computeMedian(const SlidingWindow& values) const;
+    
+    /**
+     * Select the transformer for a stream
+     * @param source_id Stream source id
+     * @return Registry transformer for the source, or the default transformer
+     */
+    const ViewTransformer* transformerFor(int source_id) const;
 };
 
 } // namespace speedflow
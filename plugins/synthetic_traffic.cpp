@@ -0,0 +1,80 @@
+#include "synthetic_traffic.h"
+#include <algorithm>
+#include <cmath>
+
+namespace speedflow {
+
+// Vehicles enter at the horizon band and leave at the bottom edge
+static constexpr float kEntryY = 0.30f;
+static constexpr float kExitY = 1.0f;
+
+SyntheticTraffic::SyntheticTraffic(const SyntheticTrafficConfig& config)
+    : config_(config) {
+    int lanes = std::max(1, config_.lanes);
+    float lane_span = config_.frame_width * 0.6f;
+    float lane_start = config_.frame_width * 0.2f;
+    float travel_px = (kExitY - kEntryY) * config_.frame_height;
+    
+    // 2..8 px/frame at 720p
+    float base_speed = 2.0f * config_.frame_height / 720.0f;
+    
+    for (int k = 0; k < config_.density; k++) {
+        Slot slot;
+        int lane = k % lanes;
+        slot.lane_x = lane_start + lane_span * (lane + 0.5f) / lanes;
+        slot.speed_px = base_speed * (1.0f + 3.0f * hash01(config_.seed, k, 1));
+        slot.travel_frames = static_cast<int64_t>(std::ceil(travel_px / slot.speed_px));
+        int64_t gap = static_cast<int64_t>(hash01(config_.seed, k, 2) * slot.travel_frames / 2);
+        slot.period_frames = slot.travel_frames + gap + 1;
+        slot.phase = static_cast<int64_t>(hash01(config_.seed, k, 3) * slot.period_frames);
+        slot.class_id = hash01(config_.seed, k, 4) < 0.8f ? 2 : 7;  // COCO car / truck
+        slot.confidence = 0.6f + 0.35f * hash01(config_.seed, k, 5);
+        slots_.push_back(slot);
+    }
+}
+
+void SyntheticTraffic::generate(int64_t frame_number, std::vector<SyntheticDetection>& out) const {
+    out.clear();
+    
+    const float h = static_cast<float>(config_.frame_height);
+    
+    for (size_t k = 0; k < slots_.size(); k++) {
+        const Slot& slot = slots_[k];
+        int64_t t = frame_number + slot.phase;
+        int64_t generation = t / slot.period_frames;
+        int64_t local = t % slot.period_frames;
+        
+        if (local >= slot.travel_frames) {
+            continue;  // In the gap between two vehicles
+        }
+        
+        float bottom = kEntryY * h + local * slot.speed_px;
+        
+        // Crude perspective: boxes grow linearly towards the camera
+        float depth = (bottom / h - kEntryY) / (kExitY - kEntryY);
+        float box_w = (0.04f + 0.12f * depth) * config_.frame_width;
+        float box_h = box_w * (slot.class_id == 7 ? 0.9f : 0.7f);
+        
+        SyntheticDetection det;
+        det.track_id = 1 + k + static_cast<uint64_t>(generation) * slots_.size();
+        det.class_id = slot.class_id;
+        det.width = box_w;
+        det.left = slot.lane_x - box_w / 2.0f;
+        det.top = std::max(0.0f, bottom - box_h);
+        det.height = std::min(box_h, bottom);
+        det.confidence = slot.confidence;
+        out.push_back(det);
+    }
+}
+
+float SyntheticTraffic::hash01(uint32_t seed, uint32_t slot, uint32_t salt) {
+    // splitmix-style integer hash, stable across platforms
+    uint64_t x = (static_cast<uint64_t>(seed) << 32) ^ (static_cast<uint64_t>(slot) << 8) ^ salt;
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x = x ^ (x >> 31);
+    return static_cast<float>(x >> 40) / static_cast<float>(1ULL << 24);
+}
+
+} // namespace speedflow
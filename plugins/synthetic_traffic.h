@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace speedflow {
+
+/**
+ * Configuration for the synthetic traffic generator
+ */
+struct SyntheticTrafficConfig {
+    int frame_width = 1280;
+    int frame_height = 720;
+    int density = 8;            // Vehicle slots (upper bound of vehicles in view)
+    int lanes = 4;
+    uint32_t seed = 1;
+};
+
+/**
+ * A single synthetic detection (pixel coordinates)
+ */
+struct SyntheticDetection {
+    uint64_t track_id;
+    int class_id;
+    float left;
+    float top;
+    float width;
+    float height;
+    float confidence;
+};
+
+/**
+ * SyntheticTraffic - Deterministic vehicle trajectories for CPU load testing
+ *
+ * Every vehicle slot drives down its lane at a constant pixel speed, leaves
+ * the frame, waits a slot-specific gap and re-enters with a new track id.
+ * Positions are a pure function of (seed, slot, frame number), so two runs
+ * with the same configuration produce identical detections.
+ */
+class SyntheticTraffic {
+public:
+    explicit SyntheticTraffic(const SyntheticTrafficConfig& config = SyntheticTrafficConfig());
+    
+    /**
+     * Generate detections for a frame
+     * @param frame_number Frame index (0-based)
+     * @param out Output detections (cleared first, capacity is reused)
+     */
+    void generate(int64_t frame_number, std::vector<SyntheticDetection>& out) const;
+
+private:
+    struct Slot {
+        float lane_x;           // Lane center in pixels
+        float speed_px;         // Downward speed in pixels per frame
+        int64_t travel_frames;  // Frames spent in view
+        int64_t period_frames;  // travel + gap
+        int64_t phase;
+        int class_id;
+        float confidence;
+    };
+    
+    SyntheticTrafficConfig config_;
+    std::vector<Slot> slots_;
+    
+    static float hash01(uint32_t seed, uint32_t slot, uint32_t salt);
+};
+
+} // namespace speedflow
@@ -0,0 +1,211 @@
+#include "trace_recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace speedflow {
+
+// Flush thread wake-up interval
+static constexpr auto kFlushInterval = std::chrono::milliseconds(100);
+
+static std::atomic<uint64_t> next_instance_id{1};
+
+TraceRecorder::TraceRecorder(const std::string& path, size_t events_per_thread)
+    : path_(path),
+      events_per_thread_(std::max<size_t>(events_per_thread, 64)),
+      instance_id_(next_instance_id.fetch_add(1)),
+      running_(false),
+      written_(0),
+      dropped_(0) {
+}
+
+TraceRecorder::~TraceRecorder() {
+    stop();
+}
+
+int64_t TraceRecorder::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool TraceRecorder::start() {
+    if (running_) {
+        return true;
+    }
+    
+    file_ = std::fopen(path_.c_str(), "w");
+    if (!file_) {
+        std::cerr << "[TraceRecorder] Cannot open " << path_ << std::endl;
+        return false;
+    }
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file_);
+    first_event_ = true;
+    origin_ns_ = nowNs();
+    
+    running_ = true;
+    thread_ = std::thread(&TraceRecorder::run, this);
+    
+    std::cout << "[TraceRecorder] Writing trace events to " << path_ << std::endl;
+    return true;
+}
+
+void TraceRecorder::stop() {
+    if (!running_) {
+        return;
+    }
+    
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    // Thread names as metadata events, then close the JSON object
+    std::string out;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) {
+            char line[160];
+            std::snprintf(line, sizeof(line),
+                          "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%ld,"
+                          "\"args\":{\"name\":\"%s\"}}",
+                          first_event_ ? "" : ",\n", buffer->tid, buffer->thread_name.c_str());
+            out += line;
+            first_event_ = false;
+        }
+    }
+    out += "\n]}\n";
+    std::fwrite(out.data(), 1, out.size(), file_);
+    std::fclose(file_);
+    file_ = nullptr;
+    
+    std::cout << "[TraceRecorder] Stopped: " << written_.load() << " events written, "
+              << dropped_.load() << " dropped" << std::endl;
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::threadBuffer() {
+    // Cached per thread; the instance id keeps a new recorder from
+    // picking up a buffer of a destroyed one
+    thread_local uint64_t cached_id = 0;
+    thread_local ThreadBuffer* cached = nullptr;
+    if (cached_id == instance_id_) {
+        return cached;
+    }
+    
+    auto buffer = std::make_unique<ThreadBuffer>(events_per_thread_);
+    buffer->tid = static_cast<long>(syscall(SYS_gettid));
+    char name[16] = {0};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    for (const char* c = name; *c; c++) {
+        // Keep the JSON valid whatever the thread is called
+        buffer->thread_name.push_back(*c == '"' || *c == '\\' ? '_' : *c);
+    }
+    
+    cached = buffer.get();
+    cached_id = instance_id_;
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    buffers_.push_back(std::move(buffer));
+    return cached;
+}
+
+void TraceRecorder::push(const Event& event) {
+    ThreadBuffer* buffer = threadBuffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    if (head - buffer->tail.load(std::memory_order_acquire) >= buffer->events.size()) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->events[head % buffer->events.size()] = event;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceRecorder::complete(const char* name, int64_t start_ns, int64_t end_ns,
+                             int frame, int source) {
+    push({name, start_ns, end_ns - start_ns, 0, frame, source, 'X'});
+}
+
+void TraceRecorder::span(const char* name, int64_t start_ns, int64_t end_ns, uint64_t id,
+                         int frame, int source) {
+    push({name, start_ns, end_ns - start_ns, id, frame, source, 'b'});
+}
+
+void TraceRecorder::instant(const char* name, int frame, int source) {
+    push({name, nowNs(), 0, 0, frame, source, 'i'});
+}
+
+void TraceRecorder::run() {
+    std::string out;
+    out.reserve(1 << 20);
+    
+    while (true) {
+        bool stopping = !running_;
+        size_t count = drain(out);
+        if (!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), file_);
+            std::fflush(file_);
+            out.clear();
+        }
+        written_ += count;
+        
+        if (stopping) {
+            break;
+        }
+        std::this_thread::sleep_for(kFlushInterval);
+    }
+}
+
+size_t TraceRecorder::drain(std::string& out) {
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) {
+            buffers.push_back(buffer.get());
+        }
+    }
+    
+    size_t count = 0;
+    char line[512];
+    for (ThreadBuffer* buffer : buffers) {
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        for (; tail < head; tail++) {
+            const Event& event = buffer->events[tail % buffer->events.size()];
+            double ts_us = (event.ts_ns - origin_ns_) / 1000.0;
+            int len;
+            if (event.phase == 'X') {
+                len = std::snprintf(line, sizeof(line),
+                                    "%s{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%ld,"
+                                    "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%d,\"source\":%d}}",
+                                    first_event_ ? "" : ",\n", event.name, buffer->tid,
+                                    ts_us, event.dur_ns / 1000.0, event.frame, event.source);
+            } else if (event.phase == 'b') {
+                // Begin/end pair, matched by category, name and id
+                len = std::snprintf(line, sizeof(line),
+                                    "%s{\"ph\":\"b\",\"cat\":\"element\",\"name\":\"%s\",\"id\":%llu,"
+                                    "\"pid\":1,\"tid\":%ld,\"ts\":%.3f,\"args\":{\"frame\":%d,\"source\":%d}},\n"
+                                    "{\"ph\":\"e\",\"cat\":\"element\",\"name\":\"%s\",\"id\":%llu,"
+                                    "\"pid\":1,\"tid\":%ld,\"ts\":%.3f}",
+                                    first_event_ ? "" : ",\n", event.name,
+                                    static_cast<unsigned long long>(event.id), buffer->tid, ts_us,
+                                    event.frame, event.source, event.name,
+                                    static_cast<unsigned long long>(event.id), buffer->tid,
+                                    ts_us + event.dur_ns / 1000.0);
+            } else {
+                len = std::snprintf(line, sizeof(line),
+                                    "%s{\"ph\":\"i\",\"s\":\"t\",\"name\":\"%s\",\"pid\":1,\"tid\":%ld,"
+                                    "\"ts\":%.3f,\"args\":{\"frame\":%d,\"source\":%d}}",
+                                    first_event_ ? "" : ",\n", event.name, buffer->tid,
+                                    ts_us, event.frame, event.source);
+            }
+            out.append(line, static_cast<size_t>(std::min<int>(std::max(len, 0), sizeof(line) - 1)));
+            first_event_ = false;
+            count++;
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+    return count;
+}
+
+} // namespace speedflow
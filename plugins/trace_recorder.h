@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace speedflow {
+
+/**
+ * TraceRecorder - Per-frame timing events in Chrome trace-event JSON
+ *
+ * Every recording thread gets its own single-producer ring, registered on
+ * its first event; recording is a clock read and a few stores, with no lock
+ * and no allocation. A flush thread drains the rings and appends the events
+ * to the output file, which opens in chrome://tracing or ui.perfetto.dev.
+ *
+ * Tracing is opt-in: components hold a TraceRecorder pointer that is null
+ * when tracing is off, so the disabled cost is the null check.
+ * Event names must outlive the recorder (string literals, element names
+ * owned by the pipeline builder).
+ */
+class TraceRecorder {
+public:
+    /**
+     * @param path Output file (Chrome JSON object format)
+     * @param events_per_thread Ring size per recording thread; a full ring drops events
+     */
+    explicit TraceRecorder(const std::string& path, size_t events_per_thread = 16384);
+    ~TraceRecorder();
+    
+    bool start();
+    void stop();
+    
+    /** @return Monotonic time in ns, the clock of all events */
+    static int64_t nowNs();
+    
+    /**
+     * Record a finished span
+     * @param name Event name (not copied)
+     * @param start_ns Begin (nowNs())
+     * @param end_ns End (nowNs())
+     * @param frame Frame number, or -1
+     * @param source Source id, or -1
+     */
+    void complete(const char* name, int64_t start_ns, int64_t end_ns, int frame, int source);
+    
+    /**
+     * Record a span that may overlap others of the same name (async event),
+     * e.g. an element working on several buffers at once
+     * @param name Event name (not copied)
+     * @param start_ns Begin (nowNs())
+     * @param end_ns End (nowNs())
+     * @param id Unique among overlapping spans of this name
+     * @param frame Frame number, or -1
+     * @param source Source id, or -1
+     */
+    void span(const char* name, int64_t start_ns, int64_t end_ns, uint64_t id,
+              int frame, int source);
+    
+    /**
+     * Record a point in time on the calling thread
+     * @param name Event name (not copied)
+     * @param frame Frame number, or -1
+     * @param source Source id, or -1
+     */
+    void instant(const char* name, int frame, int source);
+    
+    uint64_t writtenCount() const { return written_.load(); }
+    uint64_t droppedCount() const { return dropped_.load(); }
+
+private:
+    struct Event {
+        const char* name;
+        int64_t ts_ns;
+        int64_t dur_ns;
+        uint64_t id;            // Async spans only
+        int32_t frame;
+        int32_t source;
+        char phase;             // 'X' complete, 'b' async span, 'i' instant
+    };
+    
+    // Single producer (the owning thread), single consumer (the flush thread)
+    struct ThreadBuffer {
+        explicit ThreadBuffer(size_t capacity) : events(capacity) {}
+        std::vector<Event> events;
+        std::atomic<uint64_t> head{0};  // Written by the owning thread
+        alignas(64) std::atomic<uint64_t> tail{0};  // Written by the flush thread
+        long tid = 0;
+        std::string thread_name;
+    };
+    
+    ThreadBuffer* threadBuffer();
+    void push(const Event& event);
+    void run();
+    size_t drain(std::string& out);
+    
+    std::string path_;
+    size_t events_per_thread_;
+    uint64_t instance_id_;          // Distinguishes recorders in the thread-local cache
+    int64_t origin_ns_ = 0;
+    
+    std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    
+    FILE* file_ = nullptr;
+    bool first_event_ = true;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+};
+
+/**
+ * Span from construction to destruction, recorded only with a recorder
+ */
+class TraceScope {
+public:
+    TraceScope(TraceRecorder* tracer, const char* name, int frame = -1, int source = -1)
+        : tracer_(tracer), name_(name), frame_(frame), source_(source),
+          start_ns_(tracer ? TraceRecorder::nowNs() : 0) {}
+    
+    ~TraceScope() {
+        if (tracer_) {
+            tracer_->complete(name_, start_ns_, TraceRecorder::nowNs(), frame_, source_);
+        }
+    }
+    
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceRecorder* tracer_;
+    const char* name_;
+    int frame_;
+    int source_;
+    int64_t start_ns_;
+};
+
+} // namespace speedflow
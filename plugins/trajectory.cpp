@@ -0,0 +1,156 @@
+#include "trajectory.h"
+#include <algorithm>
+#include <cmath>
+
+namespace speedflow {
+
+TrajectorySimplifier::TrajectorySimplifier(float max_error_m, size_t max_vertices)
+    : max_error_m_(max_error_m),
+      axis_error_m_(max_error_m / std::sqrt(2.0f)),
+      max_vertices_(std::max<size_t>(max_vertices, 2)) {
+}
+
+void TrajectorySimplifier::add(float x, float y, int frame) {
+    if (!has_anchor_) {
+        anchor_ = {x, y, frame};
+        last_ = anchor_;
+        vertices_.push_back(anchor_);
+        has_anchor_ = true;
+        points_++;
+        return;
+    }
+    if (frame <= last_.frame) {
+        return;
+    }
+    points_++;
+    
+    // Slopes from the anchor that keep this position within tolerance
+    float dt = static_cast<float>(frame - anchor_.frame);
+    float lo_x = (x - axis_error_m_ - anchor_.x) / dt;
+    float hi_x = (x + axis_error_m_ - anchor_.x) / dt;
+    float lo_y = (y - axis_error_m_ - anchor_.y) / dt;
+    float hi_y = (y + axis_error_m_ - anchor_.y) / dt;
+    
+    if (has_cone_) {
+        lo_x = std::max(lo_x, lo_x_);
+        hi_x = std::min(hi_x, hi_x_);
+        lo_y = std::max(lo_y, lo_y_);
+        hi_y = std::min(hi_y, hi_y_);
+        if (lo_x <= hi_x && lo_y <= hi_y) {
+            lo_x_ = lo_x; hi_x_ = hi_x;
+            lo_y_ = lo_y; hi_y_ = hi_y;
+            last_ = {x, y, frame};
+            return;
+        }
+        
+        // No single segment covers this position too: end the segment at
+        // the previous position and restart the doors from there
+        closeSegment();
+        dt = static_cast<float>(frame - anchor_.frame);
+        lo_x = (x - axis_error_m_ - anchor_.x) / dt;
+        hi_x = (x + axis_error_m_ - anchor_.x) / dt;
+        lo_y = (y - axis_error_m_ - anchor_.y) / dt;
+        hi_y = (y + axis_error_m_ - anchor_.y) / dt;
+    }
+    
+    lo_x_ = lo_x; hi_x_ = hi_x;
+    lo_y_ = lo_y; hi_y_ = hi_y;
+    has_cone_ = true;
+    last_ = {x, y, frame};
+}
+
+void TrajectorySimplifier::closeSegment() {
+    // The middle slope is inside both ranges, so it is within tolerance of
+    // every position of the segment
+    float dt = static_cast<float>(last_.frame - anchor_.frame);
+    TrajectoryVertex vertex;
+    vertex.x = anchor_.x + (lo_x_ + hi_x_) * 0.5f * dt;
+    vertex.y = anchor_.y + (lo_y_ + hi_y_) * 0.5f * dt;
+    vertex.frame = last_.frame;
+    vertices_.push_back(vertex);
+    anchor_ = vertex;
+    has_cone_ = false;
+}
+
+void TrajectorySimplifier::take(std::vector<TrajectoryVertex>& out, bool finish) {
+    if (finish && has_cone_) {
+        closeSegment();
+    }
+    
+    out.swap(vertices_);
+    vertices_.clear();
+    points_ = 0;
+    
+    if (finish) {
+        has_anchor_ = false;
+        has_cone_ = false;
+    } else if (has_anchor_) {
+        // The next batch starts where this one ends
+        vertices_.push_back(anchor_);
+    }
+}
+
+static void writeVarint(uint64_t value, std::string& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static bool readVarint(const std::string& data, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void encodeTrajectory(const std::vector<TrajectoryVertex>& vertices, std::string& out) {
+    out.clear();
+    int64_t prev_x = 0, prev_y = 0, prev_frame = 0;
+    for (const auto& vertex : vertices) {
+        // Deltas of quantized values, so rounding does not accumulate
+        int64_t x = std::llround(static_cast<double>(vertex.x) * 100.0);
+        int64_t y = std::llround(static_cast<double>(vertex.y) * 100.0);
+        writeVarint(zigzag(x - prev_x), out);
+        writeVarint(zigzag(y - prev_y), out);
+        writeVarint(zigzag(vertex.frame - prev_frame), out);
+        prev_x = x;
+        prev_y = y;
+        prev_frame = vertex.frame;
+    }
+}
+
+bool decodeTrajectory(const std::string& data, std::vector<TrajectoryVertex>& out) {
+    out.clear();
+    int64_t x = 0, y = 0, frame = 0;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        uint64_t dx, dy, dframe;
+        if (!readVarint(data, pos, dx) || !readVarint(data, pos, dy) ||
+            !readVarint(data, pos, dframe)) {
+            return false;
+        }
+        x += unzigzag(dx);
+        y += unzigzag(dy);
+        frame += unzigzag(dframe);
+        out.push_back({static_cast<float>(x / 100.0), static_cast<float>(y / 100.0),
+                       static_cast<int>(frame)});
+    }
+    return true;
+}
+
+} // namespace speedflow
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace speedflow {
+
+/**
+ * Polyline vertex in world coordinates (meters) with its frame number
+ */
+struct TrajectoryVertex {
+    float x;
+    float y;
+    int frame;
+};
+
+/**
+ * Simplified world-space path of one track
+ * Position at any frame between two vertices is their linear interpolation.
+ */
+struct Trajectory {
+    int source_id = 0;
+    int track_id = 0;
+    int64_t ntp_timestamp = 0;      // Frame on which it was emitted (set by speedcalc)
+    float video_fps = 0.0f;         // Converts vertex frames to seconds
+    float max_error_m = 0.0f;       // Bound on the distance to any input position
+    uint32_t num_points = 0;        // Input positions covered by the vertices
+    bool complete = true;           // false = vertex budget reached, continues in the next one
+    std::vector<TrajectoryVertex> vertices;
+};
+
+/**
+ * TrajectorySimplifier - Online error-bounded polyline simplification
+ *
+ * Swinging-door compression of x(t) and y(t): from the last vertex (anchor)
+ * it keeps, per axis, the range of slopes that stays within the tolerance of
+ * every position seen since. When a new position empties either range, a
+ * vertex is placed at the previous position's frame on the middle slope and
+ * becomes the new anchor. Every input position is therefore within
+ * max_error_m (synchronized Euclidean distance) of the polyline.
+ *
+ * State is O(1) besides the emitted vertices, and at most max_vertices of
+ * those are kept before the caller has to take them.
+ */
+class TrajectorySimplifier {
+public:
+    /**
+     * @param max_error_m Tolerance on the reconstructed position (meters)
+     * @param max_vertices Vertices kept before full() reports true
+     */
+    explicit TrajectorySimplifier(float max_error_m = 0.25f, size_t max_vertices = 256);
+    
+    /**
+     * Add the next position; positions with a frame not after the last one are ignored
+     */
+    void add(float x, float y, int frame);
+    
+    /** @return true once max_vertices vertices are waiting to be taken */
+    bool full() const { return vertices_.size() >= max_vertices_; }
+    
+    /** @return Input positions since the last take */
+    uint32_t pointCount() const { return points_; }
+    
+    /**
+     * Move the vertices out
+     * @param out Receives the vertices (previous contents replaced)
+     * @param finish true closes the open segment and resets the simplifier;
+     *        false keeps it open and starts the next batch at the current anchor
+     */
+    void take(std::vector<TrajectoryVertex>& out, bool finish);
+    
+    float maxError() const { return max_error_m_; }
+
+private:
+    void closeSegment();
+    
+    float max_error_m_;
+    float axis_error_m_;            // max_error_m / sqrt(2), per axis
+    size_t max_vertices_;
+    
+    bool has_anchor_ = false;
+    bool has_cone_ = false;
+    TrajectoryVertex anchor_{};
+    TrajectoryVertex last_{};       // Latest input position
+    float lo_x_ = 0.0f, hi_x_ = 0.0f;   // Slope ranges (meters per frame)
+    float lo_y_ = 0.0f, hi_y_ = 0.0f;
+    uint32_t points_ = 0;
+    std::vector<TrajectoryVertex> vertices_;
+};
+
+/**
+ * Encode vertices as zigzag varint deltas: x, y in centimeters, then frame
+ * Quantization adds at most 0.5 cm per axis to the simplification error.
+ * @param vertices Vertices in frame order
+ * @param out Encoded bytes (previous contents replaced)
+ */
+void encodeTrajectory(const std::vector<TrajectoryVertex>& vertices, std::string& out);
+
+/**
+ * Decode bytes produced by encodeTrajectory
+ * @param data Encoded bytes
+ * @param out Decoded vertices (previous contents replaced)
+ * @return false if the data is truncated or malformed
+ */
+bool decodeTrajectory(const std::string& data, std::vector<TrajectoryVertex>& out);
+
+} // namespace speedflow
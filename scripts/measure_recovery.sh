@@ -0,0 +1,122 @@
+#!/bin/bash
+# Measure source recovery time under cpu-sim
+#
+# Serves a live videotestsrc over TCP (Matroska/JPEG, base and good plugins
+# only), runs speedflow on tcp://127.0.0.1:<port> with --profile cpu-sim,
+# and kills the sender for a few seconds per cycle. For every outage it
+# reports, from the timestamped speedflow log:
+#   detect     kill -> the source is restarted (EOS/error/stall)
+#   back       sender restarted -> first frame through the source again
+#              (what the backoff adds on top of the outage itself)
+#   reported   the pipeline's own "recovered after X ms" (first failure ->
+#              first frame, so it includes the outage)
+#
+# Usage: scripts/measure_recovery.sh [cycles] [outage_s] [up_s]
+# Extra speedflow options can be passed in SPEEDFLOW_ARGS.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+ROOT="$(dirname "$SCRIPT_DIR")"
+CYCLES=${1:-5}
+OUTAGE_S=${2:-3}
+UP_S=${3:-8}
+PORT=${PORT:-5600}
+
+WORK="$(mktemp -d)"
+LOG="$WORK/speedflow.log"
+EVENTS="$WORK/events"
+SENDER=
+APP=
+
+cleanup() {
+    [ -n "$SENDER" ] && kill "$SENDER" 2>/dev/null || true
+    [ -n "$APP" ] && kill "$APP" 2>/dev/null || true
+    wait 2>/dev/null || true
+}
+trap cleanup EXIT
+
+now_ms() { date +%s%3N; }
+
+start_sender() {
+    gst-launch-1.0 -q videotestsrc is-live=true \
+        ! video/x-raw,width=640,height=360,framerate=25/1 \
+        ! jpegenc ! matroskamux streamable=true \
+        ! tcpserversink host=127.0.0.1 port="$PORT" sync-method=latest-keyframe \
+        > /dev/null 2>&1 &
+    SENDER=$!
+}
+
+start_sender
+sleep 1
+
+# Every log line gets a millisecond timestamp as it arrives
+export GST_PLUGIN_PATH="$ROOT/build/plugins"
+"$ROOT/build/speedflow" "tcp://127.0.0.1:$PORT" --profile cpu-sim --headless $SPEEDFLOW_ARGS \
+    > >(while IFS= read -r line; do echo "$(now_ms) $line"; done > "$LOG") 2>&1 &
+APP=$!
+
+echo "[Recovery] $CYCLES outages of $OUTAGE_S s, $UP_S s apart, log in $LOG"
+sleep "$UP_S"
+for ((i = 1; i <= CYCLES; i++)); do
+    kill_ms=$(now_ms)
+    kill "$SENDER"
+    wait "$SENDER" 2>/dev/null || true
+    sleep "$OUTAGE_S"
+    back_ms=$(now_ms)
+    start_sender
+    echo "$kill_ms $back_ms" >> "$EVENTS"
+    sleep "$UP_S"
+done
+
+kill -INT "$APP"
+wait "$APP" 2>/dev/null || true
+APP=
+
+awk -v events="$EVENTS" '
+    BEGIN {
+        n = 0
+        while ((getline line < events) > 0) {
+            split(line, f, " ")
+            n++; kill_ms[n] = f[1]; back_ms[n] = f[2]
+        }
+    }
+    # Restarts print "Source 0 <reason>", recoveries "Source 0 recovered after X ms"
+    / Source 0 (failed|ended|stalled)$/ {
+        for (i = 1; i <= n; i++) {
+            if (!detect[i] && $1 >= kill_ms[i] && (i == n || $1 < kill_ms[i + 1])) {
+                detect[i] = $1
+                break
+            }
+        }
+    }
+    / Source 0 recovered after / {
+        for (i = 1; i <= n; i++) {
+            if (!recovered[i] && $1 >= back_ms[i]) {
+                recovered[i] = $1
+                for (k = 1; k <= NF; k++) {
+                    if ($k == "after") reported[i] = $(k + 1)
+                }
+                break
+            }
+        }
+    }
+    END {
+        printf "\n outage   detect ms   back ms   reported ms\n"
+        ok = 0
+        for (i = 1; i <= n; i++) {
+            if (!recovered[i]) {
+                printf "%7d %11s %9s %13s\n", i, detect[i] ? detect[i] - kill_ms[i] : "-", "never", "-"
+                continue
+            }
+            b = recovered[i] - back_ms[i]
+            printf "%7d %11s %9d %13d\n", i, detect[i] ? detect[i] - kill_ms[i] : "-", b, reported[i]
+            sum += b; ok++
+            if (ok == 1 || b > worst) worst = b
+        }
+        if (ok > 0) {
+            printf "\n[Recovery] %d/%d recovered, back after the sender returned: mean %.0f ms, worst %d ms\n",
+                   ok, n, sum / ok, worst
+        }
+    }
+' "$LOG"
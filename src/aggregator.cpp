@@ -0,0 +1,474 @@
+#include "aggregator.h"
+#include "delimited_stream.h"
+#include "speedflow.pb.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+// Merge thread wake-up interval
+static constexpr auto kMergeTick = std::chrono::milliseconds(5);
+
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t wallNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct Aggregator::Connection {
+    int fd;
+    int node = -1;              // Registered on the first record
+    std::string peer;           // Node id fallback when the first record has none
+    DelimitedReader input;
+};
+
+struct Aggregator::Worker {
+    int index;
+    int epoll_fd = -1;
+    int listen_fd = -1;
+    std::thread thread;
+    std::unordered_map<int, Connection> connections;
+    
+    // Parsed records waiting for the merge thread
+    std::mutex inbox_mutex;
+    std::vector<Record> inbox;
+};
+
+Aggregator::Aggregator(const AggregatorConfig& config)
+    : config_(config),
+      running_(false),
+      merging_(false),
+      sequence_(0),
+      max_seen_ntp_(0),
+      released_ntp_(0),
+      released_any_(false),
+      released_(0),
+      dropped_(0) {
+    if (config_.io_threads <= 0) {
+        config_.io_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+Aggregator::~Aggregator() {
+    stop();
+}
+
+void Aggregator::addSink(std::shared_ptr<speedflow::ResultSink> sink) {
+    sinks_.push_back(std::move(sink));
+}
+
+bool Aggregator::start() {
+    if (running_) {
+        return true;
+    }
+    
+    for (int i = 0; i < config_.io_threads; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->index = i;
+        
+        // Every loop listens on the same port; the kernel spreads connections
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(static_cast<uint16_t>(config_.port));
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(fd, SOMAXCONN) != 0) {
+            std::cerr << "[Aggregator] Cannot listen on port " << config_.port << ": "
+                      << std::strerror(errno) << std::endl;
+            if (fd >= 0) {
+                close(fd);
+            }
+            for (auto& w : workers_) {
+                close(w->listen_fd);
+                close(w->epoll_fd);
+            }
+            workers_.clear();
+            return false;
+        }
+        
+        worker->listen_fd = fd;
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        workers_.push_back(std::move(worker));
+    }
+    
+    running_ = true;
+    merging_ = true;
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&Aggregator::runWorker, this, std::ref(*worker));
+    }
+    merge_thread_ = std::thread(&Aggregator::runMerge, this);
+    
+    std::cout << "[Aggregator] Listening on port " << config_.port << " with "
+              << config_.io_threads << " connection threads, "
+              << config_.reorder_window_ms << " ms reorder window" << std::endl;
+    return true;
+}
+
+void Aggregator::stop() {
+    if (!running_) {
+        return;
+    }
+    
+    // Connections first, then the merge thread drains what they delivered
+    running_ = false;
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    merging_ = false;
+    if (merge_thread_.joinable()) {
+        merge_thread_.join();
+    }
+    workers_.clear();
+    
+    std::cout << "[Aggregator] Stopped: " << released_.load() << " records merged, "
+              << dropped_.load() << " dropped" << std::endl;
+}
+
+void Aggregator::rollups(std::vector<NodeRollup>& out) const {
+    std::lock_guard<std::mutex> lock(nodes_mutex_);
+    out = nodes_;
+}
+
+int Aggregator::registerNode(const std::string& node_id) {
+    std::lock_guard<std::mutex> lock(nodes_mutex_);
+    auto it = node_index_.find(node_id);
+    int index;
+    if (it == node_index_.end()) {
+        index = static_cast<int>(nodes_.size());
+        node_index_.emplace(node_id, index);
+        nodes_.emplace_back();
+        nodes_.back().node_id = node_id;
+    } else {
+        index = it->second;
+    }
+    nodes_[index].connections++;
+    std::cout << "[Aggregator] Node " << node_id << " connected ("
+              << nodes_[index].connections << " connection(s))" << std::endl;
+    return index;
+}
+
+void Aggregator::runWorker(Worker& worker) {
+    epoll_event events[64];
+    std::vector<Record> parsed;
+    
+    while (running_) {
+        int n = epoll_wait(worker.epoll_fd, events, 64, 100);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            
+            if (fd == worker.listen_fd) {
+                sockaddr_in peer{};
+                socklen_t peer_len = sizeof(peer);
+                int conn_fd;
+                while ((conn_fd = accept4(fd, reinterpret_cast<sockaddr*>(&peer), &peer_len,
+                                          SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    char host[INET_ADDRSTRLEN] = {};
+                    inet_ntop(AF_INET, &peer.sin_addr, host, sizeof(host));
+                    
+                    Connection& conn = worker.connections[conn_fd];
+                    conn.fd = conn_fd;
+                    conn.peer = std::string(host) + ":" + std::to_string(ntohs(peer.sin_port));
+                    
+                    epoll_event ev{};
+                    ev.events = EPOLLIN | EPOLLRDHUP;
+                    ev.data.fd = conn_fd;
+                    epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, conn_fd, &ev);
+                    peer_len = sizeof(peer);
+                }
+                continue;
+            }
+            
+            auto it = worker.connections.find(fd);
+            if (it != worker.connections.end() && !readConnection(it->second, parsed)) {
+                closeConnection(worker, fd);
+            }
+        }
+        
+        if (!parsed.empty()) {
+            std::lock_guard<std::mutex> lock(worker.inbox_mutex);
+            for (Record& record : parsed) {
+                // The merge thread fell behind: never hold more than max_pending
+                if (worker.inbox.size() >= config_.max_pending) {
+                    dropped_++;
+                    continue;
+                }
+                worker.inbox.push_back(std::move(record));
+            }
+            parsed.clear();
+        }
+    }
+    
+    while (!worker.connections.empty()) {
+        closeConnection(worker, worker.connections.begin()->first);
+    }
+    close(worker.listen_fd);
+    close(worker.epoll_fd);
+}
+
+bool Aggregator::readConnection(Connection& conn, std::vector<Record>& parsed) {
+    // Fill the buffer up to the read budget, then parse what is complete
+    bool open = conn.input.fill(conn.fd);
+    
+    speedflow::NodeRecord msg;
+    const int64_t arrival_ns = steadyNowNs();
+    const uint8_t* data;
+    uint32_t length;
+    while (true) {
+        DelimitedReader::Status status = conn.input.next(config_.max_record_bytes, data, length);
+        if (status == DelimitedReader::Status::Incomplete) {
+            break;
+        }
+        if (status == DelimitedReader::Status::Corrupt) {
+            std::cerr << "[Aggregator] Corrupt length prefix from " << conn.peer << std::endl;
+            return false;
+        }
+        if (status == DelimitedReader::Status::TooLarge) {
+            std::cerr << "[Aggregator] Record of " << length << " bytes from " << conn.peer
+                      << " exceeds the limit, closing" << std::endl;
+            return false;
+        }
+        if (!msg.ParseFromArray(data, static_cast<int>(length))) {
+            std::cerr << "[Aggregator] Malformed record from " << conn.peer << ", closing" << std::endl;
+            return false;
+        }
+        
+        if (conn.node < 0) {
+            conn.node = registerNode(msg.node_id().empty() ? conn.peer : msg.node_id());
+        }
+        
+        Record record;
+        record.sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+        record.arrival_ns = arrival_ns;
+        record.node = conn.node;
+        if (msg.has_frame()) {
+            const speedflow::FrameData& frame = msg.frame();
+            record.is_alert = false;
+            record.ntp_timestamp = frame.ntp_timestamp();
+            record.frame.source_id = frame.source_id();
+            record.frame.frame_number = frame.frame_number();
+            record.frame.ntp_timestamp = frame.ntp_timestamp();
+            record.frame.objects.resize(frame.objects_size());
+            for (int i = 0; i < frame.objects_size(); i++) {
+                const speedflow::ObjectInfo& info = frame.objects(i);
+                speedflow::ObjectResult& obj = record.frame.objects[i];
+                obj.track_id = static_cast<uint64_t>(info.track_id());
+                obj.class_id = info.class_id();
+                obj.confidence = info.confidence();
+                obj.bbox_x = info.bbox_x();
+                obj.bbox_y = info.bbox_y();
+                obj.bbox_w = info.bbox_w();
+                obj.bbox_h = info.bbox_h();
+                obj.speed_kmh = info.speed_kmh();
+                obj.is_valid = info.speed_kmh() > 0.0f;
+                obj.is_overspeeding = info.is_overspeeding();
+            }
+        } else if (msg.has_alert()) {
+            const speedflow::OverspeedAlert& alert = msg.alert();
+            record.is_alert = true;
+            record.ntp_timestamp = alert.ntp_timestamp();
+            record.alert.source_id = alert.source_id();
+            record.alert.ntp_timestamp = alert.ntp_timestamp();
+            record.alert.peak_speed_kmh = alert.speed_kmh();
+            record.alert.object = speedflow::ObjectResult{};
+            record.alert.object.track_id = static_cast<uint64_t>(alert.track_id());
+            record.alert.object.speed_kmh = alert.speed_kmh();
+            record.alert.object.is_valid = true;
+            record.alert.object.is_overspeeding = true;
+        } else {
+            continue;  // Hello without payload
+        }
+        parsed.push_back(std::move(record));
+    }
+    return open;
+}
+
+void Aggregator::closeConnection(Worker& worker, int fd) {
+    auto it = worker.connections.find(fd);
+    if (it == worker.connections.end()) {
+        return;
+    }
+    
+    if (it->second.node >= 0) {
+        std::lock_guard<std::mutex> lock(nodes_mutex_);
+        NodeRollup& node = nodes_[it->second.node];
+        node.connections--;
+        std::cout << "[Aggregator] Node " << node.node_id << " disconnected" << std::endl;
+    }
+    epoll_ctl(worker.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    worker.connections.erase(it);
+}
+
+bool Aggregator::later(const Record& a, const Record& b) {
+    if (a.ntp_timestamp != b.ntp_timestamp) {
+        return a.ntp_timestamp > b.ntp_timestamp;
+    }
+    if (a.is_alert != b.is_alert) {
+        return a.is_alert;
+    }
+    return a.sequence > b.sequence;
+}
+
+void Aggregator::runMerge() {
+    const int64_t window_ns = static_cast<int64_t>(config_.reorder_window_ms) * 1000000;
+    const int64_t report_ns = static_cast<int64_t>(config_.report_interval_s) * 1000000000;
+    std::vector<Record> batch;
+    int64_t last_report_ns = steadyNowNs();
+    
+    while (true) {
+        std::this_thread::sleep_for(kMergeTick);
+        bool stopping = !merging_;
+        
+        for (auto& worker : workers_) {
+            {
+                std::lock_guard<std::mutex> lock(worker->inbox_mutex);
+                batch.swap(worker->inbox);
+            }
+            
+            for (Record& record : batch) {
+                if (released_any_ && record.ntp_timestamp < released_ntp_) {
+                    std::lock_guard<std::mutex> lock(nodes_mutex_);
+                    nodes_[record.node].late++;
+                    continue;
+                }
+                
+                // A node whose clock runs ahead must not push everyone
+                // else's records out as late
+                int64_t seen = std::min(record.ntp_timestamp, wallNowNs() + window_ns);
+                max_seen_ntp_ = std::max(max_seen_ntp_, seen);
+                pending_.push_back(std::move(record));
+                std::push_heap(pending_.begin(), pending_.end(), later);
+            }
+            batch.clear();
+        }
+        
+        // Release in timestamp order; on shutdown, everything
+        const int64_t now_ns = steadyNowNs();
+        const int64_t watermark = max_seen_ntp_ - window_ns;
+        if (!pending_.empty()) {
+            std::lock_guard<std::mutex> lock(nodes_mutex_);
+            while (!pending_.empty()) {
+                const Record& top = pending_.front();
+                if (!stopping && top.ntp_timestamp > watermark &&
+                    now_ns - top.arrival_ns < window_ns && pending_.size() <= config_.max_pending) {
+                    break;
+                }
+                std::pop_heap(pending_.begin(), pending_.end(), later);
+                release(pending_.back());
+                released_batch_.push_back(std::move(pending_.back()));
+                pending_.pop_back();
+            }
+        }
+        
+        // Sinks run without nodes_mutex_, so a slow consumer never blocks
+        // connection threads registering or closing nodes
+        for (Record& record : released_batch_) {
+            deliver(record);
+        }
+        released_batch_.clear();
+        
+        if (report_ns > 0 && now_ns - last_report_ns >= report_ns) {
+            report(now_ns - last_report_ns);
+            last_report_ns = now_ns;
+        }
+        
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+void Aggregator::release(Record& record) {
+    // Caller holds nodes_mutex_; rollups and the corridor source id only
+    NodeRollup& node = nodes_[record.node];
+    int source_id = record.is_alert ? record.alert.source_id : record.frame.source_id;
+    uint64_t key = (static_cast<uint64_t>(record.node) << 32) | static_cast<uint32_t>(source_id);
+    auto it = source_ids_.find(key);
+    if (it == source_ids_.end()) {
+        int corridor_id = static_cast<int>(source_ids_.size());
+        it = source_ids_.emplace(key, corridor_id).first;
+        std::cout << "[Aggregator] " << node.node_id << " source " << source_id
+                  << " -> corridor source " << corridor_id << std::endl;
+    }
+    
+    released_ntp_ = std::max(released_ntp_, record.ntp_timestamp);
+    released_any_ = true;
+    node.last_ntp_timestamp = std::max(node.last_ntp_timestamp, record.ntp_timestamp);
+    released_++;
+    
+    if (record.is_alert) {
+        node.alerts++;
+        record.alert.source_id = it->second;
+    } else {
+        node.frames++;
+        for (const auto& obj : record.frame.objects) {
+            if (obj.speed_kmh > 0.0f) {
+                node.measured++;
+                node.speed_sum_kmh += obj.speed_kmh;
+            }
+        }
+        record.frame.source_id = it->second;
+    }
+}
+
+void Aggregator::deliver(const Record& record) {
+    for (auto& sink : sinks_) {
+        if (record.is_alert) {
+            sink->onAlert(record.alert);
+        } else {
+            sink->onFrame(record.frame);
+        }
+    }
+}
+
+void Aggregator::report(int64_t elapsed_ns) {
+    // Corridor totals; the interval figures are differences to the last report
+    int connected = 0;
+    NodeRollup total;
+    {
+        std::lock_guard<std::mutex> lock(nodes_mutex_);
+        for (const NodeRollup& node : nodes_) {
+            connected += node.connections > 0 ? 1 : 0;
+            total.frames += node.frames;
+            total.alerts += node.alerts;
+            total.late += node.late;
+            total.measured += node.measured;
+            total.speed_sum_kmh += node.speed_sum_kmh;
+        }
+    }
+    
+    double seconds = elapsed_ns / 1e9;
+    uint64_t measured = total.measured - last_report_.measured;
+    double mean_speed = measured > 0 ? (total.speed_sum_kmh - last_report_.speed_sum_kmh) / measured : 0.0;
+    double lag_ms = released_any_ ? (wallNowNs() - released_ntp_) / 1e6 : 0.0;
+    
+    std::cout << "[Aggregator] " << connected << " nodes, " << source_ids_.size() << " sources: "
+              << static_cast<uint64_t>((total.frames - last_report_.frames) / seconds) << " frames/s, "
+              << (total.alerts - last_report_.alerts) << " alerts, mean " << mean_speed << " km/h, "
+              << (total.late - last_report_.late) << " late, " << pending_.size() << " pending, "
+              << dropped_.load() << " dropped, merged " << lag_ms << " ms behind" << std::endl;
+    
+    last_report_ = total;
+}
@@ -0,0 +1,137 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../plugins/result_sink.h"
+
+/**
+ * Configuration for the corridor aggregator
+ */
+struct AggregatorConfig {
+    int port = 9400;                    // TCP port nodes connect to
+    int io_threads = 0;                 // Connection threads (0 = one per core)
+    int reorder_window_ms = 500;        // How far behind the newest record a record may arrive
+    size_t max_pending = 200000;        // Records held for reordering before the oldest are forced out
+    size_t max_record_bytes = 4u << 20; // Larger length prefixes close the connection
+    int report_interval_s = 10;         // Rollup log interval (0 = off)
+};
+
+/**
+ * Running totals of one node, as merged so far
+ */
+struct NodeRollup {
+    std::string node_id;
+    int connections = 0;            // Open connections right now
+    uint64_t frames = 0;
+    uint64_t alerts = 0;
+    uint64_t late = 0;              // Arrived behind the reorder window, dropped
+    uint64_t measured = 0;          // Vehicles with a measured speed, over all frames
+    double speed_sum_kmh = 0.0;
+    int64_t last_ntp_timestamp = 0;
+};
+
+/**
+ * Aggregator - Merges the result streams of many SpeedFlow nodes
+ *
+ * Nodes connect over TCP (FrameDataPublisher with a tcp:// target) and send
+ * length-delimited speedflow.NodeRecord messages: frames and overspeed
+ * alerts, with the node id on the first record of a connection.
+ *
+ * Connections are spread over io_threads epoll loops; every loop has its own
+ * SO_REUSEPORT listening socket, so the kernel balances new connections
+ * and no accept or read path is shared between threads. Loops only parse
+ * records and hand them to the merge thread in batches.
+ *
+ * The merge thread orders records by ntp_timestamp in a min-heap. A record
+ * is released once the newest timestamp seen is reorder_window_ms past it,
+ * or once it has waited reorder_window_ms itself (a quiet corridor still
+ * flows). Records older than what was already released are late: counted
+ * per node and dropped, so the merged stream never goes back in time.
+ * Released records update the per-node rollups and go to the sinks, with
+ * every (node, source) pair renumbered to a corridor-wide source id in
+ * order of first appearance.
+ *
+ * Sinks are called on the merge thread only, as ResultSink expects, and
+ * never under the lock connection threads take to register nodes.
+ */
+class Aggregator {
+public:
+    explicit Aggregator(const AggregatorConfig& config);
+    ~Aggregator();
+    
+    /** Add a consumer of the merged stream (before start()) */
+    void addSink(std::shared_ptr<speedflow::ResultSink> sink);
+    
+    bool start();
+    void stop();
+    
+    /**
+     * Current rollups of all nodes seen so far
+     * @param out Replaced with one entry per node, in order of first connection
+     */
+    void rollups(std::vector<NodeRollup>& out) const;
+    
+    uint64_t releasedCount() const { return released_.load(); }
+    uint64_t droppedCount() const { return dropped_.load(); }
+
+private:
+    // One parsed record on its way to the merge thread
+    struct Record {
+        int64_t ntp_timestamp;
+        uint64_t sequence;          // Arrival order, breaks timestamp ties
+        int64_t arrival_ns;         // steady_clock
+        int node;
+        bool is_alert;              // Alerts sort after frames of the same time
+        speedflow::FrameResult frame;
+        speedflow::AlertResult alert;
+    };
+    
+    struct Connection;
+    struct Worker;
+    
+    static bool later(const Record& a, const Record& b);
+    
+    void runWorker(Worker& worker);
+    bool readConnection(Connection& conn, std::vector<Record>& parsed);
+    void closeConnection(Worker& worker, int fd);
+    int registerNode(const std::string& node_id);
+    
+    void runMerge();
+    void release(Record& record);
+    void deliver(const Record& record);
+    void report(int64_t elapsed_ns);
+    
+    AggregatorConfig config_;
+    std::vector<std::shared_ptr<speedflow::ResultSink>> sinks_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::thread merge_thread_;
+    std::atomic<bool> running_;     // Connection threads
+    std::atomic<bool> merging_;     // Merge thread, stops after them
+    std::atomic<uint64_t> sequence_;
+    
+    // Node ids to rollup index (connection threads register, merge thread updates)
+    mutable std::mutex nodes_mutex_;
+    std::unordered_map<std::string, int> node_index_;
+    std::vector<NodeRollup> nodes_;
+    
+    // Merge thread only
+    std::vector<Record> pending_;               // Min-heap by (ntp_timestamp, is_alert, sequence)
+    std::vector<Record> released_batch_;        // Released under nodes_mutex_, delivered after it
+    std::unordered_map<uint64_t, int> source_ids_;  // (node << 32 | source) -> corridor source id
+    int64_t max_seen_ntp_;
+    int64_t released_ntp_;
+    bool released_any_;
+    NodeRollup last_report_;                    // Corridor totals at the last report
+    
+    std::atomic<uint64_t> released_;
+    std::atomic<uint64_t> dropped_;             // Inbox overflow, records never merged
+};
+
+#endif // AGGREGATOR_H
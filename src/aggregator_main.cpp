@@ -0,0 +1,128 @@
+// aggregator_main.cpp - speedflow_aggregator, merges the streams of many nodes
+// into one corridor-wide stream, REST snapshot and FrameData output
+
+#include <iostream>
+#include <csignal>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "aggregator.h"
+#include "api_server.h"
+#include "frame_publisher.h"
+#include "snapshot_publisher.h"
+
+static std::atomic<bool> g_stop(false);
+
+void signalHandler(int) {
+    g_stop = true;
+}
+
+void printUsage(const char* prog_name) {
+    std::cout << "Usage: " << prog_name << " [options]\n"
+              << "\nOptions:\n"
+              << "  --port <n>          TCP port for node streams (default: 9400)\n"
+              << "  --threads <n>       Connection threads (default: one per core)\n"
+              << "  --reorder-ms <n>    Reorder window in ms (default: 500)\n"
+              << "  --api-port <n>      REST snapshot API port, 0 = off (default: 8080)\n"
+              << "  --max-sources <n>   Corridor sources in the snapshot API (default: 256)\n"
+              << "  --output <target>   Merged FrameData stream: file://, unix:// or tcp:// (default: off)\n"
+              << "  --report <s>        Rollup log interval in seconds, 0 = off (default: 10)\n"
+              << "  --help              Show this help message\n"
+              << "\nNodes publish with results_output: tcp://<this host>:<port>\n"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    AggregatorConfig config;
+    int api_port = 8080;
+    int max_sources = 256;
+    std::string output;
+    
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--port" && i + 1 < argc) {
+                config.port = std::stoi(argv[++i]);
+            } else if (arg == "--threads" && i + 1 < argc) {
+                config.io_threads = std::stoi(argv[++i]);
+            } else if (arg == "--reorder-ms" && i + 1 < argc) {
+                config.reorder_window_ms = std::stoi(argv[++i]);
+            } else if (arg == "--api-port" && i + 1 < argc) {
+                api_port = std::stoi(argv[++i]);
+            } else if (arg == "--max-sources" && i + 1 < argc) {
+                max_sources = std::stoi(argv[++i]);
+            } else if (arg == "--output" && i + 1 < argc) {
+                output = argv[++i];
+            } else if (arg == "--report" && i + 1 < argc) {
+                config.report_interval_s = std::stoi(argv[++i]);
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << std::endl;
+        return 1;
+    }
+    
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    
+    Aggregator aggregator(config);
+    
+    // Merged stream consumers, the same sinks speedcalc feeds on a node
+    std::shared_ptr<SnapshotPublisher> snapshots;
+    std::unique_ptr<ApiServer> api_server;
+    if (api_port > 0) {
+        snapshots = std::make_shared<SnapshotPublisher>(max_sources);
+        aggregator.addSink(snapshots);
+    }
+    
+    std::shared_ptr<FrameDataPublisher> publisher;
+    if (!output.empty()) {
+        publisher = std::make_shared<FrameDataPublisher>(output, 8192, "aggregator");
+        if (!publisher->start()) {
+            std::cerr << "[Main] Failed to start merged stream: " << output << std::endl;
+            return 1;
+        }
+        aggregator.addSink(publisher);
+    }
+    
+    if (!aggregator.start()) {
+        return 1;
+    }
+    
+    // REST API (failure to bind is not fatal for the merge)
+    if (snapshots) {
+        api_server = std::make_unique<ApiServer>(snapshots, api_port);
+        if (!api_server->start()) {
+            api_server.reset();
+        }
+    }
+    
+    std::cout << "[Main] Running... (Press Ctrl+C to stop)" << std::endl;
+    while (!g_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    
+    std::cout << "\n[Main] Shutting down..." << std::endl;
+    api_server.reset();
+    aggregator.stop();
+    if (publisher) {
+        publisher->stop();
+    }
+    
+    std::vector<NodeRollup> nodes;
+    aggregator.rollups(nodes);
+    for (const NodeRollup& node : nodes) {
+        std::cout << "[Main] " << node.node_id << ": " << node.frames << " frames, "
+                  << node.alerts << " alerts, " << node.late << " late, mean "
+                  << (node.measured > 0 ? node.speed_sum_kmh / node.measured : 0.0) << " km/h"
+                  << std::endl;
+    }
+    return 0;
+}
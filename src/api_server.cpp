@@ -1,14 +1,461 @@
-// api_server.cpp - Placeholder for Phase 3
-// Will implement Oat++ WebSocket server and WebRTC signaling
+// api_server.cpp - Oat++ async REST API (snapshot, source and preview endpoints)
+// WebSocket streaming and WebRTC signaling are still to come (Phase 3); the
+// RTP preview is negotiated with a plain SDP answer instead
 
+#include "api_server.h"
+#include "speedflow.pb.h"
+#include <google/protobuf/util/json_util.h>
+#include <chrono>
 #include <iostream>
+#include <vector>
 
-// TODO: Implement Oat++ server
-// - WebSocket endpoint for Protobuf data streaming
-// - REST endpoints for WebRTC signaling (/api/webrtc/offer, /api/webrtc/ice)
-// - Static file serving for frontend
-// - Thread-safe queue consumer
+#include "oatpp/core/async/Executor.hpp"
+#include "oatpp/core/macro/codegen.hpp"
+#include "oatpp/core/utils/ConversionUtils.hpp"
+#include "oatpp/network/Server.hpp"
+#include "oatpp/network/tcp/server/ConnectionProvider.hpp"
+#include "oatpp/parser/json/mapping/ObjectMapper.hpp"
+#include "oatpp/web/server/AsyncHttpConnectionHandler.hpp"
+#include "oatpp/web/server/HttpRouter.hpp"
+#include "oatpp/web/server/api/ApiController.hpp"
 
-void startApiServer() {
-    std::cout << "[ApiServer] Placeholder - to be implemented in Phase 3" << std::endl;
+// How long a source change may take on the pipeline's main loop, and how
+// often a handler checks for its reply meanwhile
+static constexpr std::chrono::milliseconds kSourceReplyTimeout(5000);
+static constexpr std::chrono::milliseconds kSourceReplyPoll(5);
+
+static void fillSource(const SourceSnapshot& snapshot, speedflow::SourceSnapshot* msg) {
+    speedflow::FrameData* frame = msg->mutable_frame();
+    frame->set_ntp_timestamp(snapshot.frame.ntp_timestamp);
+    frame->set_frame_number(snapshot.frame.frame_number);
+    frame->set_source_id(snapshot.frame.source_id);
+    for (const auto& obj : snapshot.frame.objects) {
+        speedflow::ObjectInfo* info = frame->add_objects();
+        info->set_track_id(static_cast<int32_t>(obj.track_id));
+        info->set_speed_kmh(obj.speed_kmh);
+        info->set_bbox_x(obj.bbox_x);
+        info->set_bbox_y(obj.bbox_y);
+        info->set_bbox_w(obj.bbox_w);
+        info->set_bbox_h(obj.bbox_h);
+        info->set_class_id(obj.class_id);
+        info->set_confidence(obj.confidence);
+        info->set_is_overspeeding(obj.is_overspeeding);
+    }
+    msg->set_vehicle_count(snapshot.vehicle_count);
+    msg->set_mean_speed_kmh(snapshot.mean_speed_kmh);
+    msg->set_overspeed_count(snapshot.overspeed_count);
+}
+
+static void fillSourceInfo(const SourceStatus& status, speedflow::SourceInfo* msg) {
+    msg->set_source_id(status.source_id);
+    msg->set_uri(status.uri);
+    msg->set_calibration(status.calibration);
+    msg->set_connected(status.connected);
+}
+
+// The body moves into the oatpp::String, and responses share it from there
+static oatpp::String serialize(const google::protobuf::Message& msg, bool json) {
+    std::string body;
+    if (json) {
+        google::protobuf::util::JsonPrintOptions options;
+        options.preserve_proto_field_names = true;
+        options.always_print_primitive_fields = true;
+        google::protobuf::util::MessageToJsonString(msg, &body, options);
+    } else {
+        msg.SerializeToString(&body);
+    }
+    return oatpp::String(std::move(body));
+}
+
+#include OATPP_CODEGEN_BEGIN(ApiController)
+
+class RestController : public oatpp::web::server::api::ApiController {
+public:
+    RestController(ApiServer* server, const std::shared_ptr<ObjectMapper>& object_mapper)
+        : oatpp::web::server::api::ApiController(object_mapper), server_(server) {}
+    
+    ENDPOINT_ASYNC("GET", "/api/snapshot", GetSnapshot) {
+        ENDPOINT_ASYNC_INIT(GetSnapshot)
+        
+        Action act() override {
+            bool json = wantsJson(request);
+            return _return(controller->bodyResponse(controller->server_->snapshotBody(json), json));
+        }
+    };
+    
+    ENDPOINT_ASYNC("GET", "/api/snapshot/{source}", GetSourceSnapshot) {
+        ENDPOINT_ASYNC_INIT(GetSourceSnapshot)
+        
+        Action act() override {
+            bool ok = false;
+            v_int32 source_id = oatpp::utils::conversion::strToInt32(
+                request->getPathVariable("source"), ok);
+            if (!ok) {
+                return _return(controller->createResponse(Status::CODE_400, "Invalid source id"));
+            }
+            
+            bool json = wantsJson(request);
+            auto body = controller->server_->sourceBody(source_id, json);
+            if (!body) {
+                return _return(controller->createResponse(Status::CODE_404, "No frame for source"));
+            }
+            return _return(controller->bodyResponse(body, json));
+        }
+    };
+    
+    // Source changes run on the pipeline's main loop; the handlers poll
+    // the reply with timed waits, so no worker blocks on it
+    ENDPOINT_ASYNC("GET", "/api/sources", ListSources) {
+        ENDPOINT_ASYNC_INIT(ListSources)
+        
+        std::future<SourceReply> pending_;
+        std::chrono::steady_clock::time_point deadline_;
+        
+        Action act() override {
+            SourceControl* control = controller->server_->sourceControl();
+            if (!control) {
+                return _return(controller->createResponse(Status::CODE_404, "Source control disabled"));
+            }
+            pending_ = control->listSources();
+            deadline_ = std::chrono::steady_clock::now() + kSourceReplyTimeout;
+            return yieldTo(&ListSources::onReply);
+        }
+        
+        Action onReply() {
+            SourceReply reply;
+            if (!takeReply(pending_, deadline_, reply)) {
+                return waitRepeat(kSourceReplyPoll);
+            }
+            if (reply.result != SourceChange::Done) {
+                return _return(controller->changeError(reply.result, reply.error));
+            }
+            
+            speedflow::SourceList msg;
+            for (const auto& source : reply.sources) {
+                fillSourceInfo(source, msg.add_sources());
+            }
+            bool json = wantsJson(request);
+            return _return(controller->bodyResponse(serialize(msg, json), json));
+        }
+    };
+    
+    ENDPOINT_ASYNC("POST", "/api/sources", AttachSource) {
+        ENDPOINT_ASYNC_INIT(AttachSource)
+        
+        std::future<SourceReply> pending_;
+        std::chrono::steady_clock::time_point deadline_;
+        
+        Action act() override {
+            if (!controller->server_->sourceControl()) {
+                return _return(controller->createResponse(Status::CODE_404, "Source control disabled"));
+            }
+            return request->readBodyToStringAsync().callbackTo(&AttachSource::onBody);
+        }
+        
+        Action onBody(const oatpp::String& body) {
+            // JSON unless the client sends protobuf
+            speedflow::AttachSourceRequest msg;
+            auto content_type = request->getHeader(Header::CONTENT_TYPE);
+            bool parsed;
+            if (content_type && content_type->find("application/x-protobuf") != std::string::npos) {
+                parsed = body && msg.ParseFromString(*body);
+            } else {
+                parsed = body && google::protobuf::util::JsonStringToMessage(*body, &msg).ok();
+            }
+            if (!parsed || msg.uri().empty()) {
+                return _return(controller->createResponse(Status::CODE_400,
+                                                          "Expected AttachSourceRequest with a uri"));
+            }
+            
+            pending_ = controller->server_->sourceControl()->attachSource(msg.uri(), msg.calibration());
+            deadline_ = std::chrono::steady_clock::now() + kSourceReplyTimeout;
+            return yieldTo(&AttachSource::onReply);
+        }
+        
+        Action onReply() {
+            SourceReply reply;
+            if (!takeReply(pending_, deadline_, reply)) {
+                return waitRepeat(kSourceReplyPoll);
+            }
+            if (reply.result != SourceChange::Done) {
+                return _return(controller->changeError(reply.result, reply.error));
+            }
+            
+            speedflow::SourceInfo info;
+            fillSourceInfo(reply.sources.front(), &info);
+            bool json = wantsJson(request);
+            return _return(controller->bodyResponse(serialize(info, json), json, Status::CODE_201));
+        }
+    };
+    
+    ENDPOINT_ASYNC("DELETE", "/api/sources/{source}", DetachSource) {
+        ENDPOINT_ASYNC_INIT(DetachSource)
+        
+        std::future<SourceReply> pending_;
+        std::chrono::steady_clock::time_point deadline_;
+        
+        Action act() override {
+            SourceControl* control = controller->server_->sourceControl();
+            if (!control) {
+                return _return(controller->createResponse(Status::CODE_404, "Source control disabled"));
+            }
+            
+            bool ok = false;
+            v_int32 source_id = oatpp::utils::conversion::strToInt32(
+                request->getPathVariable("source"), ok);
+            if (!ok) {
+                return _return(controller->createResponse(Status::CODE_400, "Invalid source id"));
+            }
+            
+            pending_ = control->detachSource(source_id);
+            deadline_ = std::chrono::steady_clock::now() + kSourceReplyTimeout;
+            return yieldTo(&DetachSource::onReply);
+        }
+        
+        Action onReply() {
+            SourceReply reply;
+            if (!takeReply(pending_, deadline_, reply)) {
+                return waitRepeat(kSourceReplyPoll);
+            }
+            if (reply.result != SourceChange::Done) {
+                return _return(controller->changeError(reply.result, reply.error));
+            }
+            return _return(controller->createResponse(Status::CODE_204, ""));
+        }
+    };
+    
+    // Preview viewers: the SDP describes the RTP stream the node now sends
+    // to host:port; players (ffplay, VLC, GStreamer sdpdemux) open it directly
+    ENDPOINT_ASYNC("POST", "/api/preview/viewers", AddPreviewViewer) {
+        ENDPOINT_ASYNC_INIT(AddPreviewViewer)
+        
+        Action act() override {
+            if (!controller->server_->previewControl()) {
+                return _return(controller->createResponse(Status::CODE_404, "Preview control disabled"));
+            }
+            return request->readBodyToStringAsync().callbackTo(&AddPreviewViewer::onBody);
+        }
+        
+        Action onBody(const oatpp::String& body) {
+            speedflow::PreviewViewerRequest msg;
+            auto content_type = request->getHeader(Header::CONTENT_TYPE);
+            bool parsed;
+            if (content_type && content_type->find("application/x-protobuf") != std::string::npos) {
+                parsed = body && msg.ParseFromString(*body);
+            } else {
+                parsed = body && google::protobuf::util::JsonStringToMessage(*body, &msg).ok();
+            }
+            if (!parsed || msg.host().empty() || msg.port() == 0) {
+                return _return(controller->createResponse(Status::CODE_400,
+                                                          "Expected PreviewViewerRequest with host and port"));
+            }
+            
+            std::string sdp;
+            std::string error;
+            if (!controller->server_->previewControl()->addPreviewViewer(
+                    msg.host(), static_cast<int>(msg.port()), sdp, error)) {
+                return _return(controller->createResponse(Status::CODE_409,
+                    oatpp::String(error.data(), static_cast<v_buff_size>(error.size()))));
+            }
+            
+            auto response = controller->createResponse(Status::CODE_201,
+                oatpp::String(sdp.data(), static_cast<v_buff_size>(sdp.size())));
+            response->putHeader(Header::CONTENT_TYPE, "application/sdp");
+            response->putHeader("Cache-Control", "no-store");
+            response->putHeader("Access-Control-Allow-Origin", "*");
+            return _return(response);
+        }
+    };
+    
+    ENDPOINT_ASYNC("DELETE", "/api/preview/viewers/{host}/{port}", RemovePreviewViewer) {
+        ENDPOINT_ASYNC_INIT(RemovePreviewViewer)
+        
+        Action act() override {
+            PreviewControl* control = controller->server_->previewControl();
+            if (!control) {
+                return _return(controller->createResponse(Status::CODE_404, "Preview control disabled"));
+            }
+            
+            bool ok = false;
+            v_int32 port = oatpp::utils::conversion::strToInt32(request->getPathVariable("port"), ok);
+            auto host = request->getPathVariable("host");
+            if (!ok || !host) {
+                return _return(controller->createResponse(Status::CODE_400, "Invalid viewer"));
+            }
+            
+            if (!control->removePreviewViewer(*host, port)) {
+                return _return(controller->createResponse(Status::CODE_404, "Viewer not subscribed"));
+            }
+            return _return(controller->createResponse(Status::CODE_204, ""));
+        }
+    };
+
+private:
+    /**
+     * Take a source change's reply if the main loop has sent it
+     * @param reply Filled with the reply, or a Timeout once the deadline passed
+     * @return false while the handler should keep waiting
+     */
+    static bool takeReply(std::future<SourceReply>& pending,
+                          std::chrono::steady_clock::time_point deadline,
+                          SourceReply& reply) {
+        if (pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            reply = pending.get();
+            return true;
+        }
+        if (std::chrono::steady_clock::now() < deadline) {
+            return false;
+        }
+        reply.result = SourceChange::Timeout;
+        reply.error = "pipeline main loop did not respond";
+        return true;
+    }
+    
+    static bool wantsJson(const std::shared_ptr<IncomingRequest>& request) {
+        auto format = request->getQueryParameter("format");
+        if (format) {
+            return format != "protobuf";
+        }
+        auto accept = request->getHeader(Header::ACCEPT);
+        return !(accept && accept->find("application/x-protobuf") != std::string::npos);
+    }
+    
+    // The response body references the cached string, no copy per request
+    std::shared_ptr<OutgoingResponse> bodyResponse(const oatpp::String& body,
+                                                   bool json,
+                                                   const Status& status = Status::CODE_200) {
+        auto response = createResponse(status, body);
+        response->putHeader(Header::CONTENT_TYPE, json ? "application/json" : "application/x-protobuf");
+        response->putHeader("Cache-Control", "no-store");
+        response->putHeader("Access-Control-Allow-Origin", "*");
+        return response;
+    }
+    
+    std::shared_ptr<OutgoingResponse> changeError(SourceChange result, const std::string& error) {
+        Status status = result == SourceChange::NotFound ? Status::CODE_404
+                      : result == SourceChange::Rejected ? Status::CODE_409
+                      : result == SourceChange::Timeout ? Status::CODE_503
+                      : Status::CODE_500;
+        return createResponse(status, oatpp::String(error.data(), static_cast<v_buff_size>(error.size())));
+    }
+    
+    ApiServer* server_;
+};
+
+#include OATPP_CODEGEN_END(ApiController)
+
+ApiServer::ApiServer(std::shared_ptr<const SnapshotPublisher> snapshots, int port, int threads)
+    : snapshots_(std::move(snapshots)),
+      port_(port),
+      threads_(threads) {
+}
+
+ApiServer::~ApiServer() {
+    stop();
+}
+
+bool ApiServer::start() {
+    if (server_) {
+        return true;
+    }
+    
+    oatpp::base::Environment::init();
+    
+    try {
+        // Coroutine workers + one I/O and one timer worker
+        executor_ = std::make_shared<oatpp::async::Executor>(threads_, 1, 1);
+        
+        auto router = oatpp::web::server::HttpRouter::createShared();
+        router->addController(std::make_shared<RestController>(
+            this, oatpp::parser::json::mapping::ObjectMapper::createShared()));
+        
+        handler_ = oatpp::web::server::AsyncHttpConnectionHandler::createShared(router, executor_);
+        provider_ = oatpp::network::tcp::server::ConnectionProvider::createShared(
+            {"0.0.0.0", static_cast<v_uint16>(port_), oatpp::network::Address::IP_4});
+        server_ = oatpp::network::Server::createShared(provider_, handler_);
+    } catch (const std::exception& e) {
+        std::cerr << "[ApiServer] Failed to start on port " << port_ << ": " << e.what() << std::endl;
+        server_.reset();
+        handler_.reset();
+        provider_.reset();
+        if (executor_) {
+            executor_->stop();
+            executor_->join();
+            executor_.reset();
+        }
+        oatpp::base::Environment::destroy();
+        return false;
+    }
+    
+    thread_ = std::thread([this] { server_->run(); });
+    
+    std::cout << "[ApiServer] Snapshot API at http://<device-ip>:" << port_
+              << "/api/snapshot" << std::endl;
+    return true;
+}
+
+void ApiServer::stop() {
+    if (!server_) {
+        return;
+    }
+    
+    server_->stop();
+    handler_->stop();
+    provider_->stop();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    executor_->waitTasksFinished();
+    executor_->stop();
+    executor_->join();
+    
+    server_.reset();
+    handler_.reset();
+    provider_.reset();
+    executor_.reset();
+    oatpp::base::Environment::destroy();
+    
+    std::cout << "[ApiServer] Stopped" << std::endl;
+}
+
+oatpp::String ApiServer::snapshotBody(bool json) {
+    uint64_t sequence = snapshots_->sequence();
+    CachedBody& cache = cache_[json ? 1 : 0];
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        if (cache.body && cache.sequence == sequence) {
+            return cache.body;
+        }
+    }
+    
+    // Serialize outside the lock; concurrent misses may each serialize,
+    // the newest result is kept
+    std::vector<std::shared_ptr<const SourceSnapshot>> sources;
+    snapshots_->latestAll(sources);
+    
+    speedflow::Snapshot msg;
+    msg.set_sequence(sequence);
+    for (const auto& source : sources) {
+        fillSource(*source, msg.add_sources());
+    }
+    auto body = serialize(msg, json);
+    
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (!cache.body || sequence >= cache.sequence) {
+        cache.sequence = sequence;
+        cache.body = body;
+    }
+    return body;
+}
+
+oatpp::String ApiServer::sourceBody(int source_id, bool json) {
+    auto snapshot = snapshots_->latest(source_id);
+    if (!snapshot) {
+        return nullptr;
+    }
+    
+    speedflow::SourceSnapshot msg;
+    fillSource(*snapshot, &msg);
+    return serialize(msg, json);
 }
@@ -0,0 +1,106 @@
+#ifndef API_SERVER_H
+#define API_SERVER_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "snapshot_publisher.h"
+#include "source_control.h"
+#include "preview_control.h"
+#include "oatpp/core/Types.hpp"
+
+namespace oatpp {
+namespace async { class Executor; }
+namespace network { class Server; class ServerConnectionProvider; class ConnectionHandler; }
+}
+
+/**
+ * ApiServer - Oat++ async REST API for dashboards
+ *
+ * Endpoints (JSON by default, protobuf with ?format=protobuf or
+ * Accept: application/x-protobuf):
+ *   GET /api/snapshot           speedflow.Snapshot, latest frame of every source
+ *   GET /api/snapshot/{source}  speedflow.SourceSnapshot of one source
+ *
+ * With a SourceControl (api_source_control, otherwise 404):
+ *   GET    /api/sources          speedflow.SourceList
+ *   POST   /api/sources          speedflow.AttachSourceRequest -> SourceInfo (201)
+ *   DELETE /api/sources/{source} 204; 404 unknown, 409 refused, 503 pipeline busy
+ *
+ * With a PreviewControl (api_preview_viewers, otherwise 404):
+ *   POST   /api/preview/viewers  speedflow.PreviewViewerRequest -> SDP (201), renews the lease
+ *   DELETE /api/preview/viewers/{host}/{port}  204; 404 not subscribed
+ *
+ * Handlers are coroutines on a small Oat++ executor and only read the
+ * SnapshotPublisher, so polling clients never touch the streaming thread.
+ * The full snapshot is serialized once per published frame and the same
+ * body is shared by every request that asks for that frame. Source changes
+ * run on the pipeline's main loop; their handlers poll for the reply with
+ * timed waits instead of holding a worker.
+ */
+class ApiServer {
+public:
+    /**
+     * @param snapshots Snapshot source, filled by speedcalc
+     * @param port TCP port to listen on
+     * @param threads Coroutine worker threads
+     */
+    ApiServer(std::shared_ptr<const SnapshotPublisher> snapshots, int port, int threads = 2);
+    ~ApiServer();
+    
+    /**
+     * Serve /api/sources (before start())
+     * @param control Pipeline to attach and detach sources on, must outlive the server
+     */
+    void setSourceControl(SourceControl* control) { source_control_ = control; }
+    SourceControl* sourceControl() const { return source_control_; }
+    
+    /**
+     * Serve /api/preview/viewers (before start())
+     * @param control Pipeline with an rtp preview, must outlive the server
+     */
+    void setPreviewControl(PreviewControl* control) { preview_control_ = control; }
+    PreviewControl* previewControl() const { return preview_control_; }
+    
+    bool start();
+    void stop();
+    
+    /**
+     * Serialized snapshot of all sources
+     * @param json JSON (true) or binary protobuf (false)
+     */
+    oatpp::String snapshotBody(bool json);
+    
+    /**
+     * Serialized snapshot of one source
+     * @param source_id Stream source id
+     * @param json JSON (true) or binary protobuf (false)
+     * @return Body, or nullptr if the source has no frame yet
+     */
+    oatpp::String sourceBody(int source_id, bool json);
+
+private:
+    struct CachedBody {
+        uint64_t sequence = 0;
+        oatpp::String body;     // Shared with the responses that send it
+    };
+    
+    std::shared_ptr<const SnapshotPublisher> snapshots_;
+    SourceControl* source_control_ = nullptr;
+    PreviewControl* preview_control_ = nullptr;
+    int port_;
+    int threads_;
+    
+    std::mutex cache_mutex_;
+    CachedBody cache_[2];  // [protobuf, json]
+    
+    std::shared_ptr<oatpp::async::Executor> executor_;
+    std::shared_ptr<oatpp::network::ServerConnectionProvider> provider_;
+    std::shared_ptr<oatpp::network::ConnectionHandler> handler_;
+    std::shared_ptr<oatpp::network::Server> server_;
+    std::thread thread_;
+};
+
+#endif // API_SERVER_H
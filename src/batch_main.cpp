@@ -0,0 +1,312 @@
+// batch_main.cpp - speedflow_batch, analyzes a long recording as chunks run
+// by parallel speedflow processes and merges their event logs into one
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+#include "chunk_merger.h"
+#include "config_loader.h"
+
+extern char** environ;
+
+namespace fs = std::filesystem;
+
+struct BatchOptions {
+    std::string uri;
+    std::string config_path = "configs/pipeline.yml";
+    std::string profile;
+    std::string out_dir = "batch";
+    std::string speedflow;              // speedflow binary (default: next to this one)
+    std::vector<int> chunk_counts = {1};
+    double overlap_s = 10.0;
+    double duration_s = 0.0;            // 0 = probe the container
+    double media_epoch_s = 0.0;
+    float stitch_distance_m = 1.5f;
+};
+
+void printUsage(const char* prog_name) {
+    std::cout << "Usage: " << prog_name << " <recording> [options]\n"
+              << "\nArguments:\n"
+              << "  recording             File path or file:// URI\n"
+              << "\nOptions:\n"
+              << "  --config <path>       Pipeline config YAML (default: configs/pipeline.yml)\n"
+              << "  --profile <name>      deepstream | cpu-sim (overrides config)\n"
+              << "  --chunks <n[,n...]>   Parallel chunks; a list runs once per count and\n"
+              << "                        reports the speedup over the first (default: 1)\n"
+              << "  --overlap <s>         Warm-up before each chunk, also the stitching window (default: 10)\n"
+              << "  --out <dir>           Output directory (default: batch)\n"
+              << "  --duration <s>        Recording length, when the container does not tell\n"
+              << "  --media-epoch <s>     Unix time of the recording start (default: 0, media time)\n"
+              << "  --stitch-distance <m> Mean distance of one vehicle's two paths (default: 1.5)\n"
+              << "  --speedflow <path>    speedflow binary (default: next to this one)\n"
+              << "  --help                Show this help message\n"
+              << "\nExample:\n"
+              << "  " << prog_name << " /data/cam3_2024-05-02.mp4 --chunks 1,2,4,8 --out /tmp/cam3\n"
+              << std::endl;
+}
+
+// Length of the recording from its container
+static double probeDuration(const std::string& uri) {
+    GError* error = nullptr;
+    GstDiscoverer* discoverer = gst_discoverer_new(30 * GST_SECOND, &error);
+    if (!discoverer) {
+        std::cerr << "[Batch] Discoverer failed: " << (error ? error->message : "unknown") << std::endl;
+        g_clear_error(&error);
+        return 0.0;
+    }
+    
+    GstDiscovererInfo* info = gst_discoverer_discover_uri(discoverer, uri.c_str(), &error);
+    GstClockTime duration = info ? gst_discoverer_info_get_duration(info) : GST_CLOCK_TIME_NONE;
+    if (error) {
+        std::cerr << "[Batch] Cannot probe " << uri << ": " << error->message << std::endl;
+        g_clear_error(&error);
+    }
+    if (info) {
+        gst_discoverer_info_unref(info);
+    }
+    g_object_unref(discoverer);
+    return GST_CLOCK_TIME_IS_VALID(duration) ? duration / 1e9 : 0.0;
+}
+
+// Start a child with stdout and stderr in a file
+static pid_t spawn(const std::vector<std::string>& args, const std::string& output_path) {
+    std::vector<char*> argv;
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, output_path.c_str(),
+                                     O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    
+    pid_t pid = -1;
+    int rc = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) {
+        std::cerr << "[Batch] Cannot start " << argv[0] << ": " << strerror(rc) << std::endl;
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * Analyze the whole recording once, split into `chunks` parallel runs
+ * @param wall_s Wall-clock time of the runs and the merge
+ * @return false if a chunk failed or the merge could not be written
+ */
+static bool runChunks(const BatchOptions& options, float video_fps, int chunks,
+                      double duration_s, double& wall_s, ChunkMergeStats& stats) {
+    fs::path dir = fs::path(options.out_dir) / ("chunks-" + std::to_string(chunks));
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+    
+    // Chunk i owns [b_i, b_i+1) and starts overlap_s earlier to warm up
+    // its tracker; the seek snaps that start to the keyframe before it
+    std::vector<ChunkLog> logs(chunks);
+    std::vector<pid_t> pids(chunks, -1);
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < chunks; i++) {
+        double own_start = duration_s * i / chunks;
+        double own_stop = i + 1 < chunks ? duration_s * (i + 1) / chunks : 0.0;
+        logs[i].own_start_s = own_start;
+        logs[i].own_stop_s = own_stop;
+        logs[i].dir = (dir / ("chunk-" + std::to_string(i))).string();
+        
+        std::ostringstream start;
+        std::ostringstream stop;
+        std::ostringstream epoch;
+        start.precision(3);
+        stop.precision(3);
+        epoch.precision(3);
+        start << std::fixed << (i > 0 ? std::max(0.0, own_start - options.overlap_s) : 0.0);
+        stop << std::fixed << own_stop;
+        epoch << std::fixed << options.media_epoch_s;
+        
+        std::vector<std::string> args = {options.speedflow, options.uri,
+                                         "--config", options.config_path,
+                                         "--event-log", logs[i].dir,
+                                         "--start", start.str(),
+                                         "--media-epoch", epoch.str()};
+        if (own_stop > 0.0) {
+            args.insert(args.end(), {"--stop", stop.str()});
+        }
+        if (!options.profile.empty()) {
+            args.insert(args.end(), {"--profile", options.profile});
+        }
+        
+        fs::create_directories(logs[i].dir, ec);
+        pids[i] = spawn(args, logs[i].dir + "/speedflow.out");
+        if (pids[i] < 0) {
+            for (int j = 0; j < i; j++) {
+                kill(pids[j], SIGTERM);
+                waitpid(pids[j], nullptr, 0);
+            }
+            return false;
+        }
+    }
+    
+    bool ok = true;
+    for (int i = 0; i < chunks; i++) {
+        int status = 0;
+        waitpid(pids[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "[Batch] Chunk " << i << " failed, see " << logs[i].dir
+                      << "/speedflow.out" << std::endl;
+            ok = false;
+        }
+    }
+    if (!ok) {
+        return false;
+    }
+    
+    ChunkMergeConfig merge_config;
+    merge_config.video_fps = video_fps;
+    merge_config.media_epoch_ns = static_cast<int64_t>(options.media_epoch_s * 1e9);
+    merge_config.stitch_max_distance_m = options.stitch_distance_m;
+    merge_config.stitch_max_gap_frames = std::max(1, static_cast<int>(std::lround(video_fps / 2)));
+    
+    ChunkMerger merger(merge_config);
+    for (const ChunkLog& log : logs) {
+        if (!merger.addChunk(log)) {
+            return false;
+        }
+    }
+    std::string merged = (dir / "merged.log").string();
+    if (!merger.write(merged)) {
+        return false;
+    }
+    wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    stats = merger.stats();
+    
+    std::cout << "[Batch] " << chunks << " chunk(s): " << wall_s << " s, merged log " << merged
+              << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    BatchOptions options;
+    options.uri = argv[1];
+    if (options.uri == "--help" || options.uri == "-h") {
+        printUsage(argv[0]);
+        return 0;
+    }
+    
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--config" && i + 1 < argc) {
+                options.config_path = argv[++i];
+            } else if (arg == "--profile" && i + 1 < argc) {
+                options.profile = argv[++i];
+            } else if (arg == "--chunks" && i + 1 < argc) {
+                options.chunk_counts.clear();
+                std::stringstream list(argv[++i]);
+                std::string count;
+                while (std::getline(list, count, ',')) {
+                    options.chunk_counts.push_back(std::max(1, std::stoi(count)));
+                }
+            } else if (arg == "--overlap" && i + 1 < argc) {
+                options.overlap_s = std::stod(argv[++i]);
+            } else if (arg == "--out" && i + 1 < argc) {
+                options.out_dir = argv[++i];
+            } else if (arg == "--duration" && i + 1 < argc) {
+                options.duration_s = std::stod(argv[++i]);
+            } else if (arg == "--media-epoch" && i + 1 < argc) {
+                options.media_epoch_s = std::stod(argv[++i]);
+            } else if (arg == "--stitch-distance" && i + 1 < argc) {
+                options.stitch_distance_m = std::stof(argv[++i]);
+            } else if (arg == "--speedflow" && i + 1 < argc) {
+                options.speedflow = argv[++i];
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << std::endl;
+        return 1;
+    }
+    if (options.chunk_counts.empty()) {
+        std::cerr << "No chunk counts given" << std::endl;
+        return 1;
+    }
+    
+    // Children resolve paths from their own working directory, which is ours
+    if (options.uri.find("://") == std::string::npos) {
+        options.uri = "file://" + fs::absolute(options.uri).string();
+    }
+    if (options.speedflow.empty()) {
+        std::error_code ec;
+        options.speedflow = (fs::read_symlink("/proc/self/exe", ec).parent_path() / "speedflow").string();
+    }
+    
+    PipelineConfig config;
+    try {
+        config = ConfigLoader::loadPipelineConfig(options.config_path);
+    } catch (const std::exception& e) {
+        std::cerr << "[Batch] " << e.what() << std::endl;
+        return 1;
+    }
+    
+    gst_init(&argc, &argv);
+    double duration_s = options.duration_s > 0.0 ? options.duration_s : probeDuration(options.uri);
+    if (duration_s <= 0.0) {
+        std::cerr << "[Batch] Unknown recording length, pass --duration" << std::endl;
+        return 1;
+    }
+    std::cout << "[Batch] " << options.uri << ": " << duration_s << " s at " << config.video_fps
+              << " FPS, overlap " << options.overlap_s << " s" << std::endl;
+    
+    // One full analysis per chunk count, sequentially, so runs never compete
+    double baseline_s = 0.0;
+    std::ostringstream report;
+    report << "\n chunks   wall s  speedup  x realtime  measurements  alerts  stitched  dup alerts\n";
+    for (int chunks : options.chunk_counts) {
+        double wall_s = 0.0;
+        ChunkMergeStats stats;
+        if (!runChunks(options, config.video_fps, chunks, duration_s, wall_s, stats)) {
+            return 1;
+        }
+        if (baseline_s == 0.0) {
+            baseline_s = wall_s;
+        }
+        
+        char line[160];
+        snprintf(line, sizeof(line), "%7d %8.1f %8.2f %11.1f %13llu %7llu %9llu %11llu\n",
+                 chunks, wall_s, baseline_s / wall_s, duration_s / wall_s,
+                 static_cast<unsigned long long>(stats.measurements),
+                 static_cast<unsigned long long>(stats.alerts),
+                 static_cast<unsigned long long>(stats.stitched),
+                 static_cast<unsigned long long>(stats.duplicate_alerts));
+        report << line;
+    }
+    
+    std::cout << report.str() << "\n(speedup over " << options.chunk_counts.front()
+              << " chunk(s); wall time includes spawning, seeking and merging)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,363 @@
+#include "chunk_merger.h"
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Position of a path at a frame by linear interpolation between vertices
+// (the simplified path's own definition); i is a cursor for increasing frames
+static void positionAt(const std::vector<speedflow::TrajectoryVertex>& path, size_t& i,
+                       int frame, float& x, float& y) {
+    while (i + 1 < path.size() && path[i + 1].frame <= frame) {
+        i++;
+    }
+    if (i + 1 >= path.size() || path[i].frame >= frame) {
+        x = path[i].x;
+        y = path[i].y;
+        return;
+    }
+    const auto& a = path[i];
+    const auto& b = path[i + 1];
+    float t = static_cast<float>(frame - a.frame) / static_cast<float>(b.frame - a.frame);
+    x = a.x + (b.x - a.x) * t;
+    y = a.y + (b.y - a.y) * t;
+}
+
+ChunkMerger::ChunkMerger(const ChunkMergeConfig& config)
+    : config_(config) {
+}
+
+bool ChunkMerger::addChunk(const ChunkLog& log) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(log.dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && name.rfind("events-", 0) == 0 &&
+            entry.path().extension() == ".log") {
+            files.push_back(entry.path());
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "[ChunkMerger] No event log in " << log.dir << std::endl;
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    
+    Chunk chunk;
+    chunk.own_start_ns = config_.media_epoch_ns + static_cast<int64_t>(log.own_start_s * 1e9);
+    chunk.own_stop_ns = log.own_stop_s > 0.0
+        ? config_.media_epoch_ns + static_cast<int64_t>(log.own_stop_s * 1e9)
+        : INT64_MAX;
+    chunk.own_start_frame = static_cast<int>(std::ceil(log.own_start_s * config_.video_fps - 1e-6));
+    for (const auto& file : files) {
+        if (!readLog(file.string(), chunk)) {
+            return false;
+        }
+    }
+    for (auto& [key, track] : chunk.tracks) {
+        track.boundary = chunk.own_start_frame;
+    }
+    
+    chunks_.push_back(std::move(chunk));
+    return true;
+}
+
+bool ChunkMerger::readLog(const std::string& path, Chunk& chunk) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "[ChunkMerger] Cannot open " << path << std::endl;
+        return false;
+    }
+    
+    // A torn tail (the chunk was killed) ends the file like a clean EOF
+    google::protobuf::io::FileInputStream input(fd);
+    speedflow::EventLogRecord record;
+    bool clean_eof = false;
+    std::vector<speedflow::TrajectoryVertex> vertices;
+    while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&record, &input, &clean_eof)) {
+        switch (record.event_case()) {
+            case speedflow::EventLogRecord::kMeasurement: {
+                const auto& event = record.measurement();
+                chunk.tracks[{event.source_id(), event.track_id()}].measurements.push_back(event);
+                break;
+            }
+            case speedflow::EventLogRecord::kOverspeed: {
+                const auto& alert = record.overspeed();
+                chunk.tracks[{alert.source_id(), alert.track_id()}].alerts.push_back(alert);
+                break;
+            }
+            case speedflow::EventLogRecord::kTrajectory: {
+                const auto& trajectory = record.trajectory();
+                if (!speedflow::decodeTrajectory(trajectory.vertices(), vertices)) {
+                    break;
+                }
+                Track& track = chunk.tracks[{trajectory.source_id(), trajectory.track_id()}];
+                
+                // A continuation record starts where the previous one ended
+                for (const auto& vertex : vertices) {
+                    if (track.path.empty() || vertex.frame > track.path.back().frame) {
+                        track.path.push_back(vertex);
+                    }
+                }
+                track.max_error_m = std::max(track.max_error_m, trajectory.max_error_m());
+                track.num_points += trajectory.num_points();
+                track.emitted_ntp = std::max(track.emitted_ntp, trajectory.ntp_timestamp());
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    close(fd);
+    
+    if (!clean_eof) {
+        std::cout << "[ChunkMerger] " << path << " ends in a partial record, ignored" << std::endl;
+    }
+    return true;
+}
+
+bool ChunkMerger::owns(const Chunk& chunk, int64_t ntp_timestamp) const {
+    return ntp_timestamp >= chunk.own_start_ns && ntp_timestamp < chunk.own_stop_ns;
+}
+
+double ChunkMerger::meanDistance(const std::vector<speedflow::TrajectoryVertex>& a,
+                                 const std::vector<speedflow::TrajectoryVertex>& b,
+                                 int& common) const {
+    int first = std::max(a.front().frame, b.front().frame);
+    int last = std::min(a.back().frame, b.back().frame);
+    common = last - first + 1;
+    if (common < config_.stitch_min_frames) {
+        return INFINITY;
+    }
+    
+    size_t ia = 0;
+    size_t ib = 0;
+    double sum = 0.0;
+    for (int frame = first; frame <= last; frame++) {
+        float ax, ay, bx, by;
+        positionAt(a, ia, frame, ax, ay);
+        positionAt(b, ib, frame, bx, by);
+        sum += std::hypot(ax - bx, ay - by);
+    }
+    return sum / common;
+}
+
+void ChunkMerger::stitch(Chunk& earlier, Chunk& later) {
+    const int boundary = later.own_start_frame;
+    
+    // Earlier tracks still alive at the boundary, later tracks that began in
+    // the warm-up and continue past it
+    struct Candidate {
+        double distance;
+        Track* a;
+        Track* b;
+    };
+    std::vector<Candidate> candidates;
+    for (auto& [key_a, a] : earlier.tracks) {
+        if (a.path.empty() || a.path.back().frame < boundary - config_.stitch_max_gap_frames) {
+            continue;
+        }
+        for (auto& [key_b, b] : later.tracks) {
+            if (key_b.first != key_a.first || b.path.empty() ||
+                b.path.front().frame >= boundary || b.path.back().frame < boundary) {
+                continue;
+            }
+            int common = 0;
+            double distance = meanDistance(a.path, b.path, common);
+            if (distance <= config_.stitch_max_distance_m) {
+                candidates.push_back({distance, &a, &b});
+            }
+        }
+    }
+    
+    // Closest pairs first, one partner per track
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& x, const Candidate& y) { return x.distance < y.distance; });
+    for (const Candidate& candidate : candidates) {
+        if (candidate.a->next || candidate.b->previous) {
+            continue;
+        }
+        candidate.a->next = candidate.b;
+        candidate.b->previous = candidate.a;
+        stats_.stitched++;
+    }
+}
+
+bool ChunkMerger::write(const std::string& path) {
+    stats_ = ChunkMergeStats();
+    for (size_t i = 1; i < chunks_.size(); i++) {
+        stitch(chunks_[i - 1], chunks_[i]);
+    }
+    
+    // Output in time order; ties keep measurements ahead of alerts and
+    // trajectories, as speedcalc emits them
+    struct Output {
+        int64_t ntp_timestamp;
+        int order;
+        int source_id;
+        int track_id;
+        speedflow::EventLogRecord record;
+    };
+    std::vector<Output> output;
+    std::vector<Output> alerts;
+    std::map<int, int> next_id;  // Per source
+    
+    auto mergedId = [&](int source_id, Track& track) {
+        Track* first = &track;
+        while (first->previous) {
+            first = first->previous;
+        }
+        if (first->merged_id < 0) {
+            first->merged_id = ++next_id[source_id];
+        }
+        return first->merged_id;
+    };
+    
+    for (Chunk& chunk : chunks_) {
+        // Tracks in order of first appearance, so ids increase with time
+        std::vector<std::pair<int, TrackKey>> order;
+        for (auto& [key, track] : chunk.tracks) {
+            int first = track.path.empty() ? INT_MAX : track.path.front().frame;
+            if (!track.measurements.empty()) {
+                first = std::min(first, track.measurements.front().frame_number());
+            }
+            order.push_back({first, key});
+        }
+        std::sort(order.begin(), order.end());
+        
+        for (const auto& [first, key] : order) {
+            Track& track = chunk.tracks[key];
+            const int source_id = key.first;
+            
+            for (const auto& event : track.measurements) {
+                if (!owns(chunk, event.ntp_timestamp())) {
+                    stats_.warmup_dropped++;
+                    continue;
+                }
+                Output out{event.ntp_timestamp(), 0, source_id, mergedId(source_id, track), {}};
+                *out.record.mutable_measurement() = event;
+                out.record.mutable_measurement()->set_track_id(out.track_id);
+                output.push_back(std::move(out));
+            }
+            
+            for (const auto& alert : track.alerts) {
+                if (!owns(chunk, alert.ntp_timestamp())) {
+                    stats_.warmup_dropped++;
+                    continue;
+                }
+                Output out{alert.ntp_timestamp(), 1, source_id, mergedId(source_id, track), {}};
+                *out.record.mutable_overspeed() = alert;
+                out.record.mutable_overspeed()->set_track_id(out.track_id);
+                alerts.push_back(std::move(out));
+            }
+            
+            // A path is written once, by the last piece of a stitched vehicle
+            if (track.path.empty() || track.next) {
+                continue;
+            }
+            std::vector<const Track*> chain = {&track};
+            while (chain.back()->previous) {
+                chain.push_back(chain.back()->previous);
+            }
+            std::reverse(chain.begin(), chain.end());
+            
+            if (chain.size() == 1) {
+                // Alone: only if some of it lies in this chunk's own range
+                int own_stop_frame = chunk.own_stop_ns == INT64_MAX ? INT_MAX
+                    : static_cast<int>(std::ceil((chunk.own_stop_ns - config_.media_epoch_ns) / 1e9 *
+                                                 config_.video_fps - 1e-6));
+                if (track.path.back().frame < chunk.own_start_frame ||
+                    track.path.front().frame >= own_stop_frame) {
+                    stats_.warmup_dropped++;
+                    continue;
+                }
+            }
+            
+            // Each piece up to the next one's boundary, joined at the later
+            // piece's position on the boundary frame
+            std::vector<speedflow::TrajectoryVertex> vertices;
+            float max_error_m = 0.0f;
+            uint32_t num_points = 0;  // Overlap frames are counted in both pieces
+            for (size_t j = 0; j < chain.size(); j++) {
+                const Track* piece = chain[j];
+                int lo = j == 0 ? INT_MIN : piece->boundary;
+                int hi = j + 1 == chain.size() ? INT_MAX : chain[j + 1]->boundary;
+                if (j > 0 && piece->path.front().frame < lo) {
+                    size_t cursor = 0;
+                    float x, y;
+                    positionAt(piece->path, cursor, lo, x, y);
+                    vertices.push_back({x, y, lo});
+                }
+                for (const auto& vertex : piece->path) {
+                    if (vertex.frame >= lo && vertex.frame < hi &&
+                        (vertices.empty() || vertex.frame > vertices.back().frame)) {
+                        vertices.push_back(vertex);
+                    }
+                }
+                max_error_m = std::max(max_error_m, piece->max_error_m);
+                num_points += piece->num_points;
+            }
+            
+            Output out{track.emitted_ntp, 2, source_id, mergedId(source_id, track), {}};
+            speedflow::TrackTrajectory* trajectory = out.record.mutable_trajectory();
+            trajectory->set_source_id(source_id);
+            trajectory->set_track_id(out.track_id);
+            trajectory->set_ntp_timestamp(track.emitted_ntp);
+            trajectory->set_video_fps(config_.video_fps);
+            trajectory->set_max_error_m(max_error_m);
+            trajectory->set_num_points(num_points);
+            trajectory->set_num_vertices(static_cast<uint32_t>(vertices.size()));
+            speedflow::encodeTrajectory(vertices, *trajectory->mutable_vertices());
+            trajectory->set_complete(true);
+            output.push_back(std::move(out));
+        }
+    }
+    
+    // One alert per vehicle: a stitched vehicle may alert again after the boundary
+    std::stable_sort(alerts.begin(), alerts.end(),
+                     [](const Output& x, const Output& y) { return x.ntp_timestamp < y.ntp_timestamp; });
+    std::map<std::pair<int, int>, bool> alerted;
+    for (Output& alert : alerts) {
+        bool& seen = alerted[{alert.source_id, alert.track_id}];
+        if (seen) {
+            stats_.duplicate_alerts++;
+            continue;
+        }
+        seen = true;
+        output.push_back(std::move(alert));
+    }
+    
+    std::stable_sort(output.begin(), output.end(), [](const Output& x, const Output& y) {
+        if (x.ntp_timestamp != y.ntp_timestamp) return x.ntp_timestamp < y.ntp_timestamp;
+        if (x.order != y.order) return x.order < y.order;
+        if (x.source_id != y.source_id) return x.source_id < y.source_id;
+        return x.track_id < y.track_id;
+    });
+    
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "[ChunkMerger] Cannot write " << path << std::endl;
+        return false;
+    }
+    for (const Output& out : output) {
+        if (!google::protobuf::util::SerializeDelimitedToOstream(out.record, &file)) {
+            std::cerr << "[ChunkMerger] Write failed: " << path << std::endl;
+            return false;
+        }
+        switch (out.order) {
+            case 0: stats_.measurements++; break;
+            case 1: stats_.alerts++; break;
+            default: stats_.trajectories++; break;
+        }
+    }
+    file.flush();
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,116 @@
+#ifndef CHUNK_MERGER_H
+#define CHUNK_MERGER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "speedflow.pb.h"
+#include "../plugins/trajectory.h"
+
+/**
+ * Configuration for merging the event logs of recording chunks
+ */
+struct ChunkMergeConfig {
+    float video_fps = 25.0f;            // Frame rate the chunks numbered frames with
+    int64_t media_epoch_ns = 0;         // Timestamp of the recording start (speedflow --media-epoch)
+    float stitch_max_distance_m = 1.5f; // Mean distance of two paths of the same vehicle
+    int stitch_min_frames = 5;          // Frames both paths must cover
+    int stitch_max_gap_frames = 12;     // Track of the earlier chunk may end this early
+};
+
+/**
+ * One chunk: the part of the recording it owns and where its log is
+ */
+struct ChunkLog {
+    double own_start_s = 0.0;   // Results before this are its warm-up, owned by the previous chunk
+    double own_stop_s = 0.0;    // 0 = end of the recording
+    std::string dir;            // Event log directory of the chunk's speedflow run
+};
+
+/**
+ * Counts of one merge
+ */
+struct ChunkMergeStats {
+    uint64_t measurements = 0;
+    uint64_t alerts = 0;
+    uint64_t trajectories = 0;
+    uint64_t stitched = 0;              // Tracks continued from the previous chunk
+    uint64_t warmup_dropped = 0;        // Results of a chunk outside its own range
+    uint64_t duplicate_alerts = 0;      // Second alert of a stitched vehicle
+};
+
+/**
+ * ChunkMerger - Joins the event logs of chunks of one recording into one log
+ *
+ * Every chunk runs over its own range plus a warm-up before it (the overlap
+ * with the previous chunk), on the recording's time line (media clock), so
+ * a frame has the same number and timestamp in both chunks that see it.
+ * Results are kept only from the chunk that owns their time.
+ *
+ * A vehicle that crosses a boundary is one track in each chunk. Both
+ * chunks see it during the warm-up, so the earlier chunk's track that
+ * reaches the boundary is matched to the later chunk's track that started
+ * before it: the pair with the smallest mean world-space distance over their
+ * common frames, within stitch_max_distance_m, one partner each. Stitched
+ * tracks share one id, keep their first alert only and get one trajectory.
+ *
+ * Track ids are renumbered per source in order of first appearance, since
+ * every chunk's tracker counts from its own start. The output is ordered by
+ * timestamp, then measurement, alert, trajectory.
+ */
+class ChunkMerger {
+public:
+    explicit ChunkMerger(const ChunkMergeConfig& config);
+    
+    /**
+     * Read a chunk's log; chunks must be added in recording order
+     * @return false if the directory has no readable event log
+     */
+    bool addChunk(const ChunkLog& chunk);
+    
+    /**
+     * Stitch, order and write the merged log (length-delimited EventLogRecord)
+     * @param path Output file, replaced
+     */
+    bool write(const std::string& path);
+    
+    const ChunkMergeStats& stats() const { return stats_; }
+
+private:
+    // All records of one track in one chunk
+    struct Track {
+        std::vector<speedflow::SpeedEvent> measurements;
+        std::vector<speedflow::OverspeedAlert> alerts;
+        std::vector<speedflow::TrajectoryVertex> path;  // Continuation records joined
+        float max_error_m = 0.0f;
+        uint32_t num_points = 0;
+        int64_t emitted_ntp = 0;            // Last trajectory record
+        int boundary = 0;                   // First frame its chunk owns
+        int merged_id = -1;                 // Set on the first piece of a vehicle
+        Track* previous = nullptr;          // Stitched: the same vehicle in the previous chunk
+        Track* next = nullptr;              // ... and in the next chunk
+    };
+    
+    // (source, track) -> track, per chunk
+    using TrackKey = std::pair<int, int>;
+    struct Chunk {
+        int64_t own_start_ns;
+        int64_t own_stop_ns;                // INT64_MAX = end
+        int own_start_frame;
+        std::map<TrackKey, Track> tracks;
+    };
+    
+    bool readLog(const std::string& path, Chunk& chunk);
+    bool owns(const Chunk& chunk, int64_t ntp_timestamp) const;
+    void stitch(Chunk& earlier, Chunk& later);
+    double meanDistance(const std::vector<speedflow::TrajectoryVertex>& a,
+                        const std::vector<speedflow::TrajectoryVertex>& b, int& common) const;
+    
+    ChunkMergeConfig config_;
+    std::vector<Chunk> chunks_;
+    ChunkMergeStats stats_;
+};
+
+#endif // CHUNK_MERGER_H
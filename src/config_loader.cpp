@@ -3,6 +3,8 @@
 #include <fstream>
 #include <stdexcept>
 #include <iostream>
+#include <filesystem>
+#include <algorithm>
 
 PipelineConfig ConfigLoader::loadPipelineConfig(const std::string& yaml_path) {
     PipelineConfig config;
@@ -17,12 +19,33 @@ PipelineConfig ConfigLoader::loadPipelineConfig(const std::string& yaml_path) {
         if (root["tracker_config"]) {
             config.tracker_config_path = root["tracker_config"].as<std::string>();
         }
+        if (root["tracker_type"]) {
+            config.tracker_type = root["tracker_type"].as<std::string>();
+            if (config.tracker_type != "nvdcf" && config.tracker_type != "iou") {
+                throw std::runtime_error("Invalid tracker_type: " + config.tracker_type);
+            }
+        }
+        if (root["iou_tracker_matching"]) {
+            config.iou_tracker_matching = root["iou_tracker_matching"].as<std::string>();
+            if (config.iou_tracker_matching != "greedy" && config.iou_tracker_matching != "hungarian") {
+                throw std::runtime_error("Invalid iou_tracker_matching: " + config.iou_tracker_matching);
+            }
+        }
+        if (root["iou_tracker_min_iou"]) {
+            config.iou_tracker_min_iou = root["iou_tracker_min_iou"].as<float>();
+        }
+        if (root["iou_tracker_max_age_frames"]) {
+            config.iou_tracker_max_age_frames = root["iou_tracker_max_age_frames"].as<int>();
+        }
         if (root["analytics_config"]) {
             config.analytics_config_path = root["analytics_config"].as<std::string>();
         }
         if (root["homography_config"]) {
             config.homography_config_path = root["homography_config"].as<std::string>();
         }
+        if (root["calibration_dir"]) {
+            config.calibration_dir = root["calibration_dir"].as<std::string>();
+        }
         
         // Muxer settings
         if (root["muxer_width"]) {
@@ -63,6 +86,276 @@ PipelineConfig ConfigLoader::loadPipelineConfig(const std::string& yaml_path) {
             config.median_window = root["median_window"].as<int>();
         }
         
+        // Alerts
+        if (root["alert_confirm_frames"]) {
+            config.alert_confirm_frames = root["alert_confirm_frames"].as<int>();
+        }
+        if (root["alert_rate_per_s"]) {
+            config.alert_rate_per_s = root["alert_rate_per_s"].as<float>();
+        }
+        if (root["alert_burst"]) {
+            config.alert_burst = root["alert_burst"].as<int>();
+        }
+        if (root["track_lost_frames"]) {
+            config.track_lost_frames = root["track_lost_frames"].as<int>();
+        }
+        
+        // Profile / load testing
+        if (root["profile"]) {
+            config.profile = root["profile"].as<std::string>();
+        }
+        if (root["sim_density"]) {
+            config.sim_density = root["sim_density"].as<int>();
+        }
+        if (root["sim_seed"]) {
+            config.sim_seed = root["sim_seed"].as<unsigned int>();
+        }
+        if (root["perf_interval_s"]) {
+            config.perf_interval_s = root["perf_interval_s"].as<float>();
+        }
+        if (root["trace_output"]) {
+            config.trace_output = root["trace_output"].as<std::string>();
+        }
+        
+        // Headless / result publishing
+        if (root["headless"]) {
+            config.headless = root["headless"].as<bool>();
+        }
+        if (root["results_output"]) {
+            config.results_output = root["results_output"].as<std::string>();
+        }
+        if (root["node_id"]) {
+            config.node_id = root["node_id"].as<std::string>();
+        }
+        if (root["shm_ring_name"]) {
+            config.shm_ring_name = root["shm_ring_name"].as<std::string>();
+        }
+        if (root["shm_ring_slots"]) {
+            config.shm_ring_slots = root["shm_ring_slots"].as<int>();
+        }
+        
+        // Event log
+        if (root["event_log_dir"]) {
+            config.event_log_dir = root["event_log_dir"].as<std::string>();
+        }
+        if (root["event_log_fsync_ms"]) {
+            config.event_log_fsync_ms = root["event_log_fsync_ms"].as<int>();
+        }
+        if (root["event_log_max_file_mb"]) {
+            config.event_log_max_file_mb = root["event_log_max_file_mb"].as<int>();
+        }
+        if (root["event_log_rotate_s"]) {
+            config.event_log_rotate_s = root["event_log_rotate_s"].as<int>();
+        }
+        if (root["trajectory_export"]) {
+            config.trajectory_export = root["trajectory_export"].as<bool>();
+        }
+        if (root["trajectory_max_error_m"]) {
+            config.trajectory_max_error_m = root["trajectory_max_error_m"].as<float>();
+        }
+        if (root["trajectory_max_vertices"]) {
+            config.trajectory_max_vertices = root["trajectory_max_vertices"].as<int>();
+        }
+        
+        // Frame numbers and timestamps from the recording's time line
+        if (root["media_clock"]) {
+            config.media_clock = root["media_clock"].as<bool>();
+        }
+        
+        // Track state checkpoints
+        if (root["checkpoint_path"]) {
+            config.checkpoint_path = root["checkpoint_path"].as<std::string>();
+        }
+        if (root["checkpoint_interval_s"]) {
+            config.checkpoint_interval_s = root["checkpoint_interval_s"].as<float>();
+        }
+        
+        // Overspeed evidence clips
+        if (root["evidence_dir"]) {
+            config.evidence_dir = root["evidence_dir"].as<std::string>();
+        }
+        if (root["evidence_codec"]) {
+            config.evidence_codec = root["evidence_codec"].as<std::string>();
+            if (config.evidence_codec != "h264" && config.evidence_codec != "mjpeg") {
+                throw std::runtime_error("Invalid evidence_codec: " + config.evidence_codec);
+            }
+        }
+        if (root["evidence_preroll_s"]) {
+            config.evidence_preroll_s = root["evidence_preroll_s"].as<float>();
+        }
+        if (root["evidence_postroll_s"]) {
+            config.evidence_postroll_s = root["evidence_postroll_s"].as<float>();
+        }
+        if (root["evidence_ring_mb"]) {
+            config.evidence_ring_mb = root["evidence_ring_mb"].as<int>();
+        }
+        if (root["evidence_bitrate_kbps"]) {
+            config.evidence_bitrate_kbps = root["evidence_bitrate_kbps"].as<int>();
+        }
+        if (root["evidence_keyframe_s"]) {
+            config.evidence_keyframe_s = root["evidence_keyframe_s"].as<float>();
+        }
+        
+        // Speed estimator
+        if (root["speed_estimator"]) {
+            config.speed_estimator = root["speed_estimator"].as<std::string>();
+            if (config.speed_estimator != "window" && config.speed_estimator != "section") {
+                throw std::runtime_error("Invalid speed_estimator: " + config.speed_estimator);
+            }
+        }
+        auto load_line = [&](const char* key, std::vector<cv::Point2f>& line) {
+            if (!root[key]) {
+                return;
+            }
+            for (const auto& point : root[key]) {
+                line.push_back(cv::Point2f(point[0].as<float>(), point[1].as<float>()));
+            }
+            if (line.size() != 2) {
+                throw std::runtime_error(std::string(key) + " needs exactly 2 points");
+            }
+        };
+        load_line("section_line_a", config.section_line_a);
+        load_line("section_line_b", config.section_line_b);
+        if (root["section_distance_m"]) {
+            config.section_distance_m = root["section_distance_m"].as<float>();
+        }
+        
+        // Measurement prefilter
+        if (root["measurement_zone"]) {
+            config.measurement_zone = root["measurement_zone"].as<bool>();
+        }
+        if (root["measurement_zone_margin_px"]) {
+            config.measurement_zone_margin_px = root["measurement_zone_margin_px"].as<float>();
+        }
+        if (root["measured_classes"]) {
+            config.measured_classes = root["measured_classes"].as<std::vector<int>>();
+        }
+        
+        // Per-buffer budget
+        if (root["speedcalc_budget_ms"]) {
+            config.speedcalc_budget_ms = root["speedcalc_budget_ms"].as<float>();
+        }
+        if (root["max_deferred_frames"]) {
+            config.max_deferred_frames = root["max_deferred_frames"].as<int>();
+        }
+        
+        // Track re-association
+        if (root["track_reassociation"]) {
+            config.track_reassociation = root["track_reassociation"].as<bool>();
+        }
+        if (root["reassoc_max_gap_frames"]) {
+            config.reassoc_max_gap_frames = root["reassoc_max_gap_frames"].as<int>();
+        }
+        if (root["reassoc_max_distance_m"]) {
+            config.reassoc_max_distance_m = root["reassoc_max_distance_m"].as<float>();
+        }
+        if (root["reassoc_max_speed_diff_kmh"]) {
+            config.reassoc_max_speed_diff_kmh = root["reassoc_max_speed_diff_kmh"].as<float>();
+        }
+        
+        // Source reconnection
+        if (root["source_reconnect"]) {
+            config.source_reconnect = root["source_reconnect"].as<bool>();
+        }
+        if (root["source_reconnect_min_ms"]) {
+            config.source_reconnect_min_ms = root["source_reconnect_min_ms"].as<int>();
+        }
+        if (root["source_reconnect_max_ms"]) {
+            config.source_reconnect_max_ms = root["source_reconnect_max_ms"].as<int>();
+        }
+        if (root["source_stall_timeout_s"]) {
+            config.source_stall_timeout_s = root["source_stall_timeout_s"].as<float>();
+        }
+        
+        // Stage queues
+        if (root["stage_queues"]) {
+            for (const auto& node : root["stage_queues"]) {
+                StageQueueConfig queue;
+                queue.after = node["after"].as<std::string>();
+                if (node["max_size_buffers"]) {
+                    queue.max_size_buffers = node["max_size_buffers"].as<int>();
+                }
+                if (node["leaky"]) {
+                    queue.leaky = node["leaky"].as<std::string>();
+                }
+                if (node["thread_name"]) {
+                    queue.thread_name = node["thread_name"].as<std::string>();
+                }
+                if (node["cpu_affinity"]) {
+                    queue.cpu_affinity = node["cpu_affinity"].as<std::vector<int>>();
+                }
+                if (node["sched_fifo_priority"]) {
+                    queue.sched_fifo_priority = node["sched_fifo_priority"].as<int>();
+                }
+                if (node["nice"]) {
+                    queue.nice = node["nice"].as<int>();
+                }
+                
+                if (queue.leaky != "none" && queue.leaky != "upstream" &&
+                    queue.leaky != "downstream") {
+                    throw std::runtime_error("Invalid stage_queues leaky mode: " + queue.leaky);
+                }
+                config.stage_queues.push_back(queue);
+            }
+        }
+        
+        // REST API
+        if (root["api_enabled"]) {
+            config.api_enabled = root["api_enabled"].as<bool>();
+        }
+        if (root["api_port"]) {
+            config.api_port = root["api_port"].as<int>();
+        }
+        if (root["api_threads"]) {
+            config.api_threads = root["api_threads"].as<int>();
+        }
+        if (root["api_max_sources"]) {
+            config.api_max_sources = root["api_max_sources"].as<int>();
+        }
+        if (root["api_source_control"]) {
+            config.api_source_control = root["api_source_control"].as<bool>();
+        }
+        if (root["api_preview_viewers"]) {
+            config.api_preview_viewers = root["api_preview_viewers"].as<bool>();
+        }
+        
+        // Preview branch
+        if (root["preview_enabled"]) {
+            config.preview_enabled = root["preview_enabled"].as<bool>();
+        }
+        if (root["preview_port"]) {
+            config.preview_port = root["preview_port"].as<int>();
+        }
+        if (root["preview_fps"]) {
+            config.preview_fps = root["preview_fps"].as<int>();
+        }
+        if (root["preview_width"]) {
+            config.preview_width = root["preview_width"].as<int>();
+        }
+        if (root["preview_height"]) {
+            config.preview_height = root["preview_height"].as<int>();
+        }
+        if (root["preview_mode"]) {
+            config.preview_mode = root["preview_mode"].as<std::string>();
+            if (config.preview_mode != "mjpeg" && config.preview_mode != "rtp") {
+                throw std::runtime_error("Invalid preview_mode: " + config.preview_mode);
+            }
+        }
+        if (root["preview_bitrate_kbps"]) {
+            config.preview_bitrate_kbps = root["preview_bitrate_kbps"].as<int>();
+        }
+        if (root["preview_keyframe_s"]) {
+            config.preview_keyframe_s = root["preview_keyframe_s"].as<float>();
+        }
+        if (root["preview_viewer_lease_s"]) {
+            config.preview_viewer_lease_s = root["preview_viewer_lease_s"].as<int>();
+        }
+        if (root["preview_rtp_clients"]) {
+            for (const auto& node : root["preview_rtp_clients"]) {
+                config.preview_rtp_clients.push_back(node.as<std::string>());
+            }
+        }
+        
         std::cout << "[ConfigLoader] Loaded pipeline config: " 
                   << config.muxer_width << "x" << config.muxer_height 
                   << " @ " << config.video_fps << " FPS" << std::endl;
@@ -110,10 +403,16 @@ HomographyConfig ConfigLoader::loadHomographyConfig(const std::string& yaml_path
             config.target_height = root["TARGET_HEIGHT"].as<float>();
         }
         
-        // Detect original config resolution from analytics config
-        // For now, assume 1280x720 as default (can be read from analytics config)
+        // Resolution the points were picked at (defaults to 1280x720 for
+        // calibration files written before these keys existed)
         config.config_width = 1280;
         config.config_height = 720;
+        if (root["CONFIG_WIDTH"]) {
+            config.config_width = root["CONFIG_WIDTH"].as<int>();
+        }
+        if (root["CONFIG_HEIGHT"]) {
+            config.config_height = root["CONFIG_HEIGHT"].as<int>();
+        }
         
         // CRITICAL: Scale homography points to match muxer resolution
         scaleHomographyPoints(config, muxer_width, muxer_height);
@@ -129,6 +428,111 @@ HomographyConfig ConfigLoader::loadHomographyConfig(const std::string& yaml_path
     return config;
 }
 
+std::shared_ptr<speedflow::CalibrationRegistry> ConfigLoader::loadCalibrationDirectory(
+    const std::string& dir_path) {
+    namespace fs = std::filesystem;
+    
+    if (!fs::is_directory(dir_path)) {
+        throw std::runtime_error("Calibration directory not found: " + dir_path);
+    }
+    
+    // Sort for a deterministic load order (and error messages)
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(dir_path)) {
+        auto ext = entry.path().extension();
+        if (entry.is_regular_file() && (ext == ".yml" || ext == ".yaml")) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    
+    auto registry = std::make_shared<speedflow::CalibrationRegistry>();
+    
+    for (const auto& file : files) {
+        registry->add(loadCameraCalibration(file.string()));
+    }
+    
+    std::cout << "[ConfigLoader] Loaded " << registry->size()
+              << " camera calibrations from " << dir_path << std::endl;
+    
+    return registry;
+}
+
+speedflow::CameraCalibration ConfigLoader::loadCameraCalibration(const std::string& path) {
+    speedflow::CameraCalibration calib;
+    calib.path = path;
+    
+    try {
+        YAML::Node root = YAML::LoadFile(path);
+        
+        if (root["SOURCE_ID"]) {
+            calib.source_id = root["SOURCE_ID"].as<int>();
+        } else {
+            std::string stem = std::filesystem::path(path).stem().string();
+            size_t pos = stem.find_last_not_of("0123456789");
+            std::string digits = stem.substr(pos == std::string::npos ? 0 : pos + 1);
+            if (digits.empty()) {
+                throw std::runtime_error("no SOURCE_ID and no camera number in file name");
+            }
+            calib.source_id = std::stoi(digits);
+        }
+        
+        for (const auto& point : root["SOURCE"]) {
+            calib.source_points.emplace_back(point[0].as<float>(), point[1].as<float>());
+        }
+        for (const auto& point : root["TARGET"]) {
+            calib.target_points.emplace_back(point[0].as<float>(), point[1].as<float>());
+        }
+        
+        if (root["CONFIG_WIDTH"]) {
+            calib.config_width = root["CONFIG_WIDTH"].as<int>();
+        }
+        if (root["CONFIG_HEIGHT"]) {
+            calib.config_height = root["CONFIG_HEIGHT"].as<int>();
+        }
+        
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to load calibration " + path + ": " + e.what());
+    }
+    return calib;
+}
+
+speedflow::SpeedConfig ConfigLoader::speedConfig(const PipelineConfig& config) {
+    speedflow::SpeedConfig speed_config;
+    speed_config.video_fps = config.video_fps;
+    speed_config.speed_limit_kmh = config.speed_limit_kmh;
+    speed_config.min_track_age_frames = config.min_track_age_frames;
+    speed_config.min_world_displ_m = config.min_world_displ_m;
+    speed_config.max_abs_kmh = config.max_abs_kmh;
+    speed_config.bbox_area_jump = config.bbox_area_jump;
+    speed_config.min_det_conf = config.min_det_conf;
+    speed_config.median_window = config.median_window;
+    speed_config.alert_confirm_frames = config.alert_confirm_frames;
+    speed_config.alert_rate_per_s = config.alert_rate_per_s;
+    speed_config.alert_burst = config.alert_burst;
+    speed_config.track_lost_frames = config.track_lost_frames;
+    if (config.speed_estimator == "section") {
+        speed_config.estimator = speedflow::SpeedEstimator::SectionLine;
+        if (config.section_line_a.size() == 2) {
+            std::copy_n(config.section_line_a.begin(), 2, speed_config.section_line_a);
+        }
+        if (config.section_line_b.size() == 2) {
+            std::copy_n(config.section_line_b.begin(), 2, speed_config.section_line_b);
+        }
+        speed_config.section_distance_m = config.section_distance_m;
+    }
+    
+    speed_config.zone_filter = config.measurement_zone;
+    speed_config.zone_margin_px = config.measurement_zone_margin_px;
+    speed_config.class_allowlist = config.measured_classes;
+    speed_config.max_deferred_frames = config.max_deferred_frames;
+    speed_config.reassociation = config.track_reassociation;
+    speed_config.reassoc_max_gap_frames = config.reassoc_max_gap_frames;
+    speed_config.reassoc_max_distance_m = config.reassoc_max_distance_m;
+    speed_config.reassoc_max_speed_diff_kmh = config.reassoc_max_speed_diff_kmh;
+    return speed_config;
+}
+
 void ConfigLoader::scaleHomographyPoints(HomographyConfig& config,
                                           int muxer_width,
                                           int muxer_height) {
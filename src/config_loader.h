@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <opencv2/core.hpp>
+#include "../plugins/calibration_registry.h"
+#include "../plugins/speed_calculator.h"
 
 struct HomographyConfig {
     std::vector<cv::Point2f> source_points;
@@ -14,11 +16,35 @@ struct HomographyConfig {
     int config_height;
 };
 
+/**
+ * A queue inserted after a pipeline stage. Everything downstream of it runs
+ * on the queue's own streaming thread, which can be named, pinned and
+ * prioritized.
+ */
+struct StageQueueConfig {
+    std::string after;              // muxer | pgie | tracker | analytics | speedcalc
+    int max_size_buffers = 4;
+    std::string leaky = "none";     // none | upstream | downstream
+    
+    // Streaming thread settings (applied when the thread starts)
+    std::string thread_name;        // Max 15 characters
+    std::vector<int> cpu_affinity;  // Empty = any CPU
+    int sched_fifo_priority = 0;    // 1-99 selects SCHED_FIFO (needs CAP_SYS_NICE)
+    int nice = 0;                   // Used when not SCHED_FIFO
+};
+
 struct PipelineConfig {
     std::string infer_config_path;
     std::string tracker_config_path;
+    
+    // Tracker: "nvdcf" (nvtracker with tracker_config) or "iou" (CPU ioutracker)
+    std::string tracker_type = "nvdcf";
+    std::string iou_tracker_matching = "greedy";    // greedy | hungarian
+    float iou_tracker_min_iou = 0.3f;
+    int iou_tracker_max_age_frames = 30;
     std::string analytics_config_path;
     std::string homography_config_path;
+    std::string calibration_dir;    // Optional: one calibration file per camera
     
     int muxer_width = 1280;
     int muxer_height = 720;
@@ -34,6 +60,110 @@ struct PipelineConfig {
     float bbox_area_jump = 2.5f;
     float min_det_conf = 0.45f;
     int median_window = 5;
+    
+    // Overspeed alerts (one per vehicle, see SpeedCalculator)
+    int alert_confirm_frames = 3;
+    float alert_rate_per_s = 2.0f;
+    int alert_burst = 10;
+    int track_lost_frames = 50;
+    
+    // Speed estimator: "window" (default) or "section" (two world-space lines)
+    std::string speed_estimator = "window";
+    std::vector<cv::Point2f> section_line_a;    // 2 points, meters
+    std::vector<cv::Point2f> section_line_b;
+    float section_distance_m = 0.0f;            // 0 = derived from the lines
+    
+    // Prefilter before any per-track work
+    bool measurement_zone = true;   // Skip objects outside the calibration quadrilateral
+    float measurement_zone_margin_px = 0.0f;
+    std::vector<int> measured_classes;  // Detector class ids, empty = all
+    
+    // Per-buffer time budget of speedcalc, degrading in stages (0 = off)
+    float speedcalc_budget_ms = 0.0f;
+    int max_deferred_frames = 2;    // Frames in a row a track may be deferred
+    
+    // New tracker ids continuing recently lost tracks (see SpeedCalculator::endFrame)
+    bool track_reassociation = true;
+    int reassoc_max_gap_frames = 12;
+    float reassoc_max_distance_m = 3.0f;
+    float reassoc_max_speed_diff_kmh = 30.0f;
+    
+    // Pipeline profile: "deepstream" (default) or "cpu-sim" (no GPU elements)
+    std::string profile = "deepstream";
+    int sim_density = 8;            // cpu-sim: vehicle slots per frame
+    unsigned int sim_seed = 1;      // cpu-sim: trajectory seed
+    
+    float perf_interval_s = 5.0f;   // FPS/latency report interval (0 = off)
+    std::string trace_output;       // Chrome trace-event JSON of per-frame timing (empty = off)
+    
+    // Offline window of a recording (speedflow --start/--stop, used by speedflow_batch)
+    double source_start_s = 0.0;    // Seek to the keyframe at or before this time first
+    double source_stop_s = 0.0;     // End of stream here (0 = end of file)
+    bool media_clock = false;       // Frame numbers and timestamps from the recording's PTS
+    int64_t media_epoch_ns = 0;     // Timestamp of PTS 0 with media_clock
+    
+    // Headless: no OSD/preview, pipeline ends in a fakesink after speedcalc
+    bool headless = false;
+    std::string results_output;     // FrameData stream: file:///..., unix:///... or tcp://aggregator:port
+    std::string node_id;            // Name of this device on tcp:// streams (empty = host name)
+    
+    // Shared-memory result ring for co-located consumers (empty = off)
+    std::string shm_ring_name;      // e.g. "/speedflow_results"
+    int shm_ring_slots = 256;
+    
+    // Append-only event log of measurements and overspeed alerts (empty = off)
+    std::string event_log_dir;
+    int event_log_fsync_ms = 1000;  // Group commit interval
+    int event_log_max_file_mb = 64;
+    int event_log_rotate_s = 3600;  // 0 = rotate by size only
+    
+    // Simplified per-track world paths, written to the event log
+    bool trajectory_export = false;
+    float trajectory_max_error_m = 0.25f;
+    int trajectory_max_vertices = 256;
+    
+    // Track state checkpoints for warm restarts (empty = off)
+    std::string checkpoint_path;
+    float checkpoint_interval_s = 1.0f;
+    
+    // Overspeed evidence clips from an in-memory encoded pre-roll (empty = off)
+    std::string evidence_dir;
+    std::string evidence_codec = "h264";    // "h264" (x264enc) or "mjpeg" (jpegenc)
+    float evidence_preroll_s = 5.0f;
+    float evidence_postroll_s = 3.0f;
+    int evidence_ring_mb = 16;              // Pre-roll memory per source
+    int evidence_bitrate_kbps = 2000;
+    float evidence_keyframe_s = 1.0f;       // Keyframe interval, the pre-roll granularity
+    
+    // Source reconnection (non-file URIs): only the failing source bin is
+    // rebuilt, the inference engine and tracker state stay warm
+    bool source_reconnect = true;
+    int source_reconnect_min_ms = 500;      // First retry delay, doubled per failure
+    int source_reconnect_max_ms = 30000;
+    float source_stall_timeout_s = 10.0f;   // No buffers for this long = failed (0 = off)
+    
+    // Thread boundaries between stages (none = single streaming thread)
+    std::vector<StageQueueConfig> stage_queues;
+    
+    // REST snapshot API (Oat++ async)
+    bool api_enabled = true;
+    int api_port = 8000;
+    int api_threads = 2;
+    int api_max_sources = 16;       // Sources with higher ids are not exposed
+    bool api_source_control = false;    // POST/DELETE /api/sources attach and detach streams
+    bool api_preview_viewers = false;   // POST/DELETE /api/preview/viewers (rtp preview)
+    
+    // Preview branch (encoded only while a client is connected)
+    bool preview_enabled = true;
+    std::string preview_mode = "mjpeg"; // "mjpeg" (HTTP multipart) or "rtp" (H.264 over UDP)
+    int preview_port = 8080;        // mjpeg: HTTP port
+    int preview_fps = 10;           // Decimated frame rate (0 = every frame)
+    int preview_width = 640;        // 0 = muxer resolution
+    int preview_height = 360;
+    int preview_bitrate_kbps = 1000;        // rtp
+    float preview_keyframe_s = 1.0f;        // rtp: worst-case wait of a joining viewer
+    int preview_viewer_lease_s = 30;        // rtp: API viewers expire unless renewed
+    std::vector<std::string> preview_rtp_clients;  // rtp: fixed "host:port" receivers
 };
 
 class ConfigLoader {
@@ -42,6 +172,27 @@ public:
     static HomographyConfig loadHomographyConfig(const std::string& yaml_path, 
                                                   int muxer_width, 
                                                   int muxer_height);
+    
+    /**
+     * Load every *.yml / *.yaml calibration file in a directory
+     * The camera is identified by SOURCE_ID in the file, or else by the
+     * trailing number of the file name (e.g. camera_3.yml -> source 3).
+     * Points are left at their original CONFIG_WIDTH x CONFIG_HEIGHT.
+     */
+    static std::shared_ptr<speedflow::CalibrationRegistry> loadCalibrationDirectory(
+        const std::string& dir_path);
+    
+    /**
+     * Load a single camera calibration file (same format as the directory)
+     * @throws std::runtime_error if the file cannot be read or parsed
+     */
+    static speedflow::CameraCalibration loadCameraCalibration(const std::string& path);
+    
+    /**
+     * Speed calculation settings of a pipeline config
+     * Trajectory export is left off; it depends on where results go.
+     */
+    static speedflow::SpeedConfig speedConfig(const PipelineConfig& config);
 private:
     static void scaleHomographyPoints(HomographyConfig& config, 
                                        int muxer_width, 
@@ -0,0 +1,76 @@
+#include "delimited_stream.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/message.h>
+#include <cerrno>
+#include <sys/socket.h>
+
+// Bytes read from one connection before the loop moves on to the others
+static constexpr size_t kReadBudget = 256 * 1024;
+static constexpr size_t kReadChunk = 64 * 1024;
+
+void appendDelimited(const google::protobuf::Message& msg, std::string& buffer) {
+    uint32_t size = static_cast<uint32_t>(msg.ByteSizeLong());
+    uint8_t prefix[5];
+    uint8_t* end = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(size, prefix);
+    buffer.append(reinterpret_cast<const char*>(prefix), end - prefix);
+    msg.AppendToString(&buffer);
+}
+
+bool DelimitedReader::fill(int fd) {
+    // Drop consumed bytes once they dominate the buffer
+    if (parsed_ > 0 && parsed_ * 2 >= buffer_.size()) {
+        buffer_.erase(0, parsed_);
+        parsed_ = 0;
+    }
+    
+    size_t total = 0;
+    while (total < kReadBudget) {
+        size_t old_size = buffer_.size();
+        buffer_.resize(old_size + kReadChunk);
+        ssize_t n = recv(fd, &buffer_[old_size], kReadChunk, 0);
+        buffer_.resize(old_size + (n > 0 ? static_cast<size_t>(n) : 0));
+        if (n > 0) {
+            total += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    return true;
+}
+
+DelimitedReader::Status DelimitedReader::next(size_t max_bytes, const uint8_t*& data, uint32_t& size) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(buffer_.data());
+    const size_t available = buffer_.size();
+    
+    // varint32 length prefix
+    uint32_t length = 0;
+    size_t pos = parsed_;
+    int shift = 0;
+    bool complete = false;
+    while (pos < available && shift < 35) {
+        uint8_t byte = bytes[pos++];
+        length |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+            complete = true;
+            break;
+        }
+    }
+    if (!complete) {
+        return shift >= 35 ? Status::Corrupt : Status::Incomplete;
+    }
+    size = length;
+    if (length > max_bytes) {
+        return Status::TooLarge;
+    }
+    if (available - pos < length) {
+        return Status::Incomplete;
+    }
+    
+    data = bytes + pos;
+    parsed_ = pos + length;
+    return Status::Ok;
+}
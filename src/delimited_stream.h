@@ -0,0 +1,61 @@
+#ifndef DELIMITED_STREAM_H
+#define DELIMITED_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace google {
+namespace protobuf {
+class Message;
+}
+}
+
+/**
+ * Append a varint32 length prefix and the message (the framing of
+ * protobuf's writeDelimitedTo), without a temporary string
+ * @param msg Message to append
+ * @param buffer Output buffer, appended to
+ */
+void appendDelimited(const google::protobuf::Message& msg, std::string& buffer);
+
+/**
+ * DelimitedReader - Length-delimited messages from a non-blocking socket
+ *
+ * fill() reads what the socket has, up to a budget so one busy peer cannot
+ * starve the others of an epoll loop; next() then hands out every complete
+ * message in place. Consumed bytes are dropped by the next fill() once they
+ * make up half the buffer, so the buffer is not shifted per message.
+ *
+ * Not thread-safe: one per connection, used by its worker.
+ */
+class DelimitedReader {
+public:
+    enum class Status {
+        Ok,
+        Incomplete,     // Wait for more bytes
+        Corrupt,        // Length prefix longer than a varint32
+        TooLarge        // Length above the limit (size holds it)
+    };
+    
+    /**
+     * Read up to the budget
+     * @param fd Non-blocking socket
+     * @return false once the peer closed or the socket failed
+     */
+    bool fill(int fd);
+    
+    /**
+     * Take the next complete message
+     * @param max_bytes Largest message accepted
+     * @param data Set to the message bytes, valid until the next fill()
+     * @param size Set to the message length
+     */
+    Status next(size_t max_bytes, const uint8_t*& data, uint32_t& size);
+
+private:
+    std::string buffer_;
+    size_t parsed_ = 0;     // Bytes of buffer_ already consumed
+};
+
+#endif // DELIMITED_STREAM_H
@@ -0,0 +1,98 @@
+#include "encoded_frame_ring.h"
+#include <algorithm>
+#include <cstring>
+
+EncodedFrameRing::EncodedFrameRing(size_t capacity_bytes, size_t max_frames, int64_t keep_ns)
+    : storage_(capacity_bytes),
+      index_(std::max<size_t>(max_frames, 2)),
+      keep_ns_(keep_ns) {
+}
+
+bool EncodedFrameRing::push(const uint8_t* data, size_t size, int64_t pts_ns, bool keyframe) {
+    if (size == 0 || size > storage_.size()) {
+        return false;
+    }
+    if (count_ == 0 && !keyframe) {
+        return false;
+    }
+    
+    // Frames stay contiguous: wrap to the start if this one does not fit
+    size_t offset = write_offset_;
+    if (offset + size > storage_.size()) {
+        offset = 0;
+    }
+    
+    // Frames lie in memory in stream order, so the oldest one is the first
+    // that the new frame can run into
+    while (count_ > 0) {
+        const FrameRef& oldest = at(0);
+        bool overlaps = oldest.offset < offset + size && offset < oldest.offset + oldest.size;
+        if (!overlaps && count_ < index_.size()) {
+            break;
+        }
+        evictGop();
+    }
+    if (count_ == 0 && !keyframe) {
+        return false;  // Evicted the GOP this delta frame belonged to
+    }
+    
+    std::memcpy(storage_.data() + offset, data, size);
+    index_[(first_ + count_) % index_.size()] = {offset, size, pts_ns, keyframe};
+    count_++;
+    write_offset_ = offset + size;
+    
+    // Keep one GOP more than needed: the pre-roll must start on a keyframe
+    while (count_ > 0) {
+        size_t next_key = 1;
+        while (next_key < count_ && !at(next_key).keyframe) {
+            next_key++;
+        }
+        if (next_key == count_ || pts_ns - at(next_key).pts_ns < keep_ns_) {
+            break;
+        }
+        evictGop();
+    }
+    return true;
+}
+
+void EncodedFrameRing::evictGop() {
+    do {
+        first_ = (first_ + 1) % index_.size();
+        count_--;
+    } while (count_ > 0 && !at(0).keyframe);
+    
+    if (count_ == 0) {
+        first_ = 0;
+        write_offset_ = 0;
+    }
+}
+
+size_t EncodedFrameRing::copyTo(std::vector<EncodedFrame>& out) const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < count_; i++) {
+        const FrameRef& frame = at(i);
+        out.push_back({frame.pts_ns, frame.keyframe,
+                       std::string(reinterpret_cast<const char*>(storage_.data() + frame.offset),
+                                   frame.size)});
+        bytes += frame.size;
+    }
+    return bytes;
+}
+
+void EncodedFrameRing::clear() {
+    first_ = 0;
+    count_ = 0;
+    write_offset_ = 0;
+}
+
+size_t EncodedFrameRing::usedBytes() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < count_; i++) {
+        bytes += at(i).size;
+    }
+    return bytes;
+}
+
+int64_t EncodedFrameRing::durationNs() const {
+    return count_ > 1 ? at(count_ - 1).pts_ns - at(0).pts_ns : 0;
+}
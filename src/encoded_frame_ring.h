@@ -0,0 +1,80 @@
+#ifndef ENCODED_FRAME_RING_H
+#define ENCODED_FRAME_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * One compressed frame copied out of an EncodedFrameRing
+ */
+struct EncodedFrame {
+    int64_t pts_ns;
+    bool keyframe;
+    std::string data;
+};
+
+/**
+ * EncodedFrameRing - Last seconds of a compressed stream in fixed memory
+ *
+ * Frames are copied into a byte buffer allocated once in the constructor,
+ * each frame contiguous (the unused tail is skipped when a frame does not fit
+ * before the end). Old data is evicted one GOP at a time, so the ring always
+ * starts with a keyframe and any copy of it is decodable. Memory use is the
+ * byte capacity plus a fixed frame index, regardless of bitrate.
+ *
+ * Not thread-safe: fed and read by one thread.
+ */
+class EncodedFrameRing {
+public:
+    /**
+     * @param capacity_bytes Byte buffer size (frames larger than this are dropped)
+     * @param max_frames Frame index size
+     * @param keep_ns Older GOPs are evicted once the remaining ones still cover this
+     */
+    EncodedFrameRing(size_t capacity_bytes, size_t max_frames, int64_t keep_ns);
+    
+    /**
+     * Append a frame
+     * Delta frames are dropped until the first keyframe (they cannot be decoded).
+     * @return false if the frame was dropped
+     */
+    bool push(const uint8_t* data, size_t size, int64_t pts_ns, bool keyframe);
+    
+    /**
+     * Copy every frame, oldest (a keyframe) first
+     * @param out Receives the frames (appended)
+     * @return Bytes copied
+     */
+    size_t copyTo(std::vector<EncodedFrame>& out) const;
+    
+    void clear();
+    
+    size_t frameCount() const { return count_; }
+    size_t usedBytes() const;
+    int64_t durationNs() const;
+    size_t capacityBytes() const { return storage_.size(); }
+
+private:
+    struct FrameRef {
+        size_t offset;
+        size_t size;
+        int64_t pts_ns;
+        bool keyframe;
+    };
+    
+    const FrameRef& at(size_t i) const { return index_[(first_ + i) % index_.size()]; }
+    
+    /** Evict the oldest frame and the delta frames that depend on it */
+    void evictGop();
+    
+    std::vector<uint8_t> storage_;
+    std::vector<FrameRef> index_;
+    int64_t keep_ns_;
+    size_t first_ = 0;          // Index slot of the oldest frame
+    size_t count_ = 0;
+    size_t write_offset_ = 0;   // Where the next frame goes (before wrapping)
+};
+
+#endif // ENCODED_FRAME_RING_H
@@ -0,0 +1,427 @@
+#include "event_log_writer.h"
+#include "delimited_stream.h"
+#include "speedflow.pb.h"
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Events taken from the queue per wake-up
+static constexpr size_t kBulkEvents = 1024;
+
+// Serialized bytes accumulated before a write() while the queue is busy
+static constexpr size_t kFlushBytes = 1u << 20;
+
+static int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static size_t formatTimestamp(int64_t ntp_timestamp_ns, char* buf, size_t size) {
+    // ISO 8601 UTC with milliseconds, as OverspeedAlert.timestamp
+    time_t secs = static_cast<time_t>(ntp_timestamp_ns / 1000000000);
+    int millis = static_cast<int>((ntp_timestamp_ns / 1000000) % 1000);
+    struct tm tm_utc;
+    gmtime_r(&secs, &tm_utc);
+    size_t len = strftime(buf, size, "%Y-%m-%dT%H:%M:%S", &tm_utc);
+    int n = snprintf(buf + len, size - len, ".%03dZ", millis);
+    return len + static_cast<size_t>(std::max(n, 0));
+}
+
+EventLogWriter::EventLogWriter(const EventLogConfig& config)
+    : config_(config),
+      queue_(config.queue_capacity),
+      running_(false),
+      fd_(-1),
+      file_bytes_(0),
+      file_opened_s_(0),
+      file_seq_(0),
+      dirty_(false),
+      written_(0),
+      dropped_(0) {
+}
+
+EventLogWriter::~EventLogWriter() {
+    stop();
+    
+    // Events queued while stopped, or racing with the writer's last drain
+    Event event;
+    while (queue_.try_dequeue(event)) {
+        if (event.type == EventType::Trajectory) {
+            delete event.trajectory;
+        }
+    }
+}
+
+bool EventLogWriter::start() {
+    if (running_) {
+        return true;
+    }
+    
+    std::error_code ec;
+    fs::create_directories(config_.dir, ec);
+    if (ec) {
+        std::cerr << "[EventLogWriter] Cannot create " << config_.dir << ": "
+                  << ec.message() << std::endl;
+        return false;
+    }
+    
+    if (!recoverLatestFile() && !openNewFile()) {
+        return false;
+    }
+    
+    running_ = true;
+    thread_ = std::thread(&EventLogWriter::run, this);
+    
+    std::cout << "[EventLogWriter] Logging events to " << file_path_ << std::endl;
+    return true;
+}
+
+void EventLogWriter::stop() {
+    if (!running_) {
+        return;
+    }
+    
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    closeFile();
+    
+    std::cout << "[EventLogWriter] Stopped: " << written_.load() << " events written, "
+              << dropped_.load() << " dropped" << std::endl;
+}
+
+void EventLogWriter::onFrame(const speedflow::FrameResult& frame) {
+    for (const auto& obj : frame.objects) {
+        if (!obj.is_valid) {
+            continue;
+        }
+        
+        Event event;
+        event.type = EventType::Measurement;
+        event.source_id = frame.source_id;
+        event.frame_number = frame.frame_number;
+        event.track_id = static_cast<int32_t>(obj.track_id);
+        event.ntp_timestamp = frame.ntp_timestamp;
+        event.speed_kmh = obj.speed_kmh;
+        event.is_overspeeding = obj.is_overspeeding;
+        event.trajectory = nullptr;
+        
+        // try_enqueue never allocates: a full queue drops instead of stalling
+        if (!queue_.try_enqueue(event)) {
+            dropped_++;
+        }
+    }
+}
+
+void EventLogWriter::onAlert(const speedflow::AlertResult& alert) {
+    Event event;
+    event.type = EventType::Overspeed;
+    event.source_id = alert.source_id;
+    event.frame_number = alert.frame_number;
+    event.track_id = static_cast<int32_t>(alert.object.track_id);
+    event.ntp_timestamp = alert.ntp_timestamp;
+    event.speed_kmh = alert.peak_speed_kmh;
+    event.is_overspeeding = true;
+    event.trajectory = nullptr;
+    
+    if (!queue_.try_enqueue(event)) {
+        dropped_++;
+    }
+}
+
+void EventLogWriter::onTrajectory(const speedflow::Trajectory& trajectory) {
+    // Encoded here so the queue entry stays small; once per track, not per frame
+    auto* data = new TrajectoryData;
+    data->video_fps = trajectory.video_fps;
+    data->max_error_m = trajectory.max_error_m;
+    data->num_points = trajectory.num_points;
+    data->num_vertices = static_cast<uint32_t>(trajectory.vertices.size());
+    data->complete = trajectory.complete;
+    speedflow::encodeTrajectory(trajectory.vertices, data->vertices);
+    
+    Event event;
+    event.type = EventType::Trajectory;
+    event.source_id = trajectory.source_id;
+    event.frame_number = trajectory.vertices.back().frame;
+    event.track_id = trajectory.track_id;
+    event.ntp_timestamp = trajectory.ntp_timestamp;
+    event.speed_kmh = 0.0f;
+    event.is_overspeeding = false;
+    event.trajectory = data;
+    
+    if (!queue_.try_enqueue(event)) {
+        delete data;
+        dropped_++;
+    }
+}
+
+void EventLogWriter::run() {
+    std::vector<Event> events(kBulkEvents);
+    std::string buffer;
+    buffer.reserve(kFlushBytes + 4096);
+    speedflow::EventLogRecord record;
+    speedflow::SpeedEvent measurement;
+    speedflow::OverspeedAlert alert;
+    speedflow::TrackTrajectory trajectory;
+    char timestamp[32];
+    size_t pending = 0;  // Events serialized into buffer but not yet written
+    
+    const auto fsync_interval = std::chrono::milliseconds(config_.fsync_interval_ms);
+    auto last_sync = std::chrono::steady_clock::now();
+    
+    while (true) {
+        // Wake up in time for the next group commit
+        int64_t timeout_us = 100000;
+        if (dirty_) {
+            auto until_sync = last_sync + fsync_interval - std::chrono::steady_clock::now();
+            timeout_us = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(
+                until_sync).count());
+        }
+        
+        size_t count = queue_.wait_dequeue_bulk_timed(events.begin(), kBulkEvents, timeout_us);
+        
+        for (size_t i = 0; i < count; i++) {
+            const Event& event = events[i];
+            
+            // The oneof borrows the reused submessages (released again below)
+            // so switching event types does not allocate per record
+            switch (event.type) {
+                case EventType::Measurement:
+                    measurement.set_ntp_timestamp(event.ntp_timestamp);
+                    measurement.set_source_id(event.source_id);
+                    measurement.set_frame_number(event.frame_number);
+                    measurement.set_track_id(event.track_id);
+                    measurement.set_speed_kmh(event.speed_kmh);
+                    measurement.set_is_overspeeding(event.is_overspeeding);
+                    record.set_allocated_measurement(&measurement);
+                    break;
+                case EventType::Overspeed: {
+                    size_t len = formatTimestamp(event.ntp_timestamp, timestamp, sizeof(timestamp));
+                    alert.mutable_timestamp()->assign(timestamp, len);
+                    alert.set_track_id(event.track_id);
+                    alert.set_speed_kmh(event.speed_kmh);
+                    alert.set_ntp_timestamp(event.ntp_timestamp);
+                    alert.set_source_id(event.source_id);
+                    record.set_allocated_overspeed(&alert);
+                    break;
+                }
+                case EventType::Trajectory:
+                    trajectory.set_source_id(event.source_id);
+                    trajectory.set_track_id(event.track_id);
+                    trajectory.set_ntp_timestamp(event.ntp_timestamp);
+                    trajectory.set_video_fps(event.trajectory->video_fps);
+                    trajectory.set_max_error_m(event.trajectory->max_error_m);
+                    trajectory.set_num_points(event.trajectory->num_points);
+                    trajectory.set_num_vertices(event.trajectory->num_vertices);
+                    trajectory.set_complete(event.trajectory->complete);
+                    trajectory.mutable_vertices()->swap(event.trajectory->vertices);
+                    record.set_allocated_trajectory(&trajectory);
+                    break;
+            }
+            
+            appendDelimited(record, buffer);
+            
+            switch (event.type) {
+                case EventType::Measurement:
+                    (void)record.release_measurement();
+                    break;
+                case EventType::Overspeed:
+                    (void)record.release_overspeed();
+                    break;
+                case EventType::Trajectory:
+                    (void)record.release_trajectory();
+                    delete event.trajectory;
+                    break;
+            }
+        }
+        
+        // Batch while the queue is busy, write as soon as it is drained
+        pending += count;
+        if (pending > 0 && (count < kBulkEvents || buffer.size() >= kFlushBytes)) {
+            if (flush(buffer)) {
+                written_ += pending;
+            } else {
+                dropped_ += pending;
+            }
+            pending = 0;
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        if (dirty_ && now - last_sync >= fsync_interval) {
+            sync();
+            last_sync = now;
+        }
+        
+        // Rotation (also retries opening after a failed rotation)
+        bool too_big = file_bytes_ >= config_.max_file_bytes;
+        bool too_old = config_.rotate_interval_s > 0 &&
+                       nowSeconds() - file_opened_s_ >= config_.rotate_interval_s;
+        if (fd_ < 0 || too_big || too_old) {
+            if (fd_ >= 0) {
+                sync();
+                last_sync = now;
+                closeFile();
+            }
+            openNewFile();
+        }
+        
+        if (!running_ && count == 0) {
+            break;
+        }
+    }
+    
+    if (pending > 0) {
+        if (flush(buffer)) {
+            written_ += pending;
+        } else {
+            dropped_ += pending;
+        }
+    }
+    sync();
+}
+
+bool EventLogWriter::flush(std::string& buffer) {
+    if (fd_ < 0) {
+        buffer.clear();
+        return false;
+    }
+    
+    const char* ptr = buffer.data();
+    size_t remaining = buffer.size();
+    while (remaining > 0) {
+        ssize_t n = write(fd_, ptr, remaining);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "[EventLogWriter] Write to " << file_path_ << " failed: "
+                      << std::strerror(errno) << std::endl;
+            // Drop the partial record; recovery truncates it on next start
+            buffer.clear();
+            closeFile();
+            return false;
+        }
+        ptr += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    
+    file_bytes_ += buffer.size();
+    dirty_ = true;
+    buffer.clear();
+    return true;
+}
+
+void EventLogWriter::sync() {
+    if (fd_ >= 0 && dirty_) {
+        fdatasync(fd_);
+    }
+    dirty_ = false;
+}
+
+bool EventLogWriter::recoverLatestFile() {
+    std::vector<fs::path> logs;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(config_.dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && name.rfind("events-", 0) == 0 &&
+            entry.path().extension() == ".log") {
+            logs.push_back(entry.path());
+        }
+    }
+    if (logs.empty()) {
+        return false;
+    }
+    
+    // Names embed the creation time, so the last one is the newest
+    std::sort(logs.begin(), logs.end());
+    std::string path = logs.back().string();
+    
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    
+    // Walk complete records; anything after the last one is a torn tail
+    off_t good_offset = 0;
+    uint64_t records = 0;
+    {
+        google::protobuf::io::FileInputStream input(fd);
+        speedflow::EventLogRecord record;
+        bool clean_eof = false;
+        while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&record, &input, &clean_eof)) {
+            good_offset = input.ByteCount();
+            records++;
+        }
+    }
+    
+    off_t file_size = lseek(fd, 0, SEEK_END);
+    if (file_size > good_offset) {
+        std::cout << "[EventLogWriter] Truncating torn tail of " << path << ": "
+                  << (file_size - good_offset) << " bytes after " << records << " records" << std::endl;
+        if (ftruncate(fd, good_offset) != 0) {
+            close(fd);
+            return false;
+        }
+        fdatasync(fd);
+    }
+    
+    if (static_cast<size_t>(good_offset) >= config_.max_file_bytes) {
+        close(fd);
+        return false;  // Full, start a new file
+    }
+    
+    lseek(fd, good_offset, SEEK_SET);
+    fd_ = fd;
+    file_path_ = path;
+    file_bytes_ = good_offset;
+    file_opened_s_ = nowSeconds();
+    return true;
+}
+
+bool EventLogWriter::openNewFile() {
+    time_t now = static_cast<time_t>(nowSeconds());
+    struct tm tm_utc;
+    gmtime_r(&now, &tm_utc);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_utc);
+    
+    char name[64];
+    snprintf(name, sizeof(name), "events-%s-%04u.log", stamp, file_seq_++ % 10000);
+    std::string path = (fs::path(config_.dir) / name).string();
+    
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[EventLogWriter] Failed to create " << path << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    fd_ = fd;
+    file_path_ = path;
+    file_bytes_ = 0;
+    file_opened_s_ = static_cast<int64_t>(now);
+    return true;
+}
+
+void EventLogWriter::closeFile() {
+    if (fd_ >= 0) {
+        if (dirty_) {
+            fdatasync(fd_);
+            dirty_ = false;
+        }
+        close(fd_);
+        fd_ = -1;
+    }
+}
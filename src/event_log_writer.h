@@ -0,0 +1,106 @@
+#ifndef EVENT_LOG_WRITER_H
+#define EVENT_LOG_WRITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <blockingconcurrentqueue.h>
+#include "../plugins/result_sink.h"
+
+/**
+ * Configuration for the event log
+ */
+struct EventLogConfig {
+    std::string dir;                    // Log directory
+    int fsync_interval_ms = 1000;       // Group commit interval
+    size_t max_file_bytes = 64u << 20;  // Rotate once a file reaches this size (checked per batch)
+    int rotate_interval_s = 3600;       // Rotate at least this often (0 = never)
+    size_t queue_capacity = 65536;      // Events buffered before dropping
+};
+
+/**
+ * EventLogWriter - Durable local log of speed measurements, overspeed alerts
+ * and track trajectories
+ *
+ * The streaming thread only pushes small fixed-size events into a lock-free
+ * queue (no I/O, and no allocation except one per finished trajectory for its
+ * encoded vertices). A writer thread drains the queue in bulk, serializes
+ * length-delimited speedflow.EventLogRecord messages into one buffer, writes
+ * it with a single write() and fdatasync()s at most once per fsync interval
+ * (group commit). Files rotate by size and age.
+ *
+ * On start the newest file is scanned and a torn tail left by a crash is
+ * truncated back to the last complete record before appending.
+ */
+class EventLogWriter : public speedflow::ResultSink {
+public:
+    explicit EventLogWriter(const EventLogConfig& config);
+    ~EventLogWriter() override;
+    
+    bool start();
+    void stop();
+    
+    void onFrame(const speedflow::FrameResult& frame) override;
+    void onAlert(const speedflow::AlertResult& alert) override;
+    void onTrajectory(const speedflow::Trajectory& trajectory) override;
+    
+    uint64_t writtenCount() const { return written_.load(); }
+    uint64_t droppedCount() const { return dropped_.load(); }
+
+private:
+    enum class EventType : uint8_t {
+        Measurement,
+        Overspeed,
+        Trajectory
+    };
+    
+    // Variable-size part of a trajectory event
+    struct TrajectoryData {
+        float video_fps;
+        float max_error_m;
+        uint32_t num_points;
+        uint32_t num_vertices;
+        bool complete;
+        std::string vertices;   // encodeTrajectory() output
+    };
+    
+    // Plain event passed through the queue
+    struct Event {
+        EventType type;
+        int32_t source_id;
+        int32_t frame_number;
+        int32_t track_id;
+        int64_t ntp_timestamp;
+        float speed_kmh;
+        bool is_overspeeding;
+        TrajectoryData* trajectory;  // Owned, Trajectory events only (freed by the writer,
+                                     // or the destructor if still queued)
+    };
+    
+    void run();
+    bool recoverLatestFile();
+    bool openNewFile();
+    void closeFile();
+    bool flush(std::string& buffer);
+    void sync();
+    
+    EventLogConfig config_;
+    
+    moodycamel::BlockingConcurrentQueue<Event> queue_;
+    std::thread thread_;
+    std::atomic<bool> running_;
+    
+    // Writer thread state
+    int fd_;
+    std::string file_path_;
+    size_t file_bytes_;
+    int64_t file_opened_s_;
+    uint32_t file_seq_;
+    bool dirty_;
+    
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;
+};
+
+#endif // EVENT_LOG_WRITER_H
@@ -0,0 +1,339 @@
+#include "evidence_recorder.h"
+#include <gst/app/gstappsrc.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+// Alerts waiting for a frame of their source (a source that stopped
+// delivering frames must not make them pile up)
+static constexpr size_t kMaxPendingAlerts = 64;
+
+// Time the clip muxer gets to finish a file
+static constexpr GstClockTime kWriteTimeout = 30 * GST_SECOND;
+
+EvidenceRecorder::SourceState::SourceState(const EvidenceConfig& config)
+    : ring(config.ring_bytes, config.max_ring_frames,
+           static_cast<int64_t>(config.preroll_s * 1e9)) {
+}
+
+EvidenceRecorder::EvidenceRecorder(const EvidenceConfig& config)
+    : config_(config),
+      has_alerts_(false),
+      running_(false),
+      clips_written_(0),
+      alerts_dropped_(0) {
+}
+
+EvidenceRecorder::~EvidenceRecorder() {
+    stop();
+}
+
+bool EvidenceRecorder::start() {
+    if (running_) {
+        return true;
+    }
+    
+    std::error_code ec;
+    fs::create_directories(config_.dir, ec);
+    if (ec) {
+        std::cerr << "[EvidenceRecorder] Cannot create " << config_.dir << ": "
+                  << ec.message() << std::endl;
+        return false;
+    }
+    
+    running_ = true;
+    thread_ = std::thread(&EvidenceRecorder::run, this);
+    
+    std::cout << "[EvidenceRecorder] Writing overspeed clips to " << config_.dir << " ("
+              << config_.preroll_s << " s pre-roll, " << config_.postroll_s << " s post-roll, "
+              << (config_.ring_bytes >> 20) << " MB per source)" << std::endl;
+    return true;
+}
+
+void EvidenceRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(clips_mutex_);
+        if (!running_) {
+            return;
+        }
+    }
+    
+    // The pipeline is stopped: clips still collecting end with what they have
+    {
+        std::lock_guard<std::mutex> lock(sources_mutex_);
+        for (auto& entry : sources_) {
+            if (entry.second->collecting) {
+                finishClip(*entry.second);
+            }
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(clips_mutex_);
+        running_ = false;
+    }
+    clips_cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    std::cout << "[EvidenceRecorder] Stopped: " << clips_written_.load() << " clips written, "
+              << alerts_dropped_.load() << " alerts without clip" << std::endl;
+}
+
+void EvidenceRecorder::onAlert(const speedflow::AlertResult& alert) {
+    std::lock_guard<std::mutex> lock(alerts_mutex_);
+    if (alerts_.size() >= kMaxPendingAlerts) {
+        alerts_dropped_++;
+        return;
+    }
+    alerts_.push_back(alert);
+    has_alerts_.store(true, std::memory_order_release);
+}
+
+void EvidenceRecorder::onSourceRemoved(int source_id) {
+    dropAlerts(source_id);
+}
+
+void EvidenceRecorder::resetSource(int source_id) {
+    SourceState* source = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(sources_mutex_);
+        auto it = sources_.find(source_id);
+        if (it != sources_.end()) {
+            source = it->second.get();
+        }
+    }
+    if (source) {
+        if (source->collecting) {
+            finishClip(*source);
+        }
+        source->ring.clear();
+    }
+    dropAlerts(source_id);
+}
+
+void EvidenceRecorder::dropAlerts(int source_id) {
+    std::lock_guard<std::mutex> lock(alerts_mutex_);
+    auto it = std::remove_if(alerts_.begin(), alerts_.end(),
+                             [source_id](const speedflow::AlertResult& alert) {
+                                 return alert.source_id == source_id;
+                             });
+    alerts_dropped_ += static_cast<uint64_t>(alerts_.end() - it);
+    alerts_.erase(it, alerts_.end());
+    has_alerts_.store(!alerts_.empty(), std::memory_order_release);
+}
+
+EvidenceRecorder::SourceState& EvidenceRecorder::sourceState(int source_id) {
+    // Held for the lookup only: the entry itself belongs to the caller's source
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    auto& entry = sources_[source_id];
+    if (!entry) {
+        entry = std::make_unique<SourceState>(config_);
+    }
+    return *entry;
+}
+
+void EvidenceRecorder::pushFrame(int source_id, GstBuffer* buffer, GstCaps* caps) {
+    SourceState& source = sourceState(source_id);
+    
+    GstMapInfo map;
+    if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        return;
+    }
+    int64_t pts_ns = GST_BUFFER_PTS_IS_VALID(buffer) ? static_cast<int64_t>(GST_BUFFER_PTS(buffer)) : 0;
+    bool keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    source.ring.push(map.data, map.size, pts_ns, keyframe);
+    
+    // Post-roll of the clip being collected, within its memory budget; a
+    // clip that got no keyframe from the ring starts at the next one
+    if (source.collecting && (keyframe || !source.collecting->frames.empty()) &&
+        source.collecting->bytes + map.size <= 2 * config_.ring_bytes) {
+        Clip& clip = *source.collecting;
+        clip.frames.push_back({pts_ns, keyframe,
+                               std::string(reinterpret_cast<const char*>(map.data), map.size)});
+        clip.bytes += map.size;
+    }
+    gst_buffer_unmap(buffer, &map);
+    
+    // Alerts of this source start a clip, or extend the one being collected
+    if (has_alerts_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(alerts_mutex_);
+        for (auto it = alerts_.begin(); it != alerts_.end();) {
+            if (it->source_id != source_id) {
+                ++it;
+                continue;
+            }
+            
+            int64_t end_pts_ns = pts_ns + static_cast<int64_t>(config_.postroll_s * 1e9);
+            if (!source.collecting) {
+                if (source.clips_in_flight.load() >= config_.max_clips_per_source) {
+                    alerts_dropped_++;
+                    it = alerts_.erase(it);
+                    continue;
+                }
+                
+                auto clip = std::make_unique<Clip>();
+                clip->source = &source;
+                clip->source_id = source_id;
+                clip->wall_time_s = it->ntp_timestamp > 0
+                    ? it->ntp_timestamp / 1000000000
+                    : static_cast<int64_t>(std::time(nullptr));
+                clip->end_pts_ns = end_pts_ns;
+                clip->bytes = source.ring.copyTo(clip->frames);  // Includes this frame
+                clip->caps = caps ? gst_caps_ref(caps) : nullptr;
+                source.collecting = std::move(clip);
+                source.clips_in_flight++;
+            }
+            
+            Clip& clip = *source.collecting;
+            clip.track_ids.push_back(static_cast<int>(it->object.track_id));
+            clip.peak_speed_kmh = std::max(clip.peak_speed_kmh, it->peak_speed_kmh);
+            clip.end_pts_ns = std::max(clip.end_pts_ns, end_pts_ns);
+            it = alerts_.erase(it);
+        }
+        has_alerts_.store(!alerts_.empty(), std::memory_order_release);
+    }
+    
+    if (source.collecting && pts_ns >= source.collecting->end_pts_ns) {
+        finishClip(source);
+    }
+}
+
+void EvidenceRecorder::finishClip(SourceState& source) {
+    // No keyframe before the post-roll ended: nothing that would decode
+    if (source.collecting->frames.empty()) {
+        alerts_dropped_ += source.collecting->track_ids.size();
+        if (source.collecting->caps) {
+            gst_caps_unref(source.collecting->caps);
+        }
+        source.collecting.reset();
+        source.clips_in_flight--;
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(clips_mutex_);
+        clips_.push_back(std::move(source.collecting));
+    }
+    clips_cv_.notify_one();
+}
+
+void EvidenceRecorder::run() {
+    while (true) {
+        std::unique_ptr<Clip> clip;
+        {
+            std::unique_lock<std::mutex> lock(clips_mutex_);
+            clips_cv_.wait(lock, [this] { return !clips_.empty() || !running_; });
+            if (clips_.empty()) {
+                return;
+            }
+            clip = std::move(clips_.front());
+            clips_.pop_front();
+        }
+        
+        std::string path;
+        auto write_start = std::chrono::steady_clock::now();
+        if (writeClip(*clip, path)) {
+            clips_written_++;
+            auto write_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - write_start).count();
+            std::cout << "[EvidenceRecorder] " << path << ": " << clip->frames.size()
+                      << " frames, " << (clip->bytes >> 10) << " KB, peak "
+                      << clip->peak_speed_kmh << " km/h (" << write_ms << " ms)" << std::endl;
+        }
+        
+        if (clip->caps) {
+            gst_caps_unref(clip->caps);
+        }
+        clip->source->clips_in_flight--;
+    }
+}
+
+bool EvidenceRecorder::writeClip(const Clip& clip, std::string& path) {
+    if (clip.frames.empty() || !clip.caps) {
+        return false;
+    }
+    
+    char stamp[32];
+    time_t secs = static_cast<time_t>(clip.wall_time_s);
+    struct tm tm_utc;
+    gmtime_r(&secs, &tm_utc);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_utc);
+    path = config_.dir + "/overspeed-" + stamp + "-src" + std::to_string(clip.source_id) +
+           "-track" + std::to_string(clip.track_ids.front()) + ".mkv";
+    
+    // appsrc -> [h264parse] -> matroskamux -> filesink, run to EOS on this thread
+    bool h264 = gst_structure_has_name(gst_caps_get_structure(clip.caps, 0), "video/x-h264");
+    GstElement* pipeline = gst_pipeline_new("evidence-writer");
+    GstElement* src = gst_element_factory_make("appsrc", nullptr);
+    GstElement* parse = h264 ? gst_element_factory_make("h264parse", nullptr) : nullptr;
+    GstElement* mux = gst_element_factory_make("matroskamux", nullptr);
+    GstElement* sink = gst_element_factory_make("filesink", nullptr);
+    if (!pipeline || !src || (h264 && !parse) || !mux || !sink) {
+        std::cerr << "[EvidenceRecorder] Missing appsrc/h264parse/matroskamux/filesink" << std::endl;
+        for (GstElement* element : {pipeline, src, parse, mux, sink}) {
+            if (element) {
+                gst_object_unref(element);
+            }
+        }
+        return false;
+    }
+    
+    g_object_set(G_OBJECT(src),
+                 "caps", clip.caps,
+                 "format", GST_FORMAT_TIME,
+                 "max-bytes", (guint64)0,  // The clip is in memory already
+                 nullptr);
+    g_object_set(G_OBJECT(sink), "location", path.c_str(), nullptr);
+    
+    gst_bin_add_many(GST_BIN(pipeline), src, mux, sink, nullptr);
+    bool linked;
+    if (parse) {
+        gst_bin_add(GST_BIN(pipeline), parse);
+        linked = gst_element_link_many(src, parse, mux, sink, nullptr);
+    } else {
+        linked = gst_element_link_many(src, mux, sink, nullptr);
+    }
+    if (!linked || gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        std::cerr << "[EvidenceRecorder] Cannot start clip writer for " << path << std::endl;
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+        return false;
+    }
+    
+    // Timestamps from 0; the encoder emits no B-frames, so DTS = PTS
+    const int64_t origin_ns = clip.frames.front().pts_ns;
+    for (const EncodedFrame& frame : clip.frames) {
+        GstBuffer* buffer = gst_buffer_new_allocate(nullptr, frame.data.size(), nullptr);
+        gst_buffer_fill(buffer, 0, frame.data.data(), frame.data.size());
+        GST_BUFFER_PTS(buffer) = static_cast<GstClockTime>(frame.pts_ns - origin_ns);
+        GST_BUFFER_DTS(buffer) = GST_BUFFER_PTS(buffer);
+        if (!frame.keyframe) {
+            GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+        }
+        if (gst_app_src_push_buffer(GST_APP_SRC(src), buffer) != GST_FLOW_OK) {
+            break;
+        }
+    }
+    gst_app_src_end_of_stream(GST_APP_SRC(src));
+    
+    GstBus* bus = gst_element_get_bus(pipeline);
+    GstMessage* msg = gst_bus_timed_pop_filtered(
+        bus, kWriteTimeout, (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    bool ok = msg && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+    if (!ok) {
+        std::cerr << "[EvidenceRecorder] Failed to write " << path << std::endl;
+    }
+    if (msg) {
+        gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    return ok;
+}
@@ -0,0 +1,135 @@
+#ifndef EVIDENCE_RECORDER_H
+#define EVIDENCE_RECORDER_H
+
+#include <gst/gst.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "encoded_frame_ring.h"
+#include "../plugins/result_sink.h"
+
+/**
+ * Configuration for overspeed evidence clips
+ */
+struct EvidenceConfig {
+    std::string dir;                    // Clip directory
+    float preroll_s = 5.0f;             // Video kept before the alert
+    float postroll_s = 3.0f;            // Video recorded after the alert
+    size_t ring_bytes = 16u << 20;      // Pre-roll memory per source
+    size_t max_ring_frames = 1024;      // Frame index per source
+    int max_clips_per_source = 2;       // Clips collected or waiting for the writer
+};
+
+/**
+ * EvidenceRecorder - Video clips around overspeed alerts
+ *
+ * Each source's evidence branch encodes every frame (H.264, or MJPEG) into an appsink
+ * whose callback feeds pushFrame(): each source has an EncodedFrameRing with
+ * the last preroll_s of compressed video, so nothing touches the disk until
+ * there is a violation. An alert from speedcalc (onAlert) is picked up on the
+ * next frame of its source: the ring is copied into a clip, the following
+ * postroll_s of frames are appended, and the finished clip goes to a writer
+ * thread that muxes it into <dir>/overspeed-...-src<S>-track<T>.mkv. Alerts of
+ * the same source while a clip is collecting extend that clip.
+ *
+ * Memory per source is bounded by ring_bytes for the ring plus
+ * max_clips_per_source clips of at most 2 * ring_bytes each; alerts beyond
+ * that are counted as dropped.
+ */
+class EvidenceRecorder : public speedflow::ResultSink {
+public:
+    explicit EvidenceRecorder(const EvidenceConfig& config);
+    ~EvidenceRecorder() override;
+    
+    bool start();
+    
+    /** Finish the clips being collected (shorter post-roll) and write them */
+    void stop();
+    
+    void onFrame(const speedflow::FrameResult&) override {}
+    void onAlert(const speedflow::AlertResult& alert) override;
+    
+    /** Drop the source's pending alerts, which may follow its evidence branch's removal */
+    void onSourceRemoved(int source_id) override;
+    
+    /**
+     * Forget a detached source, so a camera attached later under its id
+     * starts with an empty ring: the clip being collected is finished with
+     * what it has and pending alerts are dropped (main thread, once the
+     * source's evidence branch is stopped)
+     * @param source_id Stream source id
+     */
+    void resetSource(int source_id);
+    
+    /**
+     * Add one encoded frame (the source's evidence branch streaming thread)
+     * @param source_id Stream source id
+     * @param buffer Encoded access unit, keyframes without GST_BUFFER_FLAG_DELTA_UNIT
+     * @param caps Caps of the encoded stream (for the clip muxer)
+     */
+    void pushFrame(int source_id, GstBuffer* buffer, GstCaps* caps);
+    
+    uint64_t clipsWritten() const { return clips_written_.load(); }
+    uint64_t alertsDropped() const { return alerts_dropped_.load(); }
+
+private:
+    struct SourceState;
+    
+    struct Clip {
+        SourceState* source;            // Owner, for the in-flight count
+        int source_id;
+        std::vector<int> track_ids;
+        float peak_speed_kmh = 0.0f;
+        int64_t wall_time_s;            // Of the first alert, names the file
+        int64_t end_pts_ns;             // Post-roll collected up to here
+        size_t bytes = 0;
+        std::vector<EncodedFrame> frames;
+        GstCaps* caps = nullptr;        // Owned
+    };
+    
+    struct SourceState {
+        explicit SourceState(const EvidenceConfig& config);
+        EncodedFrameRing ring;
+        std::unique_ptr<Clip> collecting;
+        std::atomic<int> clips_in_flight{0};    // Collecting or queued for the writer
+    };
+    
+    SourceState& sourceState(int source_id);
+    void dropAlerts(int source_id);
+    void run();
+    void finishClip(SourceState& source);
+    bool writeClip(const Clip& clip, std::string& path);
+    
+    EvidenceConfig config_;
+    
+    // Rings and clips under collection, created by a source's first frame.
+    // Each source's evidence branch pushes from its own streaming thread, so
+    // the map is guarded by sources_mutex_; an entry is only used by its
+    // source's thread, or by resetSource() once that thread is stopped.
+    // Entries are never removed, clips keep pointers to them.
+    std::mutex sources_mutex_;
+    std::map<int, std::unique_ptr<SourceState>> sources_;
+    
+    // Alerts from speedcalc, taken by the next frame of their source
+    std::mutex alerts_mutex_;
+    std::vector<speedflow::AlertResult> alerts_;
+    std::atomic<bool> has_alerts_;
+    
+    // Finished clips for the writer thread
+    std::mutex clips_mutex_;
+    std::condition_variable clips_cv_;
+    std::deque<std::unique_ptr<Clip>> clips_;
+    std::thread thread_;
+    bool running_;
+    
+    std::atomic<uint64_t> clips_written_;
+    std::atomic<uint64_t> alerts_dropped_;
+};
+
+#endif // EVIDENCE_RECORDER_H
@@ -0,0 +1,317 @@
+#include "frame_publisher.h"
+#include "delimited_stream.h"
+#include "speedflow.pb.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Frames serialized into one write() call
+static constexpr size_t kMaxBatchFrames = 64;
+
+// Batch buffer reserved up front, so a burst of frames does not grow it in
+// steady state (about 25 objects per frame for a full batch)
+static constexpr size_t kBatchBufferBytes = kMaxBatchFrames * 1024;
+
+// Alerts buffered for a tcp:// target (far fewer than frames)
+static constexpr size_t kAlertCapacity = 256;
+static constexpr size_t kMaxBatchAlerts = 16;
+
+// Delay between reconnect attempts while the consumer is unavailable
+static constexpr auto kReconnectInterval = std::chrono::seconds(1);
+
+FrameDataPublisher::FrameDataPublisher(const std::string& target, size_t queue_capacity,
+                                       const std::string& node_id)
+    : target_(target),
+      is_socket_(false),
+      is_node_stream_(false),
+      node_id_(node_id),
+      hello_pending_(true),
+      fd_(-1),
+      pool_(queue_capacity),
+      free_(queue_capacity),
+      queue_(queue_capacity),
+      alerts_(kAlertCapacity),
+      running_(false),
+      published_(0),
+      dropped_(0) {
+    if (target.rfind("unix://", 0) == 0) {
+        is_socket_ = true;
+        path_ = target.substr(7);
+    } else if (target.rfind("tcp://", 0) == 0) {
+        is_socket_ = true;
+        is_node_stream_ = true;
+        path_ = target.substr(6);
+        if (node_id_.empty()) {
+            char host[256] = {};
+            gethostname(host, sizeof(host) - 1);
+            node_id_ = host;
+        }
+    } else if (target.rfind("file://", 0) == 0) {
+        path_ = target.substr(7);
+    } else {
+        path_ = target;
+    }
+    
+    for (auto& record : pool_) {
+        free_.enqueue(&record);
+    }
+}
+
+FrameDataPublisher::~FrameDataPublisher() {
+    stop();
+}
+
+bool FrameDataPublisher::start() {
+    if (running_) {
+        return true;
+    }
+    
+    // A missing socket consumer is not fatal, the thread keeps reconnecting
+    if (!openTarget() && !is_socket_) {
+        return false;
+    }
+    
+    running_ = true;
+    thread_ = std::thread(&FrameDataPublisher::run, this);
+    
+    std::cout << "[FrameDataPublisher] Publishing FrameData to " << target_ << std::endl;
+    return true;
+}
+
+void FrameDataPublisher::stop() {
+    if (!running_) {
+        return;
+    }
+    
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    closeTarget();
+    
+    std::cout << "[FrameDataPublisher] Stopped: " << published_.load() << " frames published, "
+              << dropped_.load() << " dropped" << std::endl;
+}
+
+void FrameDataPublisher::onFrame(const speedflow::FrameResult& frame) {
+    speedflow::FrameResult* record;
+    if (!free_.try_dequeue(record)) {
+        dropped_++;
+        return;
+    }
+    
+    // assign() reuses the record's capacity from earlier frames
+    record->source_id = frame.source_id;
+    record->frame_number = frame.frame_number;
+    record->ntp_timestamp = frame.ntp_timestamp;
+    record->objects.assign(frame.objects.begin(), frame.objects.end());
+    
+    if (!queue_.try_enqueue(record)) {
+        free_.enqueue(record);
+        dropped_++;
+    }
+}
+
+void FrameDataPublisher::onAlert(const speedflow::AlertResult& alert) {
+    // Bare FrameData streams have no place for alerts
+    if (is_node_stream_ && !alerts_.try_enqueue(alert)) {
+        dropped_++;
+    }
+}
+
+void FrameDataPublisher::run() {
+    speedflow::FrameData msg;
+    speedflow::OverspeedAlert alert_msg;
+    speedflow::NodeRecord record;
+    std::string buffer;
+    buffer.reserve(kBatchBufferBytes);
+    speedflow::FrameResult* frames[kMaxBatchFrames];
+    speedflow::AlertResult alerts[kMaxBatchAlerts];
+    auto next_reconnect = std::chrono::steady_clock::now();
+    
+    // Keep draining after stop() so queued frames are not lost
+    while (true) {
+        size_t count = queue_.wait_dequeue_bulk_timed(frames, kMaxBatchFrames, 100000);
+        size_t num_alerts = is_node_stream_ ? alerts_.try_dequeue_bulk(alerts, kMaxBatchAlerts) : 0;
+        if (count == 0 && num_alerts == 0) {
+            if (!running_) {
+                break;
+            }
+            continue;
+        }
+        
+        if (fd_ < 0) {
+            auto now = std::chrono::steady_clock::now();
+            if (now < next_reconnect || !openTarget()) {
+                next_reconnect = std::max(next_reconnect, now + kReconnectInterval);
+                free_.enqueue_bulk(frames, count);
+                dropped_ += count + num_alerts;
+                continue;
+            }
+        }
+        
+        buffer.clear();
+        for (size_t i = 0; i < count; i++) {
+            const speedflow::FrameResult& frame = *frames[i];
+            
+            // Clear() keeps the ObjectInfo elements for reuse by add_objects()
+            msg.Clear();
+            msg.set_ntp_timestamp(frame.ntp_timestamp);
+            msg.set_frame_number(frame.frame_number);
+            msg.set_source_id(frame.source_id);
+            for (const auto& obj : frame.objects) {
+                speedflow::ObjectInfo* info = msg.add_objects();
+                info->set_track_id(static_cast<int32_t>(obj.track_id));
+                info->set_speed_kmh(obj.speed_kmh);
+                info->set_bbox_x(obj.bbox_x);
+                info->set_bbox_y(obj.bbox_y);
+                info->set_bbox_w(obj.bbox_w);
+                info->set_bbox_h(obj.bbox_h);
+                info->set_class_id(obj.class_id);
+                info->set_confidence(obj.confidence);
+                info->set_is_overspeeding(obj.is_overspeeding);
+            }
+            
+            if (is_node_stream_) {
+                // The envelope borrows msg (released again below)
+                record.set_allocated_frame(&msg);
+                appendNodeRecord(record, buffer);
+                (void)record.release_frame();
+            } else {
+                appendDelimited(msg, buffer);
+            }
+        }
+        free_.enqueue_bulk(frames, count);
+        
+        // Alerts follow the frames they fired on
+        for (size_t i = 0; i < num_alerts; i++) {
+            const speedflow::AlertResult& alert = alerts[i];
+            alert_msg.set_ntp_timestamp(alert.ntp_timestamp);
+            alert_msg.set_source_id(alert.source_id);
+            alert_msg.set_track_id(static_cast<int32_t>(alert.object.track_id));
+            alert_msg.set_speed_kmh(alert.peak_speed_kmh);
+            record.set_allocated_alert(&alert_msg);
+            appendNodeRecord(record, buffer);
+            (void)record.release_alert();
+        }
+        
+        if (writeAll(buffer.data(), buffer.size())) {
+            published_ += count;
+        } else {
+            std::cerr << "[FrameDataPublisher] Write to " << target_ << " failed: "
+                      << std::strerror(errno) << std::endl;
+            dropped_ += count + num_alerts;
+            closeTarget();
+            next_reconnect = std::chrono::steady_clock::now() + kReconnectInterval;
+        }
+    }
+}
+
+void FrameDataPublisher::appendNodeRecord(speedflow::NodeRecord& record, std::string& buffer) {
+    if (hello_pending_) {
+        record.set_node_id(node_id_);
+        appendDelimited(record, buffer);
+        record.clear_node_id();
+        hello_pending_ = false;
+    } else {
+        appendDelimited(record, buffer);
+    }
+}
+
+bool FrameDataPublisher::openTarget() {
+    if (is_node_stream_) {
+        size_t colon = path_.rfind(':');
+        std::string host = path_.substr(0, colon);
+        std::string port = colon == std::string::npos ? "9400" : path_.substr(colon + 1);
+        
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) {
+            return false;
+        }
+        
+        int fd = -1;
+        for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                break;
+            }
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(result);
+        if (fd < 0) {
+            return false;
+        }
+        
+        // Batches are already coalesced, do not hold them back further
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fd_ = fd;
+        hello_pending_ = true;
+        std::cout << "[FrameDataPublisher] Connected to " << target_ << " as node "
+                  << node_id_ << std::endl;
+    } else if (is_socket_) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+        
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return false;
+        }
+        fd_ = fd;
+        std::cout << "[FrameDataPublisher] Connected to " << target_ << std::endl;
+    } else {
+        fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            std::cerr << "[FrameDataPublisher] Failed to open " << path_ << ": "
+                      << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrameDataPublisher::closeTarget() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool FrameDataPublisher::writeAll(const void* data, size_t size) {
+    const char* ptr = static_cast<const char*>(data);
+    
+    while (size > 0) {
+        // send() with MSG_NOSIGNAL so a vanished reader is an error, not SIGPIPE
+        ssize_t n = is_socket_ ? send(fd_, ptr, size, MSG_NOSIGNAL) : write(fd_, ptr, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        ptr += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef FRAME_PUBLISHER_H
+#define FRAME_PUBLISHER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <blockingconcurrentqueue.h>
+#include "../plugins/result_sink.h"
+
+namespace speedflow { class NodeRecord; }
+
+/**
+ * FrameDataPublisher - Streams speedcalc results as length-delimited FrameData
+ *
+ * Each record is a varint32 byte length followed by a serialized
+ * speedflow.FrameData (same framing as protobuf's writeDelimitedTo).
+ * onFrame() only copies the frame into a pooled record and queues a pointer
+ * to it; serialization and I/O happen on the publisher thread. Records and
+ * the FrameData message are reused, so once they have grown to the observed
+ * object count the publishing path does not touch the heap. Frames are
+ * dropped (and counted) when the pool is exhausted or the consumer is gone,
+ * never blocking the pipeline.
+ *
+ * Targets:
+ *   file:///path/results.bin   Append to a file
+ *   unix:///run/speedflow.sock Connect to a listening Unix stream socket
+ *   tcp://host:9400            Node stream to speedflow_aggregator
+ *   /path/results.bin          Same as file://
+ *
+ * A tcp:// target carries speedflow.NodeRecord instead of bare FrameData:
+ * frames and overspeed alerts in one stream, and the node id on the first
+ * record of every connection so the aggregator can tell devices apart.
+ */
+class FrameDataPublisher : public speedflow::ResultSink {
+public:
+    /**
+     * @param target Output target (see above)
+     * @param queue_capacity Frames buffered for the publisher thread
+     * @param node_id Node id sent to the aggregator (tcp:// only, default: host name)
+     */
+    explicit FrameDataPublisher(const std::string& target, size_t queue_capacity = 1024,
+                                const std::string& node_id = std::string());
+    ~FrameDataPublisher() override;
+    
+    bool start();
+    void stop();
+    
+    void onFrame(const speedflow::FrameResult& frame) override;
+    void onAlert(const speedflow::AlertResult& alert) override;
+    
+    uint64_t publishedCount() const { return published_.load(); }
+    uint64_t droppedCount() const { return dropped_.load(); }
+
+private:
+    void run();
+    bool openTarget();
+    void closeTarget();
+    void appendNodeRecord(speedflow::NodeRecord& record, std::string& buffer);
+    bool writeAll(const void* data, size_t size);
+    
+    std::string target_;
+    bool is_socket_;
+    bool is_node_stream_;   // tcp://: NodeRecord framing
+    std::string path_;      // File or Unix socket path, host:port for tcp://
+    std::string node_id_;
+    bool hello_pending_;    // Node id goes on the next record (publisher thread)
+    int fd_;
+    
+    // Preallocated records cycle free_ -> queue_ -> free_
+    std::vector<speedflow::FrameResult> pool_;
+    moodycamel::ConcurrentQueue<speedflow::FrameResult*> free_;
+    moodycamel::BlockingConcurrentQueue<speedflow::FrameResult*> queue_;
+    moodycamel::ConcurrentQueue<speedflow::AlertResult> alerts_;  // tcp:// only
+    std::thread thread_;
+    std::atomic<bool> running_;
+    
+    std::atomic<uint64_t> published_;
+    std::atomic<uint64_t> dropped_;
+};
+
+#endif // FRAME_PUBLISHER_H
@@ -1,8 +1,10 @@
 #include <iostream>
 #include <csignal>
+#include <cstdlib>
 #include <glib.h>
 #include "pipeline_builder.h"
 #include "config_loader.h"
+#include "api_server.h"
 
 static GMainLoop* g_main_loop = nullptr;
 static PipelineBuilder* g_pipeline = nullptr;
@@ -25,10 +27,20 @@ void printUsage(const char* prog_name) {
               << "  source_uri          RTSP URI (rtsp://...) or file path (file:///...)\n"
               << "\nOptions:\n"
               << "  --config <path>     Path to pipeline config YAML (default: configs/pipeline.yml)\n"
+              << "  --profile <name>    Pipeline profile: deepstream | cpu-sim (overrides config)\n"
+              << "  --headless          No OSD/video output, only publish speed results\n"
+              << "  --output <target>   FrameData stream: file:///path, unix:///path or tcp://host:port (overrides config)\n"
+              << "  --trace <path>      Write per-frame timing as Chrome trace JSON (overrides config)\n"
+              << "  --event-log <dir>   Event log directory (overrides config)\n"
+              << "  --start <s>         Offline: analyze a recording from this time (keyframe before it)\n"
+              << "  --stop <s>          Offline: stop at this time and exit\n"
+              << "  --media-epoch <s>   Offline: Unix time of the recording start (timestamps = epoch + PTS)\n"
               << "  --help              Show this help message\n"
               << "\nExamples:\n"
               << "  " << prog_name << " rtsp://192.168.1.100/stream\n"
               << "  " << prog_name << " file:///path/to/video.mp4 --config my_config.yml\n"
+              << "  " << prog_name << " videotestsrc --profile cpu-sim\n"
+              << "  " << prog_name << " file:///path/to/video.mp4 --headless --output file:///tmp/speeds.bin\n"
               << std::endl;
 }
 
@@ -41,6 +53,15 @@ int main(int argc, char* argv[]) {
     
     std::string source_uri = argv[1];
     std::string config_path = "configs/pipeline.yml";
+    std::string profile;
+    std::string output;
+    std::string trace;
+    std::string event_log;
+    double start_s = 0.0;
+    double stop_s = 0.0;
+    double media_epoch_s = 0.0;
+    bool window = false;
+    bool headless = false;
     
     for (int i = 2; i < argc; i++) {
         std::string arg = argv[i];
@@ -49,6 +70,30 @@ int main(int argc, char* argv[]) {
             return 0;
         } else if (arg == "--config" && i + 1 < argc) {
             config_path = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile = argv[++i];
+            if (profile != "deepstream" && profile != "cpu-sim") {
+                std::cerr << "Unknown profile: " << profile << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace = argv[++i];
+        } else if (arg == "--event-log" && i + 1 < argc) {
+            event_log = argv[++i];
+        } else if (arg == "--start" && i + 1 < argc) {
+            start_s = std::atof(argv[++i]);
+            window = true;
+        } else if (arg == "--stop" && i + 1 < argc) {
+            stop_s = std::atof(argv[++i]);
+            window = true;
+        } else if (arg == "--media-epoch" && i + 1 < argc) {
+            media_epoch_s = std::atof(argv[++i]);
+            window = true;
         }
     }
     
@@ -68,6 +113,36 @@ int main(int argc, char* argv[]) {
         // Load configuration
         std::cout << "[Main] Loading configuration..." << std::endl;
         PipelineConfig config = ConfigLoader::loadPipelineConfig(config_path);
+        if (!profile.empty()) {
+            config.profile = profile;
+        }
+        if (headless) {
+            config.headless = true;
+        }
+        if (!output.empty()) {
+            config.results_output = output;
+        }
+        if (!trace.empty()) {
+            config.trace_output = trace;
+        }
+        if (!event_log.empty()) {
+            config.event_log_dir = event_log;
+        }
+        
+        // Offline window of a recording: results only, on the recording's
+        // own time line, with trajectories for stitching chunks together
+        if (window) {
+            config.source_start_s = start_s;
+            config.source_stop_s = stop_s;
+            config.media_clock = true;
+            config.media_epoch_ns = static_cast<int64_t>(media_epoch_s * 1e9);
+            config.headless = true;
+            config.api_enabled = false;
+            config.preview_enabled = false;
+            config.evidence_dir.clear();
+            config.checkpoint_path.clear();
+            config.trajectory_export = !config.event_log_dir.empty();
+        }
         
         // Build pipeline
         std::cout << "[Main] Building pipeline..." << std::endl;
@@ -87,6 +162,30 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
+        // REST API (failure to bind is not fatal for the pipeline)
+        std::unique_ptr<ApiServer> api_server;
+        if (config.api_enabled) {
+            api_server = std::make_unique<ApiServer>(g_pipeline->getSnapshots(),
+                                                     config.api_port, config.api_threads);
+            if (config.api_source_control) {
+                api_server->setSourceControl(g_pipeline);
+            }
+            if (config.api_preview_viewers) {
+                api_server->setPreviewControl(g_pipeline);
+            }
+            if (!api_server->start()) {
+                api_server.reset();
+            }
+        }
+        
+        // An offline window ends the process at its end of stream
+        if (window) {
+            g_pipeline->setEosHandler([] {
+                g_pipeline->stop();
+                g_main_loop_quit(g_main_loop);
+            });
+        }
+        
         // Run main loop
         std::cout << "[Main] Running... (Press Ctrl+C to stop)" << std::endl;
         g_main_loop = g_main_loop_new(nullptr, FALSE);
@@ -95,6 +194,7 @@ int main(int argc, char* argv[]) {
         // Cleanup
         std::cout << "[Main] Cleaning up..." << std::endl;
         g_main_loop_unref(g_main_loop);
+        api_server.reset();
         delete g_pipeline;
         
         std::cout << "[Main] Shutdown complete" << std::endl;
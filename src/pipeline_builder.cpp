@@ -1,7 +1,19 @@
 #include "pipeline_builder.h"
 #include "../plugins/homography.h"
 #include <iostream>
+#include <cstdlib>
 #include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+#include "gstnvdsmeta.h"
 
 #define CHECK_ELEMENT(elem, name) \
     if (!elem) { \
@@ -18,18 +30,43 @@
 PipelineBuilder::PipelineBuilder(const PipelineConfig& config)
     : config_(config),
       pipeline_(nullptr),
-      source_(nullptr),
       muxer_(nullptr),
       pgie_(nullptr),
       tracker_(nullptr),
       analytics_(nullptr),
       speedcalc_(nullptr),
       osd_(nullptr),
+      tee_(nullptr),
       sink_(nullptr),
-      is_live_source_(false) {
+      preview_(nullptr),
+      preview_valve_(nullptr),
+      preview_encoder_(nullptr),
+      preview_udp_(nullptr),
+      is_live_source_(false),
+      preview_clients_(0),
+      watchdog_timer_(0),
+      preview_lease_timer_(0) {
 }
 
 PipelineBuilder::~PipelineBuilder() {
+    if (watchdog_timer_) {
+        g_source_remove(watchdog_timer_);
+    }
+    if (preview_lease_timer_) {
+        g_source_remove(preview_lease_timer_);
+    }
+    for (auto& slot : sources_) {
+        if (slot->retry_timer) {
+            g_source_remove(slot->retry_timer);
+        }
+        if (slot->sink_pad) {
+            gst_object_unref(slot->sink_pad);
+        }
+        if (slot->front_pad) {
+            gst_object_unref(slot->front_pad);
+        }
+    }
+    
     if (pipeline_) {
         gst_element_set_state(pipeline_, GST_STATE_NULL);
         gst_object_unref(pipeline_);
@@ -50,62 +87,62 @@ bool PipelineBuilder::build(const std::string& source_uri) {
     // Detect source type
     is_live_source_ = (source_uri.find("rtsp://") == 0);
     
-    // Build components
-    source_ = buildSourceBin(source_uri);
-    if (!source_) return false;
+    // Opt-in timing trace; tracing problems never stop the pipeline
+    if (!config_.trace_output.empty()) {
+        tracer_ = std::make_shared<speedflow::TraceRecorder>(config_.trace_output);
+        if (!tracer_->start()) {
+            tracer_.reset();
+        }
+    }
+    
+    if (config_.profile == "cpu-sim") {
+        return buildCpuSim(source_uri);
+    }
     
+    // Build components (the source bin is added once the muxer is in place)
     muxer_ = gst_element_factory_make("nvstreammux", "stream-muxer");
     CHECK_ELEMENT(muxer_, "nvstreammux");
     
     pgie_ = gst_element_factory_make("nvinfer", "primary-infer");
     CHECK_ELEMENT(pgie_, "nvinfer");
     
-    tracker_ = gst_element_factory_make("nvtracker", "tracker");
-    CHECK_ELEMENT(tracker_, "nvtracker");
+    tracker_ = buildTracker();
+    if (!tracker_) return false;
     
     analytics_ = gst_element_factory_make("nvdsanalytics", "analytics");
     CHECK_ELEMENT(analytics_, "nvdsanalytics");
     
-    // Initialize speed calculator
-    HomographyConfig homo_config = ConfigLoader::loadHomographyConfig(
-        config_.homography_config_path,
-        config_.muxer_width,
-        config_.muxer_height
-    );
-    
-    auto transformer = std::make_shared<speedflow::ViewTransformer>(
-        homo_config.source_points,
-        homo_config.target_points
-    );
-    
-    speedflow::SpeedConfig speed_config;
-    speed_config.video_fps = config_.video_fps;
-    speed_config.speed_limit_kmh = config_.speed_limit_kmh;
-    speed_config.min_track_age_frames = config_.min_track_age_frames;
-    speed_config.min_world_displ_m = config_.min_world_displ_m;
-    speed_config.max_abs_kmh = config_.max_abs_kmh;
-    speed_config.bbox_area_jump = config_.bbox_area_jump;
-    speed_config.min_det_conf = config_.min_det_conf;
-    speed_config.median_window = config_.median_window;
-    
-    speed_calculator_ = std::make_shared<speedflow::SpeedCalculator>(transformer, speed_config);
+    if (!buildSpeedCalc()) return false;
     
-    // Create speedcalc plugin
-    speedcalc_ = gst_element_factory_make("speedcalc", "speed-calculator");
-    CHECK_ELEMENT(speedcalc_, "speedcalc");
+    // Analytics ends in a metadata sink; sync=false so file sources run
+    // as fast as the pipeline allows
+    sink_ = gst_element_factory_make("fakesink", "metadata-sink");
+    CHECK_ELEMENT(sink_, "fakesink");
+    g_object_set(G_OBJECT(sink_), "sync", FALSE, "async", FALSE, "qos", FALSE, nullptr);
     
-    // Set calculator instance
-    g_object_set(G_OBJECT(speedcalc_),
-                 "calculator", &speed_calculator_,
-                 "muxer-width", config_.muxer_width,
-                 "muxer-height", config_.muxer_height,
-                 nullptr);
+    if (config_.headless) {
+        // No OSD, no conversions, no encoding: results only leave through
+        // the result sinks of speedcalc
+        std::cout << "[PipelineBuilder] Headless mode (no OSD / video output)" << std::endl;
+        if (config_.results_output.empty()) {
+            std::cout << "[PipelineBuilder] Warning: headless without results_output, "
+                      << "speeds are computed but not published" << std::endl;
+        }
+    }
     
-    osd_ = gst_element_factory_make("nvdsosd", "onscreendisplay");
-    CHECK_ELEMENT(osd_, "nvdsosd");
+    // Output split: the preview branch hangs off the tee behind its own
+    // leaky queue so encoding can never back-pressure inference and
+    // speedcalc (evidence is encoded per source, see addEvidenceFront)
+    if (!config_.headless) {
+        tee_ = gst_element_factory_make("tee", "output-tee");
+        CHECK_ELEMENT(tee_, "tee");
+        g_object_set(G_OBJECT(tee_), "allow-not-linked", TRUE, nullptr);
+    }
     
-    sink_ = buildSinkBin();
-    if (!sink_) return false;
+    if (!config_.headless && config_.preview_enabled) {
+        preview_ = buildPreviewBin();
+        if (!preview_) return false;
+    }
     
     // Configure elements
     g_object_set(G_OBJECT(muxer_),
@@ -120,47 +157,485 @@ bool PipelineBuilder::build(const std::string& source_uri) {
                  "config-file-path", config_.infer_config_path.c_str(),
                  nullptr);
     
-    g_object_set(G_OBJECT(tracker_),
-                 "ll-lib-file", "/opt/nvidia/deepstream/deepstream/lib/libnvds_nvmultiobjecttracker.so",
-                 "ll-config-file", config_.tracker_config_path.c_str(),
-                 "tracker-width", 640,
-                 "tracker-height", 384,
-                 "gpu-id", 0,
-                 nullptr);
-    
     g_object_set(G_OBJECT(analytics_),
                  "config-file", config_.analytics_config_path.c_str(),
                  nullptr);
     
-    g_object_set(G_OBJECT(osd_),
-                 "display-text", 1,
-                 "display-bbox", 1,
-                 nullptr);
-    
     // Add elements to pipeline
-    gst_bin_add_many(GST_BIN(pipeline_), source_, muxer_, pgie_, tracker_,
-                     analytics_, speedcalc_, osd_, sink_, nullptr);
+    gst_bin_add_many(GST_BIN(pipeline_), muxer_, pgie_, tracker_,
+                     analytics_, speedcalc_, sink_, nullptr);
     
-    // Link static pads (speedcalc inserted between analytics and osd)
-    if (!gst_element_link_many(muxer_, pgie_, tracker_, analytics_, speedcalc_, osd_, sink_, nullptr)) {
+    // Link static pads (speedcalc after analytics); the tail is
+    // speedcalc -> sink (headless) or speedcalc -> tee -> sink
+    if (tee_) {
+        gst_bin_add(GST_BIN(pipeline_), tee_);
+    }
+    if (!linkStages({{"muxer", muxer_},
+                     {"pgie", pgie_},
+                     {"tracker", tracker_},
+                     {"analytics", analytics_},
+                     {"speedcalc", speedcalc_},
+                     {"", tee_ ? tee_ : sink_}})) {
         std::cerr << "Failed to link pipeline elements" << std::endl;
         return false;
     }
     
-    // Connect pad-added signal for dynamic source linking
-    g_signal_connect(source_, "pad-added", G_CALLBACK(onPadAdded), muxer_);
+    if (tee_ && !gst_element_link(tee_, sink_)) {
+        std::cerr << "Failed to link pipeline output" << std::endl;
+        return false;
+    }
+    
+    if (preview_) {
+        gst_bin_add(GST_BIN(pipeline_), preview_);
+        if (!gst_element_link(tee_, preview_)) {
+            std::cerr << "Failed to link preview branch" << std::endl;
+            return false;
+        }
+    }
+    
+    // Source bin, linked to a muxer request pad once it exposes video
+    if (!addSource(source_uri, 0)) return false;
+    
+    addPerfProbe(sink_);
+    addTraceProbes(muxer_, "mux", false);
+    addTraceProbes(pgie_, "infer");
+    addTraceProbes(tracker_, "track");
+    addTraceProbes(analytics_, "analytics");
+    addTraceProbes(speedcalc_, "speedcalc");
     
-    // Setup bus watch
+    // Setup bus watch (the sync handler runs on the posting streaming thread)
     GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
     gst_bus_add_watch(bus, (GstBusFunc)busCallback, this);
+    gst_bus_set_sync_handler(bus, busSyncHandler, this, nullptr);
     gst_object_unref(bus);
     
     std::cout << "[PipelineBuilder] Pipeline built successfully" << std::endl;
     return true;
 }
 
-GstElement* PipelineBuilder::buildSourceBin(const std::string& uri) {
-    GstElement* source = gst_element_factory_make("uridecodebin", "source-bin");
+bool PipelineBuilder::buildCpuSim(const std::string& source_uri) {
+    // CPU-only stand-in: standard GStreamer elements replace the DeepStream
+    // ones and simdetect replaces nvinfer + nvtracker, speedcalc is unchanged.
+    // Every source has its own front, a funnel stands in for nvstreammux:
+    //   src -> [evidence front] -> videoconvert -> videoscale -> capsfilter -> simdetect -+
+    //   src -> ...                                                                       +-> funnel
+    //   -> [ioutracker] -> speedcalc -> fakesink
+    std::cout << "[PipelineBuilder] Profile: cpu-sim (no GPU elements)" << std::endl;
+    
+    muxer_ = gst_element_factory_make("funnel", "stream-muxer");
+    CHECK_ELEMENT(muxer_, "funnel");
+    
+    // Optional CPU tracker re-associating the synthetic detections
+    if (config_.tracker_type == "iou") {
+        tracker_ = buildTracker();
+        if (!tracker_) return false;
+    }
+    
+    if (!buildSpeedCalc()) return false;
+    
+    sink_ = gst_element_factory_make("fakesink", "sim-sink");
+    CHECK_ELEMENT(sink_, "fakesink");
+    g_object_set(G_OBJECT(sink_), "sync", FALSE, "qos", FALSE, nullptr);
+    
+    gst_bin_add_many(GST_BIN(pipeline_), muxer_, speedcalc_, sink_, nullptr);
+    if (tracker_) {
+        gst_bin_add(GST_BIN(pipeline_), tracker_);
+    }
+    
+    // Detection already ran in the fronts, so the funnel output is the
+    // position after pgie; a queue after "muxer" has no place of its own
+    std::vector<std::pair<std::string, GstElement*>> stages = {{"pgie", muxer_}};
+    if (tracker_) {
+        stages.push_back({"tracker", tracker_});
+    }
+    stages.push_back({"speedcalc", speedcalc_});
+    stages.push_back({"", sink_});
+    if (!linkStages(stages)) {
+        std::cerr << "Failed to link cpu-sim pipeline elements" << std::endl;
+        return false;
+    }
+    
+    // A URI goes through uridecodebin, anything else is a videotestsrc
+    if (!addSource(source_uri, 0)) return false;
+    
+    addPerfProbe(sink_);
+    if (tracker_) {
+        addTraceProbes(tracker_, "track");
+    }
+    addTraceProbes(speedcalc_, "speedcalc");
+    
+    GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
+    gst_bus_add_watch(bus, (GstBusFunc)busCallback, this);
+    gst_bus_set_sync_handler(bus, busSyncHandler, this, nullptr);
+    gst_object_unref(bus);
+    
+    std::cout << "[PipelineBuilder] Pipeline built successfully" << std::endl;
+    return true;
+}
+
+bool PipelineBuilder::addSimFront(SourceSlot* slot) {
+    // The per-source part of cpu-sim, in one bin so it comes and goes with
+    // its source
+    std::string suffix = "-" + std::to_string(slot->id);
+    GstElement* conv = gst_element_factory_make("videoconvert", ("sim-conv" + suffix).c_str());
+    CHECK_ELEMENT(conv, "videoconvert");
+    
+    GstElement* scale = gst_element_factory_make("videoscale", ("sim-scale" + suffix).c_str());
+    CHECK_ELEMENT(scale, "videoscale");
+    
+    GstElement* caps_filter = gst_element_factory_make("capsfilter", ("sim-caps" + suffix).c_str());
+    CHECK_ELEMENT(caps_filter, "capsfilter");
+    
+    // Same frame geometry the muxer would produce, so calibrations still apply
+    GstCaps* caps = gst_caps_new_simple("video/x-raw",
+                                        "width", G_TYPE_INT, config_.muxer_width,
+                                        "height", G_TYPE_INT, config_.muxer_height,
+                                        nullptr);
+    g_object_set(G_OBJECT(caps_filter), "caps", caps, nullptr);
+    gst_caps_unref(caps);
+    
+    // Different traffic per source, the same for a source on every run
+    GstElement* detect = gst_element_factory_make("simdetect", ("sim-detect" + suffix).c_str());
+    CHECK_ELEMENT(detect, "simdetect");
+    g_object_set(G_OBJECT(detect),
+                 "frame-width", config_.muxer_width,
+                 "frame-height", config_.muxer_height,
+                 "density", config_.sim_density,
+                 "seed", static_cast<guint>(config_.sim_seed) + slot->id,
+                 "source-id", slot->id,
+                 "media-fps", config_.media_clock ? config_.video_fps : 0.0f,
+                 nullptr);
+    
+    GstElement* front = gst_bin_new(("sim-front" + suffix).c_str());
+    gst_bin_add_many(GST_BIN(front), conv, scale, caps_filter, detect, nullptr);
+    if (!gst_element_link_many(conv, scale, caps_filter, detect, nullptr)) {
+        std::cerr << "Failed to link cpu-sim front " << slot->id << std::endl;
+        gst_object_unref(front);
+        return false;
+    }
+    
+    GstPad* pad = gst_element_get_static_pad(conv, "sink");
+    gst_element_add_pad(front, gst_ghost_pad_new("sink", pad));
+    gst_object_unref(pad);
+    pad = gst_element_get_static_pad(detect, "src");
+    gst_element_add_pad(front, gst_ghost_pad_new("src", pad));
+    gst_object_unref(pad);
+    
+    gst_bin_add(GST_BIN(pipeline_), front);
+    std::string pad_name = "sink_" + std::to_string(slot->id);
+    GstPad* funnel_pad = gst_element_request_pad_simple(muxer_, pad_name.c_str());
+    GstPad* src_pad = gst_element_get_static_pad(front, "src");
+    bool linked = funnel_pad && gst_pad_link(src_pad, funnel_pad) == GST_PAD_LINK_OK;
+    gst_object_unref(src_pad);
+    
+    slot->front = front;
+    slot->front_pad = funnel_pad;
+    slot->target = front;
+    if (!linked) {
+        std::cerr << "Failed to link cpu-sim front " << slot->id << " to the funnel" << std::endl;
+        removeSimFront(slot);
+        return false;
+    }
+    
+    addTraceProbes(conv, "convert");
+    addTraceProbes(scale, "scale");
+    addTraceProbes(detect, "simdetect");
+    
+    // No-op while building; brings a runtime front up to PLAYING
+    gst_element_sync_state_with_parent(front);
+    return true;
+}
+
+bool PipelineBuilder::addEvidenceFront(SourceSlot* slot) {
+    // Decoded frames of this source only, before nvstreammux batches them
+    // with others (or the cpu-sim front scales them): the encoder's samples
+    // belong to slot->id at any batch size. It stays across reconnects like
+    // the cpu-sim front, so the muxer pad is kept during an outage.
+    std::string suffix = "-" + std::to_string(slot->id);
+    GstElement* tee = gst_element_factory_make("tee", ("evidence-tee" + suffix).c_str());
+    CHECK_ELEMENT(tee, "tee");
+    
+    GstElement* branch = buildEvidenceBin(slot);
+    if (!branch) {
+        gst_object_unref(tee);
+        return false;
+    }
+    
+    GstElement* front = gst_bin_new(("evidence-front" + suffix).c_str());
+    gst_bin_add_many(GST_BIN(front), tee, branch, nullptr);
+    if (!gst_element_link(tee, branch)) {
+        std::cerr << "Failed to link evidence branch " << slot->id << std::endl;
+        gst_object_unref(front);
+        return false;
+    }
+    
+    GstPad* pad = gst_element_get_static_pad(tee, "sink");
+    gst_element_add_pad(front, gst_ghost_pad_new("sink", pad));
+    gst_object_unref(pad);
+    pad = gst_element_request_pad_simple(tee, "src_%u");
+    gst_element_add_pad(front, gst_ghost_pad_new("src", pad));
+    gst_object_unref(pad);
+    
+    // The cpu-sim front has a static pad, nvstreammux a request pad per source
+    gst_bin_add(GST_BIN(pipeline_), front);
+    GstPad* target_pad = gst_element_get_static_pad(slot->target, "sink");
+    bool requested = false;
+    if (!target_pad) {
+        std::string pad_name = "sink_" + std::to_string(slot->id);
+        target_pad = gst_element_request_pad_simple(slot->target, pad_name.c_str());
+        requested = true;
+    }
+    GstPad* src_pad = gst_element_get_static_pad(front, "src");
+    bool linked = target_pad && gst_pad_link(src_pad, target_pad) == GST_PAD_LINK_OK;
+    gst_object_unref(src_pad);
+    
+    slot->evidence = front;
+    slot->evidence_pad = target_pad;
+    slot->evidence_pad_requested = requested;
+    if (!linked) {
+        std::cerr << "Failed to link evidence front " << slot->id << " to "
+                  << GST_ELEMENT_NAME(slot->target) << std::endl;
+        removeEvidenceFront(slot);
+        return false;
+    }
+    slot->target = front;
+    
+    // No-op while building; brings a runtime front up to PLAYING
+    gst_element_sync_state_with_parent(front);
+    return true;
+}
+
+void PipelineBuilder::removeEvidenceFront(SourceSlot* slot) {
+    // Its streaming threads are stopped before the recorder forgets the
+    // source, whose id the next attach may reuse
+    gst_element_set_state(slot->evidence, GST_STATE_NULL);
+    evidence_recorder_->resetSource(static_cast<int>(slot->id));
+    if (slot->evidence_pad) {
+        // The source links to what the front fed again
+        GstElement* downstream = gst_pad_get_parent_element(slot->evidence_pad);
+        if (slot->evidence_pad_requested) {
+            gst_pad_send_event(slot->evidence_pad, gst_event_new_flush_stop(FALSE));
+            gst_element_release_request_pad(downstream, slot->evidence_pad);
+        }
+        slot->target = downstream;
+        gst_object_unref(downstream);
+        gst_object_unref(slot->evidence_pad);
+        slot->evidence_pad = nullptr;
+        slot->evidence_pad_requested = false;
+    }
+    gst_bin_remove(GST_BIN(pipeline_), slot->evidence);
+    slot->evidence = nullptr;
+}
+
+void PipelineBuilder::removeSimFront(SourceSlot* slot) {
+    gst_element_set_state(slot->front, GST_STATE_NULL);
+    if (slot->front_pad) {
+        gst_element_release_request_pad(muxer_, slot->front_pad);
+        gst_object_unref(slot->front_pad);
+        slot->front_pad = nullptr;
+    }
+    gst_bin_remove(GST_BIN(pipeline_), slot->front);
+    slot->front = nullptr;
+}
+
+GstElement* PipelineBuilder::buildTracker() {
+    if (config_.tracker_type != "iou") {
+        GstElement* tracker = gst_element_factory_make("nvtracker", "tracker");
+        CHECK_ELEMENT_PTR(tracker, "nvtracker");
+        g_object_set(G_OBJECT(tracker),
+                     "ll-lib-file", "/opt/nvidia/deepstream/deepstream/lib/libnvds_nvmultiobjecttracker.so",
+                     "ll-config-file", config_.tracker_config_path.c_str(),
+                     "tracker-width", 640,
+                     "tracker-height", 384,
+                     "gpu-id", 0,
+                     nullptr);
+        return tracker;
+    }
+    
+    // Metadata-only CPU tracker: no frame access, no GPU time
+    GstElement* tracker = gst_element_factory_make("ioutracker", "tracker");
+    CHECK_ELEMENT_PTR(tracker, "ioutracker");
+    g_object_set(G_OBJECT(tracker),
+                 "matching", config_.iou_tracker_matching.c_str(),
+                 "min-iou", config_.iou_tracker_min_iou,
+                 "max-age", config_.iou_tracker_max_age_frames,
+                 nullptr);
+    std::cout << "[PipelineBuilder] Tracker: ioutracker (" << config_.iou_tracker_matching
+              << " matching)" << std::endl;
+    return tracker;
+}
+
+bool PipelineBuilder::buildSpeedCalc() {
+    // Initialize speed calculator (the single homography is the default for
+    // cameras that have no entry in the calibration directory)
+    std::shared_ptr<speedflow::ViewTransformer> transformer;
+    if (!config_.homography_config_path.empty()) {
+        HomographyConfig homo_config = ConfigLoader::loadHomographyConfig(
+            config_.homography_config_path,
+            config_.muxer_width,
+            config_.muxer_height
+        );
+        
+        transformer = std::make_shared<speedflow::ViewTransformer>(
+            homo_config.source_points,
+            homo_config.target_points
+        );
+    }
+    
+    speedflow::SpeedConfig speed_config = ConfigLoader::speedConfig(config_);
+    if (speed_config.estimator == speedflow::SpeedEstimator::SectionLine) {
+        std::cout << "[PipelineBuilder] Speed estimator: section lines" << std::endl;
+    }
+    
+    // Trajectories are only written to the event log
+    if (config_.trajectory_export) {
+        if (config_.event_log_dir.empty()) {
+            std::cout << "[PipelineBuilder] Warning: trajectory_export needs event_log_dir, "
+                      << "trajectories disabled" << std::endl;
+        } else {
+            speed_config.trajectory_enabled = true;
+            speed_config.trajectory_max_error_m = config_.trajectory_max_error_m;
+            speed_config.trajectory_max_vertices = config_.trajectory_max_vertices;
+        }
+    }
+    
+    speed_calculator_ = std::make_shared<speedflow::SpeedCalculator>(transformer, speed_config);
+    speed_calculator_->setTracer(tracer_);
+    
+    if (!config_.calibration_dir.empty()) {
+        auto load_start = std::chrono::steady_clock::now();
+        
+        auto registry = ConfigLoader::loadCalibrationDirectory(config_.calibration_dir);
+        registry->prepare(config_.muxer_width, config_.muxer_height);
+        calibration_registry_ = registry;
+        
+        auto load_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - load_start).count();
+        std::cout << "[PipelineBuilder] Calibration registry ready: "
+                  << calibration_registry_->size() << " cameras in "
+                  << load_ms << " ms" << std::endl;
+        
+        speed_calculator_->setCalibrationRegistry(calibration_registry_,
+                                                  config_.muxer_width,
+                                                  config_.muxer_height);
+    } else if (!transformer) {
+        std::cerr << "No homography_config or calibration_dir configured" << std::endl;
+        return false;
+    }
+    
+    // Create speedcalc plugin
+    speedcalc_ = gst_element_factory_make("speedcalc", "speed-calculator");
+    CHECK_ELEMENT(speedcalc_, "speedcalc");
+    
+    // Result consumers
+    if (!config_.results_output.empty()) {
+        publisher_ = std::make_shared<FrameDataPublisher>(config_.results_output, 1024,
+                                                          config_.node_id);
+        if (!publisher_->start()) {
+            std::cerr << "Failed to start result publisher: " << config_.results_output << std::endl;
+            return false;
+        }
+        result_sinks_.push_back(publisher_);
+    }
+    
+    if (!config_.shm_ring_name.empty()) {
+        shm_ring_ = std::make_shared<ShmRingWriter>(config_.shm_ring_name,
+                                                    static_cast<uint32_t>(config_.shm_ring_slots));
+        if (!shm_ring_->open()) {
+            std::cerr << "Failed to create result ring: " << config_.shm_ring_name << std::endl;
+            return false;
+        }
+        result_sinks_.push_back(shm_ring_);
+    }
+    
+    if (!config_.event_log_dir.empty()) {
+        EventLogConfig log_config;
+        log_config.dir = config_.event_log_dir;
+        log_config.fsync_interval_ms = config_.event_log_fsync_ms;
+        log_config.max_file_bytes = static_cast<size_t>(config_.event_log_max_file_mb) << 20;
+        log_config.rotate_interval_s = config_.event_log_rotate_s;
+        event_log_ = std::make_shared<EventLogWriter>(log_config);
+        if (!event_log_->start()) {
+            std::cerr << "Failed to start event log in " << config_.event_log_dir << std::endl;
+            return false;
+        }
+        result_sinks_.push_back(event_log_);
+    }
+    
+    // Restored before the first frame, saved from the streaming thread
+    if (!config_.checkpoint_path.empty()) {
+        checkpointer_ = std::make_shared<StateCheckpointer>(speed_calculator_,
+                                                            config_.checkpoint_path,
+                                                            config_.checkpoint_interval_s);
+        checkpointer_->restore();
+        checkpointer_->start();
+        result_sinks_.push_back(checkpointer_);
+    }
+    
+    if (config_.api_enabled) {
+        snapshots_ = std::make_shared<SnapshotPublisher>(config_.api_max_sources);
+        result_sinks_.push_back(snapshots_);
+    }
+    
+    // Alerts only; frames arrive from each source's evidence front (see
+    // addEvidenceFront), at any batch size
+    if (!config_.evidence_dir.empty()) {
+        EvidenceConfig evidence_config;
+        evidence_config.dir = config_.evidence_dir;
+        evidence_config.preroll_s = config_.evidence_preroll_s;
+        evidence_config.postroll_s = config_.evidence_postroll_s;
+        evidence_config.ring_bytes = static_cast<size_t>(config_.evidence_ring_mb) << 20;
+        // Pre-roll plus the GOPs it may start in, with room for short frames
+        float ring_seconds = config_.evidence_preroll_s + 2.0f * config_.evidence_keyframe_s;
+        evidence_config.max_ring_frames = std::max<size_t>(
+            64, 2 * static_cast<size_t>(std::ceil(config_.video_fps * ring_seconds)));
+        evidence_recorder_ = std::make_shared<EvidenceRecorder>(evidence_config);
+        if (!evidence_recorder_->start()) {
+            std::cerr << "Failed to start evidence recorder in " << config_.evidence_dir << std::endl;
+            return false;
+        }
+        result_sinks_.push_back(evidence_recorder_);
+    }
+    
+    // Set calculator instance
+    g_object_set(G_OBJECT(speedcalc_),
+                 "calculator", &speed_calculator_,
+                 "result-sinks", &result_sinks_,
+                 "tracer", &tracer_,
+                 "muxer-width", config_.muxer_width,
+                 "muxer-height", config_.muxer_height,
+                 nullptr);
+    if (config_.speedcalc_budget_ms > 0.0f) {
+        g_object_set(G_OBJECT(speedcalc_), "budget-ms", config_.speedcalc_budget_ms, nullptr);
+        std::cout << "[PipelineBuilder] speedcalc budget: " << config_.speedcalc_budget_ms
+                  << " ms per buffer" << std::endl;
+    }
+    if (config_.media_clock) {
+        g_object_set(G_OBJECT(speedcalc_),
+                     "media-fps", config_.video_fps,
+                     "media-epoch", static_cast<gint64>(config_.media_epoch_ns),
+                     nullptr);
+    }
+    
+    return true;
+}
+
+GstElement* PipelineBuilder::buildSourceBin(const std::string& uri, guint id) {
+    std::string name = "source-bin-" + std::to_string(id);
+    
+    // cpu-sim without a URI: synthetic frames, the pad exists from the start
+    if (config_.profile == "cpu-sim" && uri.find("://") == std::string::npos) {
+        GstElement* source = gst_element_factory_make("videotestsrc", name.c_str());
+        CHECK_ELEMENT_PTR(source, "videotestsrc");
+        g_object_set(G_OBJECT(source),
+                     "is-live", FALSE,
+                     "pattern", 2,  // black, cheapest to render
+                     nullptr);
+        std::cout << "[PipelineBuilder] Source " << id << " configured: videotestsrc" << std::endl;
+        return source;
+    }
+    
+    GstElement* source = gst_element_factory_make("uridecodebin", name.c_str());
     CHECK_ELEMENT_PTR(source, "uridecodebin");
     
     g_object_set(G_OBJECT(source), "uri", uri.c_str(), nullptr);
@@ -181,21 +656,454 @@ GstElement* PipelineBuilder::buildSourceBin(const std::string& uri) {
     
     g_signal_connect(source, "source-setup", G_CALLBACK(on_source_setup), GINT_TO_POINTER(is_live_source_));
     
-    std::cout << "[PipelineBuilder] Source configured: " << uri << std::endl;
+    std::cout << "[PipelineBuilder] Source " << id << " configured: " << uri << std::endl;
     return source;
 }
 
-GstElement* PipelineBuilder::buildSinkBin() {
-    // MJPEG HTTP Sink for headless debugging
-    // Allows viewing stream at http://<device-ip>:8080
+bool PipelineBuilder::addSource(const std::string& uri, guint id) {
+    auto slot = std::make_unique<SourceSlot>();
+    slot->builder = this;
+    slot->id = id;
+    slot->uri = uri;
+    slot->target = muxer_;
+    slot->reconnect = config_.source_reconnect && uri.find("://") != std::string::npos &&
+                      uri.find("file://") != 0;
+    
+    if (config_.profile == "cpu-sim" && !addSimFront(slot.get())) return false;
+    
+    if ((evidence_recorder_ && !addEvidenceFront(slot.get())) || !createSourceBin(slot.get())) {
+        if (slot->evidence) {
+            removeEvidenceFront(slot.get());
+        }
+        if (slot->front) {
+            removeSimFront(slot.get());
+        }
+        return false;
+    }
+    
+    if (slot->reconnect && config_.source_stall_timeout_s > 0 && !watchdog_timer_) {
+        watchdog_timer_ = g_timeout_add_seconds(1, sourceWatchdog, this);
+    }
+    sources_.push_back(std::move(slot));
+    return true;
+}
+
+bool PipelineBuilder::createSourceBin(SourceSlot* slot) {
+    GstElement* bin = buildSourceBin(slot->uri, slot->id);
+    if (!bin) return false;
+    
+    g_signal_connect(bin, "pad-added", G_CALLBACK(onPadAdded), slot);
+    gst_bin_add(GST_BIN(pipeline_), bin);
+    slot->bin = bin;
+    slot->started_us = g_get_monotonic_time();
+    
+    // videotestsrc: no pad-added, link before it starts pushing
+    GstPad* src_pad = gst_element_get_static_pad(bin, "src");
+    if (src_pad) {
+        linkSourcePad(slot, src_pad);
+        gst_object_unref(src_pad);
+    }
+    
+    // No-op while building; brings a replacement bin up to PLAYING
+    if (!gst_element_sync_state_with_parent(bin)) {
+        std::cerr << "[PipelineBuilder] Source " << slot->id << " failed to start" << std::endl;
+        removeSourceBin(slot);
+        return false;
+    }
+    return true;
+}
+
+void PipelineBuilder::removeSourceBin(SourceSlot* slot) {
+    // Stops the bin's streaming threads, so no pad-added or probe runs after this
+    gst_element_set_state(slot->bin, GST_STATE_NULL);
+    
+    if (slot->sink_pad) {
+        if (slot->sink_pad_requested) {
+            // Same sequence as the DeepStream runtime source add/delete sample
+            gst_pad_send_event(slot->sink_pad, gst_event_new_flush_stop(FALSE));
+            gst_element_release_request_pad(slot->target, slot->sink_pad);
+        }
+        gst_object_unref(slot->sink_pad);
+        slot->sink_pad = nullptr;
+        slot->sink_pad_requested = false;
+    }
+    
+    gst_bin_remove(GST_BIN(pipeline_), slot->bin);
+    slot->bin = nullptr;
+}
+
+void PipelineBuilder::removeSource(SourceSlot* slot) {
+    if (slot->retry_timer) {
+        g_source_remove(slot->retry_timer);
+        slot->retry_timer = 0;
+    }
+    
+    // Nothing may follow the EOS on the target pad
+    if (slot->bin) {
+        gst_element_set_state(slot->bin, GST_STATE_NULL);
+    }
+    endSourceStream(slot);
+    
+    if (slot->bin) {
+        removeSourceBin(slot);
+    }
+    if (slot->evidence) {
+        removeEvidenceFront(slot);
+    }
+    if (slot->front) {
+        removeSimFront(slot);
+    }
+}
+
+void PipelineBuilder::endSourceStream(SourceSlot* slot) {
+    // During an outage the muxer pad is already released: request it once
+    // more, so the stream-eos still reaches the tracker and speedcalc
+    GstPad* pad = slot->sink_pad ? GST_PAD(gst_object_ref(slot->sink_pad))
+                                 : gst_element_get_static_pad(slot->target, "sink");
+    bool requested = false;
+    if (!pad) {
+        std::string pad_name = "sink_" + std::to_string(slot->id);
+        pad = gst_element_request_pad_simple(slot->target, pad_name.c_str());
+        requested = true;
+    }
+    if (!pad) {
+        std::cerr << "[PipelineBuilder] Source " << slot->id << ": no muxer pad for its EOS" << std::endl;
+        return;
+    }
+    
+    gst_pad_send_event(pad, gst_event_new_eos());
+    if (requested) {
+        gst_pad_send_event(pad, gst_event_new_flush_stop(FALSE));
+        gst_element_release_request_pad(slot->target, pad);
+    }
+    gst_object_unref(pad);
+}
+
+void PipelineBuilder::restartSource(SourceSlot* slot, const char* reason) {
+    if (!slot->bin) return;  // Already waiting to reconnect
+    
+    removeSourceBin(slot);
+    
+    // Recovery time is measured from the first failure of an outage
+    gint64 none = 0;
+    slot->down_since_us.compare_exchange_strong(none, g_get_monotonic_time());
+    
+    std::cerr << "[PipelineBuilder] Source " << slot->id << " " << reason << std::endl;
+    scheduleReconnect(slot);
+}
+
+void PipelineBuilder::scheduleReconnect(SourceSlot* slot) {
+    // Exponential backoff: min, 2*min, 4*min, ... capped at max
+    int failures = slot->failures.fetch_add(1);
+    gint64 delay_ms = static_cast<gint64>(std::max(config_.source_reconnect_min_ms, 1))
+                      << std::min(failures, 16);
+    delay_ms = std::min<gint64>(delay_ms, std::max(config_.source_reconnect_max_ms, 1));
+    
+    std::cout << "[PipelineBuilder] Reconnecting source " << slot->id << " in "
+              << delay_ms << " ms (attempt " << failures + 1 << ")" << std::endl;
+    slot->retry_timer = g_timeout_add(static_cast<guint>(delay_ms), onReconnectTimer, slot);
+}
+
+gboolean PipelineBuilder::onReconnectTimer(gpointer data) {
+    SourceSlot* slot = static_cast<SourceSlot*>(data);
+    slot->retry_timer = 0;
+    
+    if (!slot->builder->createSourceBin(slot)) {
+        slot->builder->scheduleReconnect(slot);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+gboolean PipelineBuilder::sourceWatchdog(gpointer data) {
+    PipelineBuilder* builder = static_cast<PipelineBuilder*>(data);
+    gint64 now_us = g_get_monotonic_time();
+    gint64 timeout_us = static_cast<gint64>(builder->config_.source_stall_timeout_s * 1e6);
+    
+    for (auto& slot : builder->sources_) {
+        if (!slot->reconnect || !slot->bin) continue;
+        
+        // A bin that never produced a buffer counts from its creation
+        gint64 last_us = std::max(slot->last_buffer_us.load(std::memory_order_relaxed),
+                                  slot->started_us);
+        if (now_us - last_us > timeout_us) {
+            builder->restartSource(slot.get(), "stalled");
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+PipelineBuilder::SourceSlot* PipelineBuilder::findSource(GstObject* object) {
+    for (auto& slot : sources_) {
+        if (slot->bin && (object == GST_OBJECT(slot->bin) ||
+                          gst_object_has_as_ancestor(object, GST_OBJECT(slot->bin)))) {
+            return slot.get();
+        }
+    }
+    return nullptr;
+}
+
+std::future<SourceReply> PipelineBuilder::attachSource(const std::string& uri,
+                                                      const std::string& calibration) {
+    auto command = std::make_shared<SourceCommand>();
+    command->builder = this;
+    command->kind = SourceCommand::Kind::Attach;
+    command->uri = uri;
+    command->calibration = calibration;
+    return runSourceCommand(command);
+}
+
+std::future<SourceReply> PipelineBuilder::detachSource(int source_id) {
+    auto command = std::make_shared<SourceCommand>();
+    command->builder = this;
+    command->kind = SourceCommand::Kind::Detach;
+    command->source_id = source_id;
+    return runSourceCommand(command);
+}
+
+std::future<SourceReply> PipelineBuilder::listSources() {
+    auto command = std::make_shared<SourceCommand>();
+    command->builder = this;
+    command->kind = SourceCommand::Kind::List;
+    return runSourceCommand(command);
+}
+
+std::future<SourceReply> PipelineBuilder::runSourceCommand(const std::shared_ptr<SourceCommand>& command) {
+    // The main loop owns the topology (reconnects, bus messages); the
+    // command stays alive until it ran, even if the caller gave up on it
+    std::future<SourceReply> done = command->done.get_future();
+    g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, onSourceCommand,
+                               new std::shared_ptr<SourceCommand>(command),
+                               +[](gpointer data) {
+                                   delete static_cast<std::shared_ptr<SourceCommand>*>(data);
+                               });
+    return done;
+}
+
+gboolean PipelineBuilder::onSourceCommand(gpointer data) {
+    SourceCommand& command = **static_cast<std::shared_ptr<SourceCommand>*>(data);
+    command.builder->applySourceCommand(command);
+    command.done.set_value(std::move(command.reply));
+    return G_SOURCE_REMOVE;
+}
+
+void PipelineBuilder::applySourceCommand(SourceCommand& command) {
+    auto status = [](const SourceSlot& slot) {
+        SourceStatus source;
+        source.source_id = static_cast<int>(slot.id);
+        source.uri = slot.uri;
+        source.calibration = slot.calibration;
+        source.connected = slot.bin && slot.sink_pad;
+        return source;
+    };
+    
+    if (command.kind == SourceCommand::Kind::List) {
+        for (const auto& slot : sources_) {
+            command.reply.sources.push_back(status(*slot));
+        }
+        std::sort(command.reply.sources.begin(), command.reply.sources.end(),
+                  [](const SourceStatus& a, const SourceStatus& b) { return a.source_id < b.source_id; });
+        command.reply.result = SourceChange::Done;
+        return;
+    }
+    
+    if (command.kind == SourceCommand::Kind::Detach) {
+        auto it = std::find_if(sources_.begin(), sources_.end(), [&](const std::unique_ptr<SourceSlot>& slot) {
+            return static_cast<int>(slot->id) == command.source_id;
+        });
+        if (it == sources_.end()) {
+            command.reply.result = SourceChange::NotFound;
+            command.reply.error = "no source " + std::to_string(command.source_id);
+            return;
+        }
+        if (sources_.size() == 1) {
+            // Its EOS would be the muxer's last one and end the pipeline
+            command.reply.result = SourceChange::Rejected;
+            command.reply.error = "the last source cannot be detached";
+            return;
+        }
+        
+        removeSource(it->get());
+        sources_.erase(it);
+        command.reply.result = SourceChange::Done;
+        std::cout << "[PipelineBuilder] Source " << command.source_id << " detached" << std::endl;
+        return;
+    }
+    
+    // Lowest free id, so muxer pads and snapshot slots are reused
+    guint id = 0;
+    while (std::any_of(sources_.begin(), sources_.end(),
+                       [id](const std::unique_ptr<SourceSlot>& slot) { return slot->id == id; })) {
+        id++;
+    }
+    if (static_cast<int>(id) >= config_.api_max_sources) {
+        command.reply.result = SourceChange::Rejected;
+        command.reply.error = "source limit reached (api_max_sources " +
+                        std::to_string(config_.api_max_sources) + ")";
+        return;
+    }
+    
+    // Bound before the bin exists, so the first frame is measured with it.
+    // Without a file the calibration_dir entry of the id (if any) applies,
+    // never one bound by an earlier source under the same id.
+    try {
+        if (!command.calibration.empty()) {
+            speedflow::CameraCalibration calibration =
+                ConfigLoader::loadCameraCalibration(command.calibration);
+            calibration.source_id = static_cast<int>(id);
+            bindCalibration(id, &calibration);
+            bound_calibrations_.insert(id);
+        } else if (bound_calibrations_.erase(id)) {
+            bindCalibration(id, nullptr);
+        }
+    } catch (const std::exception& e) {
+        command.reply.result = SourceChange::Rejected;
+        command.reply.error = e.what();
+        return;
+    }
+    
+    if (config_.homography_config_path.empty() &&
+        !(calibration_registry_ && calibration_registry_->calibration(static_cast<int>(id)))) {
+        command.reply.result = SourceChange::Rejected;
+        command.reply.error = "source " + std::to_string(id) +
+                        " needs a calibration (no default homography_config)";
+        return;
+    }
+    
+    if (!addSource(command.uri, id)) {
+        command.reply.result = SourceChange::Failed;
+        command.reply.error = "failed to start source " + command.uri;
+        return;
+    }
+    sources_.back()->calibration = command.calibration;
+    
+    command.reply.sources.push_back(status(*sources_.back()));
+    command.reply.result = SourceChange::Done;
+    std::cout << "[PipelineBuilder] Source " << id << " attached: " << command.uri << std::endl;
+}
+
+void PipelineBuilder::bindCalibration(guint source_id, const speedflow::CameraCalibration* calibration) {
+    // Copy on write: speedcalc reads the current registry without locking
+    // until it adopts the new one between batches
+    auto registry = calibration_registry_
+        ? std::make_shared<speedflow::CalibrationRegistry>(*calibration_registry_)
+        : std::make_shared<speedflow::CalibrationRegistry>();
+    registry->remove(static_cast<int>(source_id));
+    if (calibration) {
+        registry->add(*calibration);
+    }
+    registry->prepare(config_.muxer_width, config_.muxer_height);
+    
+    calibration_registry_ = registry;
+    speed_calculator_->replaceCalibrationRegistry(calibration_registry_,
+                                                  config_.muxer_width,
+                                                  config_.muxer_height);
+}
+
+GstElement* PipelineBuilder::buildPreviewBin() {
+    // Preview for headless debugging, decoupled from analytics:
+    //   queue (leaky) -> valve -> videorate -> nvdsosd -> nvvideoconvert (scale)
+    //   mjpeg: -> videoconvert -> jpegenc -> multipartmux -> tcpserversink
+    //   rtp:   -> nvv4l2h264enc (or videoconvert -> x264enc) -> h264parse
+    //          -> rtph264pay -> multiudpsink
+    
+    // Keep at most one frame; older frames are dropped instead of blocking the tee
+    GstElement* queue = gst_element_factory_make("queue", "preview-queue");
+    CHECK_ELEMENT_PTR(queue, "queue");
+    g_object_set(G_OBJECT(queue),
+                 "leaky", 2,  // downstream: drop oldest
+                 "max-size-buffers", 1,
+                 "max-size-bytes", 0,
+                 "max-size-time", (guint64)0,
+                 nullptr);
+    
+    // Closed until the first client connects, so nothing is drawn or encoded
+    preview_valve_ = gst_element_factory_make("valve", "preview-valve");
+    CHECK_ELEMENT_PTR(preview_valve_, "valve");
+    g_object_set(G_OBJECT(preview_valve_), "drop", TRUE, nullptr);
+    if (g_object_class_find_property(G_OBJECT_GET_CLASS(preview_valve_), "drop-mode")) {
+        g_object_set(G_OBJECT(preview_valve_), "drop-mode", 1, nullptr);  // forward-sticky-events
+    }
+    
+    GstElement* rate = gst_element_factory_make("videorate", "preview-rate");
+    CHECK_ELEMENT_PTR(rate, "videorate");
+    g_object_set(G_OBJECT(rate), "drop-only", TRUE, nullptr);
+    if (config_.preview_fps > 0) {
+        g_object_set(G_OBJECT(rate), "max-rate", config_.preview_fps, nullptr);
+    }
+    
+    osd_ = gst_element_factory_make("nvdsosd", "onscreendisplay");
+    CHECK_ELEMENT_PTR(osd_, "nvdsosd");
+    g_object_set(G_OBJECT(osd_),
+                 "display-text", 1,
+                 "display-bbox", 1,
+                 nullptr);
     
     GstElement* conv = gst_element_factory_make("nvvideoconvert", "conv");
     CHECK_ELEMENT_PTR(conv, "nvvideoconvert");
     
+    // Downscale on the GPU before the CPU (or the encoder) sees the frame
+    GstElement* scale_caps = gst_element_factory_make("capsfilter", "preview-caps");
+    CHECK_ELEMENT_PTR(scale_caps, "capsfilter");
+    
+    std::vector<GstElement*> chain = {queue, preview_valve_, rate, osd_, conv, scale_caps};
+    GstCaps* caps = nullptr;
+    bool rtp = config_.preview_mode == "rtp";
+    preview_encoder_ = rtp ? buildRtpPreview(chain, caps) : buildMjpegPreview(chain, caps);
+    if (!preview_encoder_) {
+        if (caps) gst_caps_unref(caps);
+        return nullptr;
+    }
+    
+    int preview_width = config_.preview_width > 0 ? config_.preview_width : config_.muxer_width;
+    int preview_height = config_.preview_height > 0 ? config_.preview_height : config_.muxer_height;
+    gst_caps_set_simple(caps,
+                        "width", G_TYPE_INT, preview_width,
+                        "height", G_TYPE_INT, preview_height,
+                        nullptr);
+    g_object_set(G_OBJECT(scale_caps), "caps", caps, nullptr);
+    gst_caps_unref(caps);
+    
+    // Create bin
+    GstElement* bin = gst_bin_new("preview-bin");
+    for (GstElement* element : chain) {
+        gst_bin_add(GST_BIN(bin), element);
+    }
+    for (size_t i = 1; i < chain.size(); i++) {
+        if (!gst_element_link(chain[i - 1], chain[i])) {
+            std::cerr << "[PipelineBuilder] Failed to link preview elements" << std::endl;
+            return nullptr;
+        }
+    }
+    addTraceProbes(osd_, "osd");
+    addTraceProbes(preview_encoder_, "encode");
+    
+    // Add ghost pad
+    GstPad* pad = gst_element_get_static_pad(queue, "sink");
+    GstPad* ghost_pad = gst_ghost_pad_new("sink", pad);
+    gst_pad_set_active(ghost_pad, TRUE);
+    gst_element_add_pad(bin, ghost_pad);
+    gst_object_unref(pad);
+    
+    std::cout << "[PipelineBuilder] Preview bin created (" << (rtp ? "H.264 RTP" : "MJPEG HTTP")
+              << " mode, " << preview_width << "x" << preview_height << " @ "
+              << (config_.preview_fps > 0 ? std::to_string(config_.preview_fps) : "full")
+              << " fps)" << std::endl;
+    if (!rtp) {
+        std::cout << "[PipelineBuilder] View stream at: http://<device-ip>:"
+                  << config_.preview_port << std::endl;
+    }
+    return bin;
+}
+
+GstElement* PipelineBuilder::buildMjpegPreview(std::vector<GstElement*>& chain, GstCaps*& caps) {
+    // Every client gets the same multipart stream, but each frame is a full
+    // JPEG: simple (any browser), heavy on CPU and bandwidth
+    caps = gst_caps_new_empty_simple("video/x-raw");
+    
     // Convert to software format (I420) for jpegenc
     GstElement* sw_conv = gst_element_factory_make("videoconvert", "sw_conv");
     CHECK_ELEMENT_PTR(sw_conv, "videoconvert");
-
+    
     GstElement* jpegenc = gst_element_factory_make("jpegenc", "jpegenc");
     CHECK_ELEMENT_PTR(jpegenc, "jpegenc");
     
@@ -205,48 +1113,723 @@ GstElement* PipelineBuilder::buildSinkBin() {
     GstElement* sink = gst_element_factory_make("tcpserversink", "mjpeg-sink");
     CHECK_ELEMENT_PTR(sink, "tcpserversink");
     
-    g_object_set(G_OBJECT(sink), "host", "0.0.0.0", "port", 8080, "sync", FALSE, "qos", FALSE, nullptr);
+    g_object_set(G_OBJECT(sink), "host", "0.0.0.0", "port", config_.preview_port,
+                 "sync", FALSE, "qos", FALSE, nullptr);
     
-    // Create bin
-    GstElement* bin = gst_bin_new("sink-bin");
-    gst_bin_add_many(GST_BIN(bin), conv, sw_conv, jpegenc, multipart, sink, nullptr);
+    g_signal_connect(sink, "client-added", G_CALLBACK(onPreviewClientAdded), this);
+    g_signal_connect(sink, "client-socket-removed", G_CALLBACK(onPreviewClientRemoved), this);
     
-    if (!gst_element_link_many(conv, sw_conv, jpegenc, multipart, sink, nullptr)) {
-        std::cerr << "[PipelineBuilder] Failed to link MJPEG sink elements" << std::endl;
-        return nullptr;
+    chain.insert(chain.end(), {sw_conv, jpegenc, multipart, sink});
+    return jpegenc;
+}
+
+GstElement* PipelineBuilder::buildRtpPreview(std::vector<GstElement*>& chain, GstCaps*& caps) {
+    // One inter-frame encode, payloaded once and sent to every receiver by
+    // multiudpsink; a viewer costs a UDP send per packet, not an encode
+    int fps = config_.preview_fps > 0 ? config_.preview_fps : static_cast<int>(config_.video_fps);
+    guint key_int = std::max(1u, static_cast<guint>(std::lround(fps * config_.preview_keyframe_s)));
+    guint bitrate_kbps = static_cast<guint>(std::max(config_.preview_bitrate_kbps, 1));
+    
+    // Hardware encoder reads the NVMM surface directly, no copy to system memory
+    GstElement* encoder = gst_element_factory_make("nvv4l2h264enc", "preview-enc");
+    if (encoder) {
+        caps = gst_caps_from_string("video/x-raw(memory:NVMM), format=(string)NV12");
+        g_object_set(G_OBJECT(encoder),
+                     "bitrate", bitrate_kbps * 1000,
+                     "iframeinterval", key_int,
+                     nullptr);
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(encoder), "idrinterval")) {
+            g_object_set(G_OBJECT(encoder), "idrinterval", key_int, nullptr);
+        }
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(encoder), "insert-sps-pps")) {
+            g_object_set(G_OBJECT(encoder), "insert-sps-pps", TRUE, nullptr);
+        }
+        chain.push_back(encoder);
+    } else {
+        std::cout << "[PipelineBuilder] nvv4l2h264enc not available, "
+                  << "preview is encoded with x264enc" << std::endl;
+        caps = gst_caps_new_empty_simple("video/x-raw");
+        
+        GstElement* sw_conv = gst_element_factory_make("videoconvert", "sw_conv");
+        CHECK_ELEMENT_PTR(sw_conv, "videoconvert");
+        
+        GstElement* raw_caps = gst_element_factory_make("capsfilter", "preview-raw-caps");
+        CHECK_ELEMENT_PTR(raw_caps, "capsfilter");
+        GstCaps* i420 = gst_caps_new_simple("video/x-raw",
+                                            "format", G_TYPE_STRING, "I420",
+                                            nullptr);
+        g_object_set(G_OBJECT(raw_caps), "caps", i420, nullptr);
+        gst_caps_unref(i420);
+        
+        encoder = gst_element_factory_make("x264enc", "preview-enc");
+        CHECK_ELEMENT_PTR(encoder, "x264enc");
+        g_object_set(G_OBJECT(encoder),
+                     "tune", 0x4,           // zerolatency
+                     "speed-preset", 1,     // ultrafast
+                     "bitrate", bitrate_kbps,
+                     "key-int-max", key_int,
+                     nullptr);
+        chain.insert(chain.end(), {sw_conv, raw_caps, encoder});
+    }
+    
+    // SPS/PPS before every keyframe, so a receiver can join at any GOP
+    GstElement* parse = gst_element_factory_make("h264parse", "preview-parse");
+    CHECK_ELEMENT_PTR(parse, "h264parse");
+    g_object_set(G_OBJECT(parse), "config-interval", -1, nullptr);
+    
+    GstElement* pay = gst_element_factory_make("rtph264pay", "preview-pay");
+    CHECK_ELEMENT_PTR(pay, "rtph264pay");
+    g_object_set(G_OBJECT(pay), "pt", 96, "config-interval", -1, nullptr);
+    
+    preview_udp_ = gst_element_factory_make("multiudpsink", "preview-udp");
+    CHECK_ELEMENT_PTR(preview_udp_, "multiudpsink");
+    g_object_set(G_OBJECT(preview_udp_), "sync", FALSE, "async", FALSE, "qos", FALSE, nullptr);
+    
+    chain.insert(chain.end(), {parse, pay, preview_udp_});
+    
+    // Fixed receivers are subscribed for the lifetime of the pipeline
+    for (const std::string& client : config_.preview_rtp_clients) {
+        size_t colon = client.rfind(':');
+        int port = colon != std::string::npos ? std::atoi(client.c_str() + colon + 1) : 0;
+        std::string host = colon != std::string::npos ? client.substr(0, colon) : "";
+        if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        if (host.empty() || port <= 0 || port > 65535) {
+            std::cerr << "[PipelineBuilder] Invalid preview_rtp_clients entry: " << client << std::endl;
+            return nullptr;
+        }
+        std::string key = host + ":" + std::to_string(port);
+        if (preview_viewers_.count(key)) {
+            continue;
+        }
+        preview_viewers_[key] = {host, port, 0};
+        g_signal_emit_by_name(preview_udp_, "add", host.c_str(), port);
+        previewClientChanged(true);
+    }
+    
+    if (config_.api_preview_viewers && config_.preview_viewer_lease_s > 0) {
+        preview_lease_timer_ = g_timeout_add_seconds(1, expirePreviewViewers, this);
+    }
+    
+    std::cout << "[PipelineBuilder] RTP preview: " << bitrate_kbps << " kbps, keyframe every "
+              << key_int << " frames, " << preview_viewers_.size() << " fixed receiver(s)"
+              << std::endl;
+    return encoder;
+}
+
+GstElement* PipelineBuilder::buildEvidenceBin(SourceSlot* slot) {
+    // Encoded pre-roll of one source for overspeed clips, software encoders only:
+    //   queue (leaky) -> [nvvideoconvert ->] videoconvert -> capsfilter (I420)
+    //   -> x264enc -> h264parse (or jpegenc) -> appsink -> EvidenceRecorder
+    // Every frame is encoded so the ring always holds the last seconds
+    std::string suffix = "-" + std::to_string(slot->id);
+    
+    // A slow encoder drops frames here rather than stalling the source
+    GstElement* queue = gst_element_factory_make("queue", ("evidence-queue" + suffix).c_str());
+    CHECK_ELEMENT_PTR(queue, "queue");
+    g_object_set(G_OBJECT(queue),
+                 "leaky", 2,  // downstream: drop oldest
+                 "max-size-buffers", 4,
+                 "max-size-bytes", 0,
+                 "max-size-time", (guint64)0,
+                 nullptr);
+    
+    std::vector<GstElement*> chain = {queue};
+    
+    // Decoder NVMM surface to system memory
+    if (config_.profile != "cpu-sim") {
+        GstElement* nvconv = gst_element_factory_make("nvvideoconvert", ("evidence-nvconv" + suffix).c_str());
+        CHECK_ELEMENT_PTR(nvconv, "nvvideoconvert");
+        chain.push_back(nvconv);
     }
     
+    GstElement* conv = gst_element_factory_make("videoconvert", ("evidence-conv" + suffix).c_str());
+    CHECK_ELEMENT_PTR(conv, "videoconvert");
+    chain.push_back(conv);
+    
+    GstElement* raw_caps = gst_element_factory_make("capsfilter", ("evidence-raw-caps" + suffix).c_str());
+    CHECK_ELEMENT_PTR(raw_caps, "capsfilter");
+    GstCaps* caps = gst_caps_new_simple("video/x-raw",
+                                        "format", G_TYPE_STRING, "I420",
+                                        nullptr);
+    g_object_set(G_OBJECT(raw_caps), "caps", caps, nullptr);
+    gst_caps_unref(caps);
+    chain.push_back(raw_caps);
+    
+    GstElement* encoder = nullptr;
+    bool h264 = config_.evidence_codec == "h264";
+    if (h264) {
+        encoder = gst_element_factory_make("x264enc", ("evidence-enc" + suffix).c_str());
+        if (!encoder) {
+            std::cout << "[PipelineBuilder] Warning: x264enc not available, "
+                      << "evidence clips fall back to MJPEG" << std::endl;
+            h264 = false;
+        }
+    }
+    
+    if (h264) {
+        // No B-frames (zerolatency) so PTS = DTS in the clips; keyframes
+        // bound how far back the pre-roll starts
+        guint key_int = std::max(1u, static_cast<guint>(
+            std::lround(config_.video_fps * config_.evidence_keyframe_s)));
+        g_object_set(G_OBJECT(encoder),
+                     "tune", 0x4,           // zerolatency
+                     "speed-preset", 1,     // ultrafast
+                     "bitrate", static_cast<guint>(config_.evidence_bitrate_kbps),
+                     "key-int-max", key_int,
+                     nullptr);
+        chain.push_back(encoder);
+        
+        // SPS/PPS in front of every keyframe, so any GOP of the ring decodes alone
+        GstElement* parse = gst_element_factory_make("h264parse", ("evidence-parse" + suffix).c_str());
+        CHECK_ELEMENT_PTR(parse, "h264parse");
+        g_object_set(G_OBJECT(parse), "config-interval", -1, nullptr);
+        chain.push_back(parse);
+        
+        caps = gst_caps_new_simple("video/x-h264",
+                                   "stream-format", G_TYPE_STRING, "byte-stream",
+                                   "alignment", G_TYPE_STRING, "au",
+                                   nullptr);
+    } else {
+        encoder = gst_element_factory_make("jpegenc", ("evidence-enc" + suffix).c_str());
+        CHECK_ELEMENT_PTR(encoder, "jpegenc");
+        chain.push_back(encoder);
+        caps = gst_caps_new_empty_simple("image/jpeg");
+    }
+    
+    GstElement* sink = gst_element_factory_make("appsink", ("evidence-sink" + suffix).c_str());
+    CHECK_ELEMENT_PTR(sink, "appsink");
+    g_object_set(G_OBJECT(sink),
+                 "caps", caps,
+                 "emit-signals", TRUE,
+                 "sync", FALSE,
+                 nullptr);
+    gst_caps_unref(caps);
+    chain.push_back(sink);
+    
+    g_signal_connect(sink, "new-sample", G_CALLBACK(onEvidenceSample), slot);
+    
+    GstElement* bin = gst_bin_new(("evidence-bin" + suffix).c_str());
+    for (GstElement* element : chain) {
+        gst_bin_add(GST_BIN(bin), element);
+    }
+    for (size_t i = 1; i < chain.size(); i++) {
+        if (!gst_element_link(chain[i - 1], chain[i])) {
+            std::cerr << "[PipelineBuilder] Failed to link evidence elements" << std::endl;
+            return nullptr;
+        }
+    }
+    addTraceProbes(encoder, "evidence-encode");
+    
     // Add ghost pad
-    GstPad* pad = gst_element_get_static_pad(conv, "sink");
+    GstPad* pad = gst_element_get_static_pad(queue, "sink");
     GstPad* ghost_pad = gst_ghost_pad_new("sink", pad);
     gst_pad_set_active(ghost_pad, TRUE);
     gst_element_add_pad(bin, ghost_pad);
     gst_object_unref(pad);
     
-    std::cout << "[PipelineBuilder] Sink bin created (MJPEG HTTP mode)" << std::endl;
-    std::cout << "[PipelineBuilder] View stream at: http://<device-ip>:8080" << std::endl;
+    std::cout << "[PipelineBuilder] Evidence bin " << slot->id << " created (" << (h264 ? "H.264 " : "MJPEG ")
+              << (h264 ? std::to_string(config_.evidence_bitrate_kbps) + " kbps" : "")
+              << ")" << std::endl;
     return bin;
 }
 
+GstFlowReturn PipelineBuilder::onEvidenceSample(GstElement* sink, gpointer data) {
+    SourceSlot* slot = static_cast<SourceSlot*>(data);
+    GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(sink));
+    if (!sample) {
+        return GST_FLOW_EOS;
+    }
+    
+    slot->builder->evidence_recorder_->pushFrame(static_cast<int>(slot->id), gst_sample_get_buffer(sample),
+                                                 gst_sample_get_caps(sample));
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+void PipelineBuilder::onPreviewClientAdded(GstElement* sink, GObject* socket, gpointer data) {
+    static_cast<PipelineBuilder*>(data)->previewClientChanged(true);
+}
+
+void PipelineBuilder::onPreviewClientRemoved(GstElement* sink, GObject* socket, gpointer data) {
+    static_cast<PipelineBuilder*>(data)->previewClientChanged(false);
+}
+
+void PipelineBuilder::previewClientChanged(bool added) {
+    if (added) {
+        if (preview_clients_.fetch_add(1) == 0) {
+            std::cout << "[PipelineBuilder] Preview client connected, encoding resumed" << std::endl;
+            g_object_set(G_OBJECT(preview_valve_), "drop", FALSE, nullptr);
+        }
+    } else if (preview_clients_.fetch_sub(1) == 1) {
+        std::cout << "[PipelineBuilder] No preview clients, encoding paused" << std::endl;
+        g_object_set(G_OBJECT(preview_valve_), "drop", TRUE, nullptr);
+    }
+}
+
+bool PipelineBuilder::addPreviewViewer(const std::string& host, int port,
+                                       std::string& sdp, std::string& error) {
+    if (!preview_udp_) {
+        error = "Preview is not in rtp mode";
+        return false;
+    }
+    if (host.empty() || host.find_first_of(" \r\n") != std::string::npos ||
+        port <= 0 || port > 65535) {
+        error = "Expected a receiver host and UDP port";
+        return false;
+    }
+    
+    std::string key = host + ":" + std::to_string(port);
+    gint64 lease_end_us = config_.preview_viewer_lease_s > 0
+        ? g_get_monotonic_time() + static_cast<gint64>(config_.preview_viewer_lease_s) * G_USEC_PER_SEC
+        : 0;
+    bool added = false;
+    {
+        std::lock_guard<std::mutex> lock(preview_viewers_mutex_);
+        auto it = preview_viewers_.find(key);
+        if (it == preview_viewers_.end()) {
+            preview_viewers_[key] = {host, port, lease_end_us};
+            g_signal_emit_by_name(preview_udp_, "add", host.c_str(), port);
+            previewClientChanged(true);
+            added = true;
+        } else if (it->second.lease_end_us != 0) {
+            it->second.lease_end_us = lease_end_us;  // Renewal; fixed receivers stay fixed
+        }
+    }
+    
+    if (added) {
+        // Next frame as a keyframe, so the new receiver does not wait for the
+        // GOP. An upstream event must enter through the encoder's src pad:
+        // gst_element_send_event() would push it out of the sink pad instead
+        GstPad* encoder_src = gst_element_get_static_pad(preview_encoder_, "src");
+        if (!encoder_src ||
+            !gst_pad_send_event(encoder_src,
+                                gst_video_event_new_upstream_force_key_unit(GST_CLOCK_TIME_NONE, TRUE, 0))) {
+            std::cout << "[PipelineBuilder] Warning: encoder ignored the keyframe request for "
+                      << key << ", it starts at the next GOP" << std::endl;
+        }
+        if (encoder_src) {
+            gst_object_unref(encoder_src);
+        }
+        std::cout << "[PipelineBuilder] Preview viewer added: " << key << std::endl;
+    }
+    
+    // In-band SPS/PPS (config-interval -1), so no sprop-parameter-sets
+    bool ipv6 = host.find(':') != std::string::npos;
+    int fps = config_.preview_fps > 0 ? config_.preview_fps : static_cast<int>(config_.video_fps);
+    sdp = "v=0\r\n"
+          "o=- 0 0 IN " + std::string(ipv6 ? "IP6 ::" : "IP4 0.0.0.0") + "\r\n"
+          "s=SpeedFlow preview\r\n"
+          "c=IN " + std::string(ipv6 ? "IP6 " : "IP4 ") + host + "\r\n"
+          "t=0 0\r\n"
+          "m=video " + std::to_string(port) + " RTP/AVP 96\r\n"
+          "a=rtpmap:96 H264/90000\r\n"
+          "a=fmtp:96 packetization-mode=1\r\n"
+          "a=framerate:" + std::to_string(fps) + "\r\n"
+          "a=recvonly\r\n";
+    return true;
+}
+
+bool PipelineBuilder::removePreviewViewer(const std::string& host, int port) {
+    if (!preview_udp_) {
+        return false;
+    }
+    
+    std::string key = host + ":" + std::to_string(port);
+    std::lock_guard<std::mutex> lock(preview_viewers_mutex_);
+    auto it = preview_viewers_.find(key);
+    if (it == preview_viewers_.end() || it->second.lease_end_us == 0) {
+        return false;
+    }
+    g_signal_emit_by_name(preview_udp_, "remove", host.c_str(), port);
+    previewClientChanged(false);
+    preview_viewers_.erase(it);
+    std::cout << "[PipelineBuilder] Preview viewer removed: " << key << std::endl;
+    return true;
+}
+
+gboolean PipelineBuilder::expirePreviewViewers(gpointer data) {
+    PipelineBuilder* builder = static_cast<PipelineBuilder*>(data);
+    gint64 now_us = g_get_monotonic_time();
+    
+    // Receivers that stopped renewing (closed player, crashed dashboard)
+    std::lock_guard<std::mutex> lock(builder->preview_viewers_mutex_);
+    for (auto it = builder->preview_viewers_.begin(); it != builder->preview_viewers_.end();) {
+        const PreviewViewer& viewer = it->second;
+        if (viewer.lease_end_us == 0 || viewer.lease_end_us > now_us) {
+            ++it;
+            continue;
+        }
+        g_signal_emit_by_name(builder->preview_udp_, "remove", viewer.host.c_str(), viewer.port);
+        builder->previewClientChanged(false);
+        std::cout << "[PipelineBuilder] Preview viewer lease expired: " << it->first << std::endl;
+        it = builder->preview_viewers_.erase(it);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
 void PipelineBuilder::onPadAdded(GstElement* element, GstPad* pad, gpointer data) {
-    GstElement* muxer = static_cast<GstElement*>(data);
+    SourceSlot* slot = static_cast<SourceSlot*>(data);
     
     GstCaps* caps = gst_pad_get_current_caps(pad);
     if (!caps) return;
     
     const gchar* name = gst_structure_get_name(gst_caps_get_structure(caps, 0));
-    
     if (g_str_has_prefix(name, "video/")) {
-        GstPad* sinkpad = gst_element_request_pad_simple(muxer, "sink_0");
-        if (sinkpad && !gst_pad_is_linked(sinkpad)) {
-            if (gst_pad_link(pad, sinkpad) == GST_PAD_LINK_OK) {
-                std::cout << "[PipelineBuilder] Source pad linked to muxer" << std::endl;
+        slot->builder->linkSourcePad(slot, pad);
+    }
+    
+    gst_caps_unref(caps);
+}
+
+void PipelineBuilder::linkSourcePad(SourceSlot* slot, GstPad* pad) {
+    // Downstream is nvstreammux (request pads) or, in cpu-sim, the source's front
+    GstElement* target = slot->target;
+    if (slot->sink_pad) return;
+    
+    bool requested = false;
+    GstPad* sinkpad = gst_element_get_static_pad(target, "sink");
+    if (!sinkpad) {
+        // One muxer pad per source, released again when the source restarts
+        std::string pad_name = "sink_" + std::to_string(slot->id);
+        sinkpad = gst_element_request_pad_simple(target, pad_name.c_str());
+        requested = true;
+    }
+    if (sinkpad && !gst_pad_is_linked(sinkpad) &&
+        gst_pad_link(pad, sinkpad) == GST_PAD_LINK_OK) {
+        slot->sink_pad = sinkpad;
+        slot->sink_pad_requested = requested;
+        gst_pad_add_probe(pad,
+                          (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER |
+                                            GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                          sourceProbe, slot, nullptr);
+        std::cout << "[PipelineBuilder] Source " << slot->id << " pad linked to "
+                  << GST_ELEMENT_NAME(target) << std::endl;
+    } else if (sinkpad) {
+        if (requested) {
+            gst_element_release_request_pad(target, sinkpad);
+        }
+        gst_object_unref(sinkpad);
+    }
+}
+
+GstPadProbeReturn PipelineBuilder::sourceProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
+    // Runs on the source's streaming thread
+    SourceSlot* slot = static_cast<SourceSlot*>(data);
+    
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        if (slot->builder->tracer_) {
+            slot->builder->tracer_->instant("decoded", -1, static_cast<int>(slot->id));
+        }
+        
+        gint64 now_us = g_get_monotonic_time();
+        slot->last_buffer_us.store(now_us, std::memory_order_relaxed);
+        
+        gint64 down_since_us = slot->down_since_us.exchange(0);
+        if (down_since_us) {
+            std::cout << "[PipelineBuilder] Source " << slot->id << " recovered after "
+                      << (now_us - down_since_us) / 1000 << " ms ("
+                      << slot->failures.load() << " attempts)" << std::endl;
+            slot->failures.store(0);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+    
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (slot->reconnect && GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
+        // A live source ending is an outage: keep the EOS away from the muxer
+        // (it would end the whole batch) and restart from the main loop
+        GstObject* bin = gst_pad_get_parent(pad);
+        if (bin) {
+            gst_element_post_message(GST_ELEMENT(bin),
+                                     gst_message_new_application(
+                                         bin, gst_structure_new_empty("source-eos")));
+            gst_object_unref(bin);
+        }
+        return GST_PAD_PROBE_DROP;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+bool PipelineBuilder::linkStages(const std::vector<std::pair<std::string, GstElement*>>& stages) {
+    for (size_t i = 0; i + 1 < stages.size(); i++) {
+        const std::string& stage = stages[i].first;
+        GstElement* upstream = stages[i].second;
+        GstElement* downstream = stages[i + 1].second;
+        
+        auto it = std::find_if(config_.stage_queues.begin(), config_.stage_queues.end(),
+                               [&](const StageQueueConfig& q) { return !stage.empty() && q.after == stage; });
+        if (it == config_.stage_queues.end()) {
+            if (!gst_element_link(upstream, downstream)) {
+                return false;
             }
-            gst_object_unref(sinkpad);
+            continue;
+        }
+        
+        // Thread boundary: only the queue's buffer count limits it
+        std::string name = "queue-after-" + stage;
+        GstElement* queue = gst_element_factory_make("queue", name.c_str());
+        CHECK_ELEMENT(queue, "queue");
+        int leaky = it->leaky == "upstream" ? 1 : it->leaky == "downstream" ? 2 : 0;
+        g_object_set(G_OBJECT(queue),
+                     "max-size-buffers", it->max_size_buffers,
+                     "max-size-bytes", 0,
+                     "max-size-time", (guint64)0,
+                     "leaky", leaky,
+                     nullptr);
+        
+        gst_bin_add(GST_BIN(pipeline_), queue);
+        if (!gst_element_link_many(upstream, queue, downstream, nullptr)) {
+            return false;
+        }
+        stage_threads_.push_back({queue, *it});
+        
+        std::cout << "[PipelineBuilder] Queue after " << stage << " ("
+                  << it->max_size_buffers << " buffers, leaky " << it->leaky;
+        if (!it->thread_name.empty()) {
+            std::cout << ", thread " << it->thread_name;
         }
+        std::cout << ")" << std::endl;
     }
     
-    gst_caps_unref(caps);
+    for (const auto& queue : config_.stage_queues) {
+        bool found = std::any_of(stage_threads_.begin(), stage_threads_.end(),
+                                 [&](const StageThread& t) { return t.settings.after == queue.after; });
+        if (!found) {
+            std::cout << "[PipelineBuilder] Warning: no stage '" << queue.after
+                      << "' in this profile, queue ignored" << std::endl;
+        }
+    }
+    return true;
+}
+
+GstBusSyncReply PipelineBuilder::busSyncHandler(GstBus* bus, GstMessage* msg, gpointer data) {
+    // STREAM_STATUS ENTER is posted synchronously from the new streaming
+    // thread itself, so settings applied here affect that thread
+    if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_STREAM_STATUS) {
+        return GST_BUS_PASS;
+    }
+    
+    GstStreamStatusType type;
+    GstElement* owner;
+    gst_message_parse_stream_status(msg, &type, &owner);
+    if (type != GST_STREAM_STATUS_TYPE_ENTER) {
+        return GST_BUS_PASS;
+    }
+    
+    PipelineBuilder* builder = static_cast<PipelineBuilder*>(data);
+    for (const auto& stage : builder->stage_threads_) {
+        if (stage.queue == owner) {
+            applyThreadSettings(stage.settings);
+            break;
+        }
+    }
+    return GST_BUS_PASS;
+}
+
+void PipelineBuilder::applyThreadSettings(const StageQueueConfig& settings) {
+    // Failures (e.g. EPERM without CAP_SYS_NICE) are reported but not fatal
+    if (!settings.thread_name.empty()) {
+        pthread_setname_np(pthread_self(), settings.thread_name.substr(0, 15).c_str());
+    }
+    
+    if (!settings.cpu_affinity.empty()) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : settings.cpu_affinity) {
+            CPU_SET(cpu, &cpus);
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0) {
+            std::cerr << "[PipelineBuilder] Failed to set CPU affinity after "
+                      << settings.after << ": " << std::strerror(err) << std::endl;
+        }
+    }
+    
+    if (settings.sched_fifo_priority > 0) {
+        sched_param param{};
+        param.sched_priority = settings.sched_fifo_priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            std::cerr << "[PipelineBuilder] Failed to set SCHED_FIFO after "
+                      << settings.after << ": " << std::strerror(err) << std::endl;
+        }
+    } else if (settings.nice != 0) {
+        // Linux applies nice per thread when given a thread id
+        pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        if (setpriority(PRIO_PROCESS, tid, settings.nice) != 0) {
+            std::cerr << "[PipelineBuilder] Failed to set nice after "
+                      << settings.after << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+}
+
+void PipelineBuilder::addPerfProbe(GstElement* element) {
+    if (config_.perf_interval_s <= 0) {
+        return;
+    }
+    
+    perf_stats_.interval_us = static_cast<gint64>(config_.perf_interval_s * G_USEC_PER_SEC);
+    perf_stats_.window_start_us = 0;
+    perf_stats_.calculator = speed_calculator_.get();
+    
+    GstPad* pad = gst_element_get_static_pad(element, "sink");
+    if (!pad) {
+        std::cerr << "[PipelineBuilder] No sink pad for perf probe on "
+                  << GST_ELEMENT_NAME(element) << std::endl;
+        return;
+    }
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, perfProbe, &perf_stats_, nullptr);
+    gst_object_unref(pad);
+}
+
+void PipelineBuilder::addTraceProbes(GstElement* element, const char* name, bool span) {
+    if (!tracer_) {
+        return;
+    }
+    
+    auto probe = std::make_unique<TraceProbe>();
+    probe->tracer = tracer_.get();
+    probe->name = name;
+    probe->span = span;
+    
+    GstPad* sink_pad = span ? gst_element_get_static_pad(element, "sink") : nullptr;
+    GstPad* src_pad = gst_element_get_static_pad(element, "src");
+    if ((span && !sink_pad) || !src_pad) {
+        std::cerr << "[PipelineBuilder] No pads to trace on " << GST_ELEMENT_NAME(element) << std::endl;
+    } else {
+        if (sink_pad) {
+            gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, traceEnterProbe, probe.get(), nullptr);
+        }
+        gst_pad_add_probe(src_pad, GST_PAD_PROBE_TYPE_BUFFER, traceExitProbe, probe.get(), nullptr);
+        trace_probes_.push_back(std::move(probe));
+    }
+    
+    if (sink_pad) gst_object_unref(sink_pad);
+    if (src_pad) gst_object_unref(src_pad);
+}
+
+GstPadProbeReturn PipelineBuilder::traceEnterProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
+    TraceProbe* probe = static_cast<TraceProbe*>(data);
+    unsigned slot = probe->next.fetch_add(1, std::memory_order_relaxed) % TraceProbe::kSlots;
+    probe->enter_ns[slot].store(speedflow::TraceRecorder::nowNs(), std::memory_order_relaxed);
+    probe->buffers[slot].store(GST_PAD_PROBE_INFO_BUFFER(info), std::memory_order_release);
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn PipelineBuilder::traceExitProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
+    TraceProbe* probe = static_cast<TraceProbe*>(data);
+    GstBuffer* buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    gint64 now_ns = speedflow::TraceRecorder::nowNs();
+    
+    // First frame of the batch identifies the buffer on the timeline
+    int frame = -1, source = -1;
+    NvDsBatchMeta* batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    if (batch_meta && batch_meta->frame_meta_list) {
+        NvDsFrameMeta* frame_meta = (NvDsFrameMeta*)(batch_meta->frame_meta_list->data);
+        frame = frame_meta->frame_num;
+        source = frame_meta->source_id;
+    }
+    
+    if (!probe->span) {
+        probe->tracer->instant(probe->name.c_str(), frame, source);
+        return GST_PAD_PROBE_OK;
+    }
+    
+    // Same buffer (in-place elements, newest entry first), else the latest
+    // entry (elements that output a new buffer for each input)
+    unsigned newest = probe->next.load(std::memory_order_relaxed) - 1;
+    unsigned match = newest;
+    for (unsigned i = 0; i < TraceProbe::kSlots; i++) {
+        unsigned slot = (newest - i) % TraceProbe::kSlots;
+        if (probe->buffers[slot].load(std::memory_order_acquire) == buf) {
+            probe->buffers[slot].store(nullptr, std::memory_order_relaxed);
+            match = newest - i;
+            break;
+        }
+    }
+    gint64 enter_ns = probe->enter_ns[match % TraceProbe::kSlots].load(std::memory_order_relaxed);
+    probe->tracer->span(probe->name.c_str(), enter_ns, now_ns, match, frame, source);
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn PipelineBuilder::perfProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data) {
+    PerfStats* stats = static_cast<PerfStats*>(data);
+    GstBuffer* buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    gint64 now_us = g_get_real_time();
+    
+    if (stats->window_start_us == 0) {
+        stats->window_start_us = now_us;
+    }
+    
+    // ntp_timestamp is the system time the frame entered the batch
+    // (nvstreammux attach-sys-ts, or simdetect in cpu-sim)
+    NvDsBatchMeta* batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    if (batch_meta) {
+        for (NvDsMetaList* l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+             l_frame = l_frame->next) {
+            NvDsFrameMeta* frame_meta = (NvDsFrameMeta*)(l_frame->data);
+            stats->frames++;
+            if (frame_meta->ntp_timestamp > 0) {
+                double latency_ms = (now_us * 1000.0 - frame_meta->ntp_timestamp) / 1e6;
+                stats->latency_sum_ms += latency_ms;
+                stats->latency_max_ms = std::max(stats->latency_max_ms, latency_ms);
+                stats->latency_samples++;
+            }
+        }
+    } else {
+        stats->frames++;
+    }
+    
+    gint64 elapsed_us = now_us - stats->window_start_us;
+    if (elapsed_us >= stats->interval_us) {
+        double fps = stats->frames * 1e6 / elapsed_us;
+        std::cout << "[Perf] " << fps << " fps";
+        if (stats->latency_samples > 0) {
+            std::cout << ", latency avg " << stats->latency_sum_ms / stats->latency_samples
+                      << " ms, max " << stats->latency_max_ms << " ms";
+        }
+        
+        // What speedcalc shed in this window to stay within its budget
+        if (stats->calculator) {
+            speedflow::DegradationStats now = stats->calculator->degradationStats();
+            const speedflow::DegradationStats& last = stats->degradation;
+            uint64_t degraded = 0;
+            for (int i = 0; i < 3; i++) {
+                degraded += now.buffers[i] - last.buffers[i];
+            }
+            if (degraded > 0) {
+                std::cout << ", degraded buffers " << now.buffers[0] - last.buffers[0] << "/"
+                          << now.buffers[1] - last.buffers[1] << "/"
+                          << now.buffers[2] - last.buffers[2] << " (median/zone/defer): "
+                          << now.medians_skipped - last.medians_skipped << " medians skipped, "
+                          << now.objects_outside_zone - last.objects_outside_zone << " outside zone, "
+                          << now.tracks_deferred - last.tracks_deferred << " deferred";
+            }
+            stats->degradation = now;
+            
+            // Share of the ended tracks that got a speed
+            speedflow::TrackStats tracks = stats->calculator->trackStats();
+            uint64_t closed = tracks.closed - stats->tracks.closed;
+            if (closed > 0) {
+                std::cout << ", tracks closed " << closed << " ("
+                          << 100 * (tracks.measured - stats->tracks.measured) / closed
+                          << "% measured), " << tracks.reassociated - stats->tracks.reassociated
+                          << " re-associated";
+            }
+            stats->tracks = tracks;
+        }
+        std::cout << std::endl;
+        
+        stats->frames = 0;
+        stats->latency_sum_ms = 0.0;
+        stats->latency_max_ms = 0.0;
+        stats->latency_samples = 0;
+        stats->window_start_us = now_us;
+    }
+    
+    return GST_PAD_PROBE_OK;
 }
 
 gboolean PipelineBuilder::busCallback(GstBus* bus, GstMessage* msg, gpointer data) {
@@ -254,6 +1837,9 @@ gboolean PipelineBuilder::busCallback(GstBus* bus, GstMessage* msg, gpointer dat
     switch (GST_MESSAGE_TYPE(msg)) {
         case GST_MESSAGE_EOS:
             std::cout << "[Pipeline] End of stream" << std::endl;
+            if (builder->eos_handler_) {
+                builder->eos_handler_();
+            }
             break;
         case GST_MESSAGE_ERROR: {
             GError* err;
@@ -265,6 +1851,22 @@ gboolean PipelineBuilder::busCallback(GstBus* bus, GstMessage* msg, gpointer dat
             }
             g_error_free(err);
             g_free(debug);
+            
+            // Source failures only restart that source; stale messages from
+            // an already removed bin match no slot
+            SourceSlot* slot = builder->findSource(GST_MESSAGE_SRC(msg));
+            if (slot && slot->reconnect) {
+                builder->restartSource(slot, "failed");
+            }
+            break;
+        }
+        case GST_MESSAGE_APPLICATION: {
+            if (gst_message_has_name(msg, "source-eos")) {
+                SourceSlot* slot = builder->findSource(GST_MESSAGE_SRC(msg));
+                if (slot) {
+                    builder->restartSource(slot, "ended");
+                }
+            }
             break;
         }
         case GST_MESSAGE_WARNING: {
@@ -288,6 +1890,10 @@ bool PipelineBuilder::start() {
         return false;
     }
     
+    if ((config_.source_start_s > 0.0 || config_.source_stop_s > 0.0) && !seekWindow()) {
+        return false;
+    }
+    
     GstStateChangeReturn ret = gst_element_set_state(pipeline_, GST_STATE_PLAYING);
     if (ret == GST_STATE_CHANGE_FAILURE) {
         std::cerr << "Failed to start pipeline" << std::endl;
@@ -298,9 +1904,63 @@ bool PipelineBuilder::start() {
     return true;
 }
 
+bool PipelineBuilder::seekWindow() {
+    // Preroll (sources expose their pads), then restrict playback to the
+    // window; the metadata sink prerolls too so the wait covers the decoders
+    g_object_set(G_OBJECT(sink_), "async", TRUE, nullptr);
+    if (gst_element_set_state(pipeline_, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE ||
+        gst_element_get_state(pipeline_, nullptr, nullptr, GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE) {
+        std::cerr << "[PipelineBuilder] Failed to preroll for the window seek" << std::endl;
+        return false;
+    }
+    
+    // Decoding starts on the keyframe at or before the start, so the first
+    // frame is clean and a few more frames than asked for are analyzed
+    gint64 start = static_cast<gint64>(config_.source_start_s * GST_SECOND);
+    gint64 stop = config_.source_stop_s > 0.0
+        ? static_cast<gint64>(config_.source_stop_s * GST_SECOND)
+        : static_cast<gint64>(GST_CLOCK_TIME_NONE);
+    if (!gst_element_seek(pipeline_, 1.0, GST_FORMAT_TIME,
+                          (GstSeekFlags)(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT |
+                                         GST_SEEK_FLAG_SNAP_BEFORE),
+                          GST_SEEK_TYPE_SET, start,
+                          config_.source_stop_s > 0.0 ? GST_SEEK_TYPE_SET : GST_SEEK_TYPE_NONE, stop)) {
+        std::cerr << "[PipelineBuilder] Source does not support seeking to "
+                  << config_.source_start_s << " s" << std::endl;
+        return false;
+    }
+    gst_element_get_state(pipeline_, nullptr, nullptr, GST_CLOCK_TIME_NONE);
+    
+    std::cout << "[PipelineBuilder] Window " << config_.source_start_s << " s to "
+              << (config_.source_stop_s > 0.0 ? std::to_string(config_.source_stop_s) + " s" : "end")
+              << std::endl;
+    return true;
+}
+
 void PipelineBuilder::stop() {
     if (pipeline_) {
         gst_element_set_state(pipeline_, GST_STATE_NULL);
         std::cout << "[PipelineBuilder] Pipeline stopped" << std::endl;
     }
+    
+    if (checkpointer_) {
+        checkpointer_->stop();
+    }
+    
+    // Clips still collecting end at the last frame that went through
+    if (evidence_recorder_) {
+        evidence_recorder_->stop();
+    }
+    
+    if (tracer_) {
+        tracer_->stop();
+    }
+    
+    // Flush whatever the pipeline produced before shutting down
+    if (publisher_) {
+        publisher_->stop();
+    }
+    if (event_log_) {
+        event_log_->stop();
+    }
 }
@@ -4,10 +4,39 @@
 #include <gst/gst.h>
 #include <string>
 #include <memory>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <unordered_set>
 #include "config_loader.h"
 #include "../plugins/speed_calculator.h"
+#include "../plugins/result_sink.h"
+#include "../plugins/trace_recorder.h"
+#include "frame_publisher.h"
+#include "shm_ring_writer.h"
+#include "event_log_writer.h"
+#include "snapshot_publisher.h"
+#include "state_checkpointer.h"
+#include "evidence_recorder.h"
+#include "source_control.h"
+#include "preview_control.h"
+#include <vector>
 
-class PipelineBuilder {
+/**
+ * PipelineBuilder - Builds and runs the analytics pipeline
+ *
+ * Sources can be attached and detached while the pipeline is PLAYING
+ * (SourceControl, used by the REST API): every change runs on the GLib main
+ * loop, which owns the pipeline topology, while the other streams keep
+ * flowing through the muxer.
+ *
+ * In rtp preview mode, receivers subscribe to the one H.264 encode
+ * (PreviewControl); multiudpsink and the valve are safe to change from the
+ * calling thread, only lease expiry runs on the main loop.
+ */
+class PipelineBuilder : public SourceControl, public PreviewControl {
 public:
     PipelineBuilder(const PipelineConfig& config);
     ~PipelineBuilder();
@@ -16,30 +45,239 @@ public:
     bool start();
     void stop();
     
+    /**
+     * Called on the main loop when the whole pipeline reached end of stream
+     * (file sources, offline windows); without a handler EOS is only logged
+     */
+    void setEosHandler(std::function<void()> handler) { eos_handler_ = std::move(handler); }
+    
     GstElement* getPipeline() { return pipeline_; }
     GstElement* getOsdElement() { return osd_; }
+    std::shared_ptr<const SnapshotPublisher> getSnapshots() const { return snapshots_; }
+    
+    std::future<SourceReply> attachSource(const std::string& uri,
+                                          const std::string& calibration) override;
+    std::future<SourceReply> detachSource(int source_id) override;
+    std::future<SourceReply> listSources() override;
+    
+    bool addPreviewViewer(const std::string& host, int port,
+                          std::string& sdp, std::string& error) override;
+    bool removePreviewViewer(const std::string& host, int port) override;
     
 private:
-    GstElement* buildSourceBin(const std::string& uri);
+    // One input stream; the uridecodebin is rebuilt on failure while the
+    // rest of the pipeline keeps PLAYING
+    struct SourceSlot {
+        PipelineBuilder* builder;
+        guint id;                       // Muxer pad sink_<id>, SOURCE_ID of its frames
+        std::string uri;
+        std::string calibration;        // Calibration file bound at attach
+        GstElement* target;             // nvstreammux, or the cpu-sim front bin
+        bool reconnect;                 // Rebuild on error/EOS/stall (network URIs)
+        GstElement* bin = nullptr;      // nullptr while a reconnect is pending
+        GstElement* front = nullptr;    // cpu-sim: convert/scale/simdetect ahead of the funnel
+        GstPad* front_pad = nullptr;    // cpu-sim: funnel request pad of front (ref held)
+        GstElement* evidence = nullptr; // evidence_dir: tee + encoder ahead of the front or muxer
+        GstPad* evidence_pad = nullptr; // Pad of the element evidence feeds (ref held)
+        bool evidence_pad_requested = false;
+        GstPad* sink_pad = nullptr;     // Linked pad of target (ref held)
+        bool sink_pad_requested = false;
+        guint retry_timer = 0;
+        gint64 started_us = 0;          // When the current bin was created
+        std::atomic<int> failures{0};   // Consecutive failures, reset by the first buffer
+        std::atomic<gint64> last_buffer_us{0};
+        std::atomic<gint64> down_since_us{0};  // First failure of the current outage
+    };
+    
+    // Runtime source change, run on the main loop (see runSourceCommand)
+    struct SourceCommand {
+        enum class Kind { Attach, Detach, List };
+        PipelineBuilder* builder;
+        Kind kind;
+        std::string uri;
+        std::string calibration;
+        int source_id = -1;
+        SourceReply reply;
+        std::promise<SourceReply> done;
+    };
+    
+    GstElement* buildSourceBin(const std::string& uri, guint id);
+    bool addSource(const std::string& uri, guint id);
+    bool createSourceBin(SourceSlot* slot);
+    
+    /**
+     * Stop a source bin and unlink it from its target
+     * @param slot Source with a bin
+     */
+    void removeSourceBin(SourceSlot* slot);
+    
+    /**
+     * Tear a source down for good: EOS into its target (nvstreammux turns it
+     * into the stream-eos that closes the source's tracks downstream), then
+     * the bin, the muxer pad and the evidence and cpu-sim fronts are released
+     */
+    void removeSource(SourceSlot* slot);
+    void endSourceStream(SourceSlot* slot);
+    bool addSimFront(SourceSlot* slot);
+    void removeSimFront(SourceSlot* slot);
+    
+    /**
+     * Put a source's evidence encoder between it and its target, so clips
+     * never depend on which source a batch came from
+     * @param slot Source whose target (muxer or cpu-sim front) is set
+     */
+    bool addEvidenceFront(SourceSlot* slot);
+    void removeEvidenceFront(SourceSlot* slot);
+    void linkSourcePad(SourceSlot* slot, GstPad* pad);
+    
+    /**
+     * Hand speedcalc a registry with a source's calibration replaced
+     * @param source_id Stream source id
+     * @param calibration New calibration, or nullptr to drop the source's entry
+     */
+    void bindCalibration(guint source_id, const speedflow::CameraCalibration* calibration);
+    
+    std::future<SourceReply> runSourceCommand(const std::shared_ptr<SourceCommand>& command);
+    void applySourceCommand(SourceCommand& command);
+    static gboolean onSourceCommand(gpointer data);
+    void restartSource(SourceSlot* slot, const char* reason);
+    void scheduleReconnect(SourceSlot* slot);
+    SourceSlot* findSource(GstObject* object);
     GstElement* buildInferenceBin();
-    GstElement* buildSinkBin();
+    GstElement* buildTracker();
+    GstElement* buildPreviewBin();
+    
+    /**
+     * Encoding tail of the preview bin
+     * @param chain Elements up to the scaler capsfilter; encoder, payloader/muxer and sink are appended
+     * @param caps Caps for the scaler capsfilter (system memory, or NVMM for the hardware encoder)
+     * @return Encoder element, nullptr on failure
+     */
+    GstElement* buildMjpegPreview(std::vector<GstElement*>& chain, GstCaps*& caps);
+    GstElement* buildRtpPreview(std::vector<GstElement*>& chain, GstCaps*& caps);
+    
+    /**
+     * Count a preview client in or out; the first opens the valve, the last closes it
+     */
+    void previewClientChanged(bool added);
+    GstElement* buildEvidenceBin(SourceSlot* slot);
+    bool buildSpeedCalc();
+    bool buildCpuSim(const std::string& source_uri);
+    
+    /**
+     * Preroll and seek to [source_start_s, source_stop_s) before PLAYING
+     */
+    bool seekWindow();
+    void addPerfProbe(GstElement* element);
+    
+    /**
+     * Trace an element's buffers (no-op unless tracing)
+     * @param element Element with static sink/src pads
+     * @param name Event name
+     * @param span true: enter (sink) to exit (src) span; false: instant on exit only
+     */
+    void addTraceProbes(GstElement* element, const char* name, bool span = true);
+    
+    /**
+     * Link a chain of elements, inserting the configured stage queues
+     * @param stages (stage name, element) in stream order; "" = no queue allowed after it
+     * @return true if every link succeeded
+     */
+    bool linkStages(const std::vector<std::pair<std::string, GstElement*>>& stages);
     
     static void onPadAdded(GstElement* element, GstPad* pad, gpointer data);
+    static GstPadProbeReturn sourceProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+    static gboolean onReconnectTimer(gpointer data);
+    static gboolean sourceWatchdog(gpointer data);
     static gboolean busCallback(GstBus* bus, GstMessage* msg, gpointer data);
+    static void onPreviewClientAdded(GstElement* sink, GObject* socket, gpointer data);
+    static void onPreviewClientRemoved(GstElement* sink, GObject* socket, gpointer data);
+    static gboolean expirePreviewViewers(gpointer data);
+    static GstFlowReturn onEvidenceSample(GstElement* sink, gpointer data);
+    static GstPadProbeReturn perfProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+    static GstPadProbeReturn traceEnterProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+    static GstPadProbeReturn traceExitProbe(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+    static GstBusSyncReply busSyncHandler(GstBus* bus, GstMessage* msg, gpointer data);
+    static void applyThreadSettings(const StageQueueConfig& settings);
+    
+    // Throughput/latency counters, only touched from the sink streaming thread
+    struct PerfStats {
+        guint64 frames = 0;
+        guint64 latency_samples = 0;
+        double latency_sum_ms = 0.0;
+        double latency_max_ms = 0.0;
+        gint64 window_start_us = 0;
+        gint64 interval_us = 0;
+        const speedflow::SpeedCalculator* calculator = nullptr;  // Degradation and track counters
+        speedflow::DegradationStats degradation;                // ... at the last report
+        speedflow::TrackStats tracks;
+    };
+    
+    // Enter times of the last buffers that went into a traced element;
+    // asynchronous elements (nvinfer) exit on another thread, so the exit
+    // probe looks its buffer up instead of taking the latest entry
+    struct TraceProbe {
+        static constexpr unsigned kSlots = 16;
+        speedflow::TraceRecorder* tracer;
+        std::string name;
+        bool span;
+        std::atomic<unsigned> next{0};
+        std::atomic<GstBuffer*> buffers[kSlots] = {};
+        std::atomic<gint64> enter_ns[kSlots] = {};
+    };
+    
+    // Stage queue and the settings for the streaming thread it starts
+    struct StageThread {
+        GstElement* queue;
+        StageQueueConfig settings;
+    };
     
     PipelineConfig config_;
     GstElement* pipeline_;
-    GstElement* source_;
-    GstElement* muxer_;
+    GstElement* muxer_;       // nvstreammux, funnel in cpu-sim
     GstElement* pgie_;
-    GstElement* tracker_;
+    GstElement* tracker_;     // nvtracker or ioutracker (cpu-sim: ioutracker or none)
     GstElement* analytics_;
     GstElement* speedcalc_;  // Custom speed calculation plugin
-    GstElement* osd_;
-    GstElement* sink_;
+    GstElement* osd_;         // Inside the preview bin
+    GstElement* tee_;
+    GstElement* sink_;        // Metadata sink terminating the analytics path
+    GstElement* preview_;     // Optional MJPEG or RTP preview branch
+    GstElement* preview_valve_;
+    GstElement* preview_encoder_;
+    GstElement* preview_udp_;  // rtp: multiudpsink shared by all viewers
     
     bool is_live_source_;
+    std::atomic<int> preview_clients_;
+    PerfStats perf_stats_;
+    std::vector<StageThread> stage_threads_;  // Read by busSyncHandler
+    std::vector<std::unique_ptr<SourceSlot>> sources_;
+    std::shared_ptr<speedflow::TraceRecorder> tracer_;  // Set with trace_output
+    std::vector<std::unique_ptr<TraceProbe>> trace_probes_;
+    guint watchdog_timer_;
+    std::function<void()> eos_handler_;
+    
+    // rtp preview receivers by "host:port"
+    struct PreviewViewer {
+        std::string host;
+        int port;
+        gint64 lease_end_us;            // g_get_monotonic_time(), 0 = fixed (preview_rtp_clients)
+    };
+    std::mutex preview_viewers_mutex_;
+    std::map<std::string, PreviewViewer> preview_viewers_;
+    guint preview_lease_timer_;
     std::shared_ptr<speedflow::SpeedCalculator> speed_calculator_;
+    std::shared_ptr<const speedflow::CalibrationRegistry> calibration_registry_;
+    std::unordered_set<guint> bound_calibrations_;  // Registry entries from attachSource
+    
+    // Result consumers handed to speedcalc (see buildSpeedCalc)
+    std::vector<std::shared_ptr<speedflow::ResultSink>> result_sinks_;
+    std::shared_ptr<FrameDataPublisher> publisher_;
+    std::shared_ptr<ShmRingWriter> shm_ring_;
+    std::shared_ptr<EventLogWriter> event_log_;
+    std::shared_ptr<StateCheckpointer> checkpointer_;
+    std::shared_ptr<SnapshotPublisher> snapshots_;  // For the REST API (api_enabled)
+    std::shared_ptr<EvidenceRecorder> evidence_recorder_;  // Fed by every source's evidence front
 };
 
 #endif // PIPELINE_BUILDER_H
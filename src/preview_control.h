@@ -0,0 +1,34 @@
+#ifndef PREVIEW_CONTROL_H
+#define PREVIEW_CONTROL_H
+
+#include <string>
+
+/**
+ * PreviewControl - Subscribe receivers to the RTP preview
+ *
+ * Every viewer gets the same encoded stream, so adding one costs a UDP
+ * send per packet, not an encode. Called from API threads.
+ */
+class PreviewControl {
+public:
+    virtual ~PreviewControl() = default;
+    
+    /**
+     * Send the preview to a receiver, or renew its lease
+     * @param host Receiver IPv4/IPv6 address or host name
+     * @param port Receiver UDP port (RTP; RTCP is not sent)
+     * @param sdp Filled with the session description for the receiver
+     * @param error Reason on failure
+     * @return false if the preview is not in rtp mode or the receiver is invalid
+     */
+    virtual bool addPreviewViewer(const std::string& host, int port,
+                                  std::string& sdp, std::string& error) = 0;
+    
+    /**
+     * Stop sending to a receiver
+     * @return false if it was not subscribed through addPreviewViewer
+     */
+    virtual bool removePreviewViewer(const std::string& host, int port) = 0;
+};
+
+#endif // PREVIEW_CONTROL_H
@@ -0,0 +1,321 @@
+// shm_bench_main.cpp - speedflow_shm_bench, one ShmRingWriter and several
+// reader processes: throughput, loss and publish-to-read latency
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "shm_ring.h"
+#include "shm_ring_writer.h"
+
+struct BenchOptions {
+    std::vector<int> reader_counts = {1, 2, 4, 8};
+    uint32_t slots = 1024;
+    double rate = 1000.0;           // Frames per second, 0 = as fast as possible
+    double seconds = 5.0;           // Per reader count
+    int objects = 16;               // Per frame
+};
+
+// What one reader process sends back through its pipe
+struct ReaderResult {
+    uint64_t records;
+    uint64_t overruns;
+    uint64_t lost;
+    uint32_t latency_p50_ns;
+    uint32_t latency_p99_ns;
+    uint32_t latency_max_ns;
+};
+
+// Samples kept per reader; later records are still counted
+static constexpr size_t kMaxSamples = 1u << 20;
+
+void printUsage(const char* prog_name) {
+    std::cout << "Usage: " << prog_name << " [options]\n"
+              << "\nOptions:\n"
+              << "  --readers <n[,n...]> Reader processes per step (default: 1,2,4,8)\n"
+              << "  --slots <n>         Ring slots (default: 1024)\n"
+              << "  --rate <fps>        Frames written per second, 0 = unthrottled (default: 1000)\n"
+              << "  --seconds <s>       Duration of each step (default: 5)\n"
+              << "  --objects <n>       Objects per frame (default: 16)\n"
+              << "  --tap <name>        Instead: follow a running speedflow's ring (shm_ring_name)\n"
+              << "                      until it closes, and count frames and gaps per source\n"
+              << "  --help              Show this help message\n"
+              << "\nEvery reader polls its own cursor and yields the CPU when caught up.\n"
+              << "Latency is from the writer's timestamp to the reader's copy, CLOCK_REALTIME.\n"
+              << std::endl;
+}
+
+static int64_t realtimeNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Body of a reader process: read until the writer closes the ring
+ * @param ready_fd Gets one byte once the ring is mapped
+ * @param result_fd Gets the ReaderResult at the end
+ */
+static int runReader(const std::string& name, int ready_fd, int result_fd) {
+    speedflow::shm::ShmRingReader reader;
+    bool opened = reader.open(name);
+    char byte = opened ? 1 : 0;
+    if (write(ready_fd, &byte, 1) != 1 || !opened) {
+        return 1;
+    }
+    
+    std::vector<uint32_t> latencies;
+    latencies.reserve(kMaxSamples);
+    speedflow::shm::FrameRecord record;
+    ReaderResult result{};
+    for (;;) {
+        auto status = reader.next(record);
+        if (status == speedflow::shm::ShmRingReader::Status::Closed) {
+            break;
+        }
+        if (status == speedflow::shm::ShmRingReader::Status::Empty) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (status != speedflow::shm::ShmRingReader::Status::Ok) {
+            continue;
+        }
+        result.records++;
+        if (latencies.size() < kMaxSamples) {
+            int64_t latency = realtimeNs() - record.ntp_timestamp;
+            latencies.push_back(static_cast<uint32_t>(std::max<int64_t>(0, latency)));
+        }
+    }
+    result.overruns = reader.overruns();
+    result.lost = reader.lostRecords();
+    
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+        result.latency_p50_ns = latencies[latencies.size() / 2];
+        result.latency_p99_ns = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+        result.latency_max_ns = latencies.back();
+    }
+    return write(result_fd, &result, sizeof(result)) == sizeof(result) ? 0 : 1;
+}
+
+/**
+ * Follow the ring of a running pipeline until it closes; a source whose
+ * frame_number skips lost frames upstream of speedcalc (or to an overrun)
+ */
+static int runTap(const std::string& name) {
+    speedflow::shm::ShmRingReader reader;
+    bool opened = reader.open(name);
+    for (int i = 0; i < 300 && !opened; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        opened = reader.open(name);
+    }
+    if (!opened) {
+        std::cerr << "[Tap] " << name << " did not appear" << std::endl;
+        return 1;
+    }
+    
+    struct SourceCount {
+        uint64_t frames = 0;
+        uint64_t missing = 0;       // Frame numbers skipped
+        uint64_t restarts = 0;      // Frame numbers from 0 again (id reused by an attach)
+        int32_t last = -1;
+    };
+    std::map<int32_t, SourceCount> sources;
+    speedflow::shm::FrameRecord record;
+    for (;;) {
+        auto status = reader.next(record);
+        if (status == speedflow::shm::ShmRingReader::Status::Closed) {
+            break;
+        }
+        if (status == speedflow::shm::ShmRingReader::Status::Empty) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (status != speedflow::shm::ShmRingReader::Status::Ok) {
+            continue;
+        }
+        
+        SourceCount& source = sources[record.source_id];
+        if (source.last >= 0 && record.frame_number <= source.last) {
+            source.restarts++;
+        } else if (source.last >= 0) {
+            source.missing += static_cast<uint64_t>(record.frame_number - source.last - 1);
+        }
+        source.last = record.frame_number;
+        source.frames++;
+    }
+    
+    std::cout << "\n source     frames   missing   restarts" << std::endl;
+    uint64_t missing = 0;
+    for (const auto& entry : sources) {
+        char line[80];
+        snprintf(line, sizeof(line), "%7d %10llu %9llu %10llu", entry.first,
+                 static_cast<unsigned long long>(entry.second.frames),
+                 static_cast<unsigned long long>(entry.second.missing),
+                 static_cast<unsigned long long>(entry.second.restarts));
+        std::cout << line << std::endl;
+        missing += entry.second.missing;
+    }
+    std::cout << "\n[Tap] " << sources.size() << " sources, " << missing << " frames missing, "
+              << reader.lostRecords() << " records lost to overruns" << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    std::string tap;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--readers" && i + 1 < argc) {
+                options.reader_counts.clear();
+                std::stringstream list(argv[++i]);
+                std::string count;
+                while (std::getline(list, count, ',')) {
+                    options.reader_counts.push_back(std::max(1, std::stoi(count)));
+                }
+            } else if (arg == "--slots" && i + 1 < argc) {
+                options.slots = static_cast<uint32_t>(std::max(1, std::stoi(argv[++i])));
+            } else if (arg == "--rate" && i + 1 < argc) {
+                options.rate = std::max(0.0, std::stod(argv[++i]));
+            } else if (arg == "--seconds" && i + 1 < argc) {
+                options.seconds = std::stod(argv[++i]);
+            } else if (arg == "--objects" && i + 1 < argc) {
+                options.objects = std::max(0, std::stoi(argv[++i]));
+            } else if (arg == "--tap" && i + 1 < argc) {
+                tap = argv[++i];
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << std::endl;
+        return 1;
+    }
+    
+    if (!tap.empty()) {
+        return runTap(tap);
+    }
+    
+    const std::string name = "/speedflow_bench_" + std::to_string(getpid());
+    speedflow::FrameResult frame;
+    frame.source_id = 0;
+    frame.objects.resize(options.objects);
+    for (int i = 0; i < options.objects; i++) {
+        speedflow::ObjectResult& obj = frame.objects[i];
+        obj = speedflow::ObjectResult{};
+        obj.track_id = static_cast<uint64_t>(i + 1);
+        obj.speed_kmh = 50.0f;
+        obj.is_valid = true;
+    }
+    
+    std::cout << "[Bench] " << options.slots << " slots, " << options.objects << " objects per frame, "
+              << (options.rate > 0 ? std::to_string(static_cast<int>(options.rate)) + " frames/s"
+                                   : std::string("unthrottled"))
+              << ", " << options.seconds << " s per step\n"
+              << "\n readers   written/s    read/s per reader   lost %   p50 us   p99 us   max us"
+              << std::endl;
+    
+    for (int readers : options.reader_counts) {
+        // A new ring per step, so readers start at record 0
+        ShmRingWriter writer(name, options.slots);
+        if (!writer.open()) {
+            return 1;
+        }
+        
+        int ready_pipe[2], result_pipe[2];
+        if (pipe(ready_pipe) != 0 || pipe(result_pipe) != 0) {
+            std::cerr << "[Bench] pipe failed: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        std::vector<pid_t> children;
+        for (int r = 0; r < readers; r++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                ::close(ready_pipe[0]);
+                ::close(result_pipe[0]);
+                _exit(runReader(name, ready_pipe[1], result_pipe[1]));
+            }
+            if (pid < 0) {
+                std::cerr << "[Bench] fork failed: " << std::strerror(errno) << std::endl;
+                return 1;
+            }
+            children.push_back(pid);
+        }
+        ::close(ready_pipe[1]);
+        ::close(result_pipe[1]);
+        
+        for (int r = 0; r < readers; r++) {
+            char byte = 0;
+            if (read(ready_pipe[0], &byte, 1) != 1 || byte != 1) {
+                std::cerr << "[Bench] A reader could not open " << name << std::endl;
+                return 1;
+            }
+        }
+        
+        // Throttled writes are paced against an absolute schedule
+        auto started = std::chrono::steady_clock::now();
+        auto deadline = started + std::chrono::duration<double>(options.seconds);
+        uint64_t written = 0;
+        for (;;) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                break;
+            }
+            if (options.rate > 0) {
+                auto due = started + std::chrono::duration<double>(written / options.rate);
+                if (due > now) {
+                    std::this_thread::sleep_until(due);
+                }
+            }
+            frame.frame_number = static_cast<int>(written);
+            frame.ntp_timestamp = realtimeNs();
+            writer.onFrame(frame);
+            written++;
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        writer.close();
+        
+        uint64_t records = 0, lost = 0;
+        uint32_t p50 = 0, p99 = 0, worst = 0;
+        for (int r = 0; r < readers; r++) {
+            ReaderResult result;
+            if (read(result_pipe[0], &result, sizeof(result)) != sizeof(result)) {
+                std::cerr << "[Bench] A reader did not report" << std::endl;
+                return 1;
+            }
+            records += result.records;
+            lost += result.lost;
+            p50 = std::max(p50, result.latency_p50_ns);
+            p99 = std::max(p99, result.latency_p99_ns);
+            worst = std::max(worst, result.latency_max_ns);
+        }
+        for (pid_t pid : children) {
+            waitpid(pid, nullptr, 0);
+        }
+        ::close(ready_pipe[0]);
+        ::close(result_pipe[0]);
+        
+        // Latencies are the worst reader's
+        char line[160];
+        snprintf(line, sizeof(line), "%8d %11.0f %20.0f %8.3f %8.1f %8.1f %8.1f",
+                 readers, written / elapsed, records / elapsed / readers,
+                 written > 0 ? 100.0 * lost / (written * readers) : 0.0,
+                 p50 / 1000.0, p99 / 1000.0, worst / 1000.0);
+        std::cout << line << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "shm_ring.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace speedflow {
+namespace shm {
+
+size_t ringSize(uint32_t slot_count) {
+    return sizeof(RingHeader) + static_cast<size_t>(slot_count) * sizeof(Slot);
+}
+
+ShmRingReader::ShmRingReader()
+    : mapping_(nullptr),
+      mapping_size_(0),
+      header_(nullptr),
+      slots_(nullptr),
+      slot_count_(0),
+      cursor_(0),
+      overruns_(0),
+      lost_(0) {
+}
+
+ShmRingReader::~ShmRingReader() {
+    close();
+}
+
+bool ShmRingReader::open(const std::string& name) {
+    close();
+    
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(RingHeader)) {
+        ::close(fd);
+        return false;
+    }
+    
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    
+    const RingHeader* header = static_cast<const RingHeader*>(mapping);
+    uint32_t magic = __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE);
+    if (magic != kRingMagic || header->version != kRingVersion ||
+        header->slot_size != sizeof(Slot) ||
+        ringSize(header->slot_count) > static_cast<size_t>(st.st_size)) {
+        munmap(mapping, st.st_size);
+        return false;
+    }
+    
+    mapping_ = mapping;
+    mapping_size_ = st.st_size;
+    header_ = header;
+    slots_ = reinterpret_cast<const Slot*>(static_cast<const char*>(mapping) + sizeof(RingHeader));
+    slot_count_ = header->slot_count;
+    
+    seekToLatest();
+    return true;
+}
+
+void ShmRingReader::close() {
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        header_ = nullptr;
+        slots_ = nullptr;
+    }
+}
+
+void ShmRingReader::seekToLatest() {
+    if (header_) {
+        cursor_ = header_->write_index.load(std::memory_order_acquire);
+    }
+}
+
+ShmRingReader::Status ShmRingReader::next(FrameRecord& out) {
+    if (!header_) {
+        return Status::Closed;
+    }
+    
+    // The segment stays mapped after the writer unlinks it; only the magic
+    // tells that nothing will be written to it anymore
+    if (__atomic_load_n(&header_->magic, __ATOMIC_ACQUIRE) != kRingMagic) {
+        return Status::Closed;
+    }
+    
+    uint64_t head = header_->write_index.load(std::memory_order_acquire);
+    if (cursor_ >= head) {
+        return Status::Empty;
+    }
+    if (head - cursor_ > slot_count_) {
+        return skipOverrun(head);
+    }
+    
+    const Slot& slot = slots_[cursor_ % slot_count_];
+    uint64_t expected = 2 * cursor_ + 2;
+    
+    uint64_t seq_before = slot.seq.load(std::memory_order_acquire);
+    if (seq_before != expected) {
+        // Odd or newer: the writer is already reusing this slot
+        return skipOverrun(header_->write_index.load(std::memory_order_acquire));
+    }
+    
+    // Copy the fixed part, then only the objects in use, into staging_: a
+    // torn copy must not reach out
+    std::memcpy(&staging_, &slot.record, offsetof(FrameRecord, objects));
+    uint32_t count = staging_.num_objects <= kMaxObjects ? staging_.num_objects : kMaxObjects;
+    std::memcpy(staging_.objects, slot.record.objects, count * sizeof(ObjectRecord));
+    
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t seq_after = slot.seq.load(std::memory_order_relaxed);
+    if (seq_after != seq_before) {
+        // Overwritten while copying, the copy is torn
+        return skipOverrun(header_->write_index.load(std::memory_order_acquire));
+    }
+    
+    staging_.num_objects = count;
+    std::memcpy(&out, &staging_, offsetof(FrameRecord, objects));
+    std::memcpy(out.objects, staging_.objects, count * sizeof(ObjectRecord));
+    cursor_++;
+    return Status::Ok;
+}
+
+ShmRingReader::Status ShmRingReader::skipOverrun(uint64_t head) {
+    // Leave one slot of headroom so the next read is not immediately lapped
+    uint64_t oldest = head > slot_count_ ? head - slot_count_ + 1 : 0;
+    if (oldest > cursor_) {
+        lost_ += oldest - cursor_;
+        cursor_ = oldest;
+    } else {
+        lost_++;
+        cursor_++;
+    }
+    overruns_++;
+    return Status::Overrun;
+}
+
+} // namespace shm
+} // namespace speedflow
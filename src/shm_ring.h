@@ -0,0 +1,141 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Shared-memory result ring (single producer, many consumers)
+ *
+ * speedcalc publishes one fixed-layout FrameRecord per frame into a ring of
+ * slots in /dev/shm. Every slot carries a seqlock sequence: odd while the
+ * writer is copying, 2 * index + 2 once record `index` is complete. Readers
+ * never write to the segment, keep their own cursor, and detect being
+ * lapped by the writer (overrun) from the sequence numbers. The writer
+ * clears the header magic when it closes the ring or a new writer replaces
+ * it; readers check it on every call and report Closed.
+ *
+ * Consumers only need this header and the speedflow_shm library.
+ */
+namespace speedflow {
+namespace shm {
+
+constexpr uint32_t kRingMagic = 0x53465247;  // "SFRG"
+constexpr uint32_t kRingVersion = 1;
+constexpr uint32_t kMaxObjects = 64;         // Objects per frame record
+
+// ObjectRecord::flags
+constexpr uint32_t kFlagValid = 1u << 0;       // Speed measured on this frame
+constexpr uint32_t kFlagOverspeed = 1u << 1;
+
+struct ObjectRecord {
+    uint64_t track_id;
+    int32_t class_id;
+    float confidence;
+    float bbox_x;           // Normalized 0.0 - 1.0
+    float bbox_y;
+    float bbox_w;
+    float bbox_h;
+    float speed_kmh;        // Last valid speed, 0 if not measured yet
+    uint32_t flags;
+};
+
+struct FrameRecord {
+    uint64_t index;         // Position in the stream of records
+    int64_t ntp_timestamp;  // ns since epoch
+    int32_t source_id;
+    int32_t frame_number;
+    uint32_t num_objects;
+    uint32_t dropped_objects;  // Objects beyond kMaxObjects
+    ObjectRecord objects[kMaxObjects];
+};
+
+struct alignas(64) Slot {
+    std::atomic<uint64_t> seq;
+    FrameRecord record;
+};
+
+struct alignas(64) RingHeader {
+    uint32_t magic;             // Written last by the creator
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    std::atomic<uint64_t> write_index;  // Records published so far
+    int64_t writer_pid;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Ring sequence numbers must be lock-free to live in shared memory");
+
+/**
+ * Size of a ring segment
+ * @param slot_count Number of slots
+ * @return Bytes to map
+ */
+size_t ringSize(uint32_t slot_count);
+
+/**
+ * ShmRingReader - Consumer side of the result ring
+ *
+ * Not thread-safe; use one reader per consumer thread. Each reader starts at
+ * the newest record and advances its own cursor.
+ */
+class ShmRingReader {
+public:
+    enum class Status {
+        Ok,         // Record copied, cursor advanced
+        Empty,      // Caught up with the writer
+        Overrun,    // Reader was lapped; cursor jumped to the oldest live record
+        Closed      // Not open, or the writer closed or restarted the ring; open() it again
+    };
+    
+    ShmRingReader();
+    ~ShmRingReader();
+    
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+    
+    /**
+     * Map an existing ring read-only
+     * @param name POSIX shm name, e.g. "/speedflow_results"
+     * @return false if the ring does not exist or has an incompatible layout
+     */
+    bool open(const std::string& name);
+    void close();
+    
+    /**
+     * Copy the record at the cursor
+     * @param out Destination record
+     * @return Ok, Empty, Overrun or Closed (out is untouched unless Ok)
+     */
+    Status next(FrameRecord& out);
+    
+    /** Skip to the newest record */
+    void seekToLatest();
+    
+    uint64_t cursor() const { return cursor_; }
+    uint64_t overruns() const { return overruns_; }
+    uint64_t lostRecords() const { return lost_; }
+
+private:
+    void* mapping_;
+    size_t mapping_size_;
+    const RingHeader* header_;
+    const Slot* slots_;
+    uint32_t slot_count_;
+    
+    uint64_t cursor_;
+    uint64_t overruns_;
+    uint64_t lost_;
+    
+    FrameRecord staging_;       // Copy checked for tearing before it goes to next()'s out
+    
+    Status skipOverrun(uint64_t head);
+};
+
+} // namespace shm
+} // namespace speedflow
+
+#endif // SHM_RING_H
@@ -0,0 +1,154 @@
+#include "shm_ring_writer.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using speedflow::shm::FrameRecord;
+using speedflow::shm::ObjectRecord;
+using speedflow::shm::RingHeader;
+using speedflow::shm::Slot;
+
+ShmRingWriter::ShmRingWriter(const std::string& name, uint32_t slot_count)
+    : name_(name),
+      slot_count_(slot_count),
+      mapping_(nullptr),
+      mapping_size_(0),
+      header_(nullptr),
+      slots_(nullptr),
+      next_index_(0) {
+}
+
+ShmRingWriter::~ShmRingWriter() {
+    close();
+}
+
+bool ShmRingWriter::open() {
+    if (slot_count_ == 0) {
+        std::cerr << "[ShmRingWriter] Ring needs at least one slot" << std::endl;
+        return false;
+    }
+    
+    // Start from a fresh segment. Readers keep their mapping of the old one
+    // after the unlink, so clear its magic first (a previous run that
+    // crashed did not): they see Status::Closed and reopen by name
+    invalidate(name_);
+    shm_unlink(name_.c_str());
+    
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "[ShmRingWriter] shm_open(" << name_ << ") failed: "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    size_t size = speedflow::shm::ringSize(slot_count_);
+    if (ftruncate(fd, size) != 0) {
+        std::cerr << "[ShmRingWriter] ftruncate failed: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "[ShmRingWriter] mmap failed: " << std::strerror(errno) << std::endl;
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    
+    // ftruncate zero-fills, so every slot starts at seq 0 ("never written")
+    mapping_ = mapping;
+    mapping_size_ = size;
+    header_ = static_cast<RingHeader*>(mapping);
+    slots_ = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(RingHeader));
+    
+    header_->version = speedflow::shm::kRingVersion;
+    header_->slot_count = slot_count_;
+    header_->slot_size = sizeof(Slot);
+    header_->write_index.store(0, std::memory_order_relaxed);
+    header_->writer_pid = getpid();
+    __atomic_store_n(&header_->magic, speedflow::shm::kRingMagic, __ATOMIC_RELEASE);
+    
+    next_index_ = 0;
+    
+    std::cout << "[ShmRingWriter] Publishing results to /dev/shm" << name_ << " ("
+              << slot_count_ << " slots, " << size / 1024 << " KiB)" << std::endl;
+    return true;
+}
+
+void ShmRingWriter::close() {
+    if (mapping_) {
+        // Readers check the magic on every poll; the unlinked segment stays
+        // mapped in their processes and would otherwise look live forever
+        __atomic_store_n(&header_->magic, 0u, __ATOMIC_RELEASE);
+        munmap(mapping_, mapping_size_);
+        shm_unlink(name_.c_str());
+        mapping_ = nullptr;
+        header_ = nullptr;
+        slots_ = nullptr;
+    }
+}
+
+void ShmRingWriter::invalidate(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(RingHeader)) {
+        void* mapping = mmap(nullptr, sizeof(RingHeader), PROT_READ | PROT_WRITE,
+                             MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            __atomic_store_n(&static_cast<RingHeader*>(mapping)->magic, 0u, __ATOMIC_RELEASE);
+            munmap(mapping, sizeof(RingHeader));
+        }
+    }
+    ::close(fd);
+}
+
+void ShmRingWriter::onFrame(const speedflow::FrameResult& frame) {
+    if (!header_) {
+        return;
+    }
+    
+    uint64_t index = next_index_++;
+    Slot& slot = slots_[index % slot_count_];
+    
+    // Seqlock write: odd while copying, 2 * index + 2 when complete
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    FrameRecord& record = slot.record;
+    record.index = index;
+    record.ntp_timestamp = frame.ntp_timestamp;
+    record.source_id = frame.source_id;
+    record.frame_number = frame.frame_number;
+    
+    uint32_t count = 0;
+    for (const auto& obj : frame.objects) {
+        if (count == speedflow::shm::kMaxObjects) {
+            break;
+        }
+        ObjectRecord& out = record.objects[count++];
+        out.track_id = obj.track_id;
+        out.class_id = obj.class_id;
+        out.confidence = obj.confidence;
+        out.bbox_x = obj.bbox_x;
+        out.bbox_y = obj.bbox_y;
+        out.bbox_w = obj.bbox_w;
+        out.bbox_h = obj.bbox_h;
+        out.speed_kmh = obj.speed_kmh;
+        out.flags = (obj.is_valid ? speedflow::shm::kFlagValid : 0u) |
+                    (obj.is_overspeeding ? speedflow::shm::kFlagOverspeed : 0u);
+    }
+    record.num_objects = count;
+    record.dropped_objects = static_cast<uint32_t>(frame.objects.size() - count);
+    
+    slot.seq.store(2 * index + 2, std::memory_order_release);
+    header_->write_index.store(index + 1, std::memory_order_release);
+}
@@ -0,0 +1,50 @@
+#ifndef SHM_RING_WRITER_H
+#define SHM_RING_WRITER_H
+
+#include <string>
+#include "shm_ring.h"
+#include "../plugins/result_sink.h"
+
+/**
+ * ShmRingWriter - Producer side of the shared-memory result ring
+ *
+ * A ResultSink that copies every frame straight into the next ring slot on
+ * the streaming thread: no serialization, no queue, no syscalls. There must
+ * be exactly one writer per ring name.
+ */
+class ShmRingWriter : public speedflow::ResultSink {
+public:
+    /**
+     * @param name POSIX shm name, e.g. "/speedflow_results"
+     * @param slot_count Number of frame records kept in the ring
+     */
+    ShmRingWriter(const std::string& name, uint32_t slot_count);
+    ~ShmRingWriter() override;
+    
+    /**
+     * Create (or recreate) and map the segment
+     * @return false if the segment could not be created
+     */
+    bool open();
+    void close();
+    
+    void onFrame(const speedflow::FrameResult& frame) override;
+
+private:
+    std::string name_;
+    uint32_t slot_count_;
+    
+    /**
+     * Clear the magic of an existing segment, so its readers reopen
+     * @param name POSIX shm name
+     */
+    static void invalidate(const std::string& name);
+    
+    void* mapping_;
+    size_t mapping_size_;
+    speedflow::shm::RingHeader* header_;
+    speedflow::shm::Slot* slots_;
+    uint64_t next_index_;
+};
+
+#endif // SHM_RING_WRITER_H
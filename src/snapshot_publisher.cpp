@@ -0,0 +1,87 @@
+#include "snapshot_publisher.h"
+#include <algorithm>
+
+SnapshotPublisher::SnapshotPublisher(int max_sources)
+    : slots_(static_cast<size_t>(std::max(1, max_sources))),
+      sequence_(0) {
+    for (auto& slot : slots_) {
+        for (auto& snapshot : slot.pool) {
+            snapshot = std::make_shared<SourceSnapshot>();
+        }
+    }
+}
+
+void SnapshotPublisher::onFrame(const speedflow::FrameResult& frame) {
+    if (frame.source_id < 0 || frame.source_id >= static_cast<int>(slots_.size())) {
+        return;
+    }
+    Slot& slot = slots_[frame.source_id];
+    
+    // A pooled snapshot referenced only by the pool is neither published nor
+    // held by a reader, and no reader can reach it any more
+    std::shared_ptr<SourceSnapshot> snapshot;
+    for (auto& candidate : slot.pool) {
+        if (candidate.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            snapshot = candidate;
+            break;
+        }
+    }
+    if (!snapshot) {
+        snapshot = std::make_shared<SourceSnapshot>();
+    }
+    
+    snapshot->frame.source_id = frame.source_id;
+    snapshot->frame.frame_number = frame.frame_number;
+    snapshot->frame.ntp_timestamp = frame.ntp_timestamp;
+    snapshot->frame.objects.assign(frame.objects.begin(), frame.objects.end());
+    
+    int measured = 0;
+    float speed_sum = 0.0f;
+    snapshot->overspeed_count = 0;
+    for (const auto& obj : frame.objects) {
+        if (obj.speed_kmh > 0.0f) {
+            measured++;
+            speed_sum += obj.speed_kmh;
+        }
+        if (obj.is_overspeeding) {
+            snapshot->overspeed_count++;
+        }
+    }
+    snapshot->vehicle_count = static_cast<int>(frame.objects.size());
+    snapshot->mean_speed_kmh = measured > 0 ? speed_sum / measured : 0.0f;
+    
+    std::atomic_store_explicit(&slot.current,
+                               std::shared_ptr<const SourceSnapshot>(std::move(snapshot)),
+                               std::memory_order_release);
+    sequence_.fetch_add(1, std::memory_order_release);
+}
+
+void SnapshotPublisher::onSourceRemoved(int source_id) {
+    if (source_id < 0 || source_id >= static_cast<int>(slots_.size())) {
+        return;
+    }
+    
+    // Readers holding the last snapshot keep it; the pool recycles it after
+    std::atomic_store_explicit(&slots_[source_id].current,
+                               std::shared_ptr<const SourceSnapshot>(),
+                               std::memory_order_release);
+    sequence_.fetch_add(1, std::memory_order_release);
+}
+
+std::shared_ptr<const SourceSnapshot> SnapshotPublisher::latest(int source_id) const {
+    if (source_id < 0 || source_id >= static_cast<int>(slots_.size())) {
+        return nullptr;
+    }
+    return std::atomic_load_explicit(&slots_[source_id].current, std::memory_order_acquire);
+}
+
+void SnapshotPublisher::latestAll(std::vector<std::shared_ptr<const SourceSnapshot>>& out) const {
+    out.clear();
+    for (const auto& slot : slots_) {
+        auto snapshot = std::atomic_load_explicit(&slot.current, std::memory_order_acquire);
+        if (snapshot) {
+            out.push_back(std::move(snapshot));
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SNAPSHOT_PUBLISHER_H
+#define SNAPSHOT_PUBLISHER_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "../plugins/result_sink.h"
+
+/**
+ * Immutable view of one source at one frame
+ */
+struct SourceSnapshot {
+    speedflow::FrameResult frame;
+    int vehicle_count = 0;
+    float mean_speed_kmh = 0.0f;    // Over vehicles with a measured speed
+    int overspeed_count = 0;
+};
+
+/**
+ * SnapshotPublisher - Latest-frame snapshot per source for API readers
+ *
+ * onFrame() fills a snapshot the readers cannot see yet and publishes it
+ * with one atomic shared_ptr store (RCU style). Readers take a reference with
+ * an atomic load and keep a consistent view for as long as they hold it, so
+ * any number of API threads never contend with the streaming thread.
+ *
+ * Snapshots are recycled from a small per-source pool once no reader holds
+ * them any more; only when readers pin every pooled buffer is a fresh one
+ * allocated.
+ */
+class SnapshotPublisher : public speedflow::ResultSink {
+public:
+    /**
+     * @param max_sources Sources with ids >= max_sources are ignored
+     */
+    explicit SnapshotPublisher(int max_sources = 16);
+    
+    void onFrame(const speedflow::FrameResult& frame) override;
+    
+    /** Unpublish the source's snapshot, so readers stop seeing a detached camera */
+    void onSourceRemoved(int source_id) override;
+    
+    /**
+     * Latest snapshot of a source
+     * @param source_id Stream source id
+     * @return Snapshot, or nullptr if the source has not produced a frame
+     */
+    std::shared_ptr<const SourceSnapshot> latest(int source_id) const;
+    
+    /**
+     * Latest snapshots of all sources that have produced a frame
+     * @param out Replaced with the snapshots, ordered by source id
+     */
+    void latestAll(std::vector<std::shared_ptr<const SourceSnapshot>>& out) const;
+    
+    /**
+     * Frames published so far over all sources; changes with every snapshot
+     */
+    uint64_t sequence() const { return sequence_.load(std::memory_order_acquire); }
+    
+    int maxSources() const { return static_cast<int>(slots_.size()); }
+
+private:
+    static constexpr size_t kPoolSize = 3;  // Published + being written + spare
+    
+    struct Slot {
+        std::shared_ptr<const SourceSnapshot> current;    // atomic_load/atomic_store only
+        std::shared_ptr<SourceSnapshot> pool[kPoolSize];  // Streaming thread only
+    };
+    
+    std::vector<Slot> slots_;
+    std::atomic<uint64_t> sequence_;
+};
+
+#endif // SNAPSHOT_PUBLISHER_H
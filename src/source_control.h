@@ -0,0 +1,67 @@
+#ifndef SOURCE_CONTROL_H
+#define SOURCE_CONTROL_H
+
+#include <future>
+#include <string>
+#include <vector>
+
+/**
+ * One input stream, as listed by the source API
+ */
+struct SourceStatus {
+    int source_id = 0;
+    std::string uri;
+    std::string calibration;        // File bound at attach (empty = registry or default)
+    bool connected = false;         // Linked to the muxer (false while reconnecting)
+};
+
+/**
+ * Outcome of a runtime source change
+ */
+enum class SourceChange {
+    Done,
+    NotFound,       // No source with that id
+    Rejected,       // Not allowed now (limit, last source, bad calibration)
+    Failed,         // The pipeline could not apply it
+    Timeout         // The main loop did not answer in time
+};
+
+/**
+ * Reply to a runtime source change
+ */
+struct SourceReply {
+    SourceChange result = SourceChange::Failed;
+    std::string error;                  // Reason on failure
+    std::vector<SourceStatus> sources;  // Attach: the new source; List: every source, ordered by id
+};
+
+/**
+ * SourceControl - Attach and detach input streams of a running pipeline
+ *
+ * Called from API threads without blocking them: implementations apply the
+ * change on their own thread and make the returned future ready once it is
+ * done. A caller that stops waiting (Timeout) does not cancel the change.
+ */
+class SourceControl {
+public:
+    virtual ~SourceControl() = default;
+    
+    /**
+     * Start a new stream under the lowest free source id
+     * @param uri Stream URI (rtsp://, file://, ...)
+     * @param calibration Calibration file for the stream, empty = default homography
+     */
+    virtual std::future<SourceReply> attachSource(const std::string& uri,
+                                                  const std::string& calibration) = 0;
+    
+    /**
+     * Stop a stream; downstream closes its tracks, the id becomes free
+     * @param source_id Stream source id
+     */
+    virtual std::future<SourceReply> detachSource(int source_id) = 0;
+    
+    /** Current streams */
+    virtual std::future<SourceReply> listSources() = 0;
+};
+
+#endif // SOURCE_CONTROL_H
@@ -0,0 +1,364 @@
+#include "speed_service.h"
+#include "speedflow.pb.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+SpeedService::SpeedService(const SpeedServiceConfig& config,
+                           const speedflow::SpeedConfig& speed_config,
+                           std::shared_ptr<speedflow::ViewTransformer> transformer,
+                           std::shared_ptr<const speedflow::CalibrationRegistry> registry)
+    : config_(config),
+      speed_config_(speed_config),
+      transformer_(std::move(transformer)),
+      registry_(std::move(registry)),
+      alert_bucket_(std::make_shared<speedflow::AlertTokenBucket>(speed_config.alert_rate_per_s,
+                                                                  speed_config.alert_burst)),
+      listen_fd_(-1),
+      running_(false) {
+    if (config_.io_threads <= 0) {
+        config_.io_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    // Results only go back to the client
+    speed_config_.trajectory_enabled = false;
+}
+
+SpeedService::~SpeedService() {
+    stop();
+}
+
+bool SpeedService::start() {
+    if (running_) {
+        return true;
+    }
+    
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (config_.socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[SpeedService] Socket path too long: " << config_.socket_path << std::endl;
+        return false;
+    }
+    std::strncpy(addr.sun_path, config_.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    
+    // A socket left behind by a previous run would make bind fail
+    struct stat st;
+    if (stat(config_.socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(config_.socket_path.c_str());
+    }
+    
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, SOMAXCONN) != 0) {
+        std::cerr << "[SpeedService] Cannot listen on " << config_.socket_path << ": "
+                  << std::strerror(errno) << std::endl;
+        if (listen_fd_ >= 0) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+        }
+        return false;
+    }
+    
+    // Every loop waits on the one listening socket; EPOLLEXCLUSIVE wakes
+    // only one of them per new client
+    for (int i = 0; i < config_.io_threads; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->index = i;
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = listen_fd_;
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, listen_fd_, &ev);
+        workers_.push_back(std::move(worker));
+    }
+    
+    running_ = true;
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&SpeedService::runWorker, this, std::ref(*worker));
+    }
+    
+    std::cout << "[SpeedService] Listening on " << config_.socket_path << " with "
+              << config_.io_threads << " connection threads" << std::endl;
+    return true;
+}
+
+void SpeedService::stop() {
+    if (!running_) {
+        return;
+    }
+    
+    running_ = false;
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    workers_.clear();
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(config_.socket_path.c_str());
+    
+    std::cout << "[SpeedService] Stopped" << std::endl;
+}
+
+void SpeedService::stats(SpeedServiceStats& out) const {
+    out = SpeedServiceStats();
+    for (const auto& worker : workers_) {
+        out.clients += worker->clients.load(std::memory_order_relaxed);
+        out.requests += worker->requests.load(std::memory_order_relaxed);
+        out.frames += worker->frames.load(std::memory_order_relaxed);
+        out.objects += worker->objects.load(std::memory_order_relaxed);
+        out.alerts += worker->alerts.load(std::memory_order_relaxed);
+        out.rejected += worker->rejected.load(std::memory_order_relaxed);
+    }
+}
+
+void SpeedService::runWorker(Worker& worker) {
+    epoll_event events[64];
+    
+    while (running_) {
+        int n = epoll_wait(worker.epoll_fd, events, 64, 100);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                acceptConnection(worker);
+                continue;
+            }
+            
+            auto it = worker.connections.find(fd);
+            if (it == worker.connections.end()) {
+                continue;
+            }
+            Connection& conn = it->second;
+            
+            // Hung up while no longer read: nobody will take the responses
+            bool open = !(events[i].events & (EPOLLHUP | EPOLLERR)) &&
+                        !((events[i].events & EPOLLRDHUP) && !(conn.events & EPOLLIN));
+            if (open && (events[i].events & EPOLLIN)) {
+                open = readConnection(worker, conn);
+            }
+            if (open && conn.sent < conn.output.size()) {
+                open = flush(conn);
+            }
+            if (open) {
+                updateEvents(worker, conn);
+            } else {
+                flush(conn);    // A client that shut down its side still gets what fits
+                closeConnection(worker, fd);
+            }
+        }
+    }
+    
+    while (!worker.connections.empty()) {
+        closeConnection(worker, worker.connections.begin()->first);
+    }
+    close(worker.epoll_fd);
+}
+
+void SpeedService::acceptConnection(Worker& worker) {
+    // One per wake-up: a client still waiting wakes the next loop, which
+    // spreads a burst of connections over the loops
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    
+    Connection& conn = worker.connections[fd];
+    conn.fd = fd;
+    conn.events = EPOLLIN | EPOLLRDHUP;
+    epoll_event ev{};
+    ev.events = conn.events;
+    ev.data.fd = fd;
+    epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    worker.clients++;
+}
+
+bool SpeedService::readConnection(Worker& worker, Connection& conn) {
+    // Fill the buffer up to the read budget, then answer what is complete
+    bool open = conn.input.fill(conn.fd);
+    
+    speedflow::SpeedRequest request;
+    speedflow::SpeedResponse response;
+    const uint8_t* data;
+    uint32_t length;
+    while (true) {
+        DelimitedReader::Status status = conn.input.next(config_.max_request_bytes, data, length);
+        if (status == DelimitedReader::Status::Incomplete) {
+            break;
+        }
+        if (status == DelimitedReader::Status::Corrupt) {
+            std::cerr << "[SpeedService] Corrupt length prefix, closing client" << std::endl;
+            return false;
+        }
+        if (status == DelimitedReader::Status::TooLarge) {
+            std::cerr << "[SpeedService] Request of " << length
+                      << " bytes exceeds the limit, closing client" << std::endl;
+            return false;
+        }
+        if (!request.ParseFromArray(data, static_cast<int>(length))) {
+            std::cerr << "[SpeedService] Malformed request, closing client" << std::endl;
+            return false;
+        }
+        
+        handleRequest(worker, conn, request, response);
+        appendDelimited(response, conn.output);
+    }
+    return open;
+}
+
+void SpeedService::handleRequest(Worker& worker, Connection& conn,
+                                 const speedflow::SpeedRequest& request,
+                                 speedflow::SpeedResponse& response) {
+    response.Clear();
+    response.set_request_id(request.request_id());
+    worker.requests.fetch_add(1, std::memory_order_relaxed);
+    
+    // Check the whole batch first, so a rejected request changes no state
+    std::vector<std::pair<int, int>> last_frames;   // (source, frame) within this request
+    size_t new_streams = 0;
+    for (const speedflow::FrameData& frame : request.frames()) {
+        auto seen = std::find_if(last_frames.begin(), last_frames.end(),
+                                 [&](const std::pair<int, int>& s) { return s.first == frame.source_id(); });
+        if (seen == last_frames.end()) {
+            auto it = conn.streams.find(frame.source_id());
+            if (it == conn.streams.end()) {
+                new_streams++;
+            }
+            last_frames.emplace_back(frame.source_id(),
+                                     it != conn.streams.end() ? it->second.last_frame : INT_MIN);
+            seen = last_frames.end() - 1;
+        }
+        if (frame.frame_number() <= seen->second) {
+            response.set_error("source " + std::to_string(frame.source_id()) + ": frame_number " +
+                               std::to_string(frame.frame_number()) + " does not follow " +
+                               std::to_string(seen->second));
+            break;
+        }
+        seen->second = frame.frame_number();
+    }
+    if (response.error().empty() &&
+        conn.streams.size() + new_streams > static_cast<size_t>(config_.max_streams_per_client)) {
+        response.set_error("more than " + std::to_string(config_.max_streams_per_client) +
+                           " sources on one connection");
+    }
+    if (!response.error().empty()) {
+        worker.rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    const float width = static_cast<float>(config_.muxer_width);
+    const float height = static_cast<float>(config_.muxer_height);
+    uint64_t objects = 0;
+    uint64_t alerts = 0;
+    
+    for (const speedflow::FrameData& frame : request.frames()) {
+        const int source_id = frame.source_id();
+        Stream& stream = conn.streams[source_id];
+        if (!stream.calculator) {
+            stream.calculator = std::make_unique<speedflow::SpeedCalculator>(transformer_, speed_config_);
+            if (registry_) {
+                stream.calculator->setCalibrationRegistry(registry_, config_.muxer_width,
+                                                          config_.muxer_height);
+            }
+            stream.calculator->setAlertTokenBucket(alert_bucket_);
+        }
+        stream.last_frame = frame.frame_number();
+        speedflow::SpeedCalculator& calculator = *stream.calculator;
+        
+        // Same per-object steps as speedcalc, on the muxer-sized bbox
+        speedflow::FrameData* result = response.add_frames();
+        *result = frame;
+        for (speedflow::ObjectInfo& obj : *result->mutable_objects()) {
+            float left = obj.bbox_x() * width;
+            float top = obj.bbox_y() * height;
+            float box_w = obj.bbox_w() * width;
+            float box_h = obj.bbox_h() * height;
+            float cx = left + box_w / 2.0f;
+            float bottom_y = top + box_h;
+            
+            speedflow::SpeedMeasurement measurement = {};
+            if (obj.track_id() >= 0 &&
+                calculator.acceptsObject(obj.class_id(), cx, bottom_y, source_id)) {
+                measurement = calculator.processObject(obj.track_id(), cx, bottom_y, box_w * box_h,
+                                                       obj.confidence(), frame.frame_number(),
+                                                       source_id);
+            }
+            obj.set_speed_kmh(measurement.is_valid ? measurement.speed_kmh
+                                                   : calculator.getLastSpeed(obj.track_id()));
+            obj.set_is_overspeeding(measurement.is_overspeeding);
+            
+            if (measurement.alert) {
+                speedflow::OverspeedAlert* alert = response.add_alerts();
+                alert->set_ntp_timestamp(frame.ntp_timestamp());
+                alert->set_source_id(source_id);
+                alert->set_track_id(obj.track_id());
+                alert->set_speed_kmh(measurement.peak_speed_kmh);
+                alerts++;
+            }
+        }
+        objects += result->objects_size();
+        
+        calculator.endFrame(source_id, frame.frame_number());
+    }
+    
+    worker.frames.fetch_add(request.frames_size(), std::memory_order_relaxed);
+    worker.objects.fetch_add(objects, std::memory_order_relaxed);
+    worker.alerts.fetch_add(alerts, std::memory_order_relaxed);
+}
+
+bool SpeedService::flush(Connection& conn) {
+    while (conn.sent < conn.output.size()) {
+        ssize_t n = send(conn.fd, conn.output.data() + conn.sent, conn.output.size() - conn.sent,
+                         MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    conn.output.clear();
+    conn.sent = 0;
+    return true;
+}
+
+void SpeedService::updateEvents(Worker& worker, Connection& conn) {
+    // Stop reading a client that does not take its responses
+    size_t pending = conn.output.size() - conn.sent;
+    uint32_t events = EPOLLRDHUP;
+    if (pending < config_.max_pending_output) {
+        events |= EPOLLIN;
+    }
+    if (pending > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events == conn.events) {
+        return;
+    }
+    
+    conn.events = events;
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = conn.fd;
+    epoll_ctl(worker.epoll_fd, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+void SpeedService::closeConnection(Worker& worker, int fd) {
+    auto it = worker.connections.find(fd);
+    if (it == worker.connections.end()) {
+        return;
+    }
+    
+    epoll_ctl(worker.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    worker.connections.erase(it);
+    worker.clients--;
+}
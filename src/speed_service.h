@@ -0,0 +1,139 @@
+#ifndef SPEED_SERVICE_H
+#define SPEED_SERVICE_H
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "delimited_stream.h"
+#include "../plugins/speed_calculator.h"
+
+namespace speedflow { class SpeedRequest; class SpeedResponse; }
+
+/**
+ * Configuration for the speed estimation daemon
+ */
+struct SpeedServiceConfig {
+    std::string socket_path = "/tmp/speedflow-speedd.sock";
+    int io_threads = 0;                     // Connection threads (0 = one per core)
+    int muxer_width = 1280;                 // Normalized bboxes are scaled to this frame,
+    int muxer_height = 720;                 // the one the calibrations were prepared for
+    int max_streams_per_client = 64;        // Source ids per connection
+    size_t max_request_bytes = 4u << 20;    // Larger length prefixes close the connection
+    size_t max_pending_output = 8u << 20;   // Unsent responses before a client is no longer read
+};
+
+/**
+ * Totals over all connections
+ */
+struct SpeedServiceStats {
+    int clients = 0;                // Open connections right now
+    uint64_t requests = 0;
+    uint64_t frames = 0;
+    uint64_t objects = 0;
+    uint64_t alerts = 0;
+    uint64_t rejected = 0;          // Requests answered with an error
+};
+
+/**
+ * SpeedService - SpeedCalculator for external detectors over a Unix socket
+ *
+ * Clients send length-delimited speedflow.SpeedRequest messages, each a
+ * batch of FrameData with tracked detections, and get one SpeedResponse per
+ * request, in order, with the same frames and their speeds plus the
+ * overspeed alerts confirmed on them. Validation, filtering and alerting
+ * are the pipeline's: every client stream (one source_id on one
+ * connection) has its own SpeedCalculator, configured like speedcalc and
+ * sharing the calibrations, which are selected by source_id. All streams
+ * draw from one alert token bucket, so alert_rate_per_s and alert_burst
+ * limit the whole daemon like they limit all cameras of the pipeline.
+ *
+ * Connections are spread over io_threads epoll loops that all wait on the
+ * listening socket (EPOLLEXCLUSIVE, so a new client wakes one loop). A
+ * connection stays on the loop that accepted it, together with its
+ * streams, so every loop owns a shard of the state and requests are
+ * handled without locks. Responses that the socket does not take are
+ * buffered; once max_pending_output is reached the client is no longer read
+ * until it catches up.
+ */
+class SpeedService {
+public:
+    /**
+     * @param speed_config Settings for every stream's calculator
+     * @param transformer Default homography, may be null with a registry
+     * @param registry Prepared per-camera calibrations, may be null
+     */
+    SpeedService(const SpeedServiceConfig& config,
+                 const speedflow::SpeedConfig& speed_config,
+                 std::shared_ptr<speedflow::ViewTransformer> transformer,
+                 std::shared_ptr<const speedflow::CalibrationRegistry> registry);
+    ~SpeedService();
+    
+    bool start();
+    void stop();
+    
+    void stats(SpeedServiceStats& out) const;
+
+private:
+    // Speed state of one source on one connection
+    struct Stream {
+        std::unique_ptr<speedflow::SpeedCalculator> calculator;
+        int last_frame = INT_MIN;
+    };
+    
+    struct Connection {
+        int fd;
+        DelimitedReader input;
+        std::string output;
+        size_t sent = 0;            // Bytes of output already written
+        uint32_t events = 0;        // Registered with epoll
+        std::unordered_map<int, Stream> streams;
+    };
+    
+    struct Worker {
+        int index;
+        int epoll_fd = -1;
+        std::thread thread;
+        std::unordered_map<int, Connection> connections;
+        
+        // Written by the worker, read by stats()
+        std::atomic<int> clients{0};
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> objects{0};
+        std::atomic<uint64_t> alerts{0};
+        std::atomic<uint64_t> rejected{0};
+    };
+    
+    void runWorker(Worker& worker);
+    void acceptConnection(Worker& worker);
+    bool readConnection(Worker& worker, Connection& conn);
+    
+    /**
+     * Run one request through its streams' calculators
+     * @param response Filled with the results, or only the error
+     */
+    void handleRequest(Worker& worker, Connection& conn,
+                       const speedflow::SpeedRequest& request,
+                       speedflow::SpeedResponse& response);
+    
+    bool flush(Connection& conn);
+    void updateEvents(Worker& worker, Connection& conn);
+    void closeConnection(Worker& worker, int fd);
+    
+    SpeedServiceConfig config_;
+    speedflow::SpeedConfig speed_config_;
+    std::shared_ptr<speedflow::ViewTransformer> transformer_;
+    std::shared_ptr<const speedflow::CalibrationRegistry> registry_;
+    std::shared_ptr<speedflow::AlertTokenBucket> alert_bucket_;    // All streams, as in speedcalc
+    
+    int listen_fd_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_;
+};
+
+#endif // SPEED_SERVICE_H
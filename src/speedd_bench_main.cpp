@@ -0,0 +1,229 @@
+// speedd_bench_main.cpp - speedflow_speedd_bench, measures requests/s and
+// latency of a running speedflow_speedd at increasing client counts
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include "speedflow.pb.h"
+#include "../plugins/synthetic_traffic.h"
+
+struct BenchOptions {
+    std::string socket_path = "/tmp/speedflow-speedd.sock";
+    std::vector<int> client_counts = {1, 2, 4, 8, 16, 32};
+    double seconds = 5.0;               // Per client count
+    int frames_per_request = 1;
+    int density = 8;                    // Vehicle slots per frame
+};
+
+// What one client measured
+struct ClientResult {
+    bool connected = false;
+    uint64_t requests = 0;
+    uint64_t frames = 0;
+    uint64_t errors = 0;
+    std::vector<uint32_t> latencies_us;
+};
+
+void printUsage(const char* prog_name) {
+    std::cout << "Usage: " << prog_name << " [options]\n"
+              << "\nOptions:\n"
+              << "  --socket <path>     speedflow_speedd socket (default: /tmp/speedflow-speedd.sock)\n"
+              << "  --clients <n[,n...]> Concurrent clients per step (default: 1,2,4,8,16,32)\n"
+              << "  --seconds <s>       Duration of each step (default: 5)\n"
+              << "  --frames <n>        Frames per request (default: 1)\n"
+              << "  --density <n>       Synthetic vehicles per frame (default: 8)\n"
+              << "  --help              Show this help message\n"
+              << "\nEvery client is one stream with its own synthetic traffic and keeps one\n"
+              << "request in flight (send, wait for the response, repeat).\n"
+              << std::endl;
+}
+
+static int connectTo(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * One closed-loop client
+ * @param ready Counted up once connected (or failed)
+ * @param start Set when all clients are ready
+ * @param stop Set when the step is over
+ */
+static void runClient(const BenchOptions& options, int index, std::atomic<int>& ready,
+                      const std::atomic<bool>& start, const std::atomic<bool>& stop,
+                      ClientResult& result) {
+    int fd = connectTo(options.socket_path);
+    result.connected = fd >= 0;
+    ready++;
+    if (fd < 0) {
+        return;
+    }
+    
+    speedflow::SyntheticTrafficConfig traffic_config;
+    traffic_config.density = options.density;
+    traffic_config.seed = static_cast<uint32_t>(index + 1);
+    speedflow::SyntheticTraffic traffic(traffic_config);
+    const float width = static_cast<float>(traffic_config.frame_width);
+    const float height = static_cast<float>(traffic_config.frame_height);
+    
+    google::protobuf::io::FileInputStream input(fd);
+    speedflow::SpeedRequest request;
+    speedflow::SpeedResponse response;
+    std::vector<speedflow::SyntheticDetection> detections;
+    int64_t frame_number = 0;
+    
+    while (!start) {
+        std::this_thread::yield();
+    }
+    
+    while (!stop) {
+        request.Clear();
+        request.set_request_id(result.requests);
+        for (int f = 0; f < options.frames_per_request; f++, frame_number++) {
+            traffic.generate(frame_number, detections);
+            speedflow::FrameData* frame = request.add_frames();
+            frame->set_frame_number(static_cast<int32_t>(frame_number));
+            frame->set_ntp_timestamp(frame_number * 40000000);
+            for (const auto& det : detections) {
+                speedflow::ObjectInfo* obj = frame->add_objects();
+                obj->set_track_id(static_cast<int32_t>(det.track_id));
+                obj->set_class_id(det.class_id);
+                obj->set_confidence(det.confidence);
+                obj->set_bbox_x(det.left / width);
+                obj->set_bbox_y(det.top / height);
+                obj->set_bbox_w(det.width / width);
+                obj->set_bbox_h(det.height / height);
+            }
+        }
+        
+        auto sent = std::chrono::steady_clock::now();
+        bool clean_eof = false;
+        if (!google::protobuf::util::SerializeDelimitedToFileDescriptor(request, fd) ||
+            !google::protobuf::util::ParseDelimitedFromZeroCopyStream(&response, &input, &clean_eof)) {
+            result.errors++;
+            break;
+        }
+        auto latency = std::chrono::steady_clock::now() - sent;
+        
+        result.requests++;
+        result.frames += options.frames_per_request;
+        result.errors += response.error().empty() ? 0 : 1;
+        result.latencies_us.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+    }
+    close(fd);
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--socket" && i + 1 < argc) {
+                options.socket_path = argv[++i];
+            } else if (arg == "--clients" && i + 1 < argc) {
+                options.client_counts.clear();
+                std::stringstream list(argv[++i]);
+                std::string count;
+                while (std::getline(list, count, ',')) {
+                    options.client_counts.push_back(std::max(1, std::stoi(count)));
+                }
+            } else if (arg == "--seconds" && i + 1 < argc) {
+                options.seconds = std::stod(argv[++i]);
+            } else if (arg == "--frames" && i + 1 < argc) {
+                options.frames_per_request = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--density" && i + 1 < argc) {
+                options.density = std::max(1, std::stoi(argv[++i]));
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << std::endl;
+        return 1;
+    }
+    
+    std::cout << "[Bench] " << options.socket_path << ": " << options.frames_per_request
+              << " frame(s) per request, " << options.density << " vehicles per frame, "
+              << options.seconds << " s per step\n"
+              << "\n clients  requests/s    frames/s   p50 ms   p99 ms   max ms  errors" << std::endl;
+    
+    // New connections every step, so each starts with fresh streams
+    for (int clients : options.client_counts) {
+        std::atomic<int> ready(0);
+        std::atomic<bool> start(false);
+        std::atomic<bool> stop(false);
+        std::vector<ClientResult> results(clients);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < clients; i++) {
+            threads.emplace_back(runClient, std::cref(options), i, std::ref(ready),
+                                 std::cref(start), std::cref(stop), std::ref(results[i]));
+        }
+        while (ready < clients) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        
+        auto started = std::chrono::steady_clock::now();
+        start = true;
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+        stop = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        
+        uint64_t requests = 0;
+        uint64_t frames = 0;
+        uint64_t errors = 0;
+        std::vector<uint32_t> latencies;
+        for (const ClientResult& result : results) {
+            if (!result.connected) {
+                std::cerr << "[Bench] Cannot connect to " << options.socket_path << std::endl;
+                return 1;
+            }
+            requests += result.requests;
+            frames += result.frames;
+            errors += result.errors;
+            latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            return latencies.empty() ? 0.0
+                : latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))] / 1000.0;
+        };
+        
+        char line[160];
+        snprintf(line, sizeof(line), "%8d %11.0f %11.0f %8.3f %8.3f %8.3f %7llu",
+                 clients, requests / elapsed, frames / elapsed, percentile(0.50), percentile(0.99),
+                 latencies.empty() ? 0.0 : latencies.back() / 1000.0,
+                 static_cast<unsigned long long>(errors));
+        std::cout << line << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+// speedd_main.cpp - speedflow_speedd, serves the speed logic to external
+// detectors and trackers over a Unix domain socket
+
+#include <iostream>
+#include <csignal>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "config_loader.h"
+#include "speed_service.h"
+
+static std::atomic<bool> g_stop(false);
+
+void signalHandler(int) {
+    g_stop = true;
+}
+
+void printUsage(const char* prog_name) {
+    std::cout << "Usage: " << prog_name << " [options]\n"
+              << "\nOptions:\n"
+              << "  --config <path>     Pipeline config YAML: speed settings, calibrations and\n"
+              << "                      the muxer size bboxes are scaled to (default: configs/pipeline.yml)\n"
+              << "  --socket <path>     Unix socket to listen on (default: /tmp/speedflow-speedd.sock)\n"
+              << "  --threads <n>       Connection threads (default: one per core)\n"
+              << "  --max-streams <n>   Source ids per client connection (default: 64)\n"
+              << "  --report <s>        Throughput log interval in seconds, 0 = off (default: 10)\n"
+              << "  --help              Show this help message\n"
+              << "\nClients send length-delimited speedflow.SpeedRequest messages (see proto/speedflow.proto)\n"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    SpeedServiceConfig service_config;
+    std::string config_path = "configs/pipeline.yml";
+    int report_interval_s = 10;
+    
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--config" && i + 1 < argc) {
+                config_path = argv[++i];
+            } else if (arg == "--socket" && i + 1 < argc) {
+                service_config.socket_path = argv[++i];
+            } else if (arg == "--threads" && i + 1 < argc) {
+                service_config.io_threads = std::stoi(argv[++i]);
+            } else if (arg == "--max-streams" && i + 1 < argc) {
+                service_config.max_streams_per_client = std::stoi(argv[++i]);
+            } else if (arg == "--report" && i + 1 < argc) {
+                report_interval_s = std::stoi(argv[++i]);
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << std::endl;
+        return 1;
+    }
+    
+    // Same speed settings and calibrations as the pipeline's speedcalc
+    std::unique_ptr<SpeedService> service;
+    try {
+        PipelineConfig config = ConfigLoader::loadPipelineConfig(config_path);
+        service_config.muxer_width = config.muxer_width;
+        service_config.muxer_height = config.muxer_height;
+        
+        std::shared_ptr<speedflow::ViewTransformer> transformer;
+        if (!config.homography_config_path.empty()) {
+            HomographyConfig homo_config = ConfigLoader::loadHomographyConfig(
+                config.homography_config_path, config.muxer_width, config.muxer_height);
+            transformer = std::make_shared<speedflow::ViewTransformer>(
+                homo_config.source_points, homo_config.target_points);
+        }
+        
+        std::shared_ptr<speedflow::CalibrationRegistry> registry;
+        if (!config.calibration_dir.empty()) {
+            registry = ConfigLoader::loadCalibrationDirectory(config.calibration_dir);
+            registry->prepare(config.muxer_width, config.muxer_height);
+            std::cout << "[Main] Calibration registry ready: " << registry->size() << " cameras"
+                      << std::endl;
+        } else if (!transformer) {
+            std::cerr << "No homography_config or calibration_dir configured" << std::endl;
+            return 1;
+        }
+        
+        service = std::make_unique<SpeedService>(service_config, ConfigLoader::speedConfig(config),
+                                                 transformer, registry);
+    } catch (const std::exception& e) {
+        std::cerr << "[Main] " << e.what() << std::endl;
+        return 1;
+    }
+    
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    
+    if (!service->start()) {
+        return 1;
+    }
+    
+    std::cout << "[Main] Running... (Press Ctrl+C to stop)" << std::endl;
+    SpeedServiceStats last;
+    auto last_report = std::chrono::steady_clock::now();
+    while (!g_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - last_report).count();
+        if (report_interval_s <= 0 || seconds < report_interval_s) {
+            continue;
+        }
+        SpeedServiceStats stats;
+        service->stats(stats);
+        std::cout << "[Main] " << stats.clients << " clients: "
+                  << static_cast<uint64_t>((stats.requests - last.requests) / seconds) << " requests/s, "
+                  << static_cast<uint64_t>((stats.frames - last.frames) / seconds) << " frames/s, "
+                  << static_cast<uint64_t>((stats.objects - last.objects) / seconds) << " objects/s, "
+                  << (stats.alerts - last.alerts) << " alerts, "
+                  << (stats.rejected - last.rejected) << " rejected" << std::endl;
+        last = stats;
+        last_report = now;
+    }
+    
+    std::cout << "\n[Main] Shutting down..." << std::endl;
+    SpeedServiceStats stats;
+    service->stats(stats);
+    service->stop();
+    std::cout << "[Main] " << stats.requests << " requests, " << stats.frames << " frames, "
+              << stats.alerts << " alerts, " << stats.rejected << " rejected" << std::endl;
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "state_checkpointer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+StateCheckpointer::StateCheckpointer(std::shared_ptr<speedflow::SpeedCalculator> calculator,
+                                     const std::string& path,
+                                     float interval_s)
+    : calculator_(std::move(calculator)),
+      path_(path),
+      interval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<float>(std::max(interval_s, 0.1f)))),
+      writing_(false),
+      written_(0) {
+}
+
+StateCheckpointer::~StateCheckpointer() {
+    stop();
+}
+
+int StateCheckpointer::restore() {
+    std::ifstream file(path_, std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    
+    auto restore_start = std::chrono::steady_clock::now();
+    int tracks = calculator_->restoreState(contents.str());
+    auto restore_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - restore_start).count();
+    
+    if (tracks < 0) {
+        std::cerr << "[StateCheckpointer] Ignoring invalid checkpoint " << path_ << std::endl;
+        return 0;
+    }
+    std::cout << "[StateCheckpointer] Restored " << tracks << " tracks from " << path_
+              << " (" << contents.str().size() << " bytes) in " << restore_ms << " ms" << std::endl;
+    return tracks;
+}
+
+bool StateCheckpointer::start() {
+    if (running_) {
+        return true;
+    }
+    
+    running_ = true;
+    next_checkpoint_ = std::chrono::steady_clock::now() + interval_;
+    thread_ = std::thread(&StateCheckpointer::run, this);
+    
+    std::cout << "[StateCheckpointer] Checkpointing track state to " << path_ << std::endl;
+    return true;
+}
+
+void StateCheckpointer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    // The pipeline is stopped, so the calculator can be read from here
+    std::string data;
+    calculator_->captureState(snapshot_);
+    writeState(snapshot_, data);
+    
+    std::cout << "[StateCheckpointer] Stopped: " << written_.load() << " checkpoints written"
+              << std::endl;
+}
+
+void StateCheckpointer::onFrame(const speedflow::FrameResult&) {
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_checkpoint_ || writing_.load(std::memory_order_acquire)) {
+        return;
+    }
+    next_checkpoint_ = now + interval_;
+    
+    calculator_->captureState(snapshot_);
+    writing_.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(pending_, snapshot_);
+        has_pending_ = true;
+    }
+    cv_.notify_one();
+}
+
+void StateCheckpointer::run() {
+    speedflow::CheckpointState state;
+    std::string data;
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return has_pending_ || !running_; });
+            if (!has_pending_) {
+                return;
+            }
+            std::swap(state, pending_);
+            has_pending_ = false;
+        }
+        
+        writeState(state, data);
+        writing_.store(false, std::memory_order_release);
+    }
+}
+
+void StateCheckpointer::writeState(const speedflow::CheckpointState& state, std::string& data) {
+    speedflow::SpeedCalculator::serializeState(state, data);
+    if (writeFile(data)) {
+        written_++;
+    }
+}
+
+bool StateCheckpointer::writeFile(const std::string& data) {
+    // Write aside and rename, so a crash leaves the previous checkpoint intact
+    std::string tmp_path = path_ + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[StateCheckpointer] Cannot open " << tmp_path << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t n = ::write(fd, data.data() + offset, data.size() - offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "[StateCheckpointer] Write failed: " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    
+    bool ok = ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        std::cerr << "[StateCheckpointer] Cannot replace " << path_ << ": "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
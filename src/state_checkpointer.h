@@ -0,0 +1,81 @@
+#ifndef STATE_CHECKPOINTER_H
+#define STATE_CHECKPOINTER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../plugins/result_sink.h"
+#include "../plugins/speed_calculator.h"
+
+/**
+ * StateCheckpointer - Periodic checkpoints of the SpeedCalculator track state
+ *
+ * Registered as a result sink so it runs on the speedcalc streaming thread,
+ * the only thread that touches the calculator: once per interval onFrame()
+ * copies the track state (SpeedCalculator::captureState) and hands the copy
+ * to a writer thread, which serializes it, writes <path>.tmp, fdatasync()s
+ * it and renames it over <path>. The two copies are swapped back and forth,
+ * so in steady state a checkpoint allocates nothing on the streaming thread.
+ * A checkpoint still being written makes the next one wait.
+ *
+ * restore() loads the checkpoint back into the calculator before the
+ * pipeline starts; stop() writes a final one after it stopped, so a planned
+ * restart resumes with the state of the last frame.
+ */
+class StateCheckpointer : public speedflow::ResultSink {
+public:
+    /**
+     * @param calculator Calculator whose state is saved (and restored)
+     * @param path Checkpoint file
+     * @param interval_s Time between checkpoints
+     */
+    StateCheckpointer(std::shared_ptr<speedflow::SpeedCalculator> calculator,
+                      const std::string& path,
+                      float interval_s);
+    ~StateCheckpointer() override;
+    
+    /**
+     * Load the checkpoint file into the calculator, if there is one
+     * @return Number of tracks restored (0 without a usable checkpoint)
+     */
+    int restore();
+    
+    bool start();
+    
+    /** Stop the writer and save a final checkpoint; call after the pipeline stopped */
+    void stop();
+    
+    void onFrame(const speedflow::FrameResult& frame) override;
+    
+    uint64_t writtenCount() const { return written_.load(); }
+
+private:
+    void run();
+    bool writeFile(const std::string& data);
+    
+    /** Serialize and write one captured state */
+    void writeState(const speedflow::CheckpointState& state, std::string& data);
+    
+    std::shared_ptr<speedflow::SpeedCalculator> calculator_;
+    std::string path_;
+    std::chrono::steady_clock::duration interval_;
+    std::chrono::steady_clock::time_point next_checkpoint_;
+    
+    speedflow::CheckpointState snapshot_;   // Streaming thread: captured state
+    speedflow::CheckpointState pending_;    // Handed to the writer thread
+    bool has_pending_ = false;
+    std::atomic<bool> writing_;     // Checkpoint in flight, skip the next one
+    
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+    bool running_ = false;
+    
+    std::atomic<uint64_t> written_;
+};
+
+#endif // STATE_CHECKPOINTER_H
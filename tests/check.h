@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdio>
+
+/**
+ * Minimal checks for the test executables
+ * A failed CHECK prints its location and expression and the test carries
+ * on; main() returns checkResult(), so ctest sees every failure at once.
+ */
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            checkFailures()++;                                                  \
+        }                                                                       \
+    } while (0)
+
+inline int checkResult() {
+    if (checkFailures() > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", checkFailures());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+// test_aggregator.cpp - Aggregator over loopback: two nodes send records out
+// of order within the reorder window, the merged stream comes out in
+// timestamp order with corridor source ids, and a record behind what was
+// already released is counted late and dropped
+
+#include "check.h"
+#include "aggregator.h"
+#include "speedflow.pb.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr int64_t kMs = 1000000;
+
+struct Merged {
+    int64_t ntp_timestamp;
+    int source_id;
+    bool is_alert;
+    int frame_number;
+};
+
+// Records in the order the aggregator released them (merge thread only)
+class CaptureSink : public speedflow::ResultSink {
+public:
+    void onFrame(const speedflow::FrameResult& frame) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        merged_.push_back({frame.ntp_timestamp, frame.source_id, false, frame.frame_number});
+    }
+    
+    void onAlert(const speedflow::AlertResult& alert) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        merged_.push_back({alert.ntp_timestamp, alert.source_id, true, -1});
+    }
+    
+    std::vector<Merged> merged() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return merged_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Merged> merged_;
+};
+
+// A node connection writing length-delimited NodeRecords
+class Node {
+public:
+    Node(int port, const std::string& node_id) : node_id_(node_id) {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        connected_ = connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+    
+    ~Node() { close(fd_); }
+    
+    bool connected() const { return connected_; }
+    
+    void frame(int source_id, int frame_number, int64_t ntp_timestamp) {
+        speedflow::NodeRecord record;
+        speedflow::FrameData* frame = record.mutable_frame();
+        frame->set_source_id(source_id);
+        frame->set_frame_number(frame_number);
+        frame->set_ntp_timestamp(ntp_timestamp);
+        send(record);
+    }
+    
+    void alert(int source_id, int64_t ntp_timestamp) {
+        speedflow::NodeRecord record;
+        speedflow::OverspeedAlert* alert = record.mutable_alert();
+        alert->set_source_id(source_id);
+        alert->set_track_id(1);
+        alert->set_speed_kmh(120.0f);
+        alert->set_ntp_timestamp(ntp_timestamp);
+        send(record);
+    }
+
+private:
+    void send(speedflow::NodeRecord& record) {
+        if (first_) {
+            record.set_node_id(node_id_);
+            first_ = false;
+        }
+        std::string bytes;
+        {
+            google::protobuf::io::StringOutputStream stream(&bytes);
+            google::protobuf::io::CodedOutputStream coded(&stream);
+            coded.WriteVarint32(static_cast<uint32_t>(record.ByteSizeLong()));
+            record.SerializeToCodedStream(&coded);
+        }
+        CHECK(::send(fd_, bytes.data(), bytes.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(bytes.size()));
+    }
+    
+    std::string node_id_;
+    int fd_;
+    bool connected_ = false;
+    bool first_ = true;
+};
+
+// Rollup of a node; nodes register in whatever order their threads parse
+static NodeRollup rollupOf(const Aggregator& aggregator, const std::string& node_id) {
+    std::vector<NodeRollup> rollups;
+    aggregator.rollups(rollups);
+    for (const NodeRollup& rollup : rollups) {
+        if (rollup.node_id == node_id) {
+            return rollup;
+        }
+    }
+    return NodeRollup();
+}
+
+static bool waitFor(const std::function<bool()>& done) {
+    for (int i = 0; i < 300 && !done(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return done();
+}
+
+int main() {
+    AggregatorConfig config;
+    config.port = 19400 + getpid() % 1000;
+    config.io_threads = 2;
+    config.reorder_window_ms = 300;
+    config.report_interval_s = 0;
+    Aggregator aggregator(config);
+    auto sink = std::make_shared<CaptureSink>();
+    aggregator.addSink(sink);
+    CHECK(aggregator.start());
+    
+    // Timestamps near the wall clock: the merge caps them at now + window
+    const int64_t base = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    // Node A, then node B, each out of order; B's alert shares a timestamp
+    // with a frame of A and must follow it
+    Node a(config.port, "node-a");
+    Node b(config.port, "node-b");
+    CHECK(a.connected() && b.connected());
+    a.frame(0, 0, base);
+    a.frame(0, 3, base + 30 * kMs);
+    a.frame(0, 1, base + 10 * kMs);
+    a.frame(0, 2, base + 20 * kMs);
+    b.frame(0, 1, base + 25 * kMs);
+    b.alert(0, base + 20 * kMs);
+    b.frame(0, 0, base + 5 * kMs);
+    b.frame(1, 0, base + 15 * kMs);
+    
+    CHECK(waitFor([&] { return aggregator.releasedCount() == 8; }));
+    std::vector<Merged> merged = sink->merged();
+    CHECK(merged.size() == 8);
+    for (size_t i = 1; i < merged.size(); i++) {
+        CHECK(merged[i - 1].ntp_timestamp <= merged[i].ntp_timestamp);
+    }
+    
+    // Corridor ids in order of first release: A/0 (t=0), B/0 (t=5), B/1 (t=15)
+    const std::vector<std::pair<int64_t, int>> expected = {
+        {0, 0}, {5, 1}, {10, 0}, {15, 2}, {20, 0}, {20, 1}, {25, 1}, {30, 0}};
+    for (size_t i = 0; i < merged.size() && i < expected.size(); i++) {
+        CHECK(merged[i].ntp_timestamp == base + expected[i].first * kMs);
+        CHECK(merged[i].source_id == expected[i].second);
+    }
+    CHECK(merged.size() == 8 && !merged[4].is_alert && merged[5].is_alert);
+    CHECK(merged.size() == 8 && merged[0].frame_number == 0 && merged[2].frame_number == 1 &&
+          merged[4].frame_number == 2 && merged[7].frame_number == 3);
+    
+    // Behind the merged stream: dropped and counted for its node
+    a.frame(0, 4, base + 1 * kMs);
+    b.frame(0, 2, base + 40 * kMs);
+    CHECK(waitFor([&] { return aggregator.releasedCount() == 9; }));
+    CHECK(waitFor([&] { return rollupOf(aggregator, "node-a").late == 1; }));
+    NodeRollup node_a = rollupOf(aggregator, "node-a");
+    NodeRollup node_b = rollupOf(aggregator, "node-b");
+    CHECK(node_a.frames == 4 && node_a.alerts == 0);
+    CHECK(node_b.frames == 4 && node_b.alerts == 1 && node_b.late == 0);
+    CHECK(sink->merged().size() == 9 && sink->merged().back().ntp_timestamp == base + 40 * kMs);
+    
+    aggregator.stop();
+    CHECK(aggregator.droppedCount() == 0);
+    return checkResult();
+}
@@ -0,0 +1,164 @@
+// test_checkpoint.cpp - 1000 live tracks over 4 sources checkpointed by
+// StateCheckpointer and restored into a new calculator after a restart:
+// readings resume on the first frames, and invalid checkpoints are refused
+
+#include "check.h"
+#include "speed_calculator.h"
+#include "state_checkpointer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <unistd.h>
+
+using namespace speedflow;
+using Clock = std::chrono::steady_clock;
+
+static constexpr int kVehicles = 1000;
+static constexpr int kSources = 4;
+static constexpr float kFps = 25.0f;
+
+static double millisSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Scene {
+    std::shared_ptr<ViewTransformer> to_world;
+    ViewTransformer to_image;
+    
+    Scene(const std::vector<cv::Point2f>& image, const std::vector<cv::Point2f>& world)
+        : to_world(std::make_shared<ViewTransformer>(image, world)), to_image(world, image) {}
+    
+    static float kmh(int v) { return 30.0f + v % 60; }
+    
+    // Constant speed along the road, staggered so all are on it at once
+    static cv::Point2f position(int v, double t) {
+        return {1.0f + v % 22, std::fmod(v * 0.37f, 40.0f) + kmh(v) / 3.6f * static_cast<float>(t)};
+    }
+    
+    struct Readings {
+        int valid = 0;
+        double rel_error = 0.0;
+        std::vector<int> first_frame = std::vector<int>(kVehicles, -1);
+    };
+    
+    void feed(SpeedCalculator& calc, int frame, double t, Readings& readings) const {
+        for (int s = 0; s < kSources; s++) {
+            for (int v = s; v < kVehicles; v += kSources) {
+                cv::Point2f world = position(v, t);
+                if (world.y > 119.0f) {
+                    continue;
+                }
+                cv::Point2f image = to_image.transformPoint(world);
+                SpeedMeasurement m = calc.processObject(v + 1, image.x, image.y, 5000.0f, 0.9f, frame, s);
+                if (m.is_valid) {
+                    readings.valid++;
+                    readings.rel_error += std::fabs(m.speed_kmh - kmh(v)) / kmh(v);
+                    if (readings.first_frame[v] < 0) {
+                        readings.first_frame[v] = frame;
+                    }
+                }
+            }
+            calc.endFrame(s, frame);
+        }
+    }
+};
+
+int main() {
+    char dir_template[] = "/tmp/speedflow_test_XXXXXX";
+    const std::string dir = mkdtemp(dir_template);
+    const std::string path = dir + "/tracks.ckpt";
+    
+    Scene scene({{417, 262}, {767, 269}, {1118, 433}, {181, 434}},
+                {{0, 0}, {24, 0}, {24, 120}, {0, 120}});
+    SpeedConfig config;
+    config.track_lost_frames = 75;
+    
+    // 1.5 s of traffic, so the tracks are in the middle of their windows
+    auto before = std::make_shared<SpeedCalculator>(scene.to_world, config);
+    Scene::Readings warmup;
+    const int first_frame = 1000, frames = 38;
+    for (int f = 0; f < frames; f++) {
+        scene.feed(*before, first_frame + f, f / kFps, warmup);
+    }
+    
+    // The streaming thread only copies; serializing is the writer's job
+    CheckpointState state;
+    std::string data;
+    before->captureState(state);
+    auto start = Clock::now();
+    for (int i = 0; i < 10; i++) {
+        before->captureState(state);
+    }
+    double capture_ms = millisSince(start) / 10;
+    start = Clock::now();
+    for (int i = 0; i < 10; i++) {
+        SpeedCalculator::serializeState(state, data);
+    }
+    double serialize_ms = millisSince(start) / 10;
+    std::printf("%zu tracks: captureState %.3f ms (streaming thread), serializeState %.3f ms, %zu bytes\n",
+                state.count, capture_ms, serialize_ms, data.size());
+    CHECK(state.count == kVehicles);
+    
+    // Periodic checkpoints through the writer thread, then the final one
+    {
+        StateCheckpointer checkpointer(before, path, 0.1f);
+        CHECK(checkpointer.start());
+        speedflow::FrameResult frame;
+        for (int i = 0; i < 30 && checkpointer.writtenCount() == 0; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            checkpointer.onFrame(frame);
+        }
+        CHECK(checkpointer.writtenCount() >= 1);
+        checkpointer.stop();
+    }
+    auto saved_at = Clock::now();
+    
+    // Restart: a cold calculator, and one restored from the file
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    for (bool warm : {false, true}) {
+        auto after = std::make_shared<SpeedCalculator>(scene.to_world, config);
+        if (warm) {
+            StateCheckpointer checkpointer(after, path, 1.0f);
+            CHECK(checkpointer.restore() == kVehicles);
+        }
+        
+        // The new process numbers frames from 0 again
+        double t = (frames - 1) / kFps + std::chrono::duration<double>(Clock::now() - saved_at).count();
+        Scene::Readings readings;
+        for (int f = 0; f < 60; f++) {
+            scene.feed(*after, f, t + f / kFps, readings);
+        }
+        int measured = 0;
+        double first = 0.0;
+        for (int frame : readings.first_frame) {
+            if (frame >= 0) {
+                measured++;
+                first += frame;
+            }
+        }
+        first /= std::max(measured, 1);
+        double error = readings.rel_error / std::max(readings.valid, 1);
+        std::printf("%s restart: %d/%d vehicles measured within 60 frames, first reading at frame %.1f, "
+                    "mean error %.2f%%\n", warm ? "warm" : "cold", measured, kVehicles, first, 100.0 * error);
+        if (warm) {
+            CHECK(first < 2.0);
+            CHECK(error < 0.01);
+        } else {
+            CHECK(first > 20.0);
+        }
+    }
+    
+    // Truncated, corrupted or foreign data is refused
+    SpeedCalculator refusing(scene.to_world, config);
+    CHECK(refusing.restoreState(data.substr(0, data.size() - 3)) == -1);
+    std::string corrupt = data;
+    corrupt[0] = 'X';
+    CHECK(refusing.restoreState(corrupt) == -1);
+    CHECK(refusing.restoreState(data + "x") == -1);
+    CHECK(refusing.restoreState("") == -1);
+    
+    std::filesystem::remove_all(dir);
+    return checkResult();
+}
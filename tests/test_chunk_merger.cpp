@@ -0,0 +1,270 @@
+// test_chunk_merger.cpp - ChunkMerger on synthetic chunk logs: the same
+// 10-minute recording split into 1, 2, 4 and 8 overlapping chunks merges
+// into the same measurements, alerts and trajectories, with warm-up results
+// dropped, boundary vehicles stitched and their repeated alerts removed
+
+#include "check.h"
+#include "chunk_merger.h"
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static constexpr float kFps = 25.0f;
+static constexpr int64_t kFrameNs = 40000000;
+static constexpr int64_t kEpochNs = 1714636800LL * 1000000000LL;
+static constexpr int kFrames = 15000;           // 600 s
+static constexpr double kOverlapS = 10.0;
+static constexpr int kVehicleFrames = 150;      // 6 s in view
+static constexpr int kMinTrackAge = 12;         // Frames before a chunk's track is measured
+static constexpr int kAlertAge = 20;
+
+static int64_t ntpOf(int frame) {
+    return kEpochNs + frame * kFrameNs;
+}
+
+// Vehicle k of a source enters every 2 s (source 1 half a vehicle later)
+// in one of three lanes at 45 km/h; every fourth one is overspeeding
+struct Vehicle {
+    int source;
+    int first;
+    int last;
+    float lane_x;
+    bool alerts;
+    
+    float y(int frame) const { return 0.5f * (frame - first); }
+};
+
+static std::vector<Vehicle> traffic() {
+    std::vector<Vehicle> vehicles;
+    for (int source = 0; source < 2; source++) {
+        for (int k = 0; 50 * k + 25 * source + kVehicleFrames <= kFrames; k++) {
+            int first = 50 * k + 25 * source;
+            vehicles.push_back({source, first, first + kVehicleFrames - 1, 3.5f * (k % 3), k % 4 == 0});
+        }
+    }
+    return vehicles;
+}
+
+static void append(std::ofstream& file, const speedflow::EventLogRecord& record) {
+    google::protobuf::util::SerializeDelimitedToOstream(record, &file);
+}
+
+/**
+ * What speedflow --start/--stop --event-log would log for one chunk: the
+ * chunk's tracker numbers its own tracks, measures them after kMinTrackAge
+ * frames and sees its own slightly different positions. A vehicle already
+ * in view at the chunk's boundary alerts once more after it (its filters
+ * started over), which the merger must drop.
+ */
+static void writeChunk(const std::vector<Vehicle>& vehicles, int begin, int end, int boundary,
+                       float offset_m, const std::string& dir) {
+    fs::create_directories(dir);
+    std::ofstream file(dir + "/events-00000.log", std::ios::binary | std::ios::trunc);
+    int next_id = 1;
+    for (const Vehicle& v : vehicles) {
+        int first = std::max(v.first, begin);
+        int last = std::min(v.last, end - 1);
+        if (first > last) {
+            continue;
+        }
+        const int track_id = next_id++;
+        
+        speedflow::EventLogRecord record;
+        for (int f = first + kMinTrackAge; f <= last; f++) {
+            speedflow::SpeedEvent* event = record.mutable_measurement();
+            event->set_ntp_timestamp(ntpOf(f));
+            event->set_source_id(v.source);
+            event->set_frame_number(f);
+            event->set_track_id(track_id);
+            event->set_speed_kmh(45.0f);
+            append(file, record);
+        }
+        
+        std::vector<int> alert_frames;
+        if (v.alerts && first + kAlertAge <= last) {
+            alert_frames.push_back(first + kAlertAge);
+        }
+        if (v.alerts && v.first < boundary && boundary <= last && begin < boundary) {
+            alert_frames.push_back(std::max(boundary + 5, first + kAlertAge + 1));
+        }
+        for (int f : alert_frames) {
+            if (f > last) {
+                continue;
+            }
+            speedflow::OverspeedAlert* alert = record.mutable_overspeed();
+            alert->set_ntp_timestamp(ntpOf(f));
+            alert->set_source_id(v.source);
+            alert->set_track_id(track_id);
+            alert->set_speed_kmh(95.0f);
+            append(file, record);
+        }
+        
+        // Path every 10 frames, in records of at most 8 vertices, each
+        // continuation starting at the previous record's last vertex
+        std::vector<speedflow::TrajectoryVertex> path;
+        for (int f = first; f <= last; f += 10) {
+            path.push_back({v.lane_x + offset_m, v.y(f), f});
+        }
+        if (path.back().frame != last) {
+            path.push_back({v.lane_x + offset_m, v.y(last), last});
+        }
+        for (size_t start = 0; start + 1 < path.size(); start += 7) {
+            size_t stop = std::min(path.size(), start + 8);
+            std::vector<speedflow::TrajectoryVertex> part(path.begin() + start, path.begin() + stop);
+            speedflow::TrackTrajectory* trajectory = record.mutable_trajectory();
+            trajectory->set_source_id(v.source);
+            trajectory->set_track_id(track_id);
+            trajectory->set_ntp_timestamp(ntpOf(part.back().frame));
+            trajectory->set_video_fps(kFps);
+            trajectory->set_max_error_m(0.25f);
+            trajectory->set_num_points(static_cast<uint32_t>(part.back().frame - part.front().frame + 1));
+            trajectory->set_num_vertices(static_cast<uint32_t>(part.size()));
+            speedflow::encodeTrajectory(part, *trajectory->mutable_vertices());
+            trajectory->set_complete(stop == path.size());
+            append(file, record);
+        }
+    }
+}
+
+struct Merged {
+    std::vector<std::tuple<int, int, int>> measurements;    // source, frame, track
+    std::vector<std::tuple<int, int64_t, int>> alerts;      // source, time, track
+    std::vector<std::tuple<int, int, int, int>> paths;      // source, track, first, last frame
+    int64_t last_ntp = 0;
+    bool ordered = true;
+    float worst_offset_m = 0.0f;                            // Vertex distance from the vehicle
+};
+
+static Merged readMerged(const std::string& path, const std::vector<Vehicle>& vehicles) {
+    Merged merged;
+    int fd = open(path.c_str(), O_RDONLY);
+    google::protobuf::io::FileInputStream input(fd);
+    speedflow::EventLogRecord record;
+    bool clean_eof = false;
+    std::vector<speedflow::TrajectoryVertex> vertices;
+    while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&record, &input, &clean_eof)) {
+        int64_t ntp = 0;
+        if (record.has_measurement()) {
+            const auto& event = record.measurement();
+            ntp = event.ntp_timestamp();
+            merged.measurements.push_back({event.source_id(), event.frame_number(), event.track_id()});
+        } else if (record.has_overspeed()) {
+            const auto& alert = record.overspeed();
+            ntp = alert.ntp_timestamp();
+            merged.alerts.push_back({alert.source_id(), alert.ntp_timestamp(), alert.track_id()});
+        } else if (record.has_trajectory()) {
+            const auto& trajectory = record.trajectory();
+            ntp = trajectory.ntp_timestamp();
+            CHECK(trajectory.complete() && speedflow::decodeTrajectory(trajectory.vertices(), vertices));
+            CHECK(vertices.size() == trajectory.num_vertices() && vertices.size() >= 2);
+            if (vertices.size() < 2) {
+                continue;
+            }
+            merged.paths.push_back({trajectory.source_id(), trajectory.track_id(),
+                                    vertices.front().frame, vertices.back().frame});
+            
+            // The vehicle with this source and first frame: every vertex on it
+            for (const Vehicle& v : vehicles) {
+                if (v.source != trajectory.source_id() || v.first != vertices.front().frame) {
+                    continue;
+                }
+                for (size_t i = 0; i < vertices.size(); i++) {
+                    CHECK(i == 0 || vertices[i].frame > vertices[i - 1].frame);
+                    float dy = vertices[i].y - v.y(vertices[i].frame);
+                    float dx = vertices[i].x - v.lane_x;
+                    merged.worst_offset_m = std::max(merged.worst_offset_m, std::hypot(dx, dy));
+                }
+            }
+        }
+        merged.ordered = merged.ordered && ntp >= merged.last_ntp;
+        merged.last_ntp = ntp;
+    }
+    close(fd);
+    CHECK(clean_eof);
+    return merged;
+}
+
+int main() {
+    char dir_template[] = "/tmp/speedflow_test_XXXXXX";
+    const std::string dir = mkdtemp(dir_template);
+    const std::vector<Vehicle> vehicles = traffic();
+    
+    Merged baseline;
+    for (int chunks : {1, 2, 4, 8}) {
+        // Chunk i owns [i D/N, (i+1) D/N) and starts kOverlapS earlier
+        ChunkMergeConfig config;
+        config.video_fps = kFps;
+        config.media_epoch_ns = kEpochNs;
+        ChunkMerger merger(config);
+        const double duration_s = kFrames / kFps;
+        int expected_duplicates = 0;
+        for (int i = 0; i < chunks; i++) {
+            ChunkLog log;
+            log.own_start_s = duration_s * i / chunks;
+            log.own_stop_s = i + 1 < chunks ? duration_s * (i + 1) / chunks : 0.0;
+            log.dir = dir + "/chunks-" + std::to_string(chunks) + "/chunk-" + std::to_string(i);
+            int boundary = static_cast<int>(std::lround(log.own_start_s * kFps));
+            int begin = std::max(0, static_cast<int>(std::lround((log.own_start_s - kOverlapS) * kFps)));
+            int end = log.own_stop_s > 0.0 ? static_cast<int>(std::lround(log.own_stop_s * kFps)) : kFrames;
+            writeChunk(vehicles, begin, end, boundary, 0.2f * (i % 2), log.dir);
+            CHECK(merger.addChunk(log));
+            for (const Vehicle& v : vehicles) {
+                expected_duplicates += i > 0 && v.alerts && v.first < boundary &&
+                                       std::max(boundary + 5, v.first + kAlertAge + 1) <= v.last;
+            }
+        }
+        
+        const std::string path = dir + "/merged-" + std::to_string(chunks) + ".log";
+        auto start = std::chrono::steady_clock::now();
+        CHECK(merger.write(path));
+        double merge_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const ChunkMergeStats& stats = merger.stats();
+        Merged merged = readMerged(path, vehicles);
+        
+        std::printf("%d chunk(s): %llu measurements, %llu alerts, %llu trajectories, %llu stitched, "
+                    "%llu warm-up dropped, %llu duplicate alerts, merge %.0f ms\n",
+                    chunks, static_cast<unsigned long long>(stats.measurements),
+                    static_cast<unsigned long long>(stats.alerts),
+                    static_cast<unsigned long long>(stats.trajectories),
+                    static_cast<unsigned long long>(stats.stitched),
+                    static_cast<unsigned long long>(stats.warmup_dropped),
+                    static_cast<unsigned long long>(stats.duplicate_alerts), merge_ms);
+        
+        CHECK(merged.ordered);
+        CHECK(merged.worst_offset_m <= 0.2f + 0.01f);
+        CHECK(merged.paths.size() == vehicles.size());
+        CHECK(static_cast<int>(stats.duplicate_alerts) == expected_duplicates);
+        if (chunks == 1) {
+            baseline = merged;
+            CHECK(stats.stitched == 0 && stats.warmup_dropped == 0);
+            continue;
+        }
+        
+        // Boundary vehicles of both sources stitched (never across sources,
+        // whose traffic is the same), the result identical to one chunk
+        int crossing = 0;
+        for (int i = 1; i < chunks; i++) {
+            int boundary = static_cast<int>(std::lround(duration_s * i / chunks * kFps));
+            for (const Vehicle& v : vehicles) {
+                crossing += v.first < boundary && v.last >= boundary;
+            }
+        }
+        CHECK(static_cast<int>(stats.stitched) == crossing);
+        CHECK(stats.warmup_dropped > 0);
+        CHECK(merged.measurements == baseline.measurements);
+        CHECK(merged.alerts == baseline.alerts);
+        CHECK(merged.paths == baseline.paths);
+    }
+    
+    fs::remove_all(dir);
+    return checkResult();
+}
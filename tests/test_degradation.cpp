@@ -0,0 +1,199 @@
+// test_degradation.cpp - Work shed under speedcalc's per-buffer budget:
+// tracks deferred in a sustained burst come due spread over
+// max_deferred_frames + 1 frames, their speeds stay exact through the
+// interpolated gaps, DegradationBudget's stages, and the per-buffer time of
+// a traffic burst with and without a budget
+
+#include "check.h"
+#include "speed_calculator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace speedflow;
+using Clock = std::chrono::steady_clock;
+
+static constexpr float kFps = 25.0f;
+
+struct Scene {
+    std::shared_ptr<ViewTransformer> to_world;
+    ViewTransformer to_image;
+    
+    Scene()
+        : to_world(std::make_shared<ViewTransformer>(road(), world())), to_image(world(), road()) {}
+    
+    static std::vector<cv::Point2f> road() { return {{417, 262}, {767, 269}, {1118, 433}, {181, 434}}; }
+    static std::vector<cv::Point2f> world() { return {{0, 0}, {24, 0}, {24, 120}, {0, 120}}; }
+    
+    // Below the speed limit, so no alert is ever pending
+    static float kmh(int v) { return 30.0f + v % 25; }
+    
+    static cv::Point2f position(int v, int frame) {
+        return {1.0f + (v % 220) * 0.1f, std::fmod(v * 0.37f, 60.0f) + kmh(v) / 3.6f * frame / kFps};
+    }
+    
+    cv::Point2f image(int v, int frame) const { return to_image.transformPoint(position(v, frame)); }
+};
+
+static int64_t microsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+/**
+ * speedcalc's loop over one single-frame buffer, with its DegradationBudget
+ * @return Time spent on the buffer in microseconds
+ */
+struct BudgetLoop {
+    int64_t budget_us;
+    DegradationBudget budget;
+    
+    int64_t run(SpeedCalculator& calc, const Scene& scene, int vehicles, int frame) {
+        auto start = Clock::now();
+        Degradation stage = budget.beginBuffer(budget_us);
+        calc.setDegradation(stage);
+        for (int v = 0; v < vehicles; v++) {
+            if (budget.canRise()) {
+                Degradation now = budget.update(microsSince(start));
+                if (now != stage) {
+                    stage = now;
+                    calc.setDegradation(stage);
+                }
+            }
+            cv::Point2f p = scene.image(v, frame);
+            if (calc.acceptsObject(2, p.x, p.y, 0) &&
+                !(stage >= Degradation::ZoneOnly && calc.shedObject(v + 1, p.x, p.y, 0, frame))) {
+                calc.processObject(v + 1, p.x, p.y, 5000.0f, 0.9f, frame, 0);
+            }
+        }
+        auto tail_start = Clock::now();
+        calc.endFrame(0, frame);
+        budget.addTail(microsSince(tail_start));
+        calc.countDegradedBuffer(budget.endBuffer());
+        return microsSince(start);
+    }
+};
+
+int main() {
+    Scene scene;
+    SpeedConfig config;
+    config.reassociation = false;
+    
+    // 600 measured tracks, then every object past the budget: each frame
+    // updates about a third of them, none waits more than 2 frames, and the
+    // interpolated positions keep the speeds exact
+    {
+        const int vehicles = 600;
+        SpeedCalculator calc(scene.to_world, config);
+        int frame = 0;
+        for (; frame < 40; frame++) {
+            for (int v = 0; v < vehicles; v++) {
+                cv::Point2f p = scene.image(v, frame);
+                calc.processObject(v + 1, p.x, p.y, 5000.0f, 0.9f, frame, 0);
+            }
+            calc.endFrame(0, frame);
+        }
+        
+        calc.setDegradation(Degradation::DeferTracks);
+        std::vector<int> waited(vehicles, 0);
+        int most = 0, fewest = vehicles, longest_wait = 0, valid = 0;
+        double rel_error = 0.0;
+        for (; frame < 70; frame++) {
+            int updated = 0;
+            for (int v = 0; v < vehicles; v++) {
+                cv::Point2f p = scene.image(v, frame);
+                if (calc.shedObject(v + 1, p.x, p.y, 0, frame)) {
+                    longest_wait = std::max(longest_wait, ++waited[v]);
+                    continue;
+                }
+                waited[v] = 0;
+                updated++;
+                SpeedMeasurement m = calc.processObject(v + 1, p.x, p.y, 5000.0f, 0.9f, frame, 0);
+                if (m.is_valid) {
+                    valid++;
+                    rel_error += std::fabs(m.speed_kmh - Scene::kmh(v)) / Scene::kmh(v);
+                }
+            }
+            calc.endFrame(0, frame);
+            most = std::max(most, updated);
+            fewest = std::min(fewest, updated);
+        }
+        rel_error /= std::max(valid, 1);
+        std::printf("sustained DeferTracks, %d tracks: %d-%d updated per frame, longest wait %d frames, "
+                    "mean error %.2f%%\n", vehicles, fewest, most, longest_wait, 100.0 * rel_error);
+        CHECK(most <= vehicles / 3 + vehicles / 20);
+        CHECK(fewest >= vehicles / 3 - vehicles / 20);
+        CHECK(longest_wait <= config.max_deferred_frames);
+        CHECK(valid > 0 && rel_error < 0.01);
+        CHECK(calc.degradationStats().tracks_deferred > 0);
+    }
+    
+    // Stage thresholds at 1/2, 3/4 and all of the budget; a buffer starts
+    // one stage below the previous one's and the previous tail counts
+    {
+        CHECK(DegradationBudget::stageFor(49, 100) == Degradation::None);
+        CHECK(DegradationBudget::stageFor(50, 100) == Degradation::SkipMedian);
+        CHECK(DegradationBudget::stageFor(75, 100) == Degradation::ZoneOnly);
+        CHECK(DegradationBudget::stageFor(100, 100) == Degradation::DeferTracks);
+        
+        DegradationBudget budget;
+        CHECK(budget.beginBuffer(100) == Degradation::None);
+        CHECK(budget.update(80) == Degradation::ZoneOnly);
+        CHECK(budget.update(10) == Degradation::ZoneOnly);
+        budget.addTail(30);
+        CHECK(budget.endBuffer() == Degradation::ZoneOnly);
+        CHECK(budget.beginBuffer(100) == Degradation::SkipMedian);
+        CHECK(budget.update(45) == Degradation::ZoneOnly);
+        CHECK(budget.update(70) == Degradation::DeferTracks && !budget.canRise());
+        budget.endBuffer();
+        CHECK(budget.beginBuffer(0) == Degradation::None && !budget.canRise());
+        CHECK(budget.endBuffer() == Degradation::None);
+        CHECK(budget.beginBuffer(100) == Degradation::None && budget.update(40) == Degradation::None);
+    }
+    
+    // Tracks with a pending alert are never deferred
+    {
+        SpeedCalculator calc(scene.to_world, config);
+        cv::Point2f start = scene.to_image.transformPoint({12.0f, 10.0f});
+        calc.processObject(1, start.x, start.y, 5000.0f, 0.9f, 0, 0);
+        int frame = 1;
+        for (; frame < 40 && calc.getLastSpeed(1) < config.speed_limit_kmh; frame++) {
+            cv::Point2f p = scene.to_image.transformPoint({12.0f, 10.0f + 100.0f / 3.6f * frame / kFps});
+            calc.processObject(1, p.x, p.y, 5000.0f, 0.9f, frame, 0);
+        }
+        calc.setDegradation(Degradation::DeferTracks);
+        cv::Point2f p = scene.to_image.transformPoint({12.0f, 10.0f + 100.0f / 3.6f * frame / kFps});
+        for (int f = frame; f < frame + 3; f++) {
+            CHECK(!calc.shedObject(1, p.x, p.y, 0, f));
+        }
+    }
+    
+    // A burst from 100 to 1500 vehicles for 2 s: per-buffer time without a
+    // budget, and with one of about the calm scene's cost. The burst's first
+    // buffers are over any budget (new tracks are never deferred); after
+    // them the budget holds, endFrame included
+    for (int64_t budget_us : {int64_t(0), int64_t(100), int64_t(200)}) {
+        SpeedCalculator calc(scene.to_world, config);
+        BudgetLoop loop{budget_us, {}};
+        std::vector<int64_t> calm, burst;
+        int64_t first_burst_us = 0;
+        for (int frame = 0; frame < 150; frame++) {
+            int vehicles = frame >= 50 && frame < 100 ? 1500 : 100;
+            int64_t us = loop.run(calc, scene, vehicles, frame);
+            if (frame == 50) {
+                first_burst_us = us;
+            } else if (frame > 52 && frame < 100) {
+                burst.push_back(us);
+            } else if (frame >= 10 && frame < 50) {
+                calm.push_back(us);
+            }
+        }
+        std::sort(calm.begin(), calm.end());
+        std::sort(burst.begin(), burst.end());
+        std::printf("budget %3lld us: calm p50 %lld us, burst first buffer %lld us, then p50 %lld / max %lld us\n",
+                    static_cast<long long>(budget_us), static_cast<long long>(calm[calm.size() / 2]),
+                    static_cast<long long>(first_burst_us), static_cast<long long>(burst[burst.size() / 2]),
+                    static_cast<long long>(burst.back()));
+    }
+    
+    return checkResult();
+}
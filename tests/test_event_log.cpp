@@ -0,0 +1,149 @@
+// test_event_log.cpp - EventLogWriter files on disk: a restart after a crash
+// truncates the torn tail of the newest file back to its last complete
+// record and appends after it, and files rotate once they reach
+// max_file_bytes
+
+#include "check.h"
+#include "event_log_writer.h"
+#include "speedflow.pb.h"
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static std::vector<fs::path> logFiles(const std::string& dir) {
+    std::vector<fs::path> logs;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        logs.push_back(entry.path());
+    }
+    std::sort(logs.begin(), logs.end());
+    return logs;
+}
+
+// Track ids of the alerts in a log file, in order; clean_eof false if it
+// does not end on a record boundary
+static std::vector<int> readAlerts(const fs::path& path, bool& clean_eof) {
+    std::vector<int> track_ids;
+    int fd = open(path.c_str(), O_RDONLY);
+    google::protobuf::io::FileInputStream input(fd);
+    speedflow::EventLogRecord record;
+    clean_eof = false;
+    while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&record, &input, &clean_eof)) {
+        CHECK(record.has_overspeed());
+        track_ids.push_back(record.overspeed().track_id());
+    }
+    close(fd);
+    return track_ids;
+}
+
+static void alert(EventLogWriter& writer, int track_id) {
+    speedflow::AlertResult result;
+    result.source_id = 1;
+    result.frame_number = track_id;
+    result.ntp_timestamp = 1714636800LL * 1000000000LL + track_id * 40000000LL;
+    result.object.track_id = static_cast<uint64_t>(track_id);
+    result.peak_speed_kmh = 95.0f;
+    writer.onAlert(result);
+}
+
+int main() {
+    char dir_template[] = "/tmp/speedflow_test_XXXXXX";
+    const std::string dir = mkdtemp(dir_template);
+    
+    // 50 alerts, then a crash in the middle of the 51st record: the restart
+    // cuts the file back to 50 records and the next 10 follow them
+    {
+        EventLogConfig config;
+        config.dir = dir + "/recovery";
+        {
+            EventLogWriter writer(config);
+            CHECK(writer.start());
+            for (int i = 0; i < 50; i++) {
+                alert(writer, i);
+            }
+            writer.stop();
+            CHECK(writer.writtenCount() == 50);
+        }
+        std::vector<fs::path> logs = logFiles(config.dir);
+        CHECK(logs.size() == 1);
+        const uintmax_t complete_bytes = fs::file_size(logs[0]);
+        
+        speedflow::EventLogRecord torn;
+        torn.mutable_overspeed()->set_track_id(50);
+        torn.mutable_overspeed()->set_timestamp("2024-05-02T08:00:02.000Z");
+        std::string bytes;
+        google::protobuf::io::StringOutputStream output(&bytes);
+        google::protobuf::util::SerializeDelimitedToZeroCopyStream(torn, &output);
+        {
+            std::ofstream file(logs[0], std::ios::binary | std::ios::app);
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size() / 2));
+        }
+        CHECK(fs::file_size(logs[0]) > complete_bytes);
+        
+        {
+            EventLogWriter writer(config);
+            CHECK(writer.start());
+            CHECK(fs::file_size(logs[0]) == complete_bytes);
+            for (int i = 50; i < 60; i++) {
+                alert(writer, i);
+            }
+            writer.stop();
+        }
+        CHECK(logFiles(config.dir) == logs);
+        bool clean_eof = false;
+        std::vector<int> track_ids = readAlerts(logs[0], clean_eof);
+        CHECK(clean_eof);
+        CHECK(track_ids.size() == 60);
+        for (size_t i = 0; i < track_ids.size(); i++) {
+            CHECK(track_ids[i] == static_cast<int>(i));
+        }
+    }
+    
+    // 20 batches of 20 alerts with a 2 KB limit: the writer rotates after
+    // the batch that reaches the limit, so every file but the newest holds at
+    // least max_file_bytes, and no alert is lost or torn
+    {
+        EventLogConfig config;
+        config.dir = dir + "/rotation";
+        config.max_file_bytes = 2048;
+        EventLogWriter writer(config);
+        CHECK(writer.start());
+        for (int batch = 0; batch < 20; batch++) {
+            for (int i = 0; i < 20; i++) {
+                alert(writer, batch * 20 + i);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        writer.stop();
+        
+        std::vector<fs::path> logs = logFiles(config.dir);
+        std::printf("rotation: %zu files for %llu alerts\n", logs.size(),
+                    static_cast<unsigned long long>(writer.writtenCount()));
+        CHECK(logs.size() >= 2);
+        std::vector<int> track_ids;
+        for (size_t f = 0; f < logs.size(); f++) {
+            if (f + 1 < logs.size()) {
+                CHECK(fs::file_size(logs[f]) >= config.max_file_bytes);
+            }
+            bool clean_eof = false;
+            std::vector<int> file_ids = readAlerts(logs[f], clean_eof);
+            CHECK(clean_eof);
+            track_ids.insert(track_ids.end(), file_ids.begin(), file_ids.end());
+        }
+        CHECK(track_ids.size() == 400);
+        for (size_t i = 0; i < track_ids.size(); i++) {
+            CHECK(track_ids[i] == static_cast<int>(i));
+        }
+    }
+    
+    fs::remove_all(dir);
+    return checkResult();
+}
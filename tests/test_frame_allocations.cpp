@@ -0,0 +1,96 @@
+// test_frame_allocations.cpp - the per-frame path allocates nothing in
+// steady state: SpeedCalculator updates of known tracks, FrameDataPublisher
+// and EventLogWriter (including their background threads)
+
+#include "check.h"
+#include "speed_calculator.h"
+#include "frame_publisher.h"
+#include "event_log_writer.h"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <unistd.h>
+
+static std::atomic<long> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static constexpr int kVehicles = 12;
+
+int main() {
+    char dir_template[] = "/tmp/speedflow_test_XXXXXX";
+    const std::string dir = mkdtemp(dir_template);
+    
+    // 0.05 m per pixel, road along the image y axis
+    std::vector<cv::Point2f> source = {{0, 0}, {480, 0}, {480, 2400}, {0, 2400}};
+    std::vector<cv::Point2f> target = {{0, 0}, {24, 0}, {24, 120}, {0, 120}};
+    speedflow::SpeedCalculator calc(std::make_shared<speedflow::ViewTransformer>(source, target));
+    
+    FrameDataPublisher publisher(dir + "/frames.bin", 256);
+    EventLogConfig log_config;
+    log_config.dir = dir + "/events";
+    EventLogWriter event_log(log_config);
+    CHECK(publisher.start());
+    CHECK(event_log.start());
+    
+    speedflow::FrameResult frame;
+    frame.source_id = 0;
+    frame.objects.resize(kVehicles);
+    
+    // The same vehicles the whole time, wrapping around the 100 m of road
+    auto run = [&](int first, int count) {
+        for (int f = first; f < first + count; f++) {
+            for (int v = 0; v < kVehicles; v++) {
+                float y_m = std::fmod(v * 8.0f + f * (10.0f + v) / 25.0f, 100.0f) + 10.0f;
+                float cx = 40.0f + 30.0f * v;
+                speedflow::SpeedMeasurement m =
+                    calc.processObject(v + 1, cx, y_m * 20.0f, 4000.0f, 0.9f, f, 0);
+                speedflow::ObjectResult& obj = frame.objects[v];
+                obj.track_id = static_cast<uint64_t>(v + 1);
+                obj.class_id = 2;
+                obj.confidence = 0.9f;
+                obj.bbox_x = cx / 480.0f;
+                obj.bbox_y = y_m / 120.0f;
+                obj.bbox_w = 0.05f;
+                obj.bbox_h = 0.05f;
+                obj.speed_kmh = calc.getLastSpeed(v + 1);
+                obj.is_valid = m.is_valid;
+                obj.is_overspeeding = m.is_overspeeding;
+            }
+            calc.endFrame(0, f);
+            frame.frame_number = f;
+            frame.ntp_timestamp = static_cast<int64_t>(f) * 40000000;
+            publisher.onFrame(frame);
+            event_log.onFrame(frame);
+            usleep(200);    // Let the writer threads keep up, as at a real frame rate
+        }
+    };
+    
+    // Warm up: tracks, windows, pools and batch buffers reach their sizes
+    run(0, 2000);
+    usleep(200000);
+    
+    long before = g_allocations.load();
+    run(2000, 5000);
+    usleep(300000);
+    long allocations = g_allocations.load() - before;
+    std::printf("allocations over 5000 steady-state frames of %d objects: %ld\n", kVehicles, allocations);
+    CHECK(allocations == 0);
+    
+    publisher.stop();
+    event_log.stop();
+    std::filesystem::remove_all(dir);
+    return checkResult();
+}
@@ -0,0 +1,204 @@
+// test_iou_tracker.cpp - IouTracker assignment: greedy against Hungarian on
+// a contested pair, class gating, coasting and constant-velocity
+// prediction, unique ids under random load, and the id-switch rate and
+// update time on synthetic traffic
+
+#include "check.h"
+#include "iou_tracker.h"
+#include "synthetic_traffic.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+
+using namespace speedflow;
+
+static IouTrackerConfig makeConfig(TrackerMatching matching, float max_center_dist) {
+    IouTrackerConfig config;
+    config.matching = matching;
+    config.max_center_dist = max_center_dist;
+    return config;
+}
+
+struct TrafficResult {
+    long switches = 0;
+    long vehicles = 0;
+    size_t detections = 0;
+    double mean_ms = 0.0;
+};
+
+// Synthetic traffic side by side in tiles of 16 lanes, detections jittered
+// and some missed; a switch is a vehicle whose id changes
+static TrafficResult runTraffic(TrackerMatching matching, int tiles, float jitter, float miss, int frames) {
+    std::vector<SyntheticTraffic> traffic;
+    for (int k = 0; k < tiles; k++) {
+        SyntheticTrafficConfig config;
+        config.frame_width = 1920;
+        config.frame_height = 1080;
+        config.density = 16;
+        config.lanes = 16;
+        config.seed = 7 + k;
+        traffic.emplace_back(config);
+    }
+    
+    IouTracker tracker(makeConfig(matching, 0.5f));
+    std::mt19937 rng(1);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::vector<SyntheticDetection> generated;
+    std::vector<TrackerBox> boxes;
+    std::vector<uint64_t> truth, ids;
+    std::unordered_map<uint64_t, uint64_t> last_id;
+    TrafficResult result;
+    double total_ms = 0.0;
+    
+    for (int f = 0; f < frames; f++) {
+        boxes.clear();
+        truth.clear();
+        for (int k = 0; k < tiles; k++) {
+            traffic[k].generate(f, generated);
+            for (const auto& d : generated) {
+                if (uniform(rng) < miss) {
+                    continue;
+                }
+                float j = jitter * d.width;
+                boxes.push_back({d.left + k * 2000.0f + j * normal(rng), d.top + j * normal(rng),
+                                 d.width * (1.0f + 0.5f * jitter * normal(rng)),
+                                 d.height * (1.0f + 0.5f * jitter * normal(rng)), d.class_id});
+                truth.push_back(d.track_id + (static_cast<uint64_t>(k) << 32));
+            }
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        tracker.update(0, boxes, ids);
+        total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.detections += boxes.size();
+        
+        for (size_t i = 0; i < ids.size(); i++) {
+            auto it = last_id.find(truth[i]);
+            if (it == last_id.end()) {
+                last_id[truth[i]] = ids[i];
+                result.vehicles++;
+            } else if (it->second != ids[i]) {
+                result.switches++;
+                it->second = ids[i];
+            }
+        }
+    }
+    result.mean_ms = total_ms / frames;
+    return result;
+}
+
+int main() {
+    std::vector<uint64_t> ids;
+    
+    // Two tracks and two detections where the best single pair (d1-A) costs
+    // the other detection its match: greedy takes it, Hungarian maximizes
+    // the total IoU and keeps both tracks
+    for (TrackerMatching matching : {TrackerMatching::Greedy, TrackerMatching::Hungarian}) {
+        IouTracker tracker(makeConfig(matching, 0.0f));
+        tracker.update(0, {{0, 0, 100, 100, 2}, {60, 0, 100, 100, 2}}, ids);
+        uint64_t a = ids[0], b = ids[1];
+        tracker.update(0, {{20, 0, 100, 100, 2}, {-35, 0, 100, 100, 2}}, ids);
+        if (matching == TrackerMatching::Greedy) {
+            CHECK(ids[0] == a && ids[1] != a && ids[1] != b);
+        } else {
+            CHECK(ids[0] == b && ids[1] == a);
+        }
+    }
+    
+    // Never across classes, unless match_class is off
+    for (bool match_class : {true, false}) {
+        IouTrackerConfig config;
+        config.match_class = match_class;
+        IouTracker tracker(config);
+        tracker.update(0, {{0, 0, 100, 100, 2}}, ids);
+        uint64_t first = ids[0];
+        tracker.update(0, {{5, 0, 100, 100, 7}}, ids);
+        CHECK((ids[0] == first) == !match_class);
+    }
+    
+    // A vehicle speeding up to 60 px/frame (IoU 0.25 with its last box, below
+    // min_iou): kept by the velocity prediction, through a 3-frame gap, and
+    // given a new id after max_age_frames
+    {
+        IouTrackerConfig config = makeConfig(TrackerMatching::Greedy, 0.0f);
+        config.max_age_frames = 5;
+        IouTracker tracker(config);
+        tracker.update(0, {{0, 0, 100, 100, 2}}, ids);
+        uint64_t id = ids[0];
+        float x = 0.0f;
+        for (float step : {30.0f, 40.0f, 50.0f, 60.0f, 60.0f, 60.0f, 60.0f}) {
+            x += step;
+            tracker.update(0, {{x, 0, 100, 100, 2}}, ids);
+            CHECK(ids[0] == id);
+        }
+        for (int f = 0; f < 3; f++) {
+            tracker.update(0, {}, ids);
+        }
+        x += 4 * 60.0f;
+        tracker.update(0, {{x, 0, 100, 100, 2}}, ids);
+        CHECK(ids[0] == id);
+        for (int f = 0; f < 6; f++) {
+            tracker.update(0, {}, ids);
+        }
+        CHECK(tracker.trackCount() == 0);
+        tracker.update(0, {{x, 0, 100, 100, 2}}, ids);
+        CHECK(ids[0] != id);
+    }
+    
+    // Streams are independent, ids unique across them
+    {
+        IouTracker tracker;
+        tracker.update(0, {{0, 0, 100, 100, 2}}, ids);
+        uint64_t first = ids[0];
+        tracker.update(1, {{0, 0, 100, 100, 2}}, ids);
+        CHECK(ids[0] != first);
+        tracker.removeSource(1);
+        CHECK(tracker.trackCount() == 1);
+    }
+    
+    // Random crowded boxes over three streams: never one id for two
+    // detections of a frame
+    for (TrackerMatching matching : {TrackerMatching::Greedy, TrackerMatching::Hungarian}) {
+        IouTracker tracker(makeConfig(matching, 0.5f));
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> uniform(0.0f, 1000.0f);
+        std::vector<TrackerBox> boxes;
+        int duplicates = 0;
+        for (int f = 0; f < 2000; f++) {
+            boxes.clear();
+            int n = rng() % 60;
+            for (int i = 0; i < n; i++) {
+                boxes.push_back({uniform(rng), uniform(rng) * 0.5f, 40 + uniform(rng) * 0.1f, 40,
+                                 static_cast<int>(rng() % 2)});
+            }
+            tracker.update(f % 3, boxes, ids);
+            std::vector<uint64_t> sorted = ids;
+            std::sort(sorted.begin(), sorted.end());
+            duplicates += std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end();
+        }
+        CHECK(duplicates == 0);
+    }
+    
+    // Id switches with jitter and missed detections, and the update time
+    // at about 50, 200 and 1000 detections per frame
+    for (TrackerMatching matching : {TrackerMatching::Greedy, TrackerMatching::Hungarian}) {
+        const char* name = matching == TrackerMatching::Greedy ? "greedy" : "hungarian";
+        TrafficResult clean = runTraffic(matching, 1, 0.0f, 0.0f, 3000);
+        TrafficResult noisy = runTraffic(matching, 1, 0.02f, 0.1f, 3000);
+        std::printf("%-9s id switches: %.2f%% clean, %.2f%% with 2%% jitter and 10%% missed (%ld vehicles)\n",
+                    name, 100.0 * clean.switches / clean.vehicles, 100.0 * noisy.switches / noisy.vehicles,
+                    noisy.vehicles);
+        CHECK(clean.switches == 0);
+        CHECK(noisy.switches <= noisy.vehicles / 20);
+        
+        for (int tiles : {4, 16, 80}) {
+            TrafficResult timed = runTraffic(matching, tiles, 0.02f, 0.05f, 300);
+            std::printf("%-9s %6.1f detections/frame: %.3f ms per update\n",
+                        name, static_cast<double>(timed.detections) / 300, timed.mean_ms);
+        }
+    }
+    
+    return checkResult();
+}
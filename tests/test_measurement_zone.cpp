@@ -0,0 +1,74 @@
+// test_measurement_zone.cpp - MeasurementZone edge functions for convex,
+// concave and degenerate quadrilaterals, and the speedcalc prefilter that
+// is on by default
+
+#include "check.h"
+#include "measurement_zone.h"
+#include "speed_calculator.h"
+
+using speedflow::MeasurementZone;
+
+// Accepts every point, as an unusable zone must
+static bool acceptsAll(const MeasurementZone& zone) {
+    return zone.contains(-1e6f, -1e6f) && zone.contains(1e6f, 1e6f) && zone.contains(0.0f, 0.0f);
+}
+
+int main() {
+    // Convex road trapezoid (a calibration's SOURCE points), both windings
+    std::vector<cv::Point2f> road = {{417, 262}, {767, 269}, {1118, 433}, {181, 434}};
+    std::vector<cv::Point2f> reversed(road.rbegin(), road.rend());
+    for (const auto& polygon : {road, reversed}) {
+        MeasurementZone zone(polygon);
+        CHECK(zone.valid());
+        CHECK(zone.contains(600, 350));
+        CHECK(zone.contains(417, 262));         // Corner
+        CHECK(zone.contains(649.5f, 433.5f));   // On the bottom edge
+        CHECK(!zone.contains(600, 250));        // Above the far edge
+        CHECK(!zone.contains(190, 300));        // Left of the slanted edge, inside the bounding box
+        CHECK(!zone.contains(600, 440));        // Below
+        CHECK(zone.contains(600, 440, 10.0f));  // Within the margin
+        CHECK(!zone.contains(5000, 350, 10.0f));
+    }
+    
+    // Edge values are distances: the margin grows the zone by that many pixels
+    MeasurementZone square({{0, 0}, {100, 0}, {100, 100}, {0, 100}});
+    CHECK(square.valid());
+    CHECK(!square.contains(105, 50, 4.0f) && square.contains(105, 50, 6.0f));
+    CHECK(!square.contains(50, -5, 4.0f) && square.contains(50, -5, 6.0f));
+    
+    // Collinear corner: still convex (a triangle), so still a zone
+    MeasurementZone triangle({{0, 0}, {50, 0}, {100, 0}, {0, 100}});
+    CHECK(triangle.valid() && triangle.contains(20, 20) && !triangle.contains(80, 80));
+    
+    // Concave (dart) and self-intersecting (bow tie): not from a usable
+    // homography, accept everything
+    MeasurementZone dart({{0, 0}, {100, 50}, {0, 100}, {40, 50}});
+    CHECK(!dart.valid() && acceptsAll(dart));
+    MeasurementZone bow_tie({{417, 262}, {1118, 433}, {767, 269}, {181, 434}});
+    CHECK(!bow_tie.valid() && acceptsAll(bow_tie));
+    
+    // Degenerate: zero area, repeated corner, wrong corner count, default
+    MeasurementZone line({{0, 0}, {10, 10}, {20, 20}, {30, 30}});
+    CHECK(!line.valid() && acceptsAll(line));
+    MeasurementZone repeated({{0, 0}, {0, 0}, {100, 0}, {0, 100}});
+    CHECK(!repeated.valid() && acceptsAll(repeated));
+    MeasurementZone three({{0, 0}, {100, 0}, {0, 100}});
+    CHECK(!three.valid() && acceptsAll(three));
+    CHECK(acceptsAll(MeasurementZone()));
+    
+    // measurement_zone defaults to on: objects outside the quadrilateral get
+    // no speed unless it is turned off
+    std::vector<cv::Point2f> target = {{0, 0}, {24, 0}, {24, 120}, {0, 120}};
+    auto transformer = std::make_shared<speedflow::ViewTransformer>(road, target);
+    speedflow::SpeedConfig config;
+    CHECK(config.zone_filter);
+    speedflow::SpeedCalculator filtered(transformer, config);
+    CHECK(filtered.acceptsObject(2, 600, 350, 0));
+    CHECK(!filtered.acceptsObject(2, 600, 250, 0));
+    CHECK(filtered.objectsRejected() == 1);
+    config.zone_filter = false;
+    speedflow::SpeedCalculator unfiltered(transformer, config);
+    CHECK(unfiltered.acceptsObject(2, 600, 250, 0));
+    
+    return checkResult();
+}
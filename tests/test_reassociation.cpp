@@ -0,0 +1,198 @@
+// test_reassociation.cpp - Re-association of new tracker ids with lost
+// tracks on an identity homography (image pixels are meters): a vehicle
+// hidden for 1-8 frames that returns under a new id keeps its speed and
+// alert, neighbours keep their own tracks, a checkpoint taken while it is
+// hidden still re-associates it, and the reading coverage of random traffic
+// with id switches
+
+#include "check.h"
+#include "speed_calculator.h"
+#include <cmath>
+#include <random>
+
+using namespace speedflow;
+
+static constexpr float kFps = 25.0f;
+
+static std::shared_ptr<ViewTransformer> identity() {
+    std::vector<cv::Point2f> square = {{0, 0}, {24, 0}, {24, 120}, {0, 120}};
+    return std::make_shared<ViewTransformer>(square, square);
+}
+
+static SpeedConfig makeConfig(bool reassociation) {
+    SpeedConfig config;
+    config.reassociation = reassociation;
+    return config;
+}
+
+// A vehicle driving up lane x at kmh, starting at y = 2 m on frame 0
+struct Vehicle {
+    float x;
+    float kmh;
+    
+    float y(int frame) const { return 2.0f + kmh / 3.6f / kFps * frame; }
+};
+
+struct Return {
+    int first_valid = -1;           // Frames after the return, -1 = none
+    float speed_kmh = 0.0f;         // First valid reading after the return
+    int alerts = 0;
+};
+
+/**
+ * Vehicles seen as track id v+1 for 40 frames, hidden for gap frames and
+ * back as id v+101 for 30 frames (or frames [frame_from, frame_to) of that)
+ */
+static Return hideAndReturn(SpeedCalculator& calc, const std::vector<Vehicle>& vehicles, int gap,
+                            int frame_from = 0, int frame_to = -1) {
+    Return result;
+    if (frame_to < 0) {
+        frame_to = 40 + gap + 30;
+    }
+    for (int f = frame_from; f < frame_to; f++) {
+        bool returned = f >= 40 + gap;
+        for (size_t v = 0; v < vehicles.size(); v++) {
+            if (f >= 40 && !returned) {
+                continue;
+            }
+            int track_id = static_cast<int>(v) + (returned ? 101 : 1);
+            SpeedMeasurement m = calc.processObject(track_id, vehicles[v].x, vehicles[v].y(f),
+                                                    5000.0f, 0.9f, f, 0);
+            result.alerts += m.alert;
+            if (v == 0 && returned && m.is_valid && result.first_valid < 0) {
+                result.first_valid = f - (40 + gap);
+                result.speed_kmh = m.speed_kmh;
+            }
+        }
+        calc.endFrame(0, f);
+    }
+    return result;
+}
+
+int main() {
+    const SpeedConfig config = makeConfig(true);
+    
+    // Hidden 1-8 frames: the new id has a reading on its third frame (two
+    // positions for a velocity, matched at that endFrame), without
+    // re-association only once its window filled again
+    for (int gap = 1; gap <= 8; gap++) {
+        for (bool reassociation : {true, false}) {
+            SpeedCalculator calc(identity(), makeConfig(reassociation));
+            Return r = hideAndReturn(calc, {{5.0f, 54.0f}}, gap);
+            if (reassociation) {
+                CHECK(calc.trackStats().reassociated == 1);
+                CHECK(r.first_valid == 2);
+                CHECK(std::fabs(r.speed_kmh - 54.0f) < 1.0f);
+            } else {
+                CHECK(calc.trackStats().reassociated == 0);
+                CHECK(r.first_valid >= config.min_track_age_frames);
+            }
+        }
+    }
+    
+    // Gone longer than reassoc_max_gap_frames: a new vehicle
+    {
+        SpeedCalculator calc(identity(), config);
+        Return r = hideAndReturn(calc, {{5.0f, 54.0f}}, config.reassoc_max_gap_frames + 1);
+        CHECK(calc.trackStats().reassociated == 0 && r.first_valid >= config.min_track_age_frames);
+    }
+    
+    // An overspeeding vehicle alerts once, not again under its new id
+    for (bool reassociation : {true, false}) {
+        SpeedCalculator calc(identity(), makeConfig(reassociation));
+        Return r = hideAndReturn(calc, {{5.0f, 90.0f}}, 4);
+        CHECK(r.alerts == (reassociation ? 1 : 2));
+    }
+    
+    // Three lanes 3.5 m apart, all hidden together: each new id continues
+    // its own lane's track (speeds differ less than the velocity gate)
+    {
+        SpeedCalculator calc(identity(), config);
+        std::vector<Vehicle> lanes = {{5.0f, 50.0f}, {1.5f, 58.0f}, {8.5f, 42.0f}};
+        Return r = hideAndReturn(calc, lanes, 5);
+        CHECK(calc.trackStats().reassociated == 3);
+        CHECK(r.first_valid == 2 && std::fabs(r.speed_kmh - 50.0f) < 1.0f);
+        for (size_t v = 0; v < lanes.size(); v++) {
+            CHECK(std::fabs(calc.getLastSpeed(static_cast<int>(v) + 101) - lanes[v].kmh) < 1.0f);
+        }
+    }
+    
+    // Checkpointed while hidden: the restored track has its velocity and is
+    // re-associated after the restart
+    {
+        SpeedCalculator before(identity(), config);
+        hideAndReturn(before, {{5.0f, 54.0f}}, 6, 0, 43);
+        std::string data;
+        before.saveState(data);
+        SpeedCalculator after(identity(), config);
+        CHECK(after.restoreState(data) == 1);
+        Return r = hideAndReturn(after, {{5.0f, 54.0f}}, 6, 43);
+        CHECK(after.trackStats().reassociated == 1);
+        CHECK(r.first_valid == 2 && std::fabs(r.speed_kmh - 54.0f) < 1.0f);
+    }
+    
+    // Three lanes of random traffic at 43-108 km/h with 0.1 m jitter; a
+    // visible vehicle is hidden with probability 1% per frame for 1-8 frames
+    // and returns under a new id. Share of frames past 30 m with a reading,
+    // and readings off by more than 10 km/h
+    for (bool reassociation : {false, true}) {
+        SpeedConfig traffic_config = makeConfig(reassociation);
+        traffic_config.alert_burst = 1000000;
+        SpeedCalculator calc(identity(), traffic_config);
+        std::mt19937 rng(7);
+        std::normal_distribution<float> jitter(0.0f, 0.1f);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        struct Car { float x, y, mps; int id, hidden; };
+        std::vector<Car> cars;
+        int next_id = 1;
+        uint64_t visible = 0, valid = 0, wrong = 0;
+        for (int f = 0; f < 10000; f++) {
+            if (f % 8 == 0) {
+                for (int lane = 0; lane < 3; lane++) {
+                    cars.push_back({3.5f * lane + 1.5f, 0.0f, 12.0f + 18.0f * uniform(rng), next_id++, 0});
+                }
+            }
+            for (Car& car : cars) {
+                car.y += car.mps / kFps;
+                if (car.y > 119.0f) {
+                    continue;
+                }
+                if (car.hidden > 0) {
+                    if (--car.hidden == 0) {
+                        car.id = next_id++;
+                    }
+                    continue;
+                }
+                if (uniform(rng) < 0.01f) {
+                    car.hidden = 1 + static_cast<int>(rng() % 8);
+                    continue;
+                }
+                SpeedMeasurement m = calc.processObject(car.id, car.x + jitter(rng), car.y + jitter(rng),
+                                                        5000.0f + 50.0f * car.y, 0.9f, f, 0);
+                if (car.y > 30.0f) {
+                    visible++;
+                    if (m.is_valid) {
+                        valid++;
+                        wrong += std::fabs(m.speed_kmh - car.mps * 3.6f) > 10.0f;
+                    }
+                }
+            }
+            calc.endFrame(0, f);
+            if (cars.size() > 200) {
+                cars.erase(cars.begin(), cars.begin() + 100);
+            }
+        }
+        double coverage = 100.0 * valid / visible;
+        std::printf("re-association %-3s: readings on %.1f%% of frames past 30 m, %.3f%% off by >10 km/h, "
+                    "%llu ids re-associated\n", reassociation ? "on" : "off", coverage,
+                    100.0 * wrong / std::max<uint64_t>(valid, 1),
+                    static_cast<unsigned long long>(calc.trackStats().reassociated));
+        CHECK(wrong * 100 < valid);
+        if (reassociation) {
+            CHECK(calc.trackStats().reassociated > 0);
+            CHECK(coverage > 95.0);
+        }
+    }
+    
+    return checkResult();
+}
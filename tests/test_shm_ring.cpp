@@ -0,0 +1,76 @@
+// test_shm_ring.cpp - ShmRingWriter/ShmRingReader: ordered reads, overrun
+// detection, and readers noticing a closed or replaced ring
+
+#include "check.h"
+#include "shm_ring.h"
+#include "shm_ring_writer.h"
+#include <string>
+#include <unistd.h>
+
+using speedflow::shm::FrameRecord;
+using speedflow::shm::ShmRingReader;
+
+static void publish(ShmRingWriter& writer, int frame_number) {
+    speedflow::FrameResult frame;
+    frame.source_id = 1;
+    frame.frame_number = frame_number;
+    frame.ntp_timestamp = frame_number;
+    frame.objects.resize(2);
+    for (auto& obj : frame.objects) {
+        obj = speedflow::ObjectResult{};
+        obj.track_id = static_cast<uint64_t>(frame_number);
+    }
+    writer.onFrame(frame);
+}
+
+int main() {
+    const std::string name = "/speedflow_test_ring_" + std::to_string(getpid());
+    FrameRecord record;
+    
+    // Records arrive in order, then the reader is caught up
+    ShmRingWriter writer(name, 8);
+    CHECK(writer.open());
+    ShmRingReader reader;
+    CHECK(!reader.open(name + "_missing"));
+    CHECK(reader.next(record) == ShmRingReader::Status::Closed);
+    CHECK(reader.open(name));
+    for (int i = 0; i < 5; i++) {
+        publish(writer, i);
+    }
+    for (int i = 0; i < 5; i++) {
+        CHECK(reader.next(record) == ShmRingReader::Status::Ok);
+        CHECK(record.frame_number == i && record.num_objects == 2 &&
+              record.objects[0].track_id == static_cast<uint64_t>(i));
+    }
+    CHECK(reader.next(record) == ShmRingReader::Status::Empty);
+    
+    // Lapped: the cursor jumps forward and the loss is counted
+    for (int i = 5; i < 25; i++) {
+        publish(writer, i);
+    }
+    CHECK(reader.next(record) == ShmRingReader::Status::Overrun);
+    CHECK(reader.lostRecords() > 0);
+    CHECK(record.frame_number == 4);        // Untouched unless Ok
+    int last = -1;
+    while (reader.next(record) == ShmRingReader::Status::Ok) {
+        CHECK(record.frame_number > last);
+        last = record.frame_number;
+    }
+    CHECK(last == 24);
+    
+    // A new writer replaces the ring while the old one is still open (a
+    // restart after a crash): readers of the old segment are told to reopen
+    ShmRingWriter replacement(name, 8);
+    CHECK(replacement.open());
+    CHECK(reader.next(record) == ShmRingReader::Status::Closed);
+    CHECK(reader.open(name));
+    publish(replacement, 100);
+    CHECK(reader.next(record) == ShmRingReader::Status::Ok && record.frame_number == 100);
+    
+    // A clean close is seen on the next poll
+    replacement.close();
+    CHECK(reader.next(record) == ShmRingReader::Status::Closed);
+    CHECK(!reader.open(name));
+    
+    return checkResult();
+}
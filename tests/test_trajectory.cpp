@@ -0,0 +1,227 @@
+// test_trajectory.cpp - TrajectorySimplifier error bound, encode/decode
+// round trip through EventLogWriter, and no trajectory left allocated when
+// a writer is destroyed with events still queued
+
+#include "check.h"
+#include "trajectory.h"
+#include "event_log_writer.h"
+#include "speedflow.pb.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <random>
+#include <sstream>
+
+static std::atomic<long> g_live_allocations{0};
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    g_live_allocations.fetch_add(1, std::memory_order_relaxed);
+    return p;
+}
+
+static void release(void* p) {
+    if (p) {
+        g_live_allocations.fetch_sub(1, std::memory_order_relaxed);
+    }
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+
+// Quantization to centimeters, both axes at their worst
+static const float kQuantizationM = 0.005f * std::sqrt(2.0f);
+
+// A vehicle changing lanes while braking, with jitter; negative x on purpose
+static std::vector<speedflow::TrajectoryVertex> drive(int first_frame, int frames, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> jitter(0.0f, 0.05f);
+    std::vector<speedflow::TrajectoryVertex> points;
+    float y = 5.0f, v = 1.2f;
+    for (int f = 0; f < frames; f++) {
+        float x = -1.75f + 3.5f / (1.0f + std::exp(-(f - frames / 2) * 0.08f));
+        y += v;
+        v = std::max(0.3f, v - 0.002f);
+        points.push_back({x + jitter(rng), y + jitter(rng), first_frame + f});
+    }
+    return points;
+}
+
+// Largest distance from an input position to the polyline at the same frame
+static float maxDeviation(const std::vector<speedflow::TrajectoryVertex>& points,
+                          const std::vector<speedflow::TrajectoryVertex>& polyline) {
+    float worst = 0.0f;
+    size_t seg = 0;
+    for (const auto& p : points) {
+        while (seg + 2 < polyline.size() && polyline[seg + 1].frame < p.frame) {
+            seg++;
+        }
+        const auto& a = polyline[seg];
+        const auto& b = polyline[seg + 1];
+        float t = b.frame > a.frame ? float(p.frame - a.frame) / float(b.frame - a.frame) : 0.0f;
+        float dx = a.x + (b.x - a.x) * t - p.x;
+        float dy = a.y + (b.y - a.y) * t - p.y;
+        worst = std::max(worst, std::sqrt(dx * dx + dy * dy));
+    }
+    return worst;
+}
+
+// Simplify in batches of max_vertices as speedcalc does, encode each batch
+static std::vector<speedflow::Trajectory> simplify(const std::vector<speedflow::TrajectoryVertex>& points,
+                                                   float max_error_m, size_t max_vertices) {
+    speedflow::TrajectorySimplifier simplifier(max_error_m, max_vertices);
+    std::vector<speedflow::Trajectory> out;
+    auto emit = [&](bool finish) {
+        speedflow::Trajectory trajectory;
+        trajectory.track_id = 7;
+        trajectory.video_fps = 25.0f;
+        trajectory.max_error_m = max_error_m;
+        trajectory.num_points = simplifier.pointCount();
+        trajectory.complete = finish;
+        simplifier.take(trajectory.vertices, finish);
+        out.push_back(std::move(trajectory));
+    };
+    for (const auto& p : points) {
+        simplifier.add(p.x, p.y, p.frame);
+        if (simplifier.full()) {
+            emit(false);
+        }
+    }
+    emit(true);
+    return out;
+}
+
+// Trajectory records of every log file in dir, in file order
+static std::vector<speedflow::TrackTrajectory> readTrajectories(const std::string& dir) {
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        files.push_back(entry.path().string());
+    }
+    std::sort(files.begin(), files.end());
+    
+    std::vector<speedflow::TrackTrajectory> out;
+    for (const auto& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream bytes;
+        bytes << in.rdbuf();
+        std::string data = bytes.str();
+        google::protobuf::io::ArrayInputStream stream(data.data(), static_cast<int>(data.size()));
+        google::protobuf::io::CodedInputStream coded(&stream);
+        uint32_t size;
+        while (coded.ReadVarint32(&size)) {
+            auto limit = coded.PushLimit(static_cast<int>(size));
+            speedflow::EventLogRecord record;
+            if (!record.ParseFromCodedStream(&coded)) {
+                break;
+            }
+            coded.PopLimit(limit);
+            if (record.has_trajectory()) {
+                out.push_back(record.trajectory());
+            }
+        }
+    }
+    return out;
+}
+
+int main() {
+    // Codec alone: quantization only, exact frames, malformed input rejected
+    std::vector<speedflow::TrajectoryVertex> vertices = {
+        {-3.456f, 0.004f, 100}, {-3.449f, 1500.129f, 90}, {2.0f, -0.006f, 5000}, {0.0f, 0.0f, 5000}};
+    std::string encoded;
+    std::vector<speedflow::TrajectoryVertex> decoded;
+    speedflow::encodeTrajectory(vertices, encoded);
+    CHECK(speedflow::decodeTrajectory(encoded, decoded));
+    CHECK(decoded.size() == vertices.size());
+    for (size_t i = 0; i < decoded.size() && i < vertices.size(); i++) {
+        CHECK(std::fabs(decoded[i].x - vertices[i].x) <= 0.0051f);
+        CHECK(std::fabs(decoded[i].y - vertices[i].y) <= 0.0051f);
+        CHECK(decoded[i].frame == vertices[i].frame);
+    }
+    CHECK(!speedflow::decodeTrajectory(encoded.substr(0, encoded.size() - 1), decoded));
+    CHECK(speedflow::decodeTrajectory("", decoded) && decoded.empty());
+    
+    // Simplified, logged and read back: every input position stays within
+    // max_error_m plus the quantization of the decoded polyline
+    char dir_template[] = "/tmp/speedflow_test_XXXXXX";
+    const std::string dir = mkdtemp(dir_template);
+    EventLogConfig log_config;
+    log_config.dir = dir;
+    struct Case {
+        float max_error_m;
+        size_t max_vertices;
+        std::vector<speedflow::TrajectoryVertex> points;
+    };
+    std::vector<Case> cases = {
+        {0.25f, 256, drive(1000, 600, 1)},
+        {0.10f, 8, drive(0, 400, 2)},        // Split over several batches
+        {0.50f, 256, drive(-50, 2, 3)},      // Two positions only
+    };
+    std::vector<speedflow::Trajectory> sent;
+    {
+        EventLogWriter writer(log_config);
+        CHECK(writer.start());
+        for (const auto& c : cases) {
+            for (auto& trajectory : simplify(c.points, c.max_error_m, c.max_vertices)) {
+                writer.onTrajectory(trajectory);
+                sent.push_back(std::move(trajectory));
+            }
+        }
+        writer.stop();
+        CHECK(writer.writtenCount() == sent.size() && writer.droppedCount() == 0);
+    }
+    
+    std::vector<speedflow::TrackTrajectory> logged = readTrajectories(dir);
+    CHECK(logged.size() == sent.size());
+    size_t next = 0;
+    for (const auto& c : cases) {
+        std::vector<speedflow::TrajectoryVertex> polyline;
+        uint32_t points = 0;
+        for (; next < logged.size(); next++) {
+            CHECK(speedflow::decodeTrajectory(logged[next].vertices(), decoded));
+            CHECK(decoded.size() == logged[next].num_vertices());
+            CHECK(decoded.size() == sent[next].vertices.size());
+            points += logged[next].num_points();
+            // A continued batch starts at the previous batch's last vertex
+            size_t skip = !polyline.empty() && !decoded.empty() &&
+                          decoded.front().frame == polyline.back().frame;
+            polyline.insert(polyline.end(), decoded.begin() + skip, decoded.end());
+            if (logged[next].complete()) {
+                next++;
+                break;
+            }
+        }
+        CHECK(points == c.points.size());
+        CHECK(polyline.size() >= 2 && polyline.front().frame == c.points.front().frame &&
+              polyline.back().frame == c.points.back().frame);
+        float deviation = maxDeviation(c.points, polyline);
+        std::printf("max_error %.2f m, %zu points -> %zu vertices, max deviation after decoding %.4f m\n",
+                    c.max_error_m, c.points.size(), polyline.size(), deviation);
+        CHECK(deviation <= c.max_error_m + kQuantizationM + 1e-4f);
+    }
+    
+    // Never started: the queued trajectories are freed with the writer
+    speedflow::Trajectory trajectory = sent.front();
+    long before = g_live_allocations.load();
+    {
+        EventLogWriter writer(log_config);
+        for (int i = 0; i < 100; i++) {
+            writer.onTrajectory(trajectory);
+        }
+    }
+    long leaked = g_live_allocations.load() - before;
+    std::printf("allocations left after destroying a writer with 100 queued trajectories: %ld\n", leaked);
+    CHECK(leaked == 0);
+    
+    std::filesystem::remove_all(dir);
+    return checkResult();
+}